@@ -48,6 +48,7 @@ benchmarks = [
     "test_quad_tree.cpp",
     "test_noop_rendering.cpp",
     "test_getline.cpp",
+    "test_image_compositing.cpp",
 #    "test_numeric_cast_vs_static_cast.cpp",
 ]
 for cpp_test in benchmarks:
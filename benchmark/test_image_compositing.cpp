@@ -0,0 +1,114 @@
+#include "bench_framework.hpp"
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/image_compositing.hpp>
+#include <random>
+
+namespace {
+
+mapnik::image_rgba8 make_image(std::size_t size, unsigned seed)
+{
+    std::default_random_engine engine(seed);
+    std::uniform_int_distribution<unsigned> uniform_dist(0, 255);
+    mapnik::image_rgba8 im(size, size);
+    for (std::size_t y = 0; y < im.height(); ++y)
+    {
+        for (std::size_t x = 0; x < im.width(); ++x)
+        {
+            // mostly opaque or empty, with antialiased edges in between
+            unsigned a = uniform_dist(engine);
+            a = a < 96 ? 0 : (a > 160 ? 255 : a);
+            unsigned r = uniform_dist(engine) * a / 255;
+            unsigned g = uniform_dist(engine) * a / 255;
+            unsigned b = uniform_dist(engine) * a / 255;
+            im(x, y) = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+    im.set_premultiplied(true);
+    return im;
+}
+
+}
+
+class premultiply : public benchmark::test_case
+{
+    mutable mapnik::image_rgba8 im_;
+public:
+    premultiply(mapnik::parameters const& params)
+     : test_case(params),
+       im_(make_image(*params.get<mapnik::value_integer>("size", 1024), 0)) {}
+    bool validate() const
+    {
+        return true;
+    }
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            im_.set_premultiplied(false);
+            mapnik::premultiply_alpha(im_);
+        }
+        return true;
+    }
+};
+
+class demultiply : public benchmark::test_case
+{
+    mutable mapnik::image_rgba8 im_;
+public:
+    demultiply(mapnik::parameters const& params)
+     : test_case(params),
+       im_(make_image(*params.get<mapnik::value_integer>("size", 1024), 0)) {}
+    bool validate() const
+    {
+        return true;
+    }
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            im_.set_premultiplied(true);
+            mapnik::demultiply_alpha(im_);
+        }
+        return true;
+    }
+};
+
+template <mapnik::composite_mode_e Mode>
+class composite : public benchmark::test_case
+{
+    mutable mapnik::image_rgba8 dst_;
+    mapnik::image_rgba8 src_;
+    float opacity_;
+public:
+    composite(mapnik::parameters const& params)
+     : test_case(params),
+       dst_(make_image(*params.get<mapnik::value_integer>("size", 1024), 0)),
+       src_(make_image(*params.get<mapnik::value_integer>("size", 1024), 1)),
+       opacity_(static_cast<float>(*params.get<double>("opacity", 1.0))) {}
+    bool validate() const
+    {
+        return true;
+    }
+    bool operator()() const
+    {
+        for (std::size_t i = 0; i < iterations_; ++i)
+        {
+            mapnik::composite(dst_, src_, Mode, opacity_);
+        }
+        return true;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    return benchmark::sequencer(argc, argv)
+        .run<premultiply>("premultiply")
+        .run<demultiply>("demultiply")
+        .run<composite<mapnik::src_over>>("composite src-over")
+        .run<composite<mapnik::multiply>>("composite multiply")
+        .run<composite<mapnik::screen>>("composite screen")
+        .run<composite<mapnik::plus>>("composite plus")
+        .run<composite<mapnik::dst_out>>("composite dst-out")
+        .done();
+}
@@ -24,6 +24,7 @@
 #define MAPNIK_AGG_RASTERIZER_HPP
 
 // mapnik
+#include <mapnik/box2d.hpp>
 #include <mapnik/util/noncopyable.hpp>
 
 
@@ -34,7 +35,44 @@
 
 namespace mapnik {
 
-struct rasterizer :  agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>, util::noncopyable {};
+struct rasterizer :  agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>, util::noncopyable
+{
+    using base_type = agg::rasterizer_scanline_aa<agg::rasterizer_sl_clip_int_sat>;
+
+    // Hides base_type::rewind_scanlines() which agg::render_scanlines() calls
+    // before sweeping, to record the cells of every rendered path.
+    bool rewind_scanlines()
+    {
+        if (!base_type::rewind_scanlines()) return false;
+        painted_extent_.expand_to_include(box2d<int>(min_x(), min_y(), max_x() + 1, max_y() + 1));
+        return true;
+    }
+
+    // Pixels rendered since the last call to reset_painted_extent(),
+    // maximum coordinates are exclusive.
+    box2d<int> const& painted_extent() const
+    {
+        return painted_extent_;
+    }
+
+    void reset_painted_extent()
+    {
+        painted_extent_ = box2d<int>();
+    }
+
+    // Records pixels drawn into the target buffer without sweeping,
+    // like images blended straight into it.
+    void add_painted_extent(box2d<int> const& extent)
+    {
+        if (extent.valid() && extent.width() > 0 && extent.height() > 0)
+        {
+            painted_extent_.expand_to_include(extent);
+        }
+    }
+
+private:
+    box2d<int> painted_extent_;
+};
 
 }
 
@@ -36,6 +36,7 @@
 #include <mapnik/symbolizer_enumerations.hpp>
 #include <mapnik/renderer_common.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/image_pool.hpp>
 // stl
 #include <memory>
 #include <stack>
@@ -75,35 +76,51 @@ public:
     {
         if (position_ == buffers_.begin())
         {
-            buffers_.emplace_front(width_, height_);
+            buffers_.emplace_front(image_pool<T>::instance().acquire(width_, height_));
             position_ = buffers_.begin();
         }
         else
         {
             position_--;
-            mapnik::fill(*position_, 0); // fill with transparent colour
+            // only clear what was drawn by the previous user
+            clear_extent(**position_, position_->get_deleter().dirty());
+            position_->get_deleter().set_dirty(full_extent());
         }
-        return *position_;
+        return **position_;
     }
 
     void pop()
+    {
+        pop(full_extent());
+    }
+
+    // dirty is the part of the buffer drawn into since push()
+    void pop(box2d<int> const& dirty)
     {
         if (position_ != buffers_.end())
         {
+            position_->get_deleter().set_dirty(dirty);
             position_++;
         }
     }
 
     T & top() const
     {
-        return *position_;
+        return **position_;
     }
 
 private:
+    using image_ptr = typename image_pool<T>::image_ptr;
+
+    box2d<int> full_extent() const
+    {
+        return box2d<int>(0, 0, static_cast<int>(width_), static_cast<int>(height_));
+    }
+
     const std::size_t width_;
     const std::size_t height_;
-    std::deque<T> buffers_;
-    typename std::deque<T>::iterator position_;
+    std::deque<image_ptr> buffers_;
+    typename std::deque<image_ptr>::iterator position_;
 };
 
 template <typename T0, typename T1=renderer_common::detector_type>
@@ -122,11 +139,15 @@ public:
                  double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
     // pass in mapnik::request object to provide the mutable things per render
     agg_renderer(Map const& m, request const& req, attributes const& vars, buffer_type & pixmap, double scale_factor=1.0, unsigned offset_x=0, unsigned offset_y=0);
+    // create detached renderer for a single independent layer, see composite_layer()
+    agg_renderer(Map const& m, agg_renderer const& parent);
     ~agg_renderer();
     void start_map_processing(Map const& map);
     void end_map_processing(Map const& map);
     void start_layer_processing(layer const& lay, box2d<double> const& query_extent);
     void end_layer_processing(layer const& lay);
+    // finish layer rendered by detached renderer
+    void composite_layer(layer const& lay, agg_renderer & detached);
 
     void start_style_processing(feature_type_style const& st);
     void end_style_processing(feature_type_style const& st);
@@ -208,6 +229,42 @@ public:
     {
         return common_.vars_;
     }
+
+    // Number of threads used for rendering of independent layers,
+    // i.e. layers with comp-op or opacity not interacting with labels.
+    inline unsigned layer_concurrency() const
+    {
+        return layer_concurrency_;
+    }
+
+    inline void set_layer_concurrency(unsigned concurrency)
+    {
+        layer_concurrency_ = concurrency;
+    }
+
+    // Maximum number of threads used for applying image filters
+    // to a style buffer, small buffers are always filtered serially.
+    inline unsigned filter_concurrency() const
+    {
+        return filter_concurrency_;
+    }
+
+    inline void set_filter_concurrency(unsigned concurrency)
+    {
+        filter_concurrency_ = concurrency;
+    }
+
+    // Maximum number of threads used for warping a reprojected raster,
+    // small rasters are always warped serially.
+    inline unsigned raster_concurrency() const
+    {
+        return raster_concurrency_;
+    }
+
+    inline void set_raster_concurrency(unsigned concurrency)
+    {
+        raster_concurrency_ = concurrency;
+    }
 protected:
     template <typename R>
     void debug_draw_box(R& buf, box2d<double> const& extent,
@@ -218,15 +275,31 @@ protected:
 
 private:
     std::stack<std::reference_wrapper<buffer_type>> buffers_;
+    // pixels drawn into each entry of buffers_, entries sharing
+    // a buffer are merged on pop_buffer()
+    std::stack<box2d<int>> painted_extents_;
     buffer_stack<buffer_type> internal_buffers_;
-    std::unique_ptr<buffer_type> inflated_buffer_;
+    typename image_pool<buffer_type>::image_ptr inflated_buffer_;
     const std::unique_ptr<rasterizer> ras_ptr;
     gamma_method_enum gamma_method_;
     double gamma_;
     renderer_common common_;
+    unsigned layer_concurrency_;
+    unsigned filter_concurrency_;
+    unsigned raster_concurrency_;
     void setup(Map const & m, buffer_type & pixmap);
+    void push_buffer(buffer_type & buffer);
+    box2d<int> pop_buffer();
+    void mark_painted(box2d<int> extent);
+    void mark_painted();
 };
 
+#ifdef MAPNIK_THREADSAFE
+// layers are only rendered on worker threads in thread safe builds
+template <typename T0, typename T1>
+struct detached_layer_rendering<agg_renderer<T0, T1>> : std::true_type {};
+#endif
+
 extern template class MAPNIK_DECL agg_renderer<image<rgba8_t>>;
 
 } // namespace mapnik
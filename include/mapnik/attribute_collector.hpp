@@ -27,6 +27,7 @@
 #include <mapnik/transform_processor.hpp>
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/attribute.hpp>
+#include <mapnik/query.hpp>
 #include <mapnik/symbolizer.hpp>
 #include <mapnik/expression.hpp>  // for expression_ptr, etc
 #include <mapnik/expression_node.hpp>
@@ -46,6 +47,7 @@
 
 // stl
 #include <set>
+#include <algorithm>
 #include <functional> // std::ref
 
 namespace mapnik {
@@ -208,12 +210,202 @@ private:
 };
 
 
+struct expression_uses_geometry_type
+{
+    bool operator() (geometry_type_attribute const&) const
+    {
+        return true;
+    }
+
+    template <typename Tag>
+    bool operator() (binary_node<Tag> const& x) const
+    {
+        return util::apply_visitor(*this, x.left) || util::apply_visitor(*this, x.right);
+    }
+
+    template <typename Tag>
+    bool operator() (unary_node<Tag> const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    bool operator() (regex_match_node const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    bool operator() (regex_replace_node const& x) const
+    {
+        return util::apply_visitor(*this, x.expr);
+    }
+
+    template <typename T>
+    bool operator() (T const&) const
+    {
+        return false;
+    }
+};
+
+// Accumulates the geometry_requirements of the symbolizers of a layer.
+// Only properties that do not depend on the feature are taken into account.
+class geometry_requirements_collector : public util::noncopyable
+{
+public:
+    geometry_requirements_collector()
+        : empty_(true),
+          points_(true),
+          clip_(true),
+          tolerance_(-1.0) {}
+
+    void operator() (point_symbolizer const& sym)
+    {
+        add_point(sym);
+    }
+
+    void operator() (markers_symbolizer const& sym)
+    {
+        add_point(sym);
+    }
+
+    void operator() (line_symbolizer const& sym)
+    {
+        // dashes are laid out from the start of the clipped line
+        add_path(sym, !has_key(sym, keys::stroke_dasharray));
+    }
+
+    void operator() (polygon_symbolizer const& sym)
+    {
+        add_path(sym, true);
+    }
+
+    void operator() (polygon_pattern_symbolizer const& sym)
+    {
+        // local patterns are aligned to the bounding box of the geometry
+        boost::optional<pattern_alignment_enum> alignment = constant(sym, keys::alignment, GLOBAL_ALIGNMENT);
+        add_path(sym, alignment && *alignment == GLOBAL_ALIGNMENT);
+    }
+
+    void operator() (line_pattern_symbolizer const& sym)
+    {
+        add_path(sym, false);
+    }
+
+    template <typename T>
+    void operator() (T const&)
+    {
+        add(false, false, 0.0);
+    }
+
+    void operator() (expression_ptr const& filter)
+    {
+        if (filter && util::apply_visitor(expression_uses_geometry_type(), *filter))
+        {
+            add(false, false, 0.0);
+        }
+    }
+
+    geometry_requirements get() const
+    {
+        geometry_requirements requirements;
+        if (!empty_)
+        {
+            requirements.points = points_;
+            requirements.clip = clip_ && !points_;
+            requirements.tolerance = std::max(0.0, tolerance_);
+        }
+        return requirements;
+    }
+
+private:
+    template <typename T>
+    static boost::optional<T> constant(symbolizer_base const& sym, keys key, T const& default_value)
+    {
+        auto itr = sym.properties.find(key);
+        if (itr != sym.properties.end() && itr->second.template is<expression_ptr>())
+        {
+            return boost::optional<T>();
+        }
+        return mapnik::get<T>(sym, key, default_value);
+    }
+
+    // the geometry itself is only used where the symbolizer does not
+    // transform it and nothing depends on its type
+    static bool plain_geometry(symbolizer_base const& sym)
+    {
+        if (has_key(sym, keys::geometry_transform))
+        {
+            return false;
+        }
+        for (auto const& prop : sym.properties)
+        {
+            if (prop.second.is<expression_ptr>())
+            {
+                expression_ptr const& expr = prop.second.get<expression_ptr>();
+                if (expr && util::apply_visitor(expression_uses_geometry_type(), *expr))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void add_point(symbolizer_base const& sym)
+    {
+        boost::optional<label_placement_enum> placement = constant(sym, keys::label_placement, POINT_PLACEMENT);
+        boost::optional<multi_policy_enum> policy = constant(sym, keys::multipolicy, EACH_MULTI);
+        if (plain_geometry(sym) && placement && *placement == POINT_PLACEMENT &&
+            policy && *policy == EACH_MULTI)
+        {
+            // the placement moves by less than the tolerance of other symbolizers
+            empty_ = false;
+            clip_ = false;
+        }
+        else
+        {
+            add(false, false, 0.0);
+        }
+    }
+
+    void add_path(symbolizer_base const& sym, bool clip_allowed)
+    {
+        if (plain_geometry(sym))
+        {
+            boost::optional<value_bool> clip = constant(sym, keys::clip, false);
+            boost::optional<value_double> simplify = constant(sym, keys::simplify_tolerance, 0.0);
+            // datasources simplify with Douglas-Peucker, which other
+            // algorithms do not give the same result on
+            boost::optional<simplify_algorithm_e> algorithm = constant(sym, keys::simplify_algorithm, radial_distance);
+            bool same_algorithm = algorithm && *algorithm == douglas_peucker;
+            add(false, clip_allowed && clip && *clip, simplify && same_algorithm ? *simplify : 0.0);
+        }
+        else
+        {
+            add(false, false, 0.0);
+        }
+    }
+
+    void add(bool points, bool clip, double tolerance)
+    {
+        empty_ = false;
+        points_ = points_ && points;
+        clip_ = clip_ && clip;
+        tolerance_ = tolerance_ < 0.0 ? tolerance : std::min(tolerance_, tolerance);
+    }
+
+    bool empty_;
+    bool points_;
+    bool clip_;
+    double tolerance_;
+};
+
 class attribute_collector : public util::noncopyable
 {
 private:
     std::set<std::string> & names_;
     double filter_factor_;
     expression_attributes<std::set<std::string> > f_attr;
+    geometry_requirements_collector g_req_;
 public:
 
     attribute_collector(std::set<std::string>& names)
@@ -228,16 +420,23 @@ public:
         for (auto const& sym : symbols)
         {
             util::apply_visitor(std::ref(s_attr), sym);
+            util::apply_visitor(std::ref(g_req_), sym);
         }
 
         expression_ptr const& expr = r.get_filter();
         util::apply_visitor(f_attr,*expr);
+        g_req_(expr);
     }
 
     double get_filter_factor() const
     {
         return filter_factor_;
     }
+
+    geometry_requirements get_geometry_requirements() const
+    {
+        return g_req_.get();
+    }
 };
 
 
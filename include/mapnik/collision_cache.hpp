@@ -24,14 +24,16 @@
 #define MAPNIK_LABEL_COLLISION_CACHE_HPP
 
 #include <mapnik/label_collision_detector.hpp>
+#include <mapnik/collision_cache_list.hpp>
+#include <mapnik/config.hpp>
 #include <mapnik/debug.hpp>
+#include <mapnik/make_unique.hpp>
 
-#include <map>
-
-#pragma GCC diagnostic push
-#include <mapnik/warning_ignore.hpp>
-#include <boost/optional.hpp>
-#pragma GCC diagnostic pop
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 namespace mapnik
 {
@@ -39,94 +41,137 @@ namespace mapnik
 template <typename Detector>
 class keyed_collision_cache
 {
-    std::map<std::string, Detector> cache_;
+    collision_index_enum index_;
+    box2d<double> extent_;
+    // indexed by collision_cache_id, created on first insert
+    std::vector<std::unique_ptr<Detector>> cache_;
     Detector & default_;
+    // Caches named by values of expressions but not registered are kept
+    // by this cache rather than registered process wide. Their ids have
+    // local_id_bit set and index local_.
+    std::unordered_map<std::string, collision_cache_id> named_;
+    std::vector<std::unique_ptr<Detector>> local_;
+
+    static constexpr collision_cache_id local_id_bit = collision_cache_id(1) << 31;
+    // never refers to a cache, so nothing collides with it
+    static constexpr collision_cache_id unknown_id = ~collision_cache_id(0);
 
-    Detector & get(boost::optional<std::string> const & key)
+    Detector * find(collision_cache_id id) const
     {
-        if (!key)
+        if (id & local_id_bit)
         {
-            return default_;
+            id &= ~local_id_bit;
+            return id < local_.size() ? local_[id].get() : nullptr;
+        }
+        return id < cache_.size() ? cache_[id].get() : nullptr;
+    }
+
+    Detector & get(collision_cache_id id)
+    {
+        if (id & local_id_bit)
+        {
+            return *local_[id & ~local_id_bit];
         }
-        auto it = cache_.find(*key);
-        if (it != cache_.end())
+        if (id >= cache_.size())
         {
-            return it->second;
+            cache_.resize(id + 1);
         }
-        return cache_.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple(*key),
-            std::forward_as_tuple(default_.extent())).first->second;
+        std::unique_ptr<Detector> & detector = cache_[id];
+        if (!detector)
+        {
+            detector = std::make_unique<Detector>(extent_, index_);
+        }
+        return *detector;
     }
 
     template <typename Keys, typename... Args>
-    bool detect(Keys const & keys, Args... args)
+    bool detect(Keys const & keys, Args const&... args)
     {
         if (keys.empty())
         {
             return default_.has_placement(args...);
         }
-        for (auto const & key : keys)
+        for (collision_cache_id id : keys)
         {
-            auto it = cache_.find(key);
-            if (it != cache_.end())
+            Detector * detector = find(id);
+            if (detector && !detector->has_placement(args...))
             {
-                Detector & detector = it->second;
-                if (!detector.has_placement(args...))
-                {
-                    return false;
-                }
+                return false;
             }
         }
         return true;
     }
 
     template <typename Keys, typename... Args>
-    void push(Keys const & keys, Args... args)
+    void push(Keys const & keys, Args const&... args)
     {
         if (keys.empty())
         {
             return default_.insert(args...);
         }
-        for (auto const & key : keys)
+        for (collision_cache_id id : keys)
         {
-            auto it = cache_.find(key);
-            if (it == cache_.end())
-            {
-                it = cache_.emplace(
-                    std::piecewise_construct,
-                    std::forward_as_tuple(key),
-                    std::forward_as_tuple(default_.extent())).first;
-            }
-
-            Detector & detector = it->second;
-            detector.insert(args...);
+            get(id).insert(args...);
         }
     }
 
-    Detector & create_default(box2d<double> const & extent)
+public:
+    keyed_collision_cache(box2d<double> const & extent,
+                          collision_index_enum index = COLLISION_INDEX_QUAD_TREE)
+        : index_(index), extent_(extent), cache_(), default_(get(default_collision_cache_id)),
+          named_(), local_()
     {
-        auto it = cache_.emplace(
-            std::piecewise_construct,
-            std::forward_as_tuple("default"),
-            std::forward_as_tuple(extent)).first;
-        return it->second;
     }
 
-public:
-    keyed_collision_cache(box2d<double> const & extent)
-        : cache_(), default_(create_default(extent))
+    // Ids of a key list given by an expression, evaluated for each feature.
+    // Names are looked up in the registry every time, so they resolve the
+    // same as in constant lists. Names not registered are given caches of
+    // this renderer to insert into. Detection skips the names nothing has
+    // been inserted into, and also checks the cache of this renderer of a
+    // name registered only after it was inserted into.
+    collision_cache_ids evaluate(std::string const& keys, bool insert)
     {
+        collision_cache_ids ids;
+        for (std::string const& name : split_collision_detector_keys(keys))
+        {
+            boost::optional<collision_cache_id> registered = collision_cache_find(name);
+            if (registered)
+            {
+                ids.push_back(*registered);
+                if (insert || named_.empty())
+                {
+                    continue;
+                }
+            }
+            auto it = named_.find(name);
+            if (it != named_.end())
+            {
+                ids.push_back(it->second);
+            }
+            else if (insert)
+            {
+                collision_cache_id id = local_id_bit | static_cast<collision_cache_id>(local_.size());
+                local_.push_back(std::make_unique<Detector>(extent_, index_));
+                named_.emplace(name, id);
+                ids.push_back(id);
+            }
+        }
+        if (ids.empty() && !insert)
+        {
+            // an empty list would detect against the default cache
+            ids.push_back(unknown_id);
+        }
+        return ids;
     }
 
 #ifdef MAPNIK_STATS_RENDER
     ~keyed_collision_cache()
     {
-        for (auto const & pair : cache_)
+        for (auto const & detector : cache_)
         {
-            Detector const & detector = pair.second;
-            std::clog << "collision cache: nodes count: " << detector.count_items() << std::endl;
-            std::clog << "collision cache: query count: " << detector.query_count_ << std::endl;
+            if (!detector) continue;
+            std::clog << "collision cache: nodes count: " << detector->count_items() << std::endl;
+            std::clog << "collision cache: query count: " << detector->query_count_ << std::endl;
         }
     }
 #endif
@@ -159,6 +204,26 @@ public:
         return detect(keys, box, margin, text, repeat_distance);
     }
 
+    template <typename Keys>
+    bool has_placement(
+        std::vector<box2d<double>> const& boxes,
+        double margin,
+        Keys const & keys)
+    {
+        return detect(keys, boxes, margin);
+    }
+
+    template <typename Keys>
+    bool has_placement(
+        std::vector<box2d<double>> const& boxes,
+        double margin,
+        mapnik::value_unicode_string const& text,
+        double repeat_distance,
+        Keys const & keys)
+    {
+        return detect(keys, boxes, margin, text, repeat_distance);
+    }
+
     template <typename Keys>
     void insert(
         box2d<double> const& box,
@@ -186,27 +251,54 @@ public:
         return default_.extent();
     }
 
+    collision_index_enum index() const
+    {
+        return index_;
+    }
+
+    Detector & detector(collision_cache_id id)
+    {
+        Detector * detector = find(id);
+        if (!detector)
+        {
+            MAPNIK_LOG_ERROR(detector) << "Collision cache '" <<
+                collision_cache_name(id) << "' does not exist. Default cache is used instead.";
+            return default_;
+        }
+        return *detector;
+    }
+
     Detector & detector(std::string const & key)
     {
-        auto it = cache_.find(key);
-        if (it == cache_.end())
+        boost::optional<collision_cache_id> id = collision_cache_find(key);
+        if (!id)
+        {
+            auto it = named_.find(key);
+            if (it != named_.end())
+            {
+                return *local_[it->second & ~local_id_bit];
+            }
+        }
+        if (!id)
         {
             MAPNIK_LOG_ERROR(detector) << "Collision cache '" <<
                 key << "' does not exist. Default cache is used instead.";
             return default_;
         }
-        return it->second;
+        return detector(*id);
     }
 
-    std::vector<std::string> keys() const
+    collision_cache_ids keys() const
     {
-        std::vector<std::string> ns;
-        ns.reserve(cache_.size());
-        for (auto const & pair : cache_)
+        collision_cache_ids ids;
+        for (collision_cache_id id = 0; id < cache_.size(); ++id)
         {
-            ns.emplace_back(pair.first);
+            if (cache_[id])
+            {
+                ids.push_back(id);
+            }
         }
-        return ns;
+        return ids;
     }
 
     Detector & get_default()
@@ -215,8 +307,11 @@ public:
     }
 };
 
-std::vector<std::string> parse_collision_detector_keys(
-    boost::optional<std::string> const & keys);
+template <typename Detector>
+constexpr collision_cache_id keyed_collision_cache<Detector>::local_id_bit;
+
+template <typename Detector>
+constexpr collision_cache_id keyed_collision_cache<Detector>::unknown_id;
 
 }
 
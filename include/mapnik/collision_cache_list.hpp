@@ -0,0 +1,119 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_COLLISION_CACHE_LIST_HPP
+#define MAPNIK_COLLISION_CACHE_LIST_HPP
+
+#include <mapnik/config.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/optional.hpp>
+#pragma GCC diagnostic pop
+
+namespace mapnik
+{
+
+// Collision cache names are interned into small integer ids, so that
+// detectors can be looked up by index while placing labels.
+using collision_cache_id = std::uint32_t;
+using collision_cache_ids = std::vector<collision_cache_id>;
+
+// Id of the "default" cache used when a symbolizer lists no keys.
+constexpr collision_cache_id default_collision_cache_id = 0;
+
+// Returns the id of a cache name, registering it if not known yet.
+MAPNIK_DECL collision_cache_id collision_cache_intern(std::string const& name);
+
+MAPNIK_DECL boost::optional<collision_cache_id> collision_cache_find(std::string const& name);
+
+MAPNIK_DECL std::string const& collision_cache_name(collision_cache_id id);
+
+// Number of cache names registered so far.
+MAPNIK_DECL std::size_t collision_cache_count();
+
+// Splits a comma separated list of cache names without registering them.
+MAPNIK_DECL std::vector<std::string> split_collision_detector_keys(std::string const& keys);
+
+// Resolves a comma separated list of cache names into ids, interning
+// the names.
+MAPNIK_DECL collision_cache_ids parse_collision_detector_keys(
+    boost::optional<std::string> const & keys);
+
+// Value of the collision-cache-insert and collision-cache-detect symbolizer
+// properties given as text: the names are interned when the list is made,
+// renderers use the ids as they are.
+class MAPNIK_DECL collision_cache_list
+{
+public:
+    collision_cache_list() = default;
+    explicit collision_cache_list(std::string const& keys);
+
+    std::string const& str() const
+    {
+        return keys_;
+    }
+
+    collision_cache_ids const& ids() const
+    {
+        return ids_;
+    }
+
+    bool operator==(collision_cache_list const& rhs) const
+    {
+        return keys_ == rhs.keys_;
+    }
+
+private:
+    std::string keys_;
+    collision_cache_ids ids_;
+};
+
+template <typename charT, typename traits>
+std::basic_ostream<charT, traits> &
+operator<< (std::basic_ostream<charT, traits> & s, collision_cache_list const& list)
+{
+    return s << list.str();
+}
+
+}
+
+namespace std {
+
+template <>
+struct hash<mapnik::collision_cache_list>
+{
+    std::size_t operator()(mapnik::collision_cache_list const& list) const
+    {
+        return std::hash<std::string>()(list.str());
+    }
+};
+
+}
+
+#endif // MAPNIK_COLLISION_CACHE_LIST_HPP
@@ -0,0 +1,44 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_COLLISION_INDEX_HPP
+#define MAPNIK_COLLISION_INDEX_HPP
+
+#include <mapnik/enumeration.hpp>
+
+namespace mapnik {
+
+// Spatial index backing label_collision_detector4
+enum collision_index_enum : std::uint8_t
+{
+    // quad_tree, adapts to any label distribution. default behaviour.
+    COLLISION_INDEX_QUAD_TREE,
+    // uniform grid of fixed size cells, cheaper to query on label dense maps
+    COLLISION_INDEX_GRID,
+    collision_index_enum_MAX
+};
+
+DEFINE_ENUM( collision_index_e, collision_index_enum );
+
+}
+
+#endif // MAPNIK_COLLISION_INDEX_HPP
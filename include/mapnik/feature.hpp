@@ -92,6 +92,19 @@ using context_ptr = std::shared_ptr<context_type>;
 
 static const value default_feature_value{};
 
+// Decodes attribute values of a feature when they are first read,
+// see feature_impl::set_attribute_source
+class feature_attribute_source
+{
+public:
+    virtual ~feature_attribute_source() {}
+    // decodes the attribute at `index` into `val`, which is left
+    // untouched if there is no value
+    virtual void decode(std::size_t index, value & val) const = 0;
+};
+
+using feature_attribute_source_ptr = std::shared_ptr<feature_attribute_source const>;
+
 class MAPNIK_DECL feature_impl : private util::noncopyable
 {
     friend class feature_kv_iterator;
@@ -106,7 +119,9 @@ public:
         ctx_(ctx),
         data_(ctx_->mapping_.size()),
         geom_(geometry::geometry_empty()),
-        raster_() {}
+        raster_(),
+        source_(),
+        pending_() {}
 
     inline mapnik::value_integer id() const { return id_;}
     inline void set_id(mapnik::value_integer _id) { id_ = _id;}
@@ -129,6 +144,7 @@ public:
             && itr->second < data_.size())
         {
             data_[itr->second] = std::move(val);
+            if (itr->second < pending_.size()) pending_[itr->second] = false;
         }
         else
         {
@@ -143,6 +159,7 @@ public:
             && itr->second < data_.size())
         {
             data_[itr->second] = std::move(val);
+            if (itr->second < pending_.size()) pending_[itr->second] = false;
         }
         else
         {
@@ -169,7 +186,10 @@ public:
     inline value_type const& get(std::size_t index) const
     {
         if (index < data_.size())
+        {
+            if (index < pending_.size() && pending_[index]) decode(index);
             return data_[index];
+        }
         return default_feature_value;
     }
 
@@ -180,12 +200,26 @@ public:
 
     inline cont_type const& get_data() const
     {
+        for (std::size_t index = 0; index < pending_.size(); ++index)
+        {
+            if (pending_[index]) decode(index);
+        }
         return data_;
     }
 
     inline void set_data(cont_type const& data)
     {
         data_ = data;
+        source_.reset();
+        pending_.clear();
+    }
+
+    // The attributes held so far are decoded by `source` on first access,
+    // so datasources only pay for the attributes actually read
+    inline void set_attribute_source(feature_attribute_source_ptr const& source)
+    {
+        source_ = source;
+        pending_.assign(data_.size(), static_cast<bool>(source));
     }
 
     inline context_ptr context() const
@@ -242,13 +276,14 @@ public:
             std::size_t index = kv.second;
             if (index < data_.size())
             {
-                if (data_[kv.second] == mapnik::value_null())
+                value_type const& val = get(index);
+                if (val == mapnik::value_null())
                 {
                     ss << "  " << kv.first  << ":null" << std::endl;
                 }
                 else
                 {
-                    ss << "  " << kv.first  << ":" <<  data_[kv.second] << std::endl;
+                    ss << "  " << kv.first  << ":" <<  val << std::endl;
                 }
             }
         }
@@ -257,11 +292,20 @@ public:
     }
 
 private:
+    inline void decode(std::size_t index) const
+    {
+        pending_[index] = false;
+        source_->decode(index, data_[index]);
+    }
+
     mapnik::value_integer id_;
     context_ptr ctx_;
-    cont_type data_;
+    // filled in by source_ as pending attributes are read
+    mutable cont_type data_;
     geometry::geometry<double> geom_;
     raster_ptr raster_;
+    feature_attribute_source_ptr source_;
+    mutable std::vector<bool> pending_;
 };
 
 
@@ -0,0 +1,155 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FEATURE_CACHE_HPP
+#define MAPNIK_FEATURE_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/featureset.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/util/noncopyable.hpp>
+// stl
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// On-disk copy of the features a datasource built from its source file, in
+// the "mapnik-features" format:
+//
+//   char[16]  "mapnik-features", format version in byte 15
+//   uint32    byte order mark, attribute count
+//   uint64    feature count, source size, source modification time
+//   uint64    offsets of the sections below, file size
+//   char[]    absolute source path
+//   names     attribute names, length prefixed
+//   features  id, bounding box and geometry offsets of each feature
+//   uint32[]  geometry structure: type tags and part sizes
+//   double[]  coordinates of all geometries, x/y interleaved
+//   cells     attribute values, one column per attribute
+//   char[]    UTF-8 string values
+//
+// The file is written once and mapped on later loads. It is only used while
+// the source path, size and modification time match.
+class MAPNIK_DECL feature_cache_writer : private util::noncopyable
+{
+public:
+    feature_cache_writer();
+    // features are stored in the order they are added
+    void add(feature_impl const& feature);
+    // writes to a temporary file that is renamed to `filename`, so
+    // processes sharing the cache never map a partial file
+    bool write(std::string const& filename, std::string const& source) const;
+
+private:
+    struct cell
+    {
+        std::uint32_t type;
+        std::uint32_t size;
+        std::uint64_t payload;
+    };
+
+    std::size_t column(std::string const& name);
+
+    std::vector<std::string> names_;
+    std::vector<std::vector<cell>> columns_;
+    std::vector<char> features_;
+    std::vector<std::uint32_t> structure_;
+    std::vector<double> coordinates_;
+    std::string strings_;
+    std::size_t count_;
+};
+
+class MAPNIK_DECL feature_cache : public std::enable_shared_from_this<feature_cache>,
+                                  private util::noncopyable
+{
+public:
+    using ptr = std::shared_ptr<feature_cache const>;
+
+    // cache file in `directory` for `source`
+    static std::string filename(std::string const& directory, std::string const& source);
+    // nullptr if `filename` is missing, damaged or was not written for the
+    // current state of `source`
+    static ptr open(std::string const& filename, std::string const& source);
+
+    ~feature_cache();
+
+    std::size_t size() const { return size_; }
+    std::vector<std::string> const& attribute_names() const { return names_; }
+    // context holding the attribute names, as used by feature()
+    context_ptr make_context() const;
+
+    value_integer id(std::size_t index) const;
+    box2d<double> envelope(std::size_t index) const;
+    bool has_attribute(std::size_t index, std::size_t column) const;
+    geometry::geometry<double> geometry(std::size_t index) const;
+    // attributes are decoded from the cache on first access
+    feature_ptr feature(std::size_t index, context_ptr const& ctx, value_integer id) const;
+    void decode(std::size_t index, std::size_t column, value & val) const;
+
+private:
+    feature_cache();
+    bool load(std::string const& filename, std::string const& source);
+
+    struct mapping;
+    std::unique_ptr<mapping> mapping_;
+    char const* data_;
+    std::size_t size_;
+    std::vector<std::string> names_;
+    char const* features_;
+    std::uint32_t const* structure_;
+    std::size_t structure_size_;
+    char const* coordinates_;
+    std::size_t coordinates_size_;
+    char const* cells_;
+    char const* strings_;
+    std::size_t strings_size_;
+};
+
+// Features of a feature_cache, in the order of `indices`. Features keep
+// their cached id, or are numbered from `first_id` when it is not 0.
+class MAPNIK_DECL feature_cache_featureset : public Featureset
+{
+public:
+    feature_cache_featureset(feature_cache::ptr const& cache,
+                             std::vector<std::size_t> && indices,
+                             value_integer first_id = 0);
+    virtual ~feature_cache_featureset() {}
+    feature_ptr next();
+
+private:
+    feature_cache::ptr cache_;
+    context_ptr ctx_;
+    std::vector<std::size_t> const indices_;
+    std::vector<std::size_t>::const_iterator itr_;
+    value_integer next_id_;
+};
+
+}
+
+#endif // MAPNIK_FEATURE_CACHE_HPP
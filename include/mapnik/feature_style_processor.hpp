@@ -33,6 +33,7 @@
 #include <vector>
 #include <set>
 #include <string>
+#include <type_traits>
 
 namespace mapnik
 {
@@ -43,6 +44,7 @@ class projection;
 class proj_transform;
 class feature_type_style;
 class rule_cache;
+class featureset_prefetcher;
 struct layer_rendering_material;
 
 enum eAttributeCollectionPolicy
@@ -51,6 +53,16 @@ enum eAttributeCollectionPolicy
     COLLECT_ALL = 1
 };
 
+// Processors able to render independent layers on worker threads
+// specialize this to std::true_type and provide:
+//  - unsigned layer_concurrency() const
+//  - a constructor Processor(Map const&, Processor const& parent)
+//    creating a processor without target, rendering a single layer
+//    into its own buffer
+//  - void composite_layer(layer const&, Processor & detached)
+template <typename Processor>
+struct detached_layer_rendering : std::false_type {};
+
 template <typename Processor>
 class MAPNIK_DECL feature_style_processor
 {
@@ -84,6 +96,12 @@ public:
                         int buffer_size,
                         std::set<std::string>& names);
 
+    /*!
+     * \brief set number of threads pulling features of all layers
+     * in advance of rendering, zero disables prefetching.
+     */
+    void set_prefetch_concurrency(unsigned concurrency);
+
 private:
     /*!
      * \brief renders a featureset with the given styles.
@@ -114,13 +132,32 @@ private:
                        int buffer_size,
                        std::set<std::string>& names);
 
+    /*!
+     * \brief start pulling features of prepared layers on worker threads.
+     */
+    void prefetch_layers(layer_rendering_material & parent_mat,
+                         featureset_prefetcher & prefetcher);
+
     /*!
      * \brief render features list queued when they are available.
      */
     void render_material(layer_rendering_material const & mat, Processor & p );
-    void render_submaterials(layer_rendering_material const & mat, Processor & p);
+    void render_submaterials(layer_rendering_material const & mat, Processor & p,
+                             featureset_prefetcher & prefetcher);
+    template <typename P>
+    void render_submaterials(layer_rendering_material const & mat, P & p,
+                             featureset_prefetcher & prefetcher, std::false_type);
+    template <typename P>
+    void render_submaterials(layer_rendering_material const & mat, P & p,
+                             featureset_prefetcher & prefetcher, std::true_type);
+
+    /*!
+     * \brief check whether a layer can be rendered on its own, independently of other layers.
+     */
+    bool detachable(layer_rendering_material const & mat) const;
 
     Map const& m_;
+    unsigned prefetch_concurrency_;
 };
 }
 
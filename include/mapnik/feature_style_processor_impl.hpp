@@ -43,13 +43,19 @@
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform.hpp>
 #include <mapnik/util/featureset_buffer.hpp>
+#include <mapnik/util/featureset_prefetch.hpp>
 #include <mapnik/util/variant.hpp>
 #include <mapnik/symbolizer_dispatch.hpp>
 #include <mapnik/timer.hpp>
+#include <mapnik/make_unique.hpp>
 
 // stl
 #include <vector>
 #include <stdexcept>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <algorithm>
 
 namespace mapnik
 {
@@ -65,12 +71,15 @@ struct layer_rendering_material
     std::vector<featureset_ptr> featureset_ptr_list_;
     std::vector<rule_cache> rule_caches_;
     std::vector<layer_rendering_material> materials_;
+    // datasource queried asynchronously by itself
+    bool asynchronous_;
 
     layer_rendering_material(layer const& lay, projection const& dest)
         :
         lay_(lay),
         proj0_(dest),
-        proj1_(lay.srs(),true) {}
+        proj1_(lay.srs(),true),
+        asynchronous_(false) {}
 
     inline bool empty() const
     {
@@ -80,9 +89,76 @@ struct layer_rendering_material
     layer_rendering_material(layer_rendering_material && rhs) = default;
 };
 
+// Symbolizers neither querying nor populating the collision detector
+struct collision_free_symbolizer
+{
+    template <typename Symbolizer>
+    bool operator() (Symbolizer const&) const { return false; }
+    bool operator() (line_symbolizer const&) const { return true; }
+    bool operator() (line_pattern_symbolizer const&) const { return true; }
+    bool operator() (polygon_symbolizer const&) const { return true; }
+    bool operator() (polygon_pattern_symbolizer const&) const { return true; }
+    bool operator() (raster_symbolizer const&) const { return true; }
+    bool operator() (building_symbolizer const&) const { return true; }
+    bool operator() (dot_symbolizer const&) const { return true; }
+};
+
+inline bool collision_free(rule_cache::rule_ptrs const& rules)
+{
+    for (rule const* r : rules)
+    {
+        for (symbolizer const& sym : r->get_symbolizers())
+        {
+            if (!util::apply_visitor(collision_free_symbolizer(), sym))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+inline bool queried_asynchronously(layer_rendering_material const& mat)
+{
+    if (mat.asynchronous_)
+    {
+        return true;
+    }
+    for (layer_rendering_material const& sub_mat : mat.materials_)
+    {
+        if (queried_asynchronously(sub_mat))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline bool collision_free(layer_rendering_material const& mat)
+{
+    for (rule_cache const& rc : mat.rule_caches_)
+    {
+        if (!collision_free(rc.get_if_rules()) ||
+            !collision_free(rc.get_else_rules()) ||
+            !collision_free(rc.get_also_rules()))
+        {
+            return false;
+        }
+    }
+    for (layer_rendering_material const& sub_mat : mat.materials_)
+    {
+        if (!collision_free(sub_mat))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 template <typename Processor>
 feature_style_processor<Processor>::feature_style_processor(Map const& m, double scale_factor)
-    : m_(m)
+    : m_(m),
+      prefetch_concurrency_(0)
 {
 #ifdef MAPNIK_STATS_RENDER
     std::clog << "EXTENT: " << m.get_current_extent() << std::endl;
@@ -94,6 +170,12 @@ feature_style_processor<Processor>::feature_style_processor(Map const& m, double
     }
 }
 
+template <typename Processor>
+void feature_style_processor<Processor>::set_prefetch_concurrency(unsigned concurrency)
+{
+    prefetch_concurrency_ = concurrency;
+}
+
 template <typename Processor>
 void feature_style_processor<Processor>::prepare_layers(layer_rendering_material & parent_mat,
                                                         std::vector<layer> const & layers,
@@ -159,7 +241,14 @@ void feature_style_processor<Processor>::apply(double scale_denom)
         layer_rendering_material root_mat(m_.layers().front(), proj);
         prepare_layers(root_mat, m_.layers(), ctx_map, p, scale_denom);
 
-        render_submaterials(root_mat, p);
+        featureset_prefetcher prefetcher(prefetch_concurrency_);
+        if (prefetch_concurrency_ > 0)
+        {
+            prefetch_layers(root_mat, prefetcher);
+            prefetcher.start();
+        }
+
+        render_submaterials(root_mat, p, prefetcher);
     }
 
     p.end_map_processing(m_);
@@ -224,12 +313,19 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay,
 
     prepare_layers(mat, lay.layers(), ctx_map, p, scale_denom);
 
+    featureset_prefetcher prefetcher(prefetch_concurrency_);
+    if (prefetch_concurrency_ > 0)
+    {
+        prefetch_layers(mat, prefetcher);
+        prefetcher.start();
+    }
+
     if (!mat.empty())
     {
         p.start_layer_processing(mat.lay_, mat.layer_ext2_);
 
         render_material(mat,p);
-        render_submaterials(mat, p);
+        render_submaterials(mat, p, prefetcher);
 
         p.end_layer_processing(mat.lay_);
     }
@@ -267,6 +363,7 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     }
 
     processor_context_ptr current_ctx = ds->get_context(ctx_map);
+    mat.asynchronous_ = static_cast<bool>(current_ctx);
     proj_transform prj_trans(mat.proj0_,mat.proj1_);
 
     box2d<double> query_ext = extent; // unbuffered
@@ -443,6 +540,7 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
         }
     }
     q.set_filter_factor(collector.get_filter_factor());
+    q.set_geometry_requirements(collector.get_geometry_requirements());
 
     // Also query the group by attribute
     std::string const& group_by = lay.group_by();
@@ -467,9 +565,40 @@ void feature_style_processor<Processor>::prepare_layer(layer_rendering_material
     }
 }
 
+template <typename Processor>
+void feature_style_processor<Processor>::prefetch_layers(layer_rendering_material & parent_mat,
+                                                         featureset_prefetcher & prefetcher)
+{
+    // Datasources supporting asynchronous queries overlap I/O by themselves.
+    if (!parent_mat.asynchronous_)
+    {
+        for (featureset_ptr & features : parent_mat.featureset_ptr_list_)
+        {
+            if (features && is_valid(features))
+            {
+                features = prefetcher.add(features);
+            }
+        }
+    }
+    for (layer_rendering_material & mat : parent_mat.materials_)
+    {
+        prefetch_layers(mat, prefetcher);
+    }
+}
+
 template <typename Processor>
 void feature_style_processor<Processor>::render_submaterials(layer_rendering_material const & parent_mat,
-                                                             Processor & p)
+                                                             Processor & p,
+                                                             featureset_prefetcher & prefetcher)
+{
+    render_submaterials(parent_mat, p, prefetcher, detached_layer_rendering<Processor>());
+}
+
+template <typename Processor> template <typename P>
+void feature_style_processor<Processor>::render_submaterials(layer_rendering_material const & parent_mat,
+                                                             P & p,
+                                                             featureset_prefetcher & prefetcher,
+                                                             std::false_type)
 {
     for (layer_rendering_material const & mat : parent_mat.materials_)
     {
@@ -481,11 +610,142 @@ void feature_style_processor<Processor>::render_submaterials(layer_rendering_mat
             p.start_layer_processing(mat.lay_, mat.layer_ext2_);
 
             render_material(mat, p);
-            render_submaterials(mat, p);
+            render_submaterials(mat, p, prefetcher);
+
+            p.end_layer_processing(mat.lay_);
+        }
+    }
+}
+
+template <typename Processor>
+bool feature_style_processor<Processor>::detachable(layer_rendering_material const & mat) const
+{
+    layer const& lay = mat.lay_;
+    // Only a layer composited from its own buffer produces the same pixels
+    // no matter what has been rendered underneath it. Its features also
+    // must not interact with labels of other layers.
+    // Featuresets of asynchronous datasources share the unsynchronized
+    // context of the render.
+    return (lay.comp_op() || lay.get_opacity() < 1.0) && collision_free(mat) &&
+           !queried_asynchronously(mat);
+}
+
+// Independent layers are rendered by detached processors on worker threads
+// while the remaining layers are rendered in place. Results are composited
+// strictly in layer order, so the output is the same as if rendered serially.
+template <typename Processor> template <typename P>
+void feature_style_processor<Processor>::render_submaterials(layer_rendering_material const & parent_mat,
+                                                             P & p,
+                                                             featureset_prefetcher & prefetcher,
+                                                             std::true_type)
+{
+    unsigned concurrency = p.layer_concurrency();
+    std::vector<layer_rendering_material const*> detached;
+    if (concurrency > 1)
+    {
+        for (layer_rendering_material const & mat : parent_mat.materials_)
+        {
+            if (!mat.empty() && detachable(mat))
+            {
+                detached.push_back(&mat);
+            }
+        }
+    }
+
+    if (detached.empty())
+    {
+        render_submaterials(parent_mat, p, prefetcher, std::false_type());
+        return;
+    }
+
+    using processor_ptr = std::unique_ptr<Processor>;
+    std::vector<std::promise<processor_ptr>> results(detached.size());
+    std::vector<std::future<processor_ptr>> futures;
+    futures.reserve(results.size());
+    for (std::promise<processor_ptr> & result : results)
+    {
+        futures.emplace_back(result.get_future());
+    }
+
+    struct workers_guard
+    {
+        std::atomic<std::size_t> & next_;
+        std::size_t size_;
+        featureset_prefetcher & prefetcher_;
+        bool finished_;
+        std::vector<std::thread> threads_;
+
+        ~workers_guard()
+        {
+            if (!finished_)
+            {
+                // stop picking up new layers if we are leaving early, and
+                // free workers waiting for features the prefetcher might
+                // never read, being blocked on the layer we left
+                next_ = size_;
+                prefetcher_.cancel();
+            }
+            for (std::thread & t : threads_)
+            {
+                t.join();
+            }
+        }
+    };
+
+    std::atomic<std::size_t> next(0);
+    workers_guard workers{next, detached.size(), prefetcher, false, {}};
+    auto worker = [&]()
+    {
+        for (std::size_t i = next++; i < detached.size(); i = next++)
+        {
+            try
+            {
+                layer_rendering_material const & mat = *detached[i];
+                processor_ptr sub = std::make_unique<Processor>(m_, p);
+                sub->start_layer_processing(mat.lay_, mat.layer_ext2_);
+                render_material(mat, *sub);
+                render_submaterials(mat, *sub, prefetcher);
+                results[i].set_value(std::move(sub));
+            }
+            catch (...)
+            {
+                results[i].set_exception(std::current_exception());
+            }
+        }
+    };
+
+    std::size_t num_threads = std::min(static_cast<std::size_t>(concurrency), detached.size());
+    for (std::size_t i = 0; i < num_threads; ++i)
+    {
+        workers.threads_.emplace_back(worker);
+    }
+
+    std::size_t index = 0;
+    for (layer_rendering_material const & mat : parent_mat.materials_)
+    {
+        if (mat.empty())
+        {
+            continue;
+        }
+        if (index < detached.size() && detached[index] == &mat)
+        {
+            processor_ptr sub = futures[index++].get();
+            p.composite_layer(mat.lay_, *sub);
+        }
+        else
+        {
+#ifdef MAPNIK_STATS_RENDER
+            mapnik::progress_timer __stats__(std::clog, "layer: " + mat.lay_.name());
+#endif
+            p.start_layer_processing(mat.lay_, mat.layer_ext2_);
+
+            render_material(mat, p);
+            render_submaterials(mat, p, prefetcher);
 
             p.end_layer_processing(mat.lay_);
         }
     }
+    workers.finished_ = true;
 }
 
 template <typename Processor>
@@ -25,6 +25,7 @@
 
 #include <mapnik/config.hpp>
 #include <mapnik/image.hpp>
+#include <mapnik/box2d.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -91,5 +92,14 @@ MAPNIK_DECL void composite(T & dst, T const& src,
                            int dx=0,
                            int dy=0);
 
+// Like composite() above, restricted to the pixels of src
+// within extent. Maximum coordinates are exclusive.
+MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src,
+                           box2d<int> const& extent,
+                           composite_mode_e mode,
+                           float opacity=1,
+                           int dx=0,
+                           int dy=0);
+
 }
 #endif // MAPNIK_IMAGE_COMPOSITING_HPP
@@ -28,6 +28,9 @@
 #include <mapnik/image_filter_types.hpp>
 #include <mapnik/image_util.hpp>
 #include <mapnik/util/hsl.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -46,7 +49,16 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 // 8-bit YUV
 //Y = ( (  66 * R + 129 * G +  25 * B + 128) >> 8) +  16
@@ -163,6 +175,37 @@ struct double_buffer
     }
 };
 
+// Images with fewer pixels are filtered on the calling thread only
+constexpr std::size_t min_filter_pixels_per_thread = 128 * 1024;
+
+// Calls func(start, end) for consecutive bands of [0, size) on up to
+// `concurrency` threads. Each item of the range covers `pixels_per_item`
+// pixels, bands are only split off for large images.
+template <typename Func>
+void for_each_band(std::size_t size, std::size_t pixels_per_item, unsigned concurrency, Func const& func)
+{
+    std::size_t bands = std::min(static_cast<std::size_t>(concurrency),
+                                 size * pixels_per_item / min_filter_pixels_per_thread);
+    bands = std::min(bands, size);
+    if (bands <= 1)
+    {
+        func(std::size_t(0), size);
+        return;
+    }
+    std::size_t band = (size + bands - 1) / bands;
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    for (std::size_t start = band; start < size; start += band)
+    {
+        threads.emplace_back(std::cref(func), start, std::min(start + band, size));
+    }
+    func(std::size_t(0), band);
+    for (std::thread & t : threads)
+    {
+        t.join();
+    }
+}
+
 template <typename Src, typename Dst, typename Conv>
 void process_channel_impl (Src const& src, Dst & dst, Conv const& k)
 {
@@ -226,184 +269,188 @@ void process_channel (Src const& src, Dst & dst, mapnik::filter::sobel)
     dst = out_value;
 }
 
+inline float const* convolution_matrix(mapnik::filter::blur) { return detail::blur_matrix; }
+inline float const* convolution_matrix(mapnik::filter::emboss) { return detail::emboss_matrix; }
+inline float const* convolution_matrix(mapnik::filter::sharpen) { return detail::sharpen_matrix; }
+inline float const* convolution_matrix(mapnik::filter::edge_detect) { return detail::edge_detect_matrix; }
+template <typename Filter>
+inline float const* convolution_matrix(Filter const&) { return nullptr; }
 
-
-template <typename Src, typename Dst, typename Filter>
-void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+// Source rows converted to floats for the 3x3 convolutions, with the
+// first and last pixel repeated on either side. Keeps the three most
+// recently used rows.
+template <typename Src>
+class convolution_rows
 {
-    using boost::gil::bits32f;
-    using boost::gil::point2;
-
-    // p0 p1 p2
-    // p3 p4 p5
-    // p6 p7 p8
-
-    typename Src::xy_locator src_loc = src_view.xy_at(0,0);
-    typename Src::xy_locator::cached_location_t loc00 = src_loc.cache_location(-1,-1);
-    typename Src::xy_locator::cached_location_t loc10 = src_loc.cache_location( 0,-1);
-    typename Src::xy_locator::cached_location_t loc20 = src_loc.cache_location( 1,-1);
-    typename Src::xy_locator::cached_location_t loc01 = src_loc.cache_location(-1, 0);
-    typename Src::xy_locator::cached_location_t loc11 = src_loc.cache_location( 0, 0);
-    typename Src::xy_locator::cached_location_t loc21 = src_loc.cache_location( 1, 0);
-    typename Src::xy_locator::cached_location_t loc02 = src_loc.cache_location(-1, 1);
-    typename Src::xy_locator::cached_location_t loc12 = src_loc.cache_location( 0, 1);
-    typename Src::xy_locator::cached_location_t loc22 = src_loc.cache_location( 1, 1);
-
-    typename Src::x_iterator dst_it = dst_view.row_begin(0);
-
-    // top row
-    for (std::ptrdiff_t x = 0 ; x < src_view.width(); ++x)
+public:
+    explicit convolution_rows(Src const& src)
+        : src_(src),
+          width_(src.width()),
+          index_{{-1, -1, -1}},
+          rows_{{std::vector<float>((width_ + 2) * 4),
+                 std::vector<float>((width_ + 2) * 4),
+                 std::vector<float>((width_ + 2) * 4)}} {}
+
+    float const* get(std::size_t y)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (std::ptrdiff_t i = 0; i < 3; ++i)
+        std::vector<float> & row = rows_[y % 3];
+        if (index_[y % 3] != static_cast<std::ptrdiff_t>(y))
         {
-            bits32f p[9];
-
-            p[4] = src_loc[loc11][i];
-            p[7] = src_loc[loc12][i];
-
-            if (x == 0)
+            std::uint8_t const* in = src_.bytes() + y * src_.row_size();
+            float * out = row.data() + 4;
+            for (std::size_t i = 0; i < width_ * 4; ++i)
             {
-                p[3] = p[4];
-                p[6] = p[7];
+                out[i] = in[i];
             }
-            else
-            {
-                p[3] = src_loc[loc01][i];
-                p[6] = src_loc[loc02][i];
-            }
-
-            if ( x == (src_view.width())-1)
-            {
-                p[5] = p[4];
-                p[8] = p[7];
-            }
-            else
-            {
-                p[5] = src_loc[loc21][i];
-                p[8] = src_loc[loc22][i];
-            }
-
-            p[0] = p[6];
-            p[1] = p[7];
-            p[2] = p[8];
-
-            process_channel(p, (*dst_it)[i], filter);
+            std::copy(out, out + 4, row.data());
+            std::copy(out + (width_ - 1) * 4, out + width_ * 4, out + width_ * 4);
+            index_[y % 3] = static_cast<std::ptrdiff_t>(y);
         }
-        ++src_loc.x();
-        ++dst_it;
+        return row.data();
     }
-    // carrige-return
-    src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
 
-    // 1... height-1 rows
-    for (std::ptrdiff_t y = 1; y < src_view.height()-1; ++y)
+private:
+    Src const& src_;
+    std::size_t width_;
+    std::array<std::ptrdiff_t, 3> index_;
+    std::array<std::vector<float>, 3> rows_;
+};
+
+// r0, r1 and r2 point to the padded rows above, at and below the output row
+template <typename Filter>
+void convolve_row(float const* r0, float const* r1, float const* r2,
+                  std::uint8_t const* in, std::uint8_t * out,
+                  std::size_t width, Filter const& filter)
+{
+    for (std::size_t x = 0; x < width; ++x, r0 += 4, r1 += 4, r2 += 4, in += 4, out += 4)
     {
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+        for (std::size_t i = 0; i < 3; ++i)
         {
-            (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-            for (std::ptrdiff_t i = 0; i < 3; ++i)
-            {
-                bits32f p[9];
-
-                p[1] = src_loc[loc10][i];
-                p[4] = src_loc[loc11][i];
-                p[7] = src_loc[loc12][i];
-
-                if (x == 0)
-                {
-                    p[0] = p[1];
-                    p[3] = p[4];
-                    p[6] = p[7];
-                }
-                else
-                {
-                    p[0] = src_loc[loc00][i];
-                    p[3] = src_loc[loc01][i];
-                    p[6] = src_loc[loc02][i];
-                }
-
-                if ( x == (src_view.width()) - 1)
-                {
-                    p[2] = p[1];
-                    p[5] = p[4];
-                    p[8] = p[7];
-                }
-                else
-                {
-                    p[2] = src_loc[loc20][i];
-                    p[5] = src_loc[loc21][i];
-                    p[8] = src_loc[loc22][i];
-                }
-                process_channel(p, (*dst_it)[i], filter);
-            }
-            ++dst_it;
-            ++src_loc.x();
+            float p[9] = { r0[i], r0[4 + i], r0[8 + i],
+                           r1[i], r1[4 + i], r1[8 + i],
+                           r2[i], r2[4 + i], r2[8 + i] };
+            process_channel(p, out[i], filter);
         }
-        // carrige-return
-        src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
+        out[3] = in[3]; // Dst.a = Src.a
     }
+}
 
-    // bottom row
-    //src_loc = src_view.xy_at(0,src_view.height()-1);
-    for (std::ptrdiff_t x = 0 ; x < src_view.width(); ++x)
+#ifdef SSE_MATH
+// Same arithmetic as process_channel_impl, for all channels of a pixel at once
+inline void convolve_row(float const* r0, float const* r1, float const* r2,
+                         std::uint8_t const* in, std::uint8_t * out,
+                         std::size_t width, float const* k)
+{
+    __m128 const k0 = _mm_set1_ps(k[0]);
+    __m128 const k1 = _mm_set1_ps(k[1]);
+    __m128 const k2 = _mm_set1_ps(k[2]);
+    __m128 const k3 = _mm_set1_ps(k[3]);
+    __m128 const k4 = _mm_set1_ps(k[4]);
+    __m128 const k5 = _mm_set1_ps(k[5]);
+    __m128 const k6 = _mm_set1_ps(k[6]);
+    __m128 const k7 = _mm_set1_ps(k[7]);
+    __m128 const k8 = _mm_set1_ps(k[8]);
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const max_value = _mm_set1_ps(255.0f);
+    for (std::size_t x = 0; x < width; ++x, r0 += 4, r1 += 4, r2 += 4, in += 4, out += 4)
     {
-        (*dst_it)[3] = src_loc[loc11][3]; // Dst.a = Src.a
-        for (std::ptrdiff_t i = 0; i < 3; ++i)
-        {
-            bits32f p[9];
-
-            p[1] = src_loc[loc10][i];
-            p[4] = src_loc[loc11][i];
-
-            if (x == 0)
-            {
-                p[0] = p[1];
-                p[3] = p[4];
-            }
-            else
-            {
-                p[0] = src_loc[loc00][i];
-                p[3] = src_loc[loc01][i];
-            }
-
-            if ( x == (src_view.width())-1)
-            {
-                p[2] = p[1];
-                p[5] = p[4];
+        __m128 sum = _mm_mul_ps(k0, _mm_loadu_ps(r0));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k1, _mm_loadu_ps(r0 + 4)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k2, _mm_loadu_ps(r0 + 8)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k3, _mm_loadu_ps(r1)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k4, _mm_loadu_ps(r1 + 4)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k5, _mm_loadu_ps(r1 + 8)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k6, _mm_loadu_ps(r2)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k7, _mm_loadu_ps(r2 + 4)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(k8, _mm_loadu_ps(r2 + 8)));
+        sum = _mm_min_ps(_mm_max_ps(sum, zero), max_value);
+        __m128i value = _mm_cvttps_epi32(sum);
+        value = _mm_packs_epi32(value, value);
+        value = _mm_packus_epi16(value, value);
+        m128_int pixel;
+        pixel.v = value;
+        out[0] = pixel.u8[0];
+        out[1] = pixel.u8[1];
+        out[2] = pixel.u8[2];
+        out[3] = in[3]; // Dst.a = Src.a
+    }
+}
+#endif
 
-            }
-            else
+// Edges are handled by repeating the first and last column, and by
+// mirroring the second and second to last row.
+template <typename Src, typename Filter>
+void apply_convolution_3x3(Src & src, Filter const& filter, unsigned concurrency)
+{
+    std::size_t width = src.width();
+    std::size_t height = src.height();
+    if (width == 0 || height == 0) return;
+    std::vector<std::uint8_t> dst(width * height * 4);
+    for_each_band(height, width, concurrency, [&](std::size_t start, std::size_t end)
+    {
+        convolution_rows<Src> rows(src);
+#ifdef SSE_MATH
+        float const* matrix = convolution_matrix(filter);
+#endif
+        for (std::size_t y = start; y < end; ++y)
+        {
+            std::size_t above = (y > 0) ? y - 1 : std::min(std::size_t(1), height - 1);
+            std::size_t below = (y + 1 < height) ? y + 1 : ((height > 1) ? height - 2 : 0);
+            float const* r0 = rows.get(above);
+            float const* r1 = rows.get(y);
+            float const* r2 = rows.get(below);
+            std::uint8_t const* in = src.bytes() + y * src.row_size();
+            std::uint8_t * out = dst.data() + y * width * 4;
+#ifdef SSE_MATH
+            if (matrix)
             {
-                p[2] = src_loc[loc20][i];
-                p[5] = src_loc[loc21][i];
+                convolve_row(r0, r1, r2, in, out, width, matrix);
+                continue;
             }
-
-            p[6] = p[0];
-            p[7] = p[1];
-            p[8] = p[2];
-            process_channel(p, (*dst_it)[i], filter);
+#endif
+            convolve_row(r0, r1, r2, in, out, width, filter);
         }
-        ++src_loc.x();
-        ++dst_it;
+    });
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        std::copy(dst.data() + y * width * 4, dst.data() + (y + 1) * width * 4,
+                  src.bytes() + y * src.row_size());
     }
 }
 
 template <typename Src, typename Filter>
-void apply_filter(Src & src, Filter const& filter, double /*scale_factor*/)
+void apply_filter(Src & src, Filter const& filter, double /*scale_factor*/, unsigned concurrency = 1)
 {
     demultiply_alpha(src);
-    double_buffer<Src> tb(src);
-    apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    apply_convolution_3x3(src, filter, concurrency);
 }
 
 template <typename Src>
-void apply_filter(Src & src, agg_stack_blur const& op, double scale_factor)
+void apply_filter(Src & src, agg_stack_blur const& op, double scale_factor, unsigned concurrency = 1)
 {
     premultiply_alpha(src);
-    agg::rendering_buffer buf(src.bytes(),src.width(),src.height(), src.row_size());
-    agg::pixfmt_rgba32_pre pixf(buf);
-    agg::stack_blur_rgba32(pixf, op.rx * scale_factor, op.ry * scale_factor);
+    std::size_t width = src.width();
+    std::size_t height = src.height();
+    if (width == 0 || height == 0) return;
+    unsigned rx = static_cast<unsigned>(op.rx * scale_factor);
+    unsigned ry = static_cast<unsigned>(op.ry * scale_factor);
+    int stride = static_cast<int>(src.row_size());
+    // the horizontal pass blurs rows and the vertical pass columns
+    // independently, so either can be split into bands
+    for_each_band(height, width, concurrency, [&](std::size_t start, std::size_t end)
+    {
+        agg::rendering_buffer buf(src.bytes() + start * src.row_size(),
+                                  static_cast<unsigned>(width), static_cast<unsigned>(end - start), stride);
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, rx, 0);
+    });
+    for_each_band(width, height, concurrency, [&](std::size_t start, std::size_t end)
+    {
+        agg::rendering_buffer buf(src.bytes() + start * 4,
+                                  static_cast<unsigned>(end - start), static_cast<unsigned>(height), stride);
+        agg::pixfmt_rgba32_pre pixf(buf);
+        agg::stack_blur_rgba32(pixf, 0, ry);
+    });
 }
 
 inline double channel_delta(double source, double match)
@@ -419,24 +466,35 @@ inline uint8_t apply_alpha_shift(double source, double match, double alpha)
     return static_cast<uint8_t>(std::floor((source*255.0)+.5));
 }
 
-template <typename Src>
-void apply_filter(Src & src, color_to_alpha const& op, double /*scale_factor*/)
-{
-    using namespace boost::gil;
-    bool premultiplied = src.get_premultiplied();
-    rgba8_view_t src_view = rgba8_view(src);
-    double cr = static_cast<double>(op.color.red())/255.0;
-    double cg = static_cast<double>(op.color.green())/255.0;
-    double cb = static_cast<double>(op.color.blue())/255.0;
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+// Point filters transform each pixel independently of its neighbours, so
+// consecutive point filters can be applied row by row in a single pass
+// over the image. A point filter is constructed with the premultiplied
+// state of its input and reports the state of its output.
+template <typename Filter>
+struct point_filter;
+
+template <typename Filter>
+struct is_point_filter : std::false_type {};
+
+template <>
+struct point_filter<color_to_alpha>
+{
+    point_filter(color_to_alpha const& op, bool premultiplied)
+        : cr_(static_cast<double>(op.color.red())/255.0),
+          cg_(static_cast<double>(op.color.green())/255.0),
+          cb_(static_cast<double>(op.color.blue())/255.0),
+          premultiplied_(premultiplied) {}
+
+    bool premultiplied() const { return true; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+        for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
         {
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t & a = get_color(src_it[x], alpha_t());
+            std::uint8_t & r = pixel[0];
+            std::uint8_t & g = pixel[1];
+            std::uint8_t & b = pixel[2];
+            std::uint8_t & a = pixel[3];
             double sr = static_cast<double>(r)/255.0;
             double sg = static_cast<double>(g)/255.0;
             double sb = static_cast<double>(b)/255.0;
@@ -447,21 +505,21 @@ void apply_filter(Src & src, color_to_alpha const& op, double /*scale_factor*/)
                 r = g = b = 0;
                 continue;
             }
-            else if (premultiplied)
+            else if (premultiplied_)
             {
                 sr /= sa;
                 sg /= sa;
                 sb /= sa;
             }
             // get that maximum color difference
-            double xa = std::max(channel_delta(sr,cr),std::max(channel_delta(sg,cg),channel_delta(sb,cb)));
+            double xa = std::max(channel_delta(sr,cr_),std::max(channel_delta(sg,cg_),channel_delta(sb,cb_)));
             if (xa > 0)
             {
                 // apply difference to each channel, returning premultiplied
                 // TODO - experiment with difference in hsl color space
-                r = apply_alpha_shift(sr,cr,xa);
-                g = apply_alpha_shift(sg,cg,xa);
-                b = apply_alpha_shift(sb,cb,xa);
+                r = apply_alpha_shift(sr,cr_,xa);
+                g = apply_alpha_shift(sg,cg_,xa);
+                b = apply_alpha_shift(sb,cb_,xa);
                 // combine new alpha with original
                 xa *= sa;
                 a = static_cast<uint8_t>(std::floor((xa*255.0)+.5));
@@ -476,227 +534,205 @@ void apply_filter(Src & src, color_to_alpha const& op, double /*scale_factor*/)
             }
         }
     }
-    // set as premultiplied
-    set_premultiplied_alpha(src, true);
-}
 
-template <typename Src>
-void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/)
+    double cr_;
+    double cg_;
+    double cb_;
+    bool premultiplied_;
+};
+
+template <>
+struct point_filter<colorize_alpha>
 {
-    using namespace boost::gil;
-    std::ptrdiff_t size = op.size();
-    if (op.size() == 1)
+    using lut_type = agg::gradient_lut<agg::color_interpolator<agg::rgba8> >;
+
+    point_filter(colorize_alpha const& op, bool premultiplied)
+        : size_(op.size()),
+          premultiplied_(premultiplied)
     {
-        // no interpolation if only one stop
-        mapnik::filter::color_stop const& stop = op[0];
-        mapnik::color const& c = stop.color;
-        rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        if (size_ == 1)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-            for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+            // no interpolation if only one stop
+            mapnik::color const& c = op[0].color;
+            color_ = agg::rgba8(c.red(), c.green(), c.blue(), c.alpha());
+        }
+        else if (size_ > 1)
+        {
+            // interpolate multiple stops
+            auto grad_lut = std::make_shared<lut_type>();
+            double step = 1.0/(size_-1);
+            double offset = 0.0;
+            for ( mapnik::filter::color_stop const& stop : op)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                if ( a > 0)
+                mapnik::color const& c = stop.color;
+                double stop_offset = stop.offset;
+                if (stop_offset == 0)
                 {
-                    a = (c.alpha() * a + 255) >> 8;
-                    r = (c.red() * a + 255) >> 8;
-                    g = (c.green() * a + 255) >> 8;
-                    b = (c.blue() * a + 255) >> 8;
+                    stop_offset = offset;
                 }
+                grad_lut->add_color(stop_offset, agg::rgba(c.red()/255.0,
+                                                           c.green()/255.0,
+                                                           c.blue()/255.0,
+                                                           c.alpha()/255.0));
+                offset += step;
+            }
+            if (grad_lut->build_lut())
+            {
+                grad_lut_ = grad_lut;
             }
         }
-        // set as premultiplied
-        set_premultiplied_alpha(src, true);
     }
-    else if (size > 1)
+
+    bool premultiplied() const { return (size_ > 0) ? true : premultiplied_; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
     {
-        // interpolate multiple stops
-        agg::gradient_lut<agg::color_interpolator<agg::rgba8> > grad_lut;
-        double step = 1.0/(size-1);
-        double offset = 0.0;
-        for ( mapnik::filter::color_stop const& stop : op)
+        if (size_ == 1)
         {
-            mapnik::color const& c = stop.color;
-            double stop_offset = stop.offset;
-            if (stop_offset == 0)
+            for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
             {
-                stop_offset = offset;
+                std::uint8_t & a = pixel[3];
+                if ( a > 0)
+                {
+                    a = (color_.a * a + 255) >> 8;
+                    pixel[0] = (color_.r * a + 255) >> 8;
+                    pixel[1] = (color_.g * a + 255) >> 8;
+                    pixel[2] = (color_.b * a + 255) >> 8;
+                }
             }
-            grad_lut.add_color(stop_offset, agg::rgba(c.red()/255.0,
-                                                      c.green()/255.0,
-                                                      c.blue()/255.0,
-                                                      c.alpha()/255.0));
-            offset += step;
         }
-        if (grad_lut.build_lut())
+        else if (grad_lut_)
         {
-            rgba8_view_t src_view = rgba8_view(src);
-            for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+            for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
             {
-                rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-                for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+                std::uint8_t & a = pixel[3];
+                if ( a > 0)
                 {
-                    uint8_t & r = get_color(src_it[x], red_t());
-                    uint8_t & g = get_color(src_it[x], green_t());
-                    uint8_t & b = get_color(src_it[x], blue_t());
-                    uint8_t & a = get_color(src_it[x], alpha_t());
-                    if ( a > 0)
-                    {
-                        agg::rgba8 c = grad_lut[a];
-                        a = (c.a * a + 255) >> 8;
-                        r = (c.r * a + 255) >> 8;
-                        g = (c.g * a + 255) >> 8;
-                        b = (c.b * a + 255) >> 8;
-        #if 0
-                        // rainbow
-                        r = 0;
-                        g = 0;
-                        b = 0;
-                        if (a < 64)
-                        {
-                            g = a * 4;
-                            b = 255;
-                        }
-                        else if (a >= 64 && a < 128)
-                        {
-                            g = 255;
-                            b = 255 - ((a - 64) * 4);
-                        }
-                        else if (a >= 128 && a < 192)
-                        {
-                            r = (a - 128) * 4;
-                            g = 255;
-                        }
-                        else // >= 192
-                        {
-                            r = 255;
-                            g = 255 - ((a - 192) * 4);
-                        }
-                        r = (r * a + 255) >> 8;
-                        g = (g * a + 255) >> 8;
-                        b = (b * a + 255) >> 8;
-        #endif
-                    }
+                    agg::rgba8 c = (*grad_lut_)[a];
+                    a = (c.a * a + 255) >> 8;
+                    pixel[0] = (c.r * a + 255) >> 8;
+                    pixel[1] = (c.g * a + 255) >> 8;
+                    pixel[2] = (c.b * a + 255) >> 8;
                 }
             }
         }
-        // set as premultiplied
-        set_premultiplied_alpha(src, true);
     }
-}
 
-template <typename Src>
-void apply_filter(Src & src, scale_hsla const& transform, double /*scale_factor*/)
-{
-    using namespace boost::gil;
-    bool tinting = !transform.is_identity();
-    bool set_alpha = !transform.is_alpha_identity();
-    // todo - filters be able to report if they
-    // should be run to avoid overhead of temp buffer
-    if (tinting || set_alpha)
+    std::size_t size_;
+    bool premultiplied_;
+    agg::rgba8 color_;
+    std::shared_ptr<lut_type> grad_lut_;
+};
+
+template <>
+struct point_filter<scale_hsla>
+{
+    point_filter(scale_hsla const& transform, bool premultiplied)
+        : transform_(transform),
+          tinting_(!transform.is_identity()),
+          set_alpha_(!transform.is_alpha_identity()),
+          premultiplied_(premultiplied) {}
+
+    bool premultiplied() const { return (tinting_ || set_alpha_) ? true : premultiplied_; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
     {
-        bool premultiplied = src.get_premultiplied();
-        rgba8_view_t src_view = rgba8_view(src);
-        for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+        if (!tinting_ && !set_alpha_) return;
+        for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
         {
-            rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-            for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+            std::uint8_t & r = pixel[0];
+            std::uint8_t & g = pixel[1];
+            std::uint8_t & b = pixel[2];
+            std::uint8_t & a = pixel[3];
+            double r2 = static_cast<double>(r)/255.0;
+            double g2 = static_cast<double>(g)/255.0;
+            double b2 = static_cast<double>(b)/255.0;
+            double a2 = static_cast<double>(a)/255.0;
+            // demultiply
+            if (a2 <= 0.0)
+            {
+                r = g = b = 0;
+                continue;
+            }
+            else if (premultiplied_)
             {
-                uint8_t & r = get_color(src_it[x], red_t());
-                uint8_t & g = get_color(src_it[x], green_t());
-                uint8_t & b = get_color(src_it[x], blue_t());
-                uint8_t & a = get_color(src_it[x], alpha_t());
-                double r2 = static_cast<double>(r)/255.0;
-                double g2 = static_cast<double>(g)/255.0;
-                double b2 = static_cast<double>(b)/255.0;
-                double a2 = static_cast<double>(a)/255.0;
-                // demultiply
-                if (a2 <= 0.0)
+                r2 /= a2;
+                g2 /= a2;
+                b2 /= a2;
+            }
+
+            if (set_alpha_)
+            {
+                a2 = transform_.a0 + (a2 * (transform_.a1 - transform_.a0));
+                if (a2 <= 0)
                 {
-                    r = g = b = 0;
+                    r = g = b = a = 0;
                     continue;
                 }
-                else if (premultiplied)
+                else if (a2 > 1)
                 {
-                    r2 /= a2;
-                    g2 /= a2;
-                    b2 /= a2;
+                    a2 = 1;
+                    a = 255;
                 }
-
-                if (set_alpha)
-                {
-                    a2 = transform.a0 + (a2 * (transform.a1 - transform.a0));
-                    if (a2 <= 0)
-                    {
-                        r = g = b = a = 0;
-                        continue;
-                    }
-                    else if (a2 > 1)
-                    {
-                        a2 = 1;
-                        a = 255;
-                    }
-                    else
-                    {
-                        a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
-                    }
-                }
-                if (tinting)
+                else
                 {
-                    double h;
-                    double s;
-                    double l;
-                    rgb2hsl(r2,g2,b2,h,s,l);
-                    double h2 = transform.h0 + (h * (transform.h1 - transform.h0));
-                    double s2 = transform.s0 + (s * (transform.s1 - transform.s0));
-                    double l2 = transform.l0 + (l * (transform.l1 - transform.l0));
-                    if (h2 > 1) { h2 = 1; }
-                    else if (h2 < 0) { h2 = 0; }
-                    if (s2 > 1) { s2 = 1; }
-                    else if (s2 < 0) { s2 = 0; }
-                    if (l2 > 1) { l2 = 1; }
-                    else if (l2 < 0) { l2 = 0; }
-                    hsl2rgb(h2,s2,l2,r2,g2,b2);
+                    a = static_cast<uint8_t>(std::floor((a2 * 255.0) +.5));
                 }
-                // premultiply
-                r2 *= a2;
-                g2 *= a2;
-                b2 *= a2;
-                r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
-                g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
-                b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
-                // all color values must be <= alpha
-                if (r>a) r=a;
-                if (g>a) g=a;
-                if (b>a) b=a;
             }
+            if (tinting_)
+            {
+                double h;
+                double s;
+                double l;
+                rgb2hsl(r2,g2,b2,h,s,l);
+                double h2 = transform_.h0 + (h * (transform_.h1 - transform_.h0));
+                double s2 = transform_.s0 + (s * (transform_.s1 - transform_.s0));
+                double l2 = transform_.l0 + (l * (transform_.l1 - transform_.l0));
+                if (h2 > 1) { h2 = 1; }
+                else if (h2 < 0) { h2 = 0; }
+                if (s2 > 1) { s2 = 1; }
+                else if (s2 < 0) { s2 = 0; }
+                if (l2 > 1) { l2 = 1; }
+                else if (l2 < 0) { l2 = 0; }
+                hsl2rgb(h2,s2,l2,r2,g2,b2);
+            }
+            // premultiply
+            r2 *= a2;
+            g2 *= a2;
+            b2 *= a2;
+            r = static_cast<uint8_t>(std::floor((r2*255.0)+.5));
+            g = static_cast<uint8_t>(std::floor((g2*255.0)+.5));
+            b = static_cast<uint8_t>(std::floor((b2*255.0)+.5));
+            // all color values must be <= alpha
+            if (r>a) r=a;
+            if (g>a) g=a;
+            if (b>a) b=a;
         }
-        // set as premultiplied
-        set_premultiplied_alpha(src, true);
     }
-}
 
-template <typename Src, typename ColorBlindFilter>
-void color_blind_filter(Src & src, ColorBlindFilter const& op)
+    scale_hsla transform_;
+    bool tinting_;
+    bool set_alpha_;
+    bool premultiplied_;
+};
+
+template <typename ColorBlindFilter>
+struct color_blind_point_filter
 {
-    using namespace boost::gil;
-    rgba8_view_t src_view = rgba8_view(src);
-    bool premultiplied = src.get_premultiplied();
+    color_blind_point_filter(ColorBlindFilter const& op, bool premultiplied)
+        : op_(op),
+          premultiplied_(premultiplied) {}
 
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
+    bool premultiplied() const { return true; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
+        for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
         {
-            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t & a = get_color(src_it[x], alpha_t());
+            std::uint8_t & r = pixel[0];
+            std::uint8_t & g = pixel[1];
+            std::uint8_t & b = pixel[2];
+            std::uint8_t & a = pixel[3];
             double dr = static_cast<double>(r)/255.0;
             double dg = static_cast<double>(g)/255.0;
             double db = static_cast<double>(b)/255.0;
@@ -707,7 +743,7 @@ void color_blind_filter(Src & src, ColorBlindFilter const& op)
                 r = g = b = 0;
                 continue;
             }
-            else if (premultiplied)
+            else if (premultiplied_)
             {
                 dr /= da;
                 dg /= da;
@@ -724,14 +760,14 @@ void color_blind_filter(Src & src, ColorBlindFilter const& op)
             double chroma_x = X / (X + Y + Z);
             double chroma_y = Y / (X + Y + Z);
             // Generate the "Confusion Line" between the source color and the Confusion Point
-            double m_div = chroma_x - op.x;
+            double m_div = chroma_x - op_.x;
             if (std::abs(m_div) < (std::numeric_limits<double>::epsilon())) continue;
-            double m = (chroma_y - op.y) / (chroma_x - op.x); // slope of Confusion Line
+            double m = (chroma_y - op_.y) / (chroma_x - op_.x); // slope of Confusion Line
             double yint = chroma_y - chroma_x * m; // y-intercept of confusion line (x-intercept = 0.0)
             // How far the xy coords deviate from the simulation
-            double m_div2 = m - op.m;
+            double m_div2 = m - op_.m;
             if (std::abs(m_div2) < (std::numeric_limits<double>::epsilon())) continue;
-            double deviate_x = (op.yint - yint) / (m - op.m);
+            double deviate_x = (op_.yint - yint) / (m - op_.m);
             double deviate_y = (m * deviate_x) + yint;
             if (std::abs(deviate_y) < (std::numeric_limits<double>::epsilon()))
             {
@@ -797,49 +833,151 @@ void color_blind_filter(Src & src, ColorBlindFilter const& op)
             b = static_cast<uint8_t>(db * 255.0);
         }
     }
-    // set as premultiplied
-    set_premultiplied_alpha(src, true);
+
+    ColorBlindFilter op_;
+    bool premultiplied_;
+};
+
+template <>
+struct point_filter<color_blind_protanope> : color_blind_point_filter<color_blind_protanope>
+{
+    using color_blind_point_filter<color_blind_protanope>::color_blind_point_filter;
+};
+
+template <>
+struct point_filter<color_blind_deuteranope> : color_blind_point_filter<color_blind_deuteranope>
+{
+    using color_blind_point_filter<color_blind_deuteranope>::color_blind_point_filter;
+};
+
+template <>
+struct point_filter<color_blind_tritanope> : color_blind_point_filter<color_blind_tritanope>
+{
+    using color_blind_point_filter<color_blind_tritanope>::color_blind_point_filter;
+};
+
+// gray and invert work with premultiplied source only
+template <>
+struct point_filter<gray>
+{
+    point_filter(gray const&, bool premultiplied)
+        : premultiply_(!premultiplied) {}
+
+    bool premultiplied() const { return true; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
+    {
+        for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
+        {
+            if (premultiply_)
+            {
+                agg::multiplier_rgba<agg::rgba8, agg::order_rgba>::premultiply(pixel);
+            }
+            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
+            std::uint8_t v = uint8_t((4915 * pixel[0] + 9667 * pixel[1] + 1802 * pixel[2] + 8192) >> 14);
+            pixel[0] = pixel[1] = pixel[2] = v;
+        }
+    }
+
+    bool premultiply_;
+};
+
+template <>
+struct point_filter<invert>
+{
+    point_filter(invert const&, bool premultiplied)
+        : premultiply_(!premultiplied) {}
+
+    bool premultiplied() const { return true; }
+
+    void operator() (std::uint8_t * row, std::size_t width) const
+    {
+        for (std::uint8_t * pixel = row, * end = row + width * 4; pixel != end; pixel += 4)
+        {
+            if (premultiply_)
+            {
+                agg::multiplier_rgba<agg::rgba8, agg::order_rgba>::premultiply(pixel);
+            }
+            // all color values are <= alpha
+            std::uint8_t a = pixel[3];
+            pixel[0] = a - pixel[0];
+            pixel[1] = a - pixel[1];
+            pixel[2] = a - pixel[2];
+        }
+    }
+
+    bool premultiply_;
+};
+
+template <> struct is_point_filter<color_to_alpha> : std::true_type {};
+template <> struct is_point_filter<colorize_alpha> : std::true_type {};
+template <> struct is_point_filter<scale_hsla> : std::true_type {};
+template <> struct is_point_filter<color_blind_protanope> : std::true_type {};
+template <> struct is_point_filter<color_blind_deuteranope> : std::true_type {};
+template <> struct is_point_filter<color_blind_tritanope> : std::true_type {};
+template <> struct is_point_filter<gray> : std::true_type {};
+template <> struct is_point_filter<invert> : std::true_type {};
+
+template <typename Src, typename Filter>
+void apply_point_filter(Src & src, Filter const& op, unsigned concurrency)
+{
+    point_filter<Filter> filter(op, src.get_premultiplied());
+    for_each_band(src.height(), src.width(), concurrency, [&](std::size_t start, std::size_t end)
+    {
+        for (std::size_t y = start; y < end; ++y)
+        {
+            filter(src.bytes() + y * src.row_size(), src.width());
+        }
+    });
+    set_premultiplied_alpha(src, filter.premultiplied());
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_protanope const& op, double /*scale_factor*/)
+void apply_filter(Src & src, color_to_alpha const& op, double /*scale_factor*/, unsigned concurrency = 1)
 {
-    color_blind_filter(src, op);
+    apply_point_filter(src, op, concurrency);
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_deuteranope const& op, double /*scale_factor*/)
+void apply_filter(Src & src, colorize_alpha const& op, double /*scale_factor*/, unsigned concurrency = 1)
 {
-    color_blind_filter(src, op);
+    apply_point_filter(src, op, concurrency);
 }
 
 template <typename Src>
-void apply_filter(Src & src, color_blind_tritanope const& op, double /*scale_factor*/)
+void apply_filter(Src & src, scale_hsla const& transform, double /*scale_factor*/, unsigned concurrency = 1)
 {
-    color_blind_filter(src, op);
+    apply_point_filter(src, transform, concurrency);
 }
 
 template <typename Src>
-void apply_filter(Src & src, gray const& /*op*/, double /*scale_factor*/)
+void apply_filter(Src & src, color_blind_protanope const& op, double /*scale_factor*/, unsigned concurrency = 1)
 {
-    premultiply_alpha(src);
-    using namespace boost::gil;
+    apply_point_filter(src, op, concurrency);
+}
 
-    rgba8_view_t src_view = rgba8_view(src);
+template <typename Src>
+void apply_filter(Src & src, color_blind_deuteranope const& op, double /*scale_factor*/, unsigned concurrency = 1)
+{
+    apply_point_filter(src, op, concurrency);
+}
 
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
-    {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
-        {
-            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t   v = uint8_t((4915 * r + 9667 * g + 1802 * b + 8192) >> 14);
-            r = g = b = v;
-        }
-    }
+template <typename Src>
+void apply_filter(Src & src, color_blind_tritanope const& op, double /*scale_factor*/, unsigned concurrency = 1)
+{
+    apply_point_filter(src, op, concurrency);
+}
+
+template <typename Src>
+void apply_filter(Src & src, gray const& op, double /*scale_factor*/, unsigned concurrency = 1)
+{
+    apply_point_filter(src, op, concurrency);
+}
+
+template <typename Src>
+void apply_filter(Src & src, invert const& op, double /*scale_factor*/, unsigned concurrency = 1)
+{
+    apply_point_filter(src, op, concurrency);
 }
 
 template <typename Src, typename Dst>
@@ -871,7 +1009,7 @@ void x_gradient_impl(Src const& src_view, Dst const& dst_view)
 }
 
 template <typename Src>
-void apply_filter(Src & src, x_gradient const& /*op*/, double /*scale_factor*/)
+void apply_filter(Src & src, x_gradient const& /*op*/, double /*scale_factor*/, unsigned /*concurrency*/ = 1)
 {
     premultiply_alpha(src);
     double_buffer<Src> tb(src);
@@ -879,7 +1017,7 @@ void apply_filter(Src & src, x_gradient const& /*op*/, double /*scale_factor*/)
 }
 
 template <typename Src>
-void apply_filter(Src & src, y_gradient const& /*op*/, double /*scale_factor*/)
+void apply_filter(Src & src, y_gradient const& /*op*/, double /*scale_factor*/, unsigned /*concurrency*/ = 1)
 {
     premultiply_alpha(src);
     double_buffer<Src> tb(src);
@@ -887,49 +1025,99 @@ void apply_filter(Src & src, y_gradient const& /*op*/, double /*scale_factor*/)
                     rotated90ccw_view(tb.dst_view));
 }
 
-template <typename Src>
-void apply_filter(Src & src, invert const& /*op*/, double /*scale_factor*/)
-{
-    premultiply_alpha(src);
-    using namespace boost::gil;
-
-    rgba8_view_t src_view = rgba8_view(src);
-
-    for (std::ptrdiff_t y = 0; y < src_view.height(); ++y)
-    {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(static_cast<long>(y));
-        for (std::ptrdiff_t x = 0; x < src_view.width(); ++x)
-        {
-            // we only work with premultiplied source,
-            // thus all color values must be <= alpha
-            uint8_t   a = get_color(src_it[x], alpha_t());
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            r = a - r;
-            g = a - g;
-            b = a - b;
-        }
-    }
-}
-
 template <typename Src>
 struct filter_visitor
 {
-    filter_visitor(Src & src, double scale_factor=1.0)
+    filter_visitor(Src & src, double scale_factor=1.0, unsigned concurrency=1)
     : src_(src),
-      scale_factor_(scale_factor) {}
+      scale_factor_(scale_factor),
+      concurrency_(concurrency) {}
 
     template <typename T>
     void operator () (T const& filter) const
     {
-        apply_filter(src_, filter, scale_factor_);
+        apply_filter(src_, filter, scale_factor_, concurrency_);
     }
 
     Src & src_;
     double scale_factor_;
+    unsigned concurrency_;
 };
 
+// Appends the row function of a point filter to `stages`,
+// returns false for any other filter
+struct point_filter_collector
+{
+    using stage_type = std::function<void(std::uint8_t *, std::size_t)>;
+
+    point_filter_collector(std::vector<stage_type> & stages, bool & premultiplied)
+        : stages_(stages),
+          premultiplied_(premultiplied) {}
+
+    template <typename T>
+    typename std::enable_if<is_point_filter<T>::value, bool>::type
+    operator () (T const& op) const
+    {
+        point_filter<T> filter(op, premultiplied_);
+        premultiplied_ = filter.premultiplied();
+        stages_.emplace_back(std::move(filter));
+        return true;
+    }
+
+    template <typename T>
+    typename std::enable_if<!is_point_filter<T>::value, bool>::type
+    operator () (T const& /*op*/) const
+    {
+        return false;
+    }
+
+    std::vector<stage_type> & stages_;
+    bool & premultiplied_;
+};
+
+// Applies `filters` in order. Runs of point filters are fused into
+// a single pass over the image, rows are split between up to
+// `concurrency` threads for large images.
+template <typename Src>
+void apply_filters(Src & src, std::vector<filter_type> const& filters,
+                   double scale_factor, unsigned concurrency = 1)
+{
+    using stage_type = point_filter_collector::stage_type;
+    filter_visitor<Src> visitor(src, scale_factor, concurrency);
+    std::vector<stage_type> stages;
+    auto itr = filters.begin();
+    auto end = filters.end();
+    while (itr != end)
+    {
+        bool premultiplied = src.get_premultiplied();
+        stages.clear();
+        point_filter_collector collector(stages, premultiplied);
+        while (itr != end && util::apply_visitor(collector, *itr))
+        {
+            ++itr;
+        }
+        if (!stages.empty())
+        {
+            for_each_band(src.height(), src.width(), concurrency, [&](std::size_t start, std::size_t end_row)
+            {
+                for (std::size_t y = start; y < end_row; ++y)
+                {
+                    std::uint8_t * row = src.bytes() + y * src.row_size();
+                    for (stage_type const& stage : stages)
+                    {
+                        stage(row, src.width());
+                    }
+                }
+            });
+            set_premultiplied_alpha(src, premultiplied);
+        }
+        if (itr != end)
+        {
+            util::apply_visitor(visitor, *itr++);
+        }
+    }
+}
+
 struct filter_radius_visitor
 {
     int & radius_;
@@ -953,11 +1141,7 @@ void filter_image(Src & src, std::string const& filter, double scale_factor=1)
     {
         throw std::runtime_error("Failed to parse filter argument in filter_image: '" + filter + "'");
     }
-    filter_visitor<Src> visitor(src, scale_factor);
-    for (filter_type const& filter_tag : filter_vector)
-    {
-        util::apply_visitor(visitor, filter_tag);
-    }
+    apply_filters(src, filter_vector, scale_factor);
 }
 
 template<typename Src>
@@ -969,11 +1153,7 @@ Src filter_image(Src const& src, std::string const& filter, double scale_factor=
         throw std::runtime_error("Failed to parse filter argument in filter_image: '" + filter + "'");
     }
     Src new_src(src);
-    filter_visitor<Src> visitor(new_src, scale_factor);
-    for (filter_type const& filter_tag : filter_vector)
-    {
-        util::apply_visitor(visitor, filter_tag);
-    }
+    apply_filters(new_src, filter_vector, scale_factor);
     return new_src;
 }
 
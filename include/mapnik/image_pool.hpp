@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_IMAGE_POOL_HPP
+#define MAPNIK_IMAGE_POOL_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+// Sets the pixels of image within extent to zero,
+// maximum coordinates are exclusive
+template <typename T>
+void clear_extent(T & image, box2d<int> extent)
+{
+    extent.clip(box2d<int>(0, 0, static_cast<int>(image.width()), static_cast<int>(image.height())));
+    if (!extent.valid() || extent.width() <= 0 || extent.height() <= 0) return;
+    std::size_t x0 = static_cast<std::size_t>(extent.minx());
+    std::size_t x1 = static_cast<std::size_t>(extent.maxx());
+    for (std::size_t y = static_cast<std::size_t>(extent.miny());
+         y < static_cast<std::size_t>(extent.maxy()); ++y)
+    {
+        typename T::pixel_type * row = image.get_row(y);
+        std::fill(row + x0, row + x1, typename T::pixel_type(0));
+    }
+}
+
+// Process wide pool of scratch images. Renderers are usually created per
+// tile, borrowing their buffers from here avoids allocating and zero
+// filling several images of the same size for every tile.
+//
+// An image returned to the pool remembers the region its last user has
+// drawn into, and only that region is cleared when it is borrowed again.
+template <typename T>
+class image_pool : public singleton<image_pool<T>, CreateStatic>,
+                   private util::noncopyable
+{
+    friend class CreateStatic<image_pool<T> >;
+public:
+    // Returns the image to the pool when the owning pointer is destroyed
+    class deleter
+    {
+    public:
+        deleter()
+            : dirty_() {}
+
+        explicit deleter(box2d<int> const& dirty)
+            : dirty_(dirty) {}
+
+        // Region to be cleared before the image is reused, in pixels with
+        // exclusive maximum. An invalid box marks the image as clean.
+        void set_dirty(box2d<int> const& dirty)
+        {
+            dirty_ = dirty;
+        }
+
+        box2d<int> const& dirty() const
+        {
+            return dirty_;
+        }
+
+        void operator() (T * image) const
+        {
+            if (image_pool::destroyed())
+            {
+                // outlived the pool, e.g. held by another static object
+                delete image;
+                return;
+            }
+            image_pool::instance().release(image, dirty_);
+        }
+
+    private:
+        box2d<int> dirty_;
+    };
+
+    using image_ptr = std::unique_ptr<T, deleter>;
+
+    // Returns a transparent image of the given size, the whole
+    // image is marked as dirty.
+    image_ptr acquire(std::size_t width, std::size_t height);
+    void clear();
+    // maximum size in bytes of the retained images, 0 disables the pool
+    void set_capacity(std::size_t bytes);
+    std::size_t capacity() const;
+    std::size_t size() const;
+
+private:
+    image_pool();
+    ~image_pool();
+    void release(T * image, box2d<int> const& dirty);
+
+    using key_type = std::pair<std::size_t, std::size_t>;
+    using entry_type = std::pair<T *, box2d<int> >;
+
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+    std::size_t capacity_;
+    std::size_t size_;
+    std::map<key_type, std::vector<entry_type> > images_;
+};
+
+extern template class MAPNIK_DECL singleton<image_pool<image_rgba8>, CreateStatic>;
+extern template class MAPNIK_DECL image_pool<image_rgba8>;
+
+}
+
+#endif // MAPNIK_IMAGE_POOL_HPP
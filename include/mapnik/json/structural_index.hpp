@@ -0,0 +1,82 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_JSON_STRUCTURAL_INDEX_HPP
+#define MAPNIK_JSON_STRUCTURAL_INDEX_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+// stl
+#include <cstdint>
+#include <vector>
+
+namespace mapnik { namespace json {
+
+// Streaming index of the tokens of a JSON text.
+//
+// Input is classified 64 bytes at a time into bit masks of quotes,
+// backslashes, whitespace and the characters {}[]:, (with SSE2 when built
+// with SSE_MATH). String interiors are masked out with bit arithmetic, so
+// the bytes of a string are never looked at one by one. next() returns, in
+// order, every structural character outside of a string and the first
+// character of every string and scalar. Positions are produced for one
+// window of input at a time, so memory use does not depend on input size.
+class structural_index : util::noncopyable
+{
+public:
+    structural_index(char const* start, char const* end);
+
+    // next token, or nullptr at end of input
+    char const* next()
+    {
+        if (pos_ == positions_.size() && !fill()) return nullptr;
+        return positions_[pos_++];
+    }
+
+    // token following the last one returned by next(), or nullptr
+    char const* peek()
+    {
+        if (pos_ == positions_.size() && !fill()) return nullptr;
+        return positions_[pos_];
+    }
+
+    // false if the input has been fully indexed and ends inside a string
+    bool valid() const
+    {
+        return block_ != end_ || in_string_ == 0;
+    }
+
+private:
+    bool fill();
+
+    char const* block_;
+    char const* end_;
+    std::vector<char const*> positions_;
+    std::size_t pos_;
+    std::uint64_t in_string_;
+    std::uint64_t prev_escaped_;
+    std::uint64_t prev_scalar_;
+};
+
+}}
+
+#endif // MAPNIK_JSON_STRUCTURAL_INDEX_HPP
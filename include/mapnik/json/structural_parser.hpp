@@ -0,0 +1,61 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_JSON_STRUCTURAL_PARSER_HPP
+#define MAPNIK_JSON_STRUCTURAL_PARSER_HPP
+
+// mapnik
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+// stl
+#include <vector>
+
+namespace mapnik { namespace json {
+
+// GeoJSON readers driven by json::structural_index.
+//
+// Each function produces the same result as the matching spirit grammar
+// on the input it accepts. Input it cannot vouch for (malformed JSON,
+// escapes other than the JSON ones, numbers spirit would read differently)
+// makes it return false without touching its output; the caller then runs
+// the grammar, which also produces the error message.
+
+// Boxes and byte ranges of the features of a FeatureCollection or of an
+// array of features, see extract_bounding_box_grammar.
+template <typename Boxes>
+bool extract_bounding_boxes(char const* start, char const* end, Boxes & boxes);
+
+// A single Feature, see feature_grammar.
+bool parse_feature(char const* start, char const* end,
+                   mapnik::feature_impl & feature, mapnik::transcoder const& tr);
+
+// The features of a FeatureCollection, numbered from start_id, see
+// feature_collection_grammar. Attribute names may have been added to ctx
+// when false is returned.
+bool parse_feature_collection(char const* start, char const* end,
+                              mapnik::context_ptr const& ctx, std::size_t & start_id,
+                              std::vector<mapnik::feature_ptr> & features,
+                              mapnik::transcoder const& tr);
+
+}}
+
+#endif // MAPNIK_JSON_STRUCTURAL_PARSER_HPP
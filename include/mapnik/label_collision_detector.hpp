@@ -25,6 +25,8 @@
 
 // mapnik
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/uniform_grid.hpp>
+#include <mapnik/collision_index.hpp>
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/value_types.hpp>
 
@@ -34,6 +36,7 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
 #include <vector>
 
 namespace mapnik
@@ -142,13 +145,49 @@ public:
 
 private:
     using tree_t = quad_tree< label >;
+    using grid_t = uniform_grid< label >;
+    collision_index_enum index_;
     tree_t tree_;
+    grid_t grid_;
+
+    template <typename Predicate>
+    bool any_in_box(box2d<double> const& box, Predicate const& pred) const
+    {
+        if (index_ == COLLISION_INDEX_GRID)
+        {
+            return grid_.any_in_box(box, pred);
+        }
+        return tree_.any_in_box(box, pred);
+    }
+
+    static box2d<double> padded(box2d<double> const& box, double pad)
+    {
+        return pad > 0 ? box2d<double>(box.minx() - pad, box.miny() - pad,
+                                       box.maxx() + pad, box.maxy() + pad)
+                       : box;
+    }
+
+    // Cheap rejection for batched queries: if nothing intersects the
+    // envelope of all boxes, none of the boxes can collide.
+    bool envelope_is_free(std::vector<box2d<double>> const& boxes, double pad) const
+    {
+        box2d<double> envelope(boxes.front());
+        for (auto const& box : boxes)
+        {
+            envelope.expand_to_include(box);
+        }
+        envelope = padded(envelope, pad);
+        return !any_in_box(envelope, [&envelope](label const& l) { return l.box.intersects(envelope); });
+    }
 
 public:
     using query_iterator = tree_t::query_iterator;
 
-    explicit label_collision_detector4(box2d<double> const& _extent)
-        : tree_(_extent)
+    explicit label_collision_detector4(box2d<double> const& _extent,
+                                       collision_index_enum index = COLLISION_INDEX_QUAD_TREE)
+        : index_(index),
+          tree_(_extent),
+          grid_(_extent)
 #ifdef MAPNIK_STATS_RENDER
           , query_count_(0)
 #endif
@@ -161,15 +200,7 @@ public:
         ++query_count_;
 #endif
 
-        tree_t::query_iterator tree_itr = tree_.query_in_box(box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for ( ;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(box)) return false;
-        }
-
-        return true;
+        return !any_in_box(box, [&box](label const& l) { return l.box.intersects(box); });
     }
 
     bool has_placement(box2d<double> const& box, double margin)
@@ -178,22 +209,8 @@ public:
         ++query_count_;
 #endif
 
-        box2d<double> const& margin_box = (margin > 0
-                                               ? box2d<double>(box.minx() - margin, box.miny() - margin,
-                                                               box.maxx() + margin, box.maxy() + margin)
-                                               : box);
-
-        tree_t::query_iterator tree_itr = tree_.query_in_box(margin_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
-
-        for (;tree_itr != tree_end; ++tree_itr)
-        {
-            if (tree_itr->get().box.intersects(margin_box))
-            {
-                return false;
-            }
-        }
-        return true;
+        box2d<double> const margin_box = padded(box, margin);
+        return !any_in_box(margin_box, [&margin_box](label const& l) { return l.box.intersects(margin_box); });
     }
 
     bool has_placement(box2d<double> const& box, double margin, mapnik::value_unicode_string const& text, double repeat_distance)
@@ -207,47 +224,58 @@ public:
             return has_placement(box, margin);
         }
 
-        box2d<double> repeat_box(box.minx() - repeat_distance, box.miny() - repeat_distance,
-                                 box.maxx() + repeat_distance, box.maxy() + repeat_distance);
+        box2d<double> const repeat_box = padded(box, repeat_distance);
+        box2d<double> const margin_box = padded(box, margin);
 
-        box2d<double> const& margin_box = (margin > 0
-                                               ? box2d<double>(box.minx() - margin, box.miny() - margin,
-                                                               box.maxx() + margin, box.maxy() + margin)
-                                               : box);
-
-        tree_t::query_iterator tree_itr = tree_.query_in_box(repeat_box);
-        tree_t::query_iterator tree_end = tree_.query_end();
+        return !any_in_box(repeat_box, [&](label const& l)
+        {
+            return l.box.intersects(margin_box) || (text == l.text && l.box.intersects(repeat_box));
+        });
+    }
 
-        for ( ;tree_itr != tree_end; ++tree_itr)
+    // Batched variants for all glyph boxes of a placement, true if none of them collides.
+    bool has_placement(std::vector<box2d<double>> const& boxes, double margin)
+    {
+        if (boxes.empty() || envelope_is_free(boxes, margin)) return true;
+        for (auto const& box : boxes)
         {
-            if (tree_itr->get().box.intersects(margin_box) || (text == tree_itr->get().text && tree_itr->get().box.intersects(repeat_box)))
-            {
-                return false;
-            }
+            if (!has_placement(box, margin)) return false;
         }
+        return true;
+    }
 
+    bool has_placement(std::vector<box2d<double>> const& boxes, double margin, mapnik::value_unicode_string const& text, double repeat_distance)
+    {
+        if (boxes.empty() || envelope_is_free(boxes, std::max(margin, repeat_distance))) return true;
+        for (auto const& box : boxes)
+        {
+            if (!has_placement(box, margin, text, repeat_distance)) return false;
+        }
         return true;
     }
 
     void insert(box2d<double> const& box)
     {
-        if (tree_.extent().intersects(box))
+        if (extent().intersects(box))
         {
-            tree_.insert(label(box), box);
+            if (index_ == COLLISION_INDEX_GRID) grid_.insert(label(box), box);
+            else tree_.insert(label(box), box);
         }
     }
 
     void insert(box2d<double> const& box, mapnik::value_unicode_string const& text)
     {
-        if (tree_.extent().intersects(box))
+        if (extent().intersects(box))
         {
-            tree_.insert(label(box, text), box);
+            if (index_ == COLLISION_INDEX_GRID) grid_.insert(label(box, text), box);
+            else tree_.insert(label(box, text), box);
         }
     }
 
     void clear()
     {
         tree_.clear();
+        grid_.clear();
     }
 
     box2d<double> const& extent() const
@@ -255,15 +283,27 @@ public:
         return tree_.extent();
     }
 
-    query_iterator begin() { return tree_.query_in_box(extent()); }
-    query_iterator end() { return tree_.query_end(); }
+    collision_index_enum index() const
+    {
+        return index_;
+    }
+
+    query_iterator begin()
+    {
+        return index_ == COLLISION_INDEX_GRID ? grid_.query_in_box(extent()) : tree_.query_in_box(extent());
+    }
+
+    query_iterator end()
+    {
+        return index_ == COLLISION_INDEX_GRID ? grid_.query_end() : tree_.query_end();
+    }
 #ifdef MAPNIK_STATS_RENDER
 public:
     unsigned long query_count_;
 
     int count_items() const
     {
-        return tree_.count_items();
+        return index_ == COLLISION_INDEX_GRID ? grid_.count_items() : tree_.count_items();
     }
 #endif
 };
@@ -23,6 +23,7 @@
 #ifndef MAPNIK_LABEL_PLACEMENT_BASE_HPP
 #define MAPNIK_LABEL_PLACEMENT_BASE_HPP
 
+#include <mapnik/collision_cache.hpp>
 #include <mapnik/symbol_cache.hpp>
 #include <mapnik/symbolizer_base.hpp>
 #include <mapnik/symbolizer.hpp>
@@ -46,6 +47,8 @@ struct placement_params
     box2d<double> const & query_extent;
     double scale_factor;
     mapnik::symbol_cache const & symbol_cache;
+    const collision_cache_ids collision_cache_insert;
+    const collision_cache_ids collision_cache_detect;
 
     template <typename T, mapnik::keys key>
     T get() const
@@ -60,6 +63,34 @@ struct placement_params
     }
 };
 
+// Ids of the caches listed by a collision cache property. Constant lists
+// are resolved when the property is set, lists given by expressions are
+// evaluated for each feature by the detector of the renderer.
+template <typename Detector>
+collision_cache_ids collision_cache_keys(
+    Detector & detector,
+    symbolizer_base const& sym,
+    keys key,
+    feature_impl const& feature,
+    attributes const& vars)
+{
+    auto itr = sym.properties.find(key);
+    if (itr == sym.properties.end())
+    {
+        return collision_cache_ids();
+    }
+    if (itr->second.template is<collision_cache_list>())
+    {
+        return itr->second.template get<collision_cache_list>().ids();
+    }
+    boost::optional<std::string> value = get_optional<std::string>(sym, key, feature, vars);
+    if (!value)
+    {
+        return collision_cache_ids();
+    }
+    return detector.evaluate(*value, key == keys::collision_cache_insert);
+}
+
 template <typename It>
 static It largest_bbox(It begin, It end)
 {
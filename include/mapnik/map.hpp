@@ -33,6 +33,7 @@
 #include <mapnik/well_known_srs.hpp>
 #include <mapnik/image_compositing.hpp>
 #include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/collision_index.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -96,6 +97,7 @@ private:
     std::map<std::string,font_set> fontsets_;
     std::vector<layer> layers_;
     aspect_fix_mode aspectFixMode_;
+    collision_index_enum collision_index_;
     box2d<double> current_extent_;
     boost::optional<box2d<double> > maximum_extent_;
     std::string base_path_;
@@ -457,6 +459,16 @@ public:
     inline void set_aspect_fix_mode(aspect_fix_mode afm) { aspectFixMode_ = afm; }
     inline aspect_fix_mode get_aspect_fix_mode() const { return aspectFixMode_; }
 
+    /*!
+     * @brief Set the spatial index used by the label collision detector.
+     */
+    inline void set_collision_index(collision_index_enum index) { collision_index_ = index; }
+
+    /*!
+     * @brief Get the spatial index used by the label collision detector.
+     */
+    inline collision_index_enum collision_index() const { return collision_index_; }
+
     /*!
      * @brief Get extra, arbitrary Parameters attached to the Map
      */
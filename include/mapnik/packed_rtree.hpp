@@ -0,0 +1,240 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_PACKED_RTREE_HPP
+#define MAPNIK_PACKED_RTREE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace mapnik
+{
+
+// Static R-tree bulk loaded in Hilbert order, written in the "mapnik-rtree"
+// index format read by mapnik::util::spatial_index:
+//
+//   char[16]  "mapnik-rtree", format version in byte 12
+//   int32     node size (max children per node)
+//   int32     size of a value
+//   int32     number of levels
+//   int32     number of entries per level, root first
+//   bbox      extent
+//   bbox[]    entry boxes per level, root first, leaves last
+//   value[]   values in leaf order
+//
+// Entry i of a level covers entries [i * node_size, (i + 1) * node_size) of
+// the level below. Levels and values start on a multiple of the node size in
+// bytes, so with the default node size no node straddles a page.
+template <typename T0, typename T1 = box2d<double>>
+class packed_rtree : util::noncopyable
+{
+    using value_type = T0;
+    using bbox_type = T1;
+    using item_type = std::pair<bbox_type, value_type>;
+public:
+    static constexpr char format_version = 1;
+
+    explicit packed_rtree(bbox_type const& ext, unsigned node_size = 16)
+        : extent_(ext),
+          node_size_(std::max(node_size, 2u)),
+          items_() {}
+
+    void insert(value_type data, bbox_type const& box)
+    {
+        items_.emplace_back(box, data);
+    }
+
+    bbox_type const& extent() const
+    {
+        return extent_;
+    }
+
+    // number of internal nodes
+    int count() const
+    {
+        int count = 0;
+        std::size_t size = items_.size();
+        while (size > 1)
+        {
+            size = (size + node_size_ - 1) / node_size_;
+            count += size;
+        }
+        return count;
+    }
+
+    int count_items() const
+    {
+        return items_.size();
+    }
+
+    template <typename OutputStream>
+    void write(OutputStream & out)
+    {
+        static_assert(std::is_standard_layout<value_type>::value,
+                      "Values stored in packed r-tree must be standard layout types to allow serialisation");
+        sort_items();
+        std::vector<std::vector<bbox_type>> levels(1);
+        levels[0].reserve(items_.size());
+        for (auto const& item : items_) levels[0].push_back(item.first);
+        while (levels.back().size() > 1)
+        {
+            std::vector<bbox_type> const& lower = levels.back();
+            std::vector<bbox_type> upper;
+            upper.reserve((lower.size() + node_size_ - 1) / node_size_);
+            for (std::size_t i = 0; i < lower.size(); i += node_size_)
+            {
+                bbox_type box = lower[i];
+                std::size_t last = std::min(i + node_size_, lower.size());
+                for (std::size_t j = i + 1; j < last; ++j) box.expand_to_include(lower[j]);
+                upper.push_back(box);
+            }
+            levels.push_back(std::move(upper));
+        }
+
+        char header[16];
+        std::memset(header, 0, 16);
+        std::strcpy(header, "mapnik-rtree");
+        header[12] = format_version;
+        out.write(header, 16);
+        std::size_t pos = 16;
+        write_int(out, node_size_, pos);
+        write_int(out, sizeof(value_type), pos);
+        write_int(out, levels.size(), pos);
+        for (auto level = levels.rbegin(); level != levels.rend(); ++level)
+        {
+            write_int(out, level->size(), pos);
+        }
+        write_raw(out, &extent_, sizeof(bbox_type), pos);
+        std::size_t const alignment = node_size_ * sizeof(bbox_type);
+        for (auto level = levels.rbegin(); level != levels.rend(); ++level)
+        {
+            pad(out, alignment, pos);
+            write_raw(out, level->data(), level->size() * sizeof(bbox_type), pos);
+        }
+        pad(out, alignment, pos);
+        for (auto const& item : items_)
+        {
+            write_raw(out, &item.second, sizeof(value_type), pos);
+        }
+    }
+
+private:
+    // distance along a Hilbert curve filling a 2^16 x 2^16 grid
+    static std::uint32_t hilbert(std::uint32_t x, std::uint32_t y)
+    {
+        std::uint32_t const n = 1u << 16;
+        std::uint32_t d = 0;
+        for (std::uint32_t s = n / 2; s > 0; s /= 2)
+        {
+            std::uint32_t rx = (x & s) > 0;
+            std::uint32_t ry = (y & s) > 0;
+            d += s * s * ((3 * rx) ^ ry);
+            if (ry == 0)
+            {
+                if (rx == 1)
+                {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    std::uint32_t grid(double value, double min, double size) const
+    {
+        if (!(size > 0)) return 0;
+        double g = std::floor((value - min) / size * 65535.0);
+        return static_cast<std::uint32_t>(std::min(65535.0, std::max(0.0, g)));
+    }
+
+    void sort_items()
+    {
+        double const minx = extent_.minx();
+        double const miny = extent_.miny();
+        double const width = extent_.width();
+        double const height = extent_.height();
+        std::vector<std::pair<std::uint32_t, std::size_t>> keys;
+        keys.reserve(items_.size());
+        for (std::size_t i = 0; i < items_.size(); ++i)
+        {
+            bbox_type const& box = items_[i].first;
+            double cx = 0.5 * (box.minx() + box.maxx());
+            double cy = 0.5 * (box.miny() + box.maxy());
+            keys.emplace_back(hilbert(grid(cx, minx, width), grid(cy, miny, height)), i);
+        }
+        std::sort(keys.begin(), keys.end());
+        std::vector<item_type> sorted;
+        sorted.reserve(items_.size());
+        for (auto const& key : keys) sorted.push_back(items_[key.second]);
+        items_.swap(sorted);
+    }
+
+    template <typename OutputStream>
+    static void write_raw(OutputStream & out, void const* data, std::size_t size, std::size_t & pos)
+    {
+        out.write(static_cast<char const*>(data), size);
+        pos += size;
+    }
+
+    template <typename OutputStream>
+    static void write_int(OutputStream & out, std::size_t value, std::size_t & pos)
+    {
+        std::int32_t v = static_cast<std::int32_t>(value);
+        write_raw(out, &v, 4, pos);
+    }
+
+    template <typename OutputStream>
+    static void pad(OutputStream & out, std::size_t alignment, std::size_t & pos)
+    {
+        static char const zeros[64] = {};
+        std::size_t size = (alignment - pos % alignment) % alignment;
+        while (size > 0)
+        {
+            std::size_t chunk = std::min(size, sizeof(zeros));
+            write_raw(out, zeros, chunk, pos);
+            size -= chunk;
+        }
+    }
+
+    bbox_type extent_;
+    unsigned node_size_;
+    std::vector<item_type> items_;
+};
+
+template <typename T0, typename T1>
+constexpr char packed_rtree<T0, T1>::format_version;
+
+}
+
+#endif // MAPNIK_PACKED_RTREE_HPP
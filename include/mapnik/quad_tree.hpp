@@ -133,6 +133,14 @@ public:
         return query_result_.end();
     }
 
+    // Returns true as soon as `pred` holds for any value stored in a node
+    // intersecting the box. Unlike query_in_box nothing is materialized.
+    template <typename Predicate>
+    bool any_in_box(bbox_type const& box, Predicate const& pred) const
+    {
+        return any_in_node(box, pred, root_);
+    }
+
     const_iterator begin() const
     {
         return nodes_.begin();
@@ -205,6 +213,23 @@ private:
         }
     }
 
+    template <typename Predicate>
+    bool any_in_node(bbox_type const& box, Predicate const& pred, node const* node_) const
+    {
+        if (node_ && box.intersects(node_->extent()))
+        {
+            for (auto const& n : *node_)
+            {
+                if (pred(n)) return true;
+            }
+            for (int k = 0; k < 4; ++k)
+            {
+                if (any_in_node(box, pred, node_->children_[k])) return true;
+            }
+        }
+        return false;
+    }
+
     void do_insert_data(value_type data, bbox_type const& box, node * n, unsigned int& depth)
     {
         if (++depth >= max_depth_)
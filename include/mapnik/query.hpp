@@ -34,6 +34,25 @@
 
 namespace mapnik {
 
+// What the active symbolizers of a layer need from its geometries, for
+// datasources that can reduce geometries before returning them.
+struct geometry_requirements
+{
+    geometry_requirements()
+        : points(false),
+          clip(false),
+          tolerance(0.0) {}
+
+    // Every symbolizer only places a symbol at the centroid of each part
+    // (the middle of lines), so the parts can be replaced by those points.
+    bool points;
+    // Every symbolizer clips geometries to the buffered extent anyway.
+    bool clip;
+    // Pixels every symbolizer simplifies geometries by anyway with the
+    // Douglas-Peucker algorithm, 0 for none.
+    double tolerance;
+};
+
 class query
 {
 public:
@@ -49,7 +68,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(unbuffered_bbox),
           names_(),
-          vars_()
+          vars_(),
+          geometry_requirements_()
     {}
 
     query(box2d<double> const& bbox,
@@ -61,7 +81,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          geometry_requirements_()
     {}
 
     query(box2d<double> const& bbox)
@@ -71,7 +92,8 @@ public:
           filter_factor_(1.0),
           unbuffered_bbox_(bbox),
           names_(),
-          vars_()
+          vars_(),
+          geometry_requirements_()
     {}
 
     query(query const& other)
@@ -81,7 +103,8 @@ public:
           filter_factor_(other.filter_factor_),
           unbuffered_bbox_(other.unbuffered_bbox_),
           names_(other.names_),
-          vars_(other.vars_)
+          vars_(other.vars_),
+          geometry_requirements_(other.geometry_requirements_)
     {}
 
     query& operator=(query const& other)
@@ -94,6 +117,7 @@ public:
         unbuffered_bbox_=other.unbuffered_bbox_;
         names_=other.names_;
         vars_=other.vars_;
+        geometry_requirements_=other.geometry_requirements_;
         return *this;
     }
 
@@ -157,6 +181,16 @@ public:
         return vars_;
     }
 
+    geometry_requirements const& get_geometry_requirements() const
+    {
+        return geometry_requirements_;
+    }
+
+    void set_geometry_requirements(geometry_requirements const& requirements)
+    {
+        geometry_requirements_ = requirements;
+    }
+
 private:
     box2d<double> bbox_;
     resolution_type resolution_;
@@ -165,6 +199,7 @@ private:
     box2d<double> unbuffered_bbox_;
     std::set<std::string> names_;
     attributes vars_;
+    geometry_requirements geometry_requirements_;
 };
 
 }
@@ -56,6 +56,8 @@ namespace mapnik
 class feature_impl;
 class raster;
 
+namespace detail { class compiled_colorizer; }
+
 
 //! \brief Enumerates the modes of interpolation
 enum colorizer_mode_enum : std::uint8_t
@@ -166,6 +168,7 @@ public:
     void set_default_mode(colorizer_mode mode)
     {
         default_mode_ = (mode == COLORIZER_INHERIT) ? COLORIZER_LINEAR : static_cast<colorizer_mode_enum>(mode);
+        compile();
     }
 
     void set_default_mode_enum(colorizer_mode_enum mode) { set_default_mode(mode); }
@@ -177,7 +180,7 @@ public:
 
     //! \brief Set the default color
     //! \param[in] color The default color
-    void set_default_color(color const& color) { default_color_ = color; }
+    void set_default_color(color const& color) { default_color_ = color; compile(); }
 
     //! \brief Get the default color
     //! \return The default color
@@ -191,8 +194,11 @@ public:
     bool add_stop(colorizer_stop const& stop);
 
     //! \brief Set the list of stops
+    //!
+    //! Stops must be in increasing order of value, as add_stop requires.
+    //! Stops not above the one before them are left out.
     //! \param[in] stops The list of stops
-    void set_stops(colorizer_stops const& stops) { stops_ = stops; }
+    void set_stops(colorizer_stops const& stops);
 
     //! \brief Get the list of stops
     //! \return The list of stops
@@ -210,18 +216,22 @@ public:
 
     //! \brief Set the epsilon value for exact mode
     //! \param[in] e The epsilon value
-    inline void set_epsilon(const float e) { if(e > 0) epsilon_ = e; }
+    inline void set_epsilon(const float e) { if(e > 0) epsilon_ = e; compile(); }
 
     //! \brief Get the epsilon value for exact mode
     //! \return The epsilon value
     inline float get_epsilon() const { return epsilon_; }
 
 private:
+    //! \brief Rebuild the lookup form of the stops used by colorize
+    void compile();
+
     colorizer_stops stops_;         //!< The vector of stops
 
     colorizer_mode default_mode_;   //!< The default mode inherited by stops
     color default_color_;           //!< The default color
     float epsilon_;                 //!< The epsilon value for exact mode
+    std::shared_ptr<detail::compiled_colorizer const> compiled_; //!< The stops resolved for colorize
 };
 
 
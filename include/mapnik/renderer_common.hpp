@@ -53,6 +53,8 @@ struct renderer_common : private util::noncopyable
                        detector_ptr detector);
     renderer_common(Map const &m, request const &req, attributes const& vars, unsigned offset_x, unsigned offset_y,
                        unsigned width, unsigned height, double scale_factor);
+    // for rendering of a detached layer, sharing no mutable state with 'other'
+    renderer_common(Map const &m, renderer_common const& other, detector_ptr detector);
     ~renderer_common();
 
     unsigned width_;
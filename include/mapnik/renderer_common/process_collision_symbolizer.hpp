@@ -102,8 +102,8 @@ public:
 protected:
     const box2d<double> size_;
     const value_bool allow_overlap_;
-    const std::vector<std::string> collision_cache_insert_;
-    const std::vector<std::string> collision_cache_detect_;
+    collision_cache_ids const& collision_cache_insert_;
+    collision_cache_ids const& collision_cache_detect_;
 };
 
 template <typename SubLayout>
@@ -64,7 +64,8 @@ struct virtual_renderer_common : private util::noncopyable
         font_manager_(common.font_manager_),
         query_extent_(common.query_extent_),
         t_(common.t_),
-        detector_(std::make_shared<label_collision_detector4>(common.detector_->extent())) {}
+        detector_(std::make_shared<label_collision_detector4>(common.detector_->extent(),
+                                                             common.detector_->index())) {}
 
     unsigned & width_;
     unsigned & height_;
@@ -139,7 +139,8 @@ struct image_warp_dispatcher
                                box2d<double> const& target_ext, box2d<double> const& source_ext,
                                double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method,
                                double filter_factor, double opacity, composite_mode_e comp_op,
-                               raster_symbolizer const& sym, feature_impl const& feature, F & composite, boost::optional<double> const& nodata)
+                               raster_symbolizer const& sym, feature_impl const& feature, F & composite, boost::optional<double> const& nodata,
+                               unsigned concurrency)
         : prj_trans_(prj_trans),
         start_x_(start_x),
         start_y_(start_y),
@@ -157,14 +158,15 @@ struct image_warp_dispatcher
         sym_(sym),
         feature_(feature),
         composite_(composite),
-        nodata_(nodata) {}
+        nodata_(nodata),
+        concurrency_(concurrency) {}
 
     void operator() (image_null const&) const {} //no-op
 
     void operator() (image_rgba8 const& data_in) const
     {
         image_rgba8 data_out(width_, height_, true, true);
-        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_);
+        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_, concurrency_);
         composite_(data_out, comp_op_, opacity_, start_x_, start_y_);
     }
 
@@ -174,7 +176,7 @@ struct image_warp_dispatcher
         using image_type = T;
         image_type data_out(width_, height_);
         if (nodata_) data_out.set(*nodata_);
-        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_);
+        warp_image(data_out, data_in, prj_trans_, target_ext_, source_ext_, offset_x_, offset_y_, mesh_size_, scaling_method_, filter_factor_, nodata_, concurrency_);
         image_rgba8 dst(width_, height_);
         raster_colorizer_ptr colorizer = get<raster_colorizer_ptr>(sym_, keys::colorizer);
         if (colorizer) colorizer->colorize(dst, data_out, nodata_, feature_);
@@ -200,6 +202,7 @@ private:
     feature_impl const& feature_;
     composite_function & composite_;
     boost::optional<double> const& nodata_;
+    unsigned concurrency_;
 };
 
 }
@@ -209,7 +212,8 @@ void render_raster_symbolizer(raster_symbolizer const& sym,
                               mapnik::feature_impl& feature,
                               proj_transform const& prj_trans,
                               renderer_common& common,
-                              F composite)
+                              F composite,
+                              unsigned concurrency = 1)
 {
     raster_ptr const& source = feature.get_raster();
     if (source)
@@ -254,7 +258,8 @@ void render_raster_symbolizer(raster_symbolizer const& sym,
                 detail::image_warp_dispatcher<F> dispatcher(prj_trans, start_x, start_y, raster_width, raster_height,
                                                                  target_query_ext, source->ext_, offset_x, offset_y, mesh_size,
                                                                  scaling_method, source->get_filter_factor(),
-                                                                 opacity, comp_op, sym, feature, composite, source->nodata());
+                                                                 opacity, comp_op, sym, feature, composite, source->nodata(),
+                                                                 concurrency);
                 util::apply_visitor(dispatcher, source->data_);
             }
             else
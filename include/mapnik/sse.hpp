@@ -153,4 +153,27 @@ _mm_scale_epu8 (__m128i x, __m128i y)
     return _mm_packus_epi16(xlo, xhi);
 }
 
+static inline __m128i
+_mm_splat_alpha_epi16 (__m128i x)
+{
+    // Broadcast the alpha channel of two RGBA pixels unpacked to 16-bit uints:
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(3,3,3,3)), _MM_SHUFFLE(3,3,3,3));
+}
+
+static inline __m128i
+_mm_mul255_epu16 (__m128i x, __m128i y)
+{
+    // Multiply 8 16-bit uints holding 8-bit values, rounding like agg:
+    // x := (x * y + 255) >> 8
+    return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(255)), 8);
+}
+
+static inline bool
+_mm_opaque_rgba (__m128i x)
+{
+    // Returns true if the 4 RGBA pixels in x are all fully opaque:
+    __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000));
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(x, alpha), alpha)) == 0xffff;
+}
+
 #endif // MAPNIK_SSE_HPP
@@ -91,7 +91,8 @@ enum class property_types : std::uint8_t
     target_upright,
     target_direction,
     target_font_feature_settings,
-    target_lacing
+    target_lacing,
+    target_collision_cache_list
 };
 
 template <typename T>
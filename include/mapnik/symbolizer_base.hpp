@@ -33,6 +33,7 @@
 #include <mapnik/group/group_symbolizer_properties.hpp>
 #include <mapnik/attribute.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
+#include <mapnik/collision_cache_list.hpp>
 #include <mapnik/util/variant.hpp>
 
 // stl
@@ -94,7 +95,8 @@ using value_base_type = util::variant<value_bool,
                                       dash_array,
                                       raster_colorizer_ptr,
                                       group_symbolizer_properties_ptr,
-                                      font_feature_settings>;
+                                      font_feature_settings,
+                                      collision_cache_list>;
 
 struct strict_value : value_base_type
 {
@@ -443,6 +443,16 @@ struct set_symbolizer_property_impl<Symbolizer,dash_array,false>
     }
 };
 
+template <typename Symbolizer>
+struct set_symbolizer_property_impl<Symbolizer,collision_cache_list,false>
+{
+    static void apply(Symbolizer & sym, keys key, std::string const& name, xml_node const & node)
+    {
+        boost::optional<std::string> list = node.get_opt_attr<std::string>(name);
+        if (list) put(sym, key, collision_cache_list(*list));
+    }
+};
+
 template <typename Symbolizer, typename T>
 struct set_symbolizer_property_impl<Symbolizer, T, true>
 {
@@ -37,9 +37,12 @@ extern "C"
 #include FT_STROKER_H
 }
 
+#include <harfbuzz/hb.h>
+
 #pragma GCC diagnostic pop
 
 //stl
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -50,7 +53,7 @@ namespace mapnik
 class MAPNIK_DECL font_face : util::noncopyable
 {
 public:
-    font_face(FT_Face face);
+    font_face(FT_Face face, std::string const& file_name, long face_index);
 
     std::string family_name() const
     {
@@ -74,6 +77,13 @@ public:
 
     inline bool is_color() const { return color_font_;}
 
+    // identifies the font in the process wide glyph_cache
+    inline std::uint32_t glyph_cache_id() const { return glyph_cache_id_; }
+
+    // HarfBuzz font for shaping, created on first use. Expects the
+    // unscaled character sizes to be set.
+    hb_font_t * hb_font() const;
+
     ~font_face();
 
 private:
@@ -83,6 +93,8 @@ private:
     FT_Face face_;
     const bool color_font_;
     const double unscaled_ascender_;
+    const std::uint32_t glyph_cache_id_;
+    mutable hb_font_t * hb_font_;
 };
 using face_ptr = std::shared_ptr<font_face>;
 
@@ -0,0 +1,138 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_TEXT_GLYPH_CACHE_HPP
+#define MAPNIK_TEXT_GLYPH_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik
+{
+
+// Coverage mask of a rasterized glyph. left/top are relative to the
+// integer pixel of the glyph origin, as in FT_BitmapGlyph.
+struct glyph_bitmap
+{
+    int left;
+    int top;
+    unsigned width;
+    unsigned rows;
+    std::vector<std::uint8_t> buffer;
+};
+
+using glyph_bitmap_ptr = std::shared_ptr<glyph_bitmap const>;
+
+struct glyph_cache_key
+{
+    std::uint32_t face_id;
+    std::uint32_t glyph_index;
+    // character size in 26.6 pixels
+    long size;
+    // rotation bucket, see text_renderer::prepare_glyphs()
+    std::int32_t angle;
+    // subpixel offset of the glyph origin in 26.6 pixels
+    std::uint8_t offset_x;
+    std::uint8_t offset_y;
+
+    bool operator==(glyph_cache_key const& rhs) const
+    {
+        return face_id == rhs.face_id &&
+            glyph_index == rhs.glyph_index &&
+            size == rhs.size &&
+            angle == rhs.angle &&
+            offset_x == rhs.offset_x &&
+            offset_y == rhs.offset_y;
+    }
+};
+
+struct glyph_cache_key_hash
+{
+    std::size_t operator()(glyph_cache_key const& key) const
+    {
+        std::size_t seed = key.face_id;
+        auto combine = [&seed](std::size_t v) { seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+        combine(key.glyph_index);
+        combine(static_cast<std::size_t>(key.size));
+        combine(static_cast<std::size_t>(key.angle));
+        combine((static_cast<std::size_t>(key.offset_x) << 8) | key.offset_y);
+        return seed;
+    }
+};
+
+struct glyph_bitmap_size
+{
+    std::size_t operator()(glyph_bitmap const& bitmap) const
+    {
+        return bitmap.buffer.size();
+    }
+};
+
+// Process wide, size bounded LRU cache of rasterized glyphs shared by all
+// renderers. Faces are identified by font file and face index, since every
+// renderer opens its own FT_Face objects.
+//
+// Off until given a capacity: cached glyphs are placed at quarter pixels
+// and angles rounded to a quarter degree, so turning it on changes output.
+class MAPNIK_DECL glyph_cache : public singleton<glyph_cache, CreateStatic>,
+                                private util::noncopyable
+{
+    friend class CreateStatic<glyph_cache>;
+public:
+    std::uint32_t face_id(std::string const& file_name, long face_index);
+    glyph_bitmap_ptr find(glyph_cache_key const& key);
+    void insert(glyph_cache_key const& key, glyph_bitmap_ptr bitmap);
+    void clear();
+    // maximum size in bytes of the cached coverage masks, 0 (the default)
+    // disables the cache
+    void set_capacity(std::size_t bytes);
+    std::size_t capacity() const;
+    std::size_t size() const;
+
+private:
+    glyph_cache();
+
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+    util::lru_cache<glyph_cache_key, glyph_bitmap, glyph_cache_key_hash, glyph_bitmap_size> cache_;
+    std::unordered_map<std::string, std::uint32_t> faces_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_GLYPH_CACHE_HPP
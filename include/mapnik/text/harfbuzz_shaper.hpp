@@ -29,17 +29,19 @@
 #include <mapnik/text/face.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
 #include <mapnik/text/itemizer.hpp>
+#include <mapnik/text/shaping_cache.hpp>
 #include <mapnik/safe_cast.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 
 // stl
+#include <algorithm>
+#include <cstdint>
 #include <list>
 #include <type_traits>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <harfbuzz/hb.h>
-#include <harfbuzz/hb-ft.h>
 #include <unicode/uvernum.h>
 #include <unicode/uscript.h>
 #pragma GCC diagnostic pop
@@ -66,6 +68,116 @@ static inline const uint16_t * uchar_to_utf16(const UChar* src)
 
 struct harfbuzz_shaper
 {
+// HarfBuzz looks at up to HB_BUFFER_CONTEXT_LENGTH code points around an
+// item, which is at most twice as many UTF-16 code units.
+static constexpr std::int32_t context_length = 10;
+
+static shaped_glyphs_ptr shape_item(hb_buffer_t * buffer,
+                                    value_unicode_string const& text,
+                                    text_item const& item,
+                                    std::vector<face_ptr> const& faces,
+                                    font_feature_settings const& ff_settings)
+{
+    std::int32_t context_start = std::max(static_cast<std::int32_t>(item.start) - context_length, 0);
+    std::int32_t context_end = std::min(static_cast<std::int32_t>(item.end) + context_length, text.length());
+    hb_direction_t direction = (item.dir == UBIDI_RTL) ? HB_DIRECTION_RTL : HB_DIRECTION_LTR;
+    hb_script_t script = _icu_script_to_script(item.script);
+
+    shaping_cache_key key;
+    key.text = text.tempSubString(context_start, context_end - context_start);
+    key.item_start = item.start - context_start;
+    key.item_length = item.end - item.start;
+    key.faces.reserve(faces.size());
+    for (auto const& face : faces)
+    {
+        key.faces.push_back(face->glyph_cache_id());
+    }
+    key.script = script;
+    key.direction = direction;
+    key.features = ff_settings.features();
+
+    shaping_cache & cache = shaping_cache::instance();
+    shaped_glyphs_ptr cached = cache.find(key);
+    if (cached)
+    {
+        return cached;
+    }
+
+    std::size_t num_faces = faces.size();
+    int ff_count = safe_cast<int>(ff_settings.count());
+    auto shaped = std::make_shared<shaped_glyphs>();
+
+    // rendering information for a single glyph
+    struct glyph_face_info
+    {
+        std::uint32_t face;
+        hb_glyph_info_t glyph;
+        hb_glyph_position_t position;
+    };
+    // this table is filled with information for rendering each glyph, so that
+    // several font faces can be used in a single text_item
+    std::vector<glyph_face_info> glyphinfos;
+    unsigned valid_glyphs = 0;
+
+    for (std::size_t pos = 0; pos < num_faces; ++pos)
+    {
+        hb_buffer_clear_contents(buffer);
+        hb_buffer_add_utf16(buffer, uchar_to_utf16(text.getBuffer()), text.length(), item.start, static_cast<int>(item.end - item.start));
+        hb_buffer_set_direction(buffer, direction);
+        hb_buffer_set_script(buffer, script);
+        hb_shape(faces[pos]->hb_font(), buffer, ff_settings.get_features(), ff_count);
+
+        unsigned num_glyphs = hb_buffer_get_length(buffer);
+
+        // if the number of rendered glyphs has increased, we need to resize the table
+        if (num_glyphs > glyphinfos.size())
+        {
+            glyphinfos.resize(num_glyphs);
+        }
+
+        hb_glyph_info_t *glyphs = hb_buffer_get_glyph_infos(buffer, nullptr);
+        hb_glyph_position_t *positions = hb_buffer_get_glyph_positions(buffer, nullptr);
+
+        // Check if all glyphs are valid.
+        for (unsigned i=0; i<num_glyphs; ++i)
+        {
+            // if we have a valid codepoint, save rendering info.
+            if (glyphs[i].codepoint)
+            {
+                if (!glyphinfos[i].glyph.codepoint)
+                {
+                    ++valid_glyphs;
+                }
+                glyphinfos[i] = { static_cast<std::uint32_t>(pos), glyphs[i], positions[i] };
+            }
+        }
+        if (valid_glyphs < num_glyphs && (pos + 1 < num_faces))
+        {
+            //Try next font in fontset
+            continue;
+        }
+
+        shaped->reserve(num_glyphs);
+        for (unsigned i=0; i<num_glyphs; ++i)
+        {
+            glyph_face_info info = { static_cast<std::uint32_t>(pos), glyphs[i], positions[i] };
+            if (glyphinfos[i].glyph.codepoint)
+            {
+                info = glyphinfos[i];
+            }
+            shaped->push_back({ info.glyph.codepoint,
+                                info.glyph.cluster - item.start,
+                                info.face,
+                                info.position.x_advance,
+                                info.position.x_offset,
+                                info.position.y_offset });
+        }
+        break; //When we reach this point the current font had all glyphs.
+    }
+    cache.insert(std::move(key), shaped);
+    return shaped;
+}
+
 static void shape_text(text_line & line,
                        text_itemizer & itemizer,
                        std::map<unsigned,double> & width_map,
@@ -85,106 +197,38 @@ static void shape_text(text_line & line,
     const std::unique_ptr<hb_buffer_t, decltype(hb_buffer_deleter)> buffer(hb_buffer_create(),hb_buffer_deleter);
     hb_buffer_pre_allocate(buffer.get(), safe_cast<int>(length));
     mapnik::value_unicode_string const& text = itemizer.text();
+    std::vector<face_ptr> faces;
 
     for (auto const& text_item : list)
     {
         face_set_ptr face_set = font_manager.get_face_set(text_item.format_->face_name, text_item.format_->fontset);
         double size = text_item.format_->text_size * scale_factor;
         face_set->set_unscaled_character_sizes();
-        std::size_t num_faces = face_set->size();
-        std::size_t pos = 0;
-        font_feature_settings const& ff_settings = text_item.format_->ff_settings;
-        int ff_count = safe_cast<int>(ff_settings.count());
+        if (face_set->size() == 0) continue;
+        faces.assign(face_set->begin(), face_set->end());
 
-        // rendering information for a single glyph
-        struct glyph_face_info
+        shaped_glyphs_ptr glyphs = shape_item(buffer.get(), text, text_item, faces,
+                                              text_item.format_->ff_settings);
+        for (auto const& glyph : *glyphs)
         {
-            face_ptr face;
-            hb_glyph_info_t glyph;
-            hb_glyph_position_t position;
-        };
-        // this table is filled with information for rendering each glyph, so that 
-        // several font faces can be used in a single text_item
-        std::vector<glyph_face_info> glyphinfos;
-        unsigned valid_glyphs = 0;
-
-        for (auto const& face : *face_set)
-        {
-            ++pos;
-            hb_buffer_clear_contents(buffer.get());
-            hb_buffer_add_utf16(buffer.get(), uchar_to_utf16(text.getBuffer()), text.length(), text_item.start, static_cast<int>(text_item.end - text_item.start));
-            hb_buffer_set_direction(buffer.get(), (text_item.dir == UBIDI_RTL)?HB_DIRECTION_RTL:HB_DIRECTION_LTR);
-            hb_buffer_set_script(buffer.get(), _icu_script_to_script(text_item.script));
-            hb_font_t *font(hb_ft_font_create(face->get_face(), nullptr));
-            // https://github.com/mapnik/test-data-visual/pull/25
-            #if HB_VERSION_MAJOR > 0
-             #if HB_VERSION_ATLEAST(1, 0 , 5)
-            hb_ft_font_set_load_flags(font,FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING);
-             #endif
-            #endif
-            hb_shape(font, buffer.get(), ff_settings.get_features(), ff_count);
-            hb_font_destroy(font);
-
-            unsigned num_glyphs = hb_buffer_get_length(buffer.get());
-
-            // if the number of rendered glyphs has increased, we need to resize the table 
-            if (num_glyphs > glyphinfos.size())
+            face_ptr const& theface = faces[glyph.face];
+            unsigned char_index = text_item.start + glyph.cluster;
+            glyph_info g(glyph.codepoint,char_index,text_item.format_);
+            if (theface->glyph_dimensions(g))
             {
-                glyphinfos.resize(num_glyphs);
-            }
-
-            hb_glyph_info_t *glyphs = hb_buffer_get_glyph_infos(buffer.get(), nullptr);
-            hb_glyph_position_t *positions = hb_buffer_get_glyph_positions(buffer.get(), nullptr);
-
-            // Check if all glyphs are valid.
-            for (unsigned i=0; i<num_glyphs; ++i)
-            {
-                // if we have a valid codepoint, save rendering info.
-                if (glyphs[i].codepoint)
-                {
-                    if (!glyphinfos[i].glyph.codepoint)
-                    {
-                        ++valid_glyphs;
-                    }
-                    glyphinfos[i] = { face, glyphs[i], positions[i] };
-                }
-            }
-            if (valid_glyphs < num_glyphs && (pos < num_faces))
-            {
-                //Try next font in fontset
-                continue;
-            }
-
-            for (unsigned i=0; i<num_glyphs; ++i)
-            {
-                auto& gpos = positions[i];
-                auto& glyph = glyphs[i];
-                face_ptr theface = face;
-                if (glyphinfos[i].glyph.codepoint)
-                {
-                    gpos = glyphinfos[i].position;
-                    glyph = glyphinfos[i].glyph;
-                    theface = glyphinfos[i].face;
-                }
-                unsigned char_index = glyph.cluster;
-                glyph_info g(glyph.codepoint,char_index,text_item.format_);
-                if (theface->glyph_dimensions(g))
+                g.face = theface;
+                g.scale_multiplier = theface->get_face()->units_per_EM > 0 ?
+                    (size / theface->get_face()->units_per_EM) : (size / 2048.0) ;
+                //Overwrite default advance with better value provided by HarfBuzz
+                // TODO: Why FT advance is more precise for color fonts?
+                if (!g.face->is_color())
                 {
-                    g.face = theface;
-                    g.scale_multiplier = theface->get_face()->units_per_EM > 0 ?
-                        (size / theface->get_face()->units_per_EM) : (size / 2048.0) ;
-                    //Overwrite default advance with better value provided by HarfBuzz
-                    // TODO: Why FT advance is more precise for color fonts?
-                    if (!g.face->is_color())
-                    {
-                        g.unscaled_advance = gpos.x_advance;
-                    }
-                    g.offset.set(gpos.x_offset * g.scale_multiplier, gpos.y_offset * g.scale_multiplier);
-                    width_map[char_index] += g.advance();
-                    line.add_glyph(std::move(g), scale_factor);
+                    g.unscaled_advance = glyph.x_advance;
                 }
+                g.offset.set(glyph.x_offset * g.scale_multiplier, glyph.y_offset * g.scale_multiplier);
+                width_map[char_index] += g.advance();
+                line.add_glyph(std::move(g), scale_factor);
             }
-            break; //When we reach this point the current font had all glyphs.
         }
     }
 }
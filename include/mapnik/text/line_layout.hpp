@@ -242,10 +242,14 @@ private:
         layout_container & layouts,
         glyph_positions_ptr & glyphs);
 
+    bool outside_canvas(
+        evaluated_text_properties const & text_props,
+        box_type const& box) const;
+
     bool collision(
         detector_type & detector,
         evaluated_text_properties const & text_props,
-        box_type const& box,
+        glyph_positions const& glyphs,
         const value_unicode_string &repeat_key) const;
 
     bool is_reachable(
@@ -254,8 +258,8 @@ private:
         text_layout const & layout) const;
 
     params_type const & params_;
-    const std::vector<std::string> collision_cache_insert_;
-    const std::vector<std::string> collision_cache_detect_;
+    collision_cache_ids const& collision_cache_insert_;
+    collision_cache_ids const& collision_cache_detect_;
 };
 
 }//ns mapnik
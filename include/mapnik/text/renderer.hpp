@@ -29,8 +29,10 @@
 #include <mapnik/util/noncopyable.hpp>
 #include <mapnik/font_engine_freetype.hpp>
 #include <mapnik/text/glyph_positions.hpp>
+#include <mapnik/text/glyph_cache.hpp>
 #include <mapnik/value_types.hpp>
 #include <mapnik/pixel_position.hpp>
+#include <mapnik/box2d.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -57,23 +59,33 @@ namespace mapnik
 struct glyph_t
 {
     glyph_info const& info;
+    // loaded on demand, see text_renderer::load_glyph()
     FT_Glyph image;
     pixel_position pos;
     rotation rot;
     double size;
     box2d<double> bbox;
+    // rotation and pen, snapped for the glyph cache, see text_renderer::prepare_glyphs()
+    FT_Matrix matrix;
+    FT_Vector pen;
+    std::int32_t angle;
     glyph_t(glyph_info const& info_,
-            FT_Glyph image_,
             pixel_position const& pos_,
             rotation const& rot_,
             double size_,
-            box2d<double> const& bbox_)
+            box2d<double> const& bbox_,
+            FT_Matrix const& matrix_,
+            FT_Vector const& pen_,
+            std::int32_t angle_)
         : info(info_),
-          image(image_),
+          image(nullptr),
           pos(pos_),
           rot(rot_),
           size(size_),
-          bbox(bbox_) {}
+          bbox(bbox_),
+          matrix(matrix_),
+          pen(pen_),
+          angle(angle_) {}
 };
 
 class text_renderer : private util::noncopyable
@@ -85,6 +97,8 @@ public:
                    double scale_factor = 1.0,
                    stroker_ptr stroker = stroker_ptr());
 
+    ~text_renderer();
+
     void set_comp_op(composite_mode_e comp_op)
     {
         comp_op_ = comp_op;
@@ -115,7 +129,11 @@ public:
 
 protected:
     using glyph_vector = std::vector<glyph_t>;
-    void prepare_glyphs(glyph_positions const& positions);
+    // Snapping rotations and pens lets rasterized glyphs be shared through
+    // the glyph_cache, but moves them slightly. Only done for cached glyphs.
+    void prepare_glyphs(glyph_positions const& positions, bool snap = false);
+    bool load_glyph(glyph_t & glyph);
+    void release_glyphs();
     halo_rasterizer_e rasterizer_;
     composite_mode_e comp_op_;
     composite_mode_e halo_comp_op_;
@@ -162,11 +180,26 @@ public:
                        double scale_factor = 1.0,
                        stroker_ptr stroker = stroker_ptr());
     void render(glyph_positions const& positions);
+    // Pixels rendered so far, maximum coordinates are exclusive
+    box2d<int> const& painted_extent() const
+    {
+        return painted_extent_;
+    }
 private:
     pixmap_type & pixmap_;
     halo_cache halo_cache_;
+    box2d<int> painted_extent_;
+
+    void mark_painted(int x, int y, int width, int height, int padding = 0)
+    {
+        painted_extent_.expand_to_include(box2d<int>(x - padding, y - padding,
+                                                     x + width + padding, y + height + padding));
+    }
+
+    glyph_bitmap_ptr rasterize(glyph_t & glyph, FT_Vector const& start,
+                               int & left, int & top);
 
-    void render_halo(unsigned char *buffer,
+    void render_halo(unsigned char const* buffer,
                      unsigned width,
                      unsigned height,
                      unsigned pixel_width,
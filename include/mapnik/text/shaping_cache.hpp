@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_TEXT_SHAPING_CACHE_HPP
+#define MAPNIK_TEXT_SHAPING_CACHE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/value_types.hpp>
+#include <mapnik/text/font_feature_settings.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#include <mapnik/util/lru_cache.hpp>
+
+// stl
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <harfbuzz/hb.h>
+#include <unicode/unistr.h>
+#pragma GCC diagnostic pop
+
+namespace mapnik
+{
+
+// A glyph chosen by HarfBuzz for a text item. Positions are in font units
+// (unscaled character sizes), so a shaped run is valid for any text size.
+struct shaped_glyph
+{
+    std::uint32_t codepoint;
+    // relative to the start of the text item
+    std::uint32_t cluster;
+    // index of the face in the face set
+    std::uint32_t face;
+    hb_position_t x_advance;
+    hb_position_t x_offset;
+    hb_position_t y_offset;
+};
+
+using shaped_glyphs = std::vector<shaped_glyph>;
+using shaped_glyphs_ptr = std::shared_ptr<shaped_glyphs const>;
+
+struct shaping_cache_key
+{
+    // text of the item plus the surrounding context seen by HarfBuzz
+    value_unicode_string text;
+    std::uint32_t item_start;
+    std::uint32_t item_length;
+    // glyph_cache face ids of the face set, in fallback order
+    std::vector<std::uint32_t> faces;
+    hb_script_t script;
+    hb_direction_t direction;
+    font_feature_settings::feature_vector features;
+
+    bool operator==(shaping_cache_key const& rhs) const
+    {
+        return item_start == rhs.item_start &&
+            item_length == rhs.item_length &&
+            script == rhs.script &&
+            direction == rhs.direction &&
+            faces == rhs.faces &&
+            features == rhs.features &&
+            text == rhs.text;
+    }
+};
+
+struct shaping_cache_key_hash
+{
+    std::size_t operator()(shaping_cache_key const& key) const
+    {
+        std::size_t seed = static_cast<std::size_t>(key.text.hashCode());
+        auto combine = [&seed](std::size_t v) { seed ^= v + 0x9e3779b9 + (seed << 6) + (seed >> 2); };
+        combine(key.item_start);
+        combine(key.item_length);
+        combine(static_cast<std::size_t>(key.script));
+        combine(static_cast<std::size_t>(key.direction));
+        for (auto face : key.faces) combine(face);
+        for (auto const& feature : key.features) combine(feature.tag ^ (feature.value << 1));
+        return seed;
+    }
+};
+
+// Process wide LRU cache of HarfBuzz shaping results, shared by all
+// renderers so repeated labels are shaped once.
+class MAPNIK_DECL shaping_cache : public singleton<shaping_cache, CreateStatic>,
+                                  private util::noncopyable
+{
+    friend class CreateStatic<shaping_cache>;
+public:
+    shaped_glyphs_ptr find(shaping_cache_key const& key);
+    void insert(shaping_cache_key key, shaped_glyphs_ptr glyphs);
+    void clear();
+    // maximum number of cached text items, 0 disables the cache
+    void set_capacity(std::size_t items);
+    std::size_t capacity() const;
+    std::size_t size() const;
+
+private:
+    shaping_cache();
+
+    util::lru_cache<shaping_cache_key, shaped_glyphs, shaping_cache_key_hash> cache_;
+};
+
+}
+
+#endif // MAPNIK_TEXT_SHAPING_CACHE_HPP
@@ -234,7 +234,9 @@ public:
         label_placement::placement_params params {
             prj_trans, t, affine_trans, sym, feature, vars,
             box2d<double>(0, 0, width, height), query_extent,
-            scale_factor, sc };
+            scale_factor, sc,
+            label_placement::collision_cache_keys(detector, sym, keys::collision_cache_insert, feature, vars),
+            label_placement::collision_cache_keys(detector, sym, keys::collision_cache_detect, feature, vars) };
 
         text_placement_info_ptr placement_info = mapnik::get<text_placements_ptr>(
             sym, keys::text_placements_)->get_placement_info(scale_factor,
@@ -0,0 +1,200 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_UNIFORM_GRID_HPP
+#define MAPNIK_UNIFORM_GRID_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/util/noncopyable.hpp>
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace mapnik
+{
+
+// Flat grid of equally sized cells over a fixed extent. Each cell keeps
+// indices into a single value store, so a query only touches the cells
+// overlapped by the box instead of walking a tree. Values not fully
+// inside the extent are kept in the border cells.
+template <typename T0, typename T1 = box2d<double>>
+class uniform_grid : util::noncopyable
+{
+    using cell_type = std::vector<std::uint32_t>;
+
+public:
+    using value_type = T0;
+    using bbox_type = T1;
+    using result_type = std::vector<std::reference_wrapper<value_type> >;
+    using query_iterator = typename result_type::iterator;
+
+    explicit uniform_grid(bbox_type const& ext,
+                          double cell_size = 64.0,
+                          unsigned max_cells = 256)
+        : extent_(ext),
+          cell_size_(std::max({ cell_size,
+                                ext.width() / max_cells,
+                                ext.height() / max_cells,
+                                std::numeric_limits<double>::min() })),
+          cols_(cell_count(ext.width())),
+          rows_(cell_count(ext.height())),
+          values_(),
+          stamps_(),
+          stamp_(0),
+          cells_(),
+          query_result_()
+    {
+    }
+
+    void insert(value_type data, bbox_type const& box)
+    {
+        if (cells_.empty())
+        {
+            // allocated lazily, an unused grid costs nothing
+            cells_.resize(cols_ * rows_);
+        }
+        std::uint32_t index = static_cast<std::uint32_t>(values_.size());
+        values_.push_back(std::move(data));
+        stamps_.push_back(0);
+        std::size_t x0, y0, x1, y1;
+        cell_range(box, x0, y0, x1, y1);
+        for (std::size_t y = y0; y <= y1; ++y)
+        {
+            for (std::size_t x = x0; x <= x1; ++x)
+            {
+                cells_[y * cols_ + x].push_back(index);
+            }
+        }
+    }
+
+    // Returns true as soon as `pred` holds for any value stored in a cell
+    // intersecting the box. Each value is tested at most once.
+    template <typename Predicate>
+    bool any_in_box(bbox_type const& box, Predicate const& pred) const
+    {
+        if (values_.empty() || !box.intersects(extent_)) return false;
+        std::uint32_t stamp = next_stamp();
+        std::size_t x0, y0, x1, y1;
+        cell_range(box, x0, y0, x1, y1);
+        for (std::size_t y = y0; y <= y1; ++y)
+        {
+            for (std::size_t x = x0; x <= x1; ++x)
+            {
+                for (std::uint32_t index : cells_[y * cols_ + x])
+                {
+                    if (stamps_[index] == stamp) continue;
+                    stamps_[index] = stamp;
+                    if (pred(values_[index])) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    query_iterator query_in_box(bbox_type const& box)
+    {
+        query_result_.clear();
+        any_in_box(box, [this](value_type const& v)
+        {
+            query_result_.push_back(std::ref(values_[&v - values_.data()]));
+            return false;
+        });
+        return query_result_.begin();
+    }
+
+    query_iterator query_end()
+    {
+        return query_result_.end();
+    }
+
+    void clear()
+    {
+        values_.clear();
+        stamps_.clear();
+        for (auto & cell : cells_)
+        {
+            cell.clear();
+        }
+    }
+
+    bbox_type const& extent() const
+    {
+        return extent_;
+    }
+
+    int count_items() const
+    {
+        return static_cast<int>(values_.size());
+    }
+
+private:
+    std::size_t cell_count(double length) const
+    {
+        return std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(length / cell_size_)));
+    }
+
+    std::size_t cell_index(double offset, std::size_t count) const
+    {
+        if (!(offset > 0)) return 0;
+        return std::min(static_cast<std::size_t>(offset / cell_size_), count - 1);
+    }
+
+    void cell_range(bbox_type const& box,
+                    std::size_t & x0, std::size_t & y0,
+                    std::size_t & x1, std::size_t & y1) const
+    {
+        x0 = cell_index(box.minx() - extent_.minx(), cols_);
+        y0 = cell_index(box.miny() - extent_.miny(), rows_);
+        x1 = cell_index(box.maxx() - extent_.minx(), cols_);
+        y1 = cell_index(box.maxy() - extent_.miny(), rows_);
+    }
+
+    std::uint32_t next_stamp() const
+    {
+        if (++stamp_ == 0)
+        {
+            std::fill(stamps_.begin(), stamps_.end(), 0);
+            stamp_ = 1;
+        }
+        return stamp_;
+    }
+
+    bbox_type extent_;
+    double cell_size_;
+    std::size_t cols_;
+    std::size_t rows_;
+    std::vector<value_type> values_;
+    // last query each value was visited by
+    mutable std::vector<std::uint32_t> stamps_;
+    mutable std::uint32_t stamp_;
+    std::vector<cell_type> cells_;
+    result_type query_result_;
+};
+}
+
+#endif // MAPNIK_UNIFORM_GRID_HPP
@@ -0,0 +1,226 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_FEATURESET_PREFETCH_HPP
+#define MAPNIK_FEATURESET_PREFETCH_HPP
+
+// mapnik
+#include <mapnik/featureset.hpp>
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <cstddef>
+#include <memory>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace mapnik {
+
+#ifdef MAPNIK_THREADSAFE
+
+// Featureset buffering features of another featureset
+// which are pulled from it on a different thread. At most
+// `capacity` features are buffered, so streaming sources
+// are not read ahead of the renderer any further.
+class prefetch_featureset : public Featureset
+{
+public:
+    prefetch_featureset(featureset_ptr const& source, std::size_t capacity)
+      : source_(source),
+        capacity_(std::max(capacity, std::size_t(1))),
+        features_(),
+        done_(false),
+        cancelled_(false),
+        error_()
+    {}
+
+    virtual ~prefetch_featureset() {}
+
+    // blocks until the next feature is available, ends early once cancelled
+    feature_ptr next()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return !features_.empty() || done_ || cancelled_; });
+        if (cancelled_)
+        {
+            return feature_ptr();
+        }
+        if (!features_.empty())
+        {
+            feature_ptr feature = std::move(features_.front());
+            features_.pop_front();
+            not_full_.notify_one();
+            return feature;
+        }
+        if (error_)
+        {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+        return feature_ptr();
+    }
+
+    // pulls all features of the source featureset, blocks
+    // while the buffer is full
+    void fetch()
+    {
+        try
+        {
+            feature_ptr feature;
+            while (!cancelled_ && (feature = source_->next()))
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                not_full_.wait(lock, [this] { return features_.size() < capacity_ || cancelled_; });
+                if (cancelled_) break;
+                features_.push_back(std::move(feature));
+                not_empty_.notify_one();
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        done_ = true;
+        source_.reset();
+        not_empty_.notify_all();
+    }
+
+    void cancel()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        cancelled_ = true;
+        not_full_.notify_all();
+        not_empty_.notify_all();
+    }
+
+private:
+    featureset_ptr source_;
+    const std::size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+    std::deque<feature_ptr> features_;
+    bool done_;
+    std::atomic<bool> cancelled_;
+    std::exception_ptr error_;
+};
+
+// Bounded set of threads pulling features of registered featuresets
+// in order of their registration. Featuresets are consumed in the
+// same order, so a thread blocked on a full buffer is always freed
+// by the renderer eventually.
+class featureset_prefetcher : private util::noncopyable
+{
+public:
+    explicit featureset_prefetcher(unsigned concurrency, std::size_t capacity = 256)
+      : concurrency_(concurrency),
+        capacity_(capacity),
+        featuresets_(),
+        next_(0),
+        threads_()
+    {}
+
+    ~featureset_prefetcher()
+    {
+        cancel();
+        for (std::thread & t : threads_)
+        {
+            t.join();
+        }
+    }
+
+    featureset_ptr add(featureset_ptr const& source)
+    {
+        auto fs = std::make_shared<prefetch_featureset>(source, capacity_);
+        featuresets_.push_back(fs);
+        return fs;
+    }
+
+    void start()
+    {
+        std::size_t num_threads = std::min(static_cast<std::size_t>(concurrency_),
+                                           featuresets_.size());
+        for (std::size_t i = 0; i < num_threads; ++i)
+        {
+            threads_.emplace_back(&featureset_prefetcher::run, this);
+        }
+    }
+
+    // stops reading, featuresets not read to the end yet end right away
+    void cancel()
+    {
+        next_ = featuresets_.size();
+        for (auto const& fs : featuresets_)
+        {
+            fs->cancel();
+        }
+    }
+
+private:
+    void run()
+    {
+        for (std::size_t i = next_++; i < featuresets_.size(); i = next_++)
+        {
+            featuresets_[i]->fetch();
+        }
+    }
+
+    const unsigned concurrency_;
+    const std::size_t capacity_;
+    std::vector<std::shared_ptr<prefetch_featureset>> featuresets_;
+    std::atomic<std::size_t> next_;
+    std::vector<std::thread> threads_;
+};
+
+#else
+
+// Without thread support featuresets are read by the renderer itself.
+class featureset_prefetcher : private util::noncopyable
+{
+public:
+    explicit featureset_prefetcher(unsigned, std::size_t = 256) {}
+
+    featureset_ptr add(featureset_ptr const& source)
+    {
+        return source;
+    }
+
+    void start() {}
+    void cancel() {}
+};
+
+#endif
+
+}
+
+#endif // MAPNIK_FEATURESET_PREFETCH_HPP
@@ -27,6 +27,7 @@
 #include <mapnik/config.hpp>
 
 // stl
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -42,6 +43,9 @@ MAPNIK_DECL std::string make_absolute(std::string const& filepath, std::string c
 MAPNIK_DECL std::string dirname(std::string const& value);
 MAPNIK_DECL std::string basename(std::string const& value);
 MAPNIK_DECL std::vector<std::string> list_directory(std::string const& value);
+// size and last modification time in nanoseconds since the epoch of a
+// regular file, false if it can not be read
+MAPNIK_DECL bool file_stat(std::string const& value, std::uint64_t & size, std::int64_t & mtime);
 
 }}
 
@@ -0,0 +1,213 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_UTIL_LRU_CACHE_HPP
+#define MAPNIK_UTIL_LRU_CACHE_HPP
+
+// mapnik
+#include <mapnik/util/noncopyable.hpp>
+
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+namespace mapnik { namespace util {
+
+// Size policy counting every value as one
+template <typename Value>
+struct lru_entry_count
+{
+    std::size_t operator()(Value const&) const
+    {
+        return 1;
+    }
+};
+
+// Least recently used cache of shared, immutable values. The sizes of the
+// values as given by SizePolicy add up to at most the capacity of the cache,
+// the least recently used values are dropped to make room for new ones.
+// Values stay valid for whoever holds them after they have been dropped.
+//
+// Locks around every call in MAPNIK_THREADSAFE builds. Values are meant to
+// be made by the caller without holding the lock, a value made by two
+// threads at once is only kept once, see insert().
+template <typename Key,
+          typename Value,
+          typename Hash = std::hash<Key>,
+          typename SizePolicy = lru_entry_count<Value> >
+class lru_cache : private noncopyable
+{
+public:
+    using value_ptr = std::shared_ptr<Value const>;
+
+    explicit lru_cache(std::size_t capacity = 0, SizePolicy size_of = SizePolicy())
+        : size_of_(size_of),
+          capacity_(capacity),
+          size_(0),
+          lru_(),
+          index_() {}
+
+    // The cached value of `key`, marked as most recently used,
+    // or nullptr if it is not cached
+    value_ptr find(Key const& key)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr == index_.end())
+        {
+            return value_ptr();
+        }
+        lru_.splice(lru_.begin(), lru_, itr->second);
+        return itr->second->second;
+    }
+
+    // Caches `value` unless `key` is cached already and returns the cached
+    // value. With a capacity of 0 nothing is kept.
+    value_ptr insert(Key key, value_ptr value)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = index_.find(key);
+        if (itr != index_.end())
+        {
+            lru_.splice(lru_.begin(), lru_, itr->second);
+            return itr->second->second;
+        }
+        if (capacity_ == 0)
+        {
+            return value;
+        }
+        auto result = index_.emplace(std::move(key), lru_.end());
+        lru_.emplace_front(&result.first->first, value);
+        result.first->second = lru_.begin();
+        size_ += size_of_(*value);
+        evict();
+        return value;
+    }
+
+    // Drops the values whose keys match `pred`
+    template <typename Predicate>
+    void erase_if(Predicate pred)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        for (auto itr = lru_.begin(); itr != lru_.end();)
+        {
+            if (pred(*itr->first))
+            {
+                size_ -= size_of_(*itr->second);
+                index_.erase(index_.find(*itr->first));
+                itr = lru_.erase(itr);
+            }
+            else
+            {
+                ++itr;
+            }
+        }
+    }
+
+    void clear()
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        index_.clear();
+        lru_.clear();
+        size_ = 0;
+    }
+
+    void set_capacity(std::size_t capacity)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        capacity_ = capacity;
+        evict();
+    }
+
+    // Grows the capacity to at least `capacity`, for caches shared by
+    // several users asking for different sizes
+    void reserve(std::size_t capacity)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        capacity_ = std::max(capacity_, capacity);
+    }
+
+    std::size_t capacity() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return capacity_;
+    }
+
+    // sum of the sizes of the cached values
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return size_;
+    }
+
+private:
+    // keys are owned by index_, whose nodes are stable
+    using entry_type = std::pair<Key const*, value_ptr>;
+    using lru_type = std::list<entry_type>;
+
+    void evict()
+    {
+        while (size_ > capacity_ && !lru_.empty())
+        {
+            size_ -= size_of_(*lru_.back().second);
+            index_.erase(index_.find(*lru_.back().first));
+            lru_.pop_back();
+        }
+    }
+
+    SizePolicy size_of_;
+    std::size_t capacity_;
+    std::size_t size_;
+    lru_type lru_;
+    std::unordered_map<Key, typename lru_type::iterator, Hash> index_;
+#ifdef MAPNIK_THREADSAFE
+    mutable std::mutex mutex_;
+#endif
+};
+
+}}
+
+#endif // MAPNIK_UTIL_LRU_CACHE_HPP
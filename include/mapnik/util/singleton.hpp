@@ -135,6 +135,12 @@ template <typename T,
             }
             return *tmp;
         }
+
+        // whether the instance has been destroyed at exit already
+        static bool destroyed()
+        {
+            return destroyed_;
+        }
     };
 
 #ifdef MAPNIK_THREADSAFE
@@ -29,8 +29,13 @@
 #include <mapnik/query.hpp>
 #include <mapnik/geom_util.hpp>
 // stl
+#include <algorithm>
 #include <type_traits>
 #include <cstring>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
 
 using mapnik::box2d;
 using mapnik::query;
@@ -38,21 +43,178 @@ using mapnik::query;
 namespace mapnik { namespace util {
 
 
+enum spatial_index_format
+{
+    SPATIAL_INDEX_INVALID = 0,
+    SPATIAL_INDEX_QUAD_TREE, // "mapnik-index", see mapnik::quad_tree
+    SPATIAL_INDEX_PACKED_RTREE // "mapnik-rtree", see mapnik::packed_rtree
+};
+
 template <typename InputStream>
-bool check_spatial_index(InputStream& in)
+spatial_index_format read_spatial_index_header(InputStream& in)
 {
     char header[17]; // mapnik-index
     std::memset(header, 0, 17);
     in.read(header,16);
-    return (std::strncmp(header, "mapnik-index",12) == 0);
+    if (std::strncmp(header, "mapnik-index",12) == 0) return SPATIAL_INDEX_QUAD_TREE;
+    if (std::strncmp(header, "mapnik-rtree",12) == 0 && header[12] == 1) return SPATIAL_INDEX_PACKED_RTREE;
+    return SPATIAL_INDEX_INVALID;
+}
+
+template <typename InputStream>
+bool check_spatial_index(InputStream& in)
+{
+    return read_spatial_index_header(in) != SPATIAL_INDEX_INVALID;
+}
+
+namespace detail {
+
+// Walks an index held in memory, e.g. a mapped file
+struct index_memory_reader
+{
+    index_memory_reader(char const* begin, std::size_t size, std::size_t pos)
+        : begin_(begin), pos_(begin + pos), end_(begin + size)
+    {
+        if (pos > size) pos_ = end_ = nullptr;
+    }
+
+    // like a stream, a truncated index reads as the end of the index
+    void read(void * dst, std::size_t size)
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < size)
+        {
+            pos_ = end_ = nullptr;
+            return;
+        }
+        std::memcpy(dst, pos_, size);
+        pos_ += size;
+    }
+
+    void skip(std::size_t size)
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < size) pos_ = end_ = nullptr;
+        else pos_ += size;
+    }
+
+    void seek(std::size_t pos)
+    {
+        if (end_ == nullptr || static_cast<std::size_t>(end_ - begin_) < pos) pos_ = end_ = nullptr;
+        else pos_ = begin_ + pos;
+    }
+
+    bool good() const
+    {
+        return pos_ != nullptr;
+    }
+
+    char const* begin_;
+    char const* pos_;
+    char const* end_;
+};
+
+template <typename InputStream>
+struct index_stream_reader
+{
+    explicit index_stream_reader(InputStream & in)
+        : in_(in) {}
+
+    void read(void * dst, std::size_t size)
+    {
+        in_.read(reinterpret_cast<char*>(dst), size);
+    }
+
+    void skip(std::size_t size)
+    {
+        in_.seekg(size, std::ios::cur);
+    }
+
+    void seek(std::size_t pos)
+    {
+        in_.seekg(pos, std::ios::beg);
+    }
+
+    bool good() const
+    {
+        return in_.good();
+    }
+
+    InputStream & in_;
+};
+
+// boost::interprocess::ibufferstream and friends expose their buffer,
+// those are walked directly in memory instead of through the stream
+template <typename InputStream>
+auto make_index_reader(InputStream & in, int)
+    -> decltype(in.buffer().first, index_memory_reader(nullptr, 0, 0))
+{
+    auto buffer = in.buffer();
+    std::streamoff pos = in.tellg();
+    if (pos < 0) return index_memory_reader(nullptr, 0, 1);
+    return index_memory_reader(buffer.first, buffer.second, static_cast<std::size_t>(pos));
+}
+
+template <typename InputStream>
+index_stream_reader<InputStream> make_index_reader(InputStream & in, long)
+{
+    return index_stream_reader<InputStream>(in);
+}
+
+template <typename Reader>
+std::int32_t read_index_integer(Reader & reader)
+{
+    char b[4] = {0, 0, 0, 0};
+    reader.read(b, 4);
+    return (b[0] & 0xff) | (b[1] & 0xff) << 8 | (b[2] & 0xff) << 16 | (b[3] & 0xff) << 24;
 }
 
+// Layout of a "mapnik-rtree" index, see mapnik::packed_rtree
+template <typename BBox>
+struct packed_rtree_layout
+{
+    std::size_t node_size = 0;
+    std::size_t value_size = 0;
+    std::vector<std::size_t> counts; // entries per level, root first
+    std::vector<std::size_t> offsets; // of each level
+    std::size_t values_offset = 0;
+    BBox extent;
+
+    template <typename Reader>
+    bool read(Reader & reader)
+    {
+        std::int32_t node = read_index_integer(reader);
+        std::int32_t value = read_index_integer(reader);
+        std::int32_t levels = read_index_integer(reader);
+        if (!reader.good() || node < 2 || value <= 0 || levels <= 0 || levels > 64) return false;
+        node_size = node;
+        value_size = value;
+        std::size_t pos = 16 + 12 + 4 * levels + sizeof(BBox);
+        std::size_t const alignment = node_size * sizeof(BBox);
+        for (std::int32_t i = 0; i < levels; ++i)
+        {
+            std::int32_t count = read_index_integer(reader);
+            if (count < 0) return false;
+            pos += (alignment - pos % alignment) % alignment;
+            counts.push_back(count);
+            offsets.push_back(pos);
+            pos += count * sizeof(BBox);
+        }
+        values_offset = pos + (alignment - pos % alignment) % alignment;
+        reader.read(&extent, sizeof(BBox));
+        return reader.good();
+    }
+};
+
+} // ns detail
+
 template <typename Value, typename Filter, typename InputStream, typename BBox = box2d<double> >
 class spatial_index
 {
     using bbox_type = BBox;
 public:
     static void query(Filter const& filter, InputStream& in,std::vector<Value>& pos);
+    // Single pass over the index for several filters, e.g. the sub-tiles of
+    // a metatile, results[i] receives the values passing filters[i]
+    static void query(std::vector<Filter> const& filters, InputStream& in, std::vector<std::vector<Value>>& results);
     static bbox_type bounding_box( InputStream& in );
     static void query_first_n(Filter const& filter, InputStream & in, std::vector<Value>& pos, std::size_t count);
 private:
@@ -60,20 +222,36 @@ private:
     ~spatial_index();
     spatial_index(spatial_index const&);
     spatial_index& operator=(spatial_index const&);
-    static int read_ndr_integer(InputStream& in);
     static void read_envelope(InputStream& in, bbox_type& envelope);
-    static void query_node(Filter const& filter, InputStream& in, std::vector<Value> & results);
-    static void query_first_n_impl(Filter const& filter, InputStream& in, std::vector<Value> & results, std::size_t count);
+    template <typename Reader>
+    static void query_nodes(Filter const& filter, Reader & reader, std::vector<Value> & results, std::size_t count);
+    template <typename Reader>
+    static void query_nodes(std::vector<Filter> const& filters, Reader & reader, std::vector<std::vector<Value>> & results);
+    template <typename Reader>
+    static detail::packed_rtree_layout<bbox_type> read_layout(Reader & reader);
+    template <typename Reader>
+    static void query_packed(Filter const& filter, Reader & reader, detail::packed_rtree_layout<bbox_type> const& layout,
+                             std::vector<Value> & results, std::size_t count);
 };
 
 template <typename Value, typename Filter, typename InputStream, typename BBox>
 BBox spatial_index<Value, Filter, InputStream, BBox>::bounding_box(InputStream& in)
 {
     static_assert(std::is_standard_layout<Value>::value, "Values stored in quad-tree must be standard layout type");
-    if (!check_spatial_index(in)) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
-    in.seekg(16 + 4, std::ios::beg);
+    spatial_index_format format = read_spatial_index_header(in);
+    if (format == SPATIAL_INDEX_INVALID) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
     typename spatial_index<Value, Filter, InputStream, BBox>::bbox_type box;
-    read_envelope(in, box);
+    if (format == SPATIAL_INDEX_PACKED_RTREE)
+    {
+        auto reader = detail::make_index_reader(in, 0);
+        box = read_layout(reader).extent;
+    }
+    else
+    {
+        in.seekg(16 + 4, std::ios::beg);
+        read_envelope(in, box);
+    }
+    in.clear();
     in.seekg(0, std::ios::beg);
     return box;
 }
@@ -81,36 +259,30 @@ BBox spatial_index<Value, Filter, InputStream, BBox>::bounding_box(InputStream&
 template <typename Value, typename Filter, typename InputStream, typename BBox>
 void spatial_index<Value, Filter, InputStream, BBox>::query(Filter const& filter, InputStream& in, std::vector<Value>& results)
 {
-    static_assert(std::is_standard_layout<Value>::value, "Values stored in quad-tree must be standard layout type");
-    if (!check_spatial_index(in)) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
-    in.seekg(16, std::ios::beg);
-    query_node(filter, in, results);
+    query_first_n(filter, in, results, std::numeric_limits<std::size_t>::max());
 }
 
 template <typename Value, typename Filter, typename InputStream, typename BBox>
-void spatial_index<Value, Filter, InputStream, BBox>::query_node(Filter const& filter, InputStream& in, std::vector<Value>& results)
+void spatial_index<Value, Filter, InputStream, BBox>::query(std::vector<Filter> const& filters, InputStream& in, std::vector<std::vector<Value>>& results)
 {
-    int offset = read_ndr_integer(in);
-    typename spatial_index<Value, Filter, InputStream, BBox>::bbox_type node_ext;
-    read_envelope(in, node_ext);
-    int num_shapes = read_ndr_integer(in);
-    if (!filter.pass(node_ext))
-    {
-        in.seekg(offset + num_shapes * sizeof(Value) + 4, std::ios::cur);
-        return;
-    }
-
-    for (int i = 0; i < num_shapes; ++i)
+    static_assert(std::is_standard_layout<Value>::value, "Values stored in quad-tree must be standard layout type");
+    spatial_index_format format = read_spatial_index_header(in);
+    if (format == SPATIAL_INDEX_INVALID) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
+    results.resize(filters.size());
+    if (filters.empty()) return;
+    auto reader = detail::make_index_reader(in, 0);
+    if (format == SPATIAL_INDEX_PACKED_RTREE)
     {
-        Value item;
-        in.read(reinterpret_cast<char*>(&item), sizeof(Value));
-        results.push_back(std::move(item));
+        // the upper levels are small, each filter walks them on its own
+        auto layout = read_layout(reader);
+        for (std::size_t i = 0; i < filters.size(); ++i)
+        {
+            query_packed(filters[i], reader, layout, results[i], std::numeric_limits<std::size_t>::max());
+        }
     }
-
-    int children = read_ndr_integer(in);
-    for (int j = 0; j < children; ++j)
+    else
     {
-        query_node(filter, in, results);
+        query_nodes(filters, reader, results);
     }
 }
 
@@ -118,44 +290,182 @@ template <typename Value, typename Filter, typename InputStream, typename BBox>
 void spatial_index<Value, Filter, InputStream, BBox>::query_first_n(Filter const& filter, InputStream& in, std::vector<Value>& results, std::size_t count)
 {
     static_assert(std::is_standard_layout<Value>::value, "Values stored in quad-tree must be standard layout type");
-    if (!check_spatial_index(in)) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
-    in.seekg(16, std::ios::beg);
-    query_first_n_impl(filter, in, results, count);
+    spatial_index_format format = read_spatial_index_header(in);
+    if (format == SPATIAL_INDEX_INVALID) throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
+    auto reader = detail::make_index_reader(in, 0);
+    if (format == SPATIAL_INDEX_PACKED_RTREE)
+    {
+        auto layout = read_layout(reader);
+        query_packed(filter, reader, layout, results, count);
+    }
+    else
+    {
+        query_nodes(filter, reader, results, count);
+    }
 }
 
 template <typename Value, typename Filter, typename InputStream, typename BBox>
-void spatial_index<Value, Filter, InputStream, BBox>::query_first_n_impl(Filter const& filter, InputStream& in, std::vector<Value>& results, std::size_t count)
+template <typename Reader>
+detail::packed_rtree_layout<BBox> spatial_index<Value, Filter, InputStream, BBox>::read_layout(Reader & reader)
 {
-    if (results.size() == count) return;
-    int offset = read_ndr_integer(in);
-    typename spatial_index<Value, Filter, InputStream, BBox>::bbox_type node_ext;
-    read_envelope(in, node_ext);
-    int num_shapes = read_ndr_integer(in);
-    if (!filter.pass(node_ext))
+    detail::packed_rtree_layout<bbox_type> layout;
+    if (!layout.read(reader) || layout.value_size != sizeof(Value))
     {
-        in.seekg(offset + num_shapes * sizeof(Value) + 4, std::ios::cur);
-        return;
+        throw std::runtime_error("Invalid index file (regenerate with shapeindex)");
     }
+    return layout;
+}
 
-    for (int i = 0; i < num_shapes; ++i)
+// Visits the tree a level at a time so each level, and the values, are read
+// front to back. Leaves are filtered on their own box.
+template <typename Value, typename Filter, typename InputStream, typename BBox>
+template <typename Reader>
+void spatial_index<Value, Filter, InputStream, BBox>::query_packed(Filter const& filter, Reader & reader,
+                                                                   detail::packed_rtree_layout<BBox> const& layout,
+                                                                   std::vector<Value>& results, std::size_t count)
+{
+    if (results.size() >= count) return;
+    std::size_t const levels = layout.counts.size();
+    std::vector<std::size_t> candidates;
+    std::vector<std::size_t> passed;
+    for (std::size_t i = 0; i < layout.counts[0]; ++i) candidates.push_back(i);
+    for (std::size_t level = 0; level < levels && !candidates.empty(); ++level)
+    {
+        bool leaves = (level + 1 == levels);
+        passed.clear();
+        std::size_t next = std::numeric_limits<std::size_t>::max();
+        for (std::size_t i : candidates)
+        {
+            if (i != next) reader.seek(layout.offsets[level] + i * sizeof(bbox_type));
+            next = i + 1;
+            bbox_type box;
+            reader.read(&box, sizeof(bbox_type));
+            if (!reader.good()) return;
+            if (!filter.pass(box)) continue;
+            if (leaves)
+            {
+                passed.push_back(i);
+                if (results.size() + passed.size() >= count) break;
+            }
+            else
+            {
+                std::size_t first = i * layout.node_size;
+                std::size_t last = std::min(first + layout.node_size, layout.counts[level + 1]);
+                for (std::size_t j = first; j < last; ++j) passed.push_back(j);
+            }
+        }
+        candidates.swap(passed);
+    }
+    std::size_t next = std::numeric_limits<std::size_t>::max();
+    for (std::size_t i : candidates)
     {
+        if (i != next) reader.seek(layout.values_offset + i * sizeof(Value));
+        next = i + 1;
         Value item;
-        in.read(reinterpret_cast<char*>(&item), sizeof(Value));
-        if (results.size() < count) results.push_back(std::move(item));
+        reader.read(&item, sizeof(Value));
+        if (!reader.good()) return;
+        results.push_back(item);
     }
-    int children = read_ndr_integer(in);
-    for (int j = 0; j < children; ++j)
+}
+
+// Nodes are stored depth first as
+//   [subtree size][envelope][num values][values...][num children][children...]
+// and are walked with an explicit stack of children left to visit per level.
+template <typename Value, typename Filter, typename InputStream, typename BBox>
+template <typename Reader>
+void spatial_index<Value, Filter, InputStream, BBox>::query_nodes(Filter const& filter, Reader & reader, std::vector<Value>& results, std::size_t count)
+{
+    std::vector<std::int32_t> pending(1, 1);
+    while (!pending.empty() && results.size() < count && reader.good())
     {
-        query_first_n_impl(filter, in, results, count);
+        if (pending.back() <= 0)
+        {
+            pending.pop_back();
+            continue;
+        }
+        --pending.back();
+        std::int32_t offset = detail::read_index_integer(reader);
+        bbox_type node_ext;
+        reader.read(&node_ext, sizeof(node_ext));
+        std::int32_t num_shapes = detail::read_index_integer(reader);
+        if (!reader.good() || num_shapes < 0) break;
+        if (!filter.pass(node_ext))
+        {
+            reader.skip(offset + num_shapes * sizeof(Value) + 4);
+            continue;
+        }
+        std::size_t num = std::min(static_cast<std::size_t>(num_shapes), count - results.size());
+        std::size_t size = results.size();
+        results.resize(size + num);
+        reader.read(results.data() + size, num * sizeof(Value));
+        reader.skip((num_shapes - num) * sizeof(Value));
+        if (!reader.good())
+        {
+            results.resize(size);
+            break;
+        }
+        std::int32_t children = detail::read_index_integer(reader);
+        if (children > 0) pending.push_back(children);
     }
 }
 
 template <typename Value, typename Filter, typename InputStream, typename BBox>
-int spatial_index<Value, Filter, InputStream, BBox>::read_ndr_integer(InputStream& in)
+template <typename Reader>
+void spatial_index<Value, Filter, InputStream, BBox>::query_nodes(std::vector<Filter> const& filters, Reader & reader, std::vector<std::vector<Value>>& results)
 {
-    char b[4];
-    in.read(b, 4);
-    return (b[0] & 0xff) | (b[1] & 0xff) << 8 | (b[2] & 0xff) << 16 | (b[3] & 0xff) << 24;
+    // indices of the filters passing each node on the current path,
+    // a level sees the range passing its parent node
+    struct level
+    {
+        std::int32_t pending;
+        std::size_t first;
+        std::size_t last;
+    };
+    std::vector<std::size_t> active;
+    active.reserve(filters.size() * 4);
+    for (std::size_t i = 0; i < filters.size(); ++i) active.push_back(i);
+    std::vector<level> levels(1, level{1, 0, filters.size()});
+    while (!levels.empty() && reader.good())
+    {
+        if (levels.back().pending <= 0)
+        {
+            active.resize(levels.back().first);
+            levels.pop_back();
+            continue;
+        }
+        --levels.back().pending;
+        std::size_t first = levels.back().first;
+        std::size_t last = levels.back().last;
+        std::int32_t offset = detail::read_index_integer(reader);
+        bbox_type node_ext;
+        reader.read(&node_ext, sizeof(node_ext));
+        std::int32_t num_shapes = detail::read_index_integer(reader);
+        if (!reader.good() || num_shapes < 0) break;
+        std::size_t node_first = active.size();
+        for (std::size_t i = first; i < last; ++i)
+        {
+            if (filters[active[i]].pass(node_ext)) active.push_back(active[i]);
+        }
+        std::size_t node_last = active.size();
+        if (node_first == node_last)
+        {
+            reader.skip(offset + num_shapes * sizeof(Value) + 4);
+            continue;
+        }
+        for (std::int32_t j = 0; j < num_shapes; ++j)
+        {
+            Value item;
+            reader.read(&item, sizeof(Value));
+            if (!reader.good()) break;
+            for (std::size_t i = node_first; i < node_last; ++i)
+            {
+                results[active[i]].push_back(item);
+            }
+        }
+        std::int32_t children = detail::read_index_integer(reader);
+        if (children > 0) levels.push_back(level{children, node_first, node_last});
+        else active.resize(node_first);
+    }
 }
 
 template <typename Value, typename Filter, typename InputStream, typename BBox>
@@ -47,11 +47,13 @@ MAPNIK_DECL void reproject_and_scale_raster(raster & target, raster const& sourc
                                             unsigned mesh_size,
                                             scaling_method_e scaling_method);
 
+// Rows of large targets are rendered in bands on up to `concurrency`
+// threads, the result does not depend on the number of threads.
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                              box2d<double> const& target_ext, box2d<double> const& source_ext,
                              double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
-                             boost::optional<double> const & nodata_value);
+                             boost::optional<double> const & nodata_value, unsigned concurrency = 1);
 }
 
 #endif // MAPNIK_WARP_HPP
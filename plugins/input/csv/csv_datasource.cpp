@@ -60,6 +60,7 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <thread>
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -75,6 +76,12 @@ csv_datasource::csv_datasource(parameters const& params)
     row_limit_ = *params.get<mapnik::value_integer>("row_limit", 0);
     manual_headers_ = mapnik::util::trim_copy(*params.get<std::string>("headers", ""));
     strict_ = *params.get<mapnik::boolean_type>("strict", false);
+#if defined(MAPNIK_THREADSAFE)
+    // rows are parsed on all cores unless told otherwise
+    mapnik::value_integer concurrency = *params.get<mapnik::value_integer>("concurrency", 0);
+    concurrency_ = concurrency > 0 ? static_cast<unsigned>(concurrency)
+        : std::max(1u, std::thread::hardware_concurrency());
+#endif
 
     auto quote_param = params.get<std::string>("quote");
     if (quote_param)
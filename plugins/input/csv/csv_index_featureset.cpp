@@ -73,11 +73,22 @@ csv_index_featureset::csv_index_featureset(std::string const& filename,
 #endif
 
     std::string indexname = filename + ".index";
+#if defined (MAPNIK_MEMORY_MAPPED_FILE)
+    boost::optional<mapnik::mapped_region_ptr> index_memory =
+        mapnik::mapped_memory_cache::instance().find(indexname, true);
+    if (!index_memory) throw mapnik::datasource_exception("CSV Plugin: can't open index file " + indexname);
+    boost::interprocess::ibufferstream index(static_cast<char const*>((*index_memory)->get_address()),
+                                             (*index_memory)->get_size());
+    mapnik::util::spatial_index<value_type,
+                                mapnik::filter_in_box,
+                                boost::interprocess::ibufferstream>::query(filter, index, positions_);
+#else
     std::ifstream index(indexname.c_str(), std::ios::binary);
     if (!index) throw mapnik::datasource_exception("CSV Plugin: can't open index file " + indexname);
     mapnik::util::spatial_index<value_type,
                                 mapnik::filter_in_box,
                                 std::ifstream>::query(filter, index, positions_);
+#endif
 
     std::sort(positions_.begin(), positions_.end(),
               [](value_type const& lhs, value_type const& rhs) { return lhs.first < rhs.first;});
@@ -39,6 +39,7 @@
 #include <string>
 #include <cstdio>
 #include <algorithm>
+#include <thread>
 
 namespace csv_utils {
 namespace detail {
@@ -233,6 +234,118 @@ bool ignore_case_equal(std::string const& s0, std::string const& s1)
                       s1.begin(), ignore_case_equal_pred());
 }
 
+namespace {
+
+// Rows parsed by a single thread between reads
+constexpr std::size_t rows_per_thread = 1024;
+
+struct csv_row
+{
+    std::size_t line_number;
+    std::size_t offset;
+    std::string line;
+};
+
+struct csv_row_result
+{
+    enum { OK, DATASOURCE_ERROR, ERROR } status = OK;
+    mapnik::csv_line values;
+    mapnik::box2d<double> box;
+    std::string error;
+};
+
+void parse_row(csv_row const& row, std::size_t num_headers, char separator, char quote,
+               geometry_column_locator const& locator, csv_row_result & result)
+{
+    try
+    {
+        auto const* line_start = row.line.data();
+        auto const* line_end = line_start + row.line.size();
+        result.values = csv_utils::parse_line(line_start, line_end, separator, quote, num_headers);
+        unsigned num_fields = result.values.size();
+        if (num_fields != num_headers)
+        {
+            std::ostringstream s;
+            s << "CSV Plugin: # of columns(" << num_fields << ")";
+            if (num_fields > num_headers)
+            {
+                s << " > ";
+            }
+            else
+            {
+                s << " < ";
+            }
+            s << "# of headers(" << num_headers << ") parsed";
+            throw mapnik::datasource_exception(s.str());
+        }
+
+        auto geom = extract_geometry(result.values, locator);
+        if (!geom.is<mapnik::geometry::geometry_empty>())
+        {
+            result.box = mapnik::geometry::envelope(geom);
+        }
+        else
+        {
+            std::ostringstream s;
+            s << "CSV Plugin: expected geometry column: could not parse row "
+              << row.line_number << " "
+              << result.values.at(locator.index) << "'";
+            throw mapnik::datasource_exception(s.str());
+        }
+    }
+    catch (mapnik::datasource_exception const& ex )
+    {
+        result.status = csv_row_result::DATASOURCE_ERROR;
+        result.error = ex.what();
+    }
+    catch (std::exception const& ex)
+    {
+        std::ostringstream s;
+        s << "CSV Plugin: unexpected error parsing line: " << row.line_number
+          << " - found " << num_headers << " with values like: " << row.line << "\n"
+          << " and got error like: " << ex.what();
+        result.status = csv_row_result::ERROR;
+        result.error = s.str();
+    }
+}
+
+// Parses rows on up to `concurrency` threads, each taking a contiguous band
+void parse_rows(std::vector<csv_row> const& rows, std::size_t num_headers, char separator, char quote,
+                geometry_column_locator const& locator, unsigned concurrency,
+                std::vector<csv_row_result> & results)
+{
+    results.clear();
+    results.resize(rows.size());
+    auto func = [&](std::size_t start, std::size_t end)
+    {
+        for (std::size_t i = start; i < end; ++i)
+        {
+            parse_row(rows[i], num_headers, separator, quote, locator, results[i]);
+        }
+    };
+    std::size_t bands = std::min(static_cast<std::size_t>(concurrency),
+                                 (rows.size() + rows_per_thread - 1) / rows_per_thread);
+    if (bands <= 1)
+    {
+        func(0, rows.size());
+        return;
+    }
+    std::size_t band = (rows.size() + bands - 1) / bands;
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    for (std::size_t start = band; start < rows.size(); start += band)
+    {
+        threads.emplace_back(func, start, std::min(start + band, rows.size()));
+    }
+    func(0, band);
+    for (std::thread & t : threads)
+    {
+        t.join();
+    }
+}
+
+}
+
 void csv_file_parser::add_feature(mapnik::value_integer, mapnik::csv_line const & )
 {
     // no-op by default
@@ -360,101 +473,82 @@ void csv_file_parser::parse_csv_and_boxes(std::istream & csv_file, T & boxes)
         }
     }
 
-    while (is_first_row || csv_utils::getline_csv(csv_file, csv_line, newline, quote_))
+    // with an index only the first row is needed, see below
+    std::size_t const batch_size = (has_disk_index_ || concurrency_ <= 1) ? 1 : rows_per_thread * concurrency_;
+    std::vector<csv_row> rows;
+    std::vector<csv_row_result> results;
+    rows.reserve(batch_size);
+    bool more = true;
+    while (more)
     {
-        ++line_number;
-        if ((row_limit_ > 0) && (line_number > row_limit_))
+        rows.clear();
+        while (rows.size() < batch_size)
         {
-            MAPNIK_LOG_DEBUG(csv) << "csv_datasource: row limit hit, exiting at feature: " << feature_count;
-            break;
-        }
-        auto record_offset = pos;
-        auto record_size = csv_line.length();
-        pos = csv_file.tellg();
-        is_first_row = false;
-
-        // skip blank lines
-        if (record_size <= 10)
-        {
-            std::string trimmed = csv_line;
-            boost::trim_if(trimmed, boost::algorithm::is_any_of("\",'\r\n "));
-            if (trimmed.empty())
+            if (!is_first_row && !csv_utils::getline_csv(csv_file, csv_line, newline, quote_))
             {
-                MAPNIK_LOG_DEBUG(csv) << "csv_datasource: empty row encountered at line: " << line_number;
-                continue;
+                more = false;
+                break;
             }
-        }
+            ++line_number;
+            if ((row_limit_ > 0) && (line_number > row_limit_))
+            {
+                MAPNIK_LOG_DEBUG(csv) << "csv_datasource: row limit hit, exiting at feature: " << feature_count;
+                more = false;
+                break;
+            }
+            auto record_offset = pos;
+            auto record_size = csv_line.length();
+            pos = csv_file.tellg();
+            is_first_row = false;
 
-        try
-        {
-            auto const* line_start = csv_line.data();
-            auto const* line_end = line_start + csv_line.size();
-            auto values = csv_utils::parse_line(line_start, line_end, separator_, quote_, num_headers);
-            unsigned num_fields = values.size();
-            if (num_fields != num_headers)
+            // skip blank lines
+            if (record_size <= 10)
             {
-                std::ostringstream s;
-                s << "CSV Plugin: # of columns(" << num_fields << ")";
-                if (num_fields > num_headers)
+                std::string trimmed = csv_line;
+                boost::trim_if(trimmed, boost::algorithm::is_any_of("\",'\r\n "));
+                if (trimmed.empty())
                 {
-                    s << " > ";
+                    MAPNIK_LOG_DEBUG(csv) << "csv_datasource: empty row encountered at line: " << line_number;
+                    continue;
                 }
-                else
-                {
-                    s << " < ";
-                }
-                s << "# of headers(" << num_headers << ") parsed";
-                throw mapnik::datasource_exception(s.str());
             }
+            rows.push_back(csv_row{static_cast<std::size_t>(line_number), static_cast<std::size_t>(record_offset), std::string()});
+            rows.back().line.swap(csv_line);
+        }
 
-            auto geom = extract_geometry(values, locator_);
-            if (!geom.is<mapnik::geometry::geometry_empty>())
+        parse_rows(rows, num_headers, separator_, quote_, locator_, concurrency_, results);
+
+        // merge in file order
+        for (std::size_t i = 0; i < rows.size(); ++i)
+        {
+            csv_row_result & result = results[i];
+            if (result.status == csv_row_result::OK)
             {
-                auto box = mapnik::geometry::envelope(geom);
                 if (!extent_initialized_)
                 {
                     if (extent_.valid())
-                        extent_.expand_to_include(box);
+                        extent_.expand_to_include(result.box);
                     else
-                        extent_ = box;
+                        extent_ = result.box;
                 }
-                boxes.emplace_back(box_type(box), make_pair(record_offset, record_size));
-                add_feature(++feature_count, values);
+                boxes.emplace_back(box_type(result.box), std::make_pair(rows[i].offset, rows[i].line.length()));
+                add_feature(++feature_count, result.values);
             }
-            else
+            else if (strict_)
             {
-                std::ostringstream s;
-                s << "CSV Plugin: expected geometry column: could not parse row "
-                  << line_number << " "
-                  << values.at(locator_.index) << "'";
-                throw mapnik::datasource_exception(s.str());
+                throw mapnik::datasource_exception(result.error);
             }
-        }
-        catch (mapnik::datasource_exception const& ex )
-        {
-            if (strict_) throw ex;
-            else
-            {
-                MAPNIK_LOG_ERROR(csv) << ex.what() << " at line: " << line_number;
-            }
-        }
-        catch (std::exception const& ex)
-        {
-            std::ostringstream s;
-            s << "CSV Plugin: unexpected error parsing line: " << line_number
-              << " - found " << headers_.size() << " with values like: " << csv_line << "\n"
-              << " and got error like: " << ex.what();
-            if (strict_)
+            else if (result.status == csv_row_result::DATASOURCE_ERROR)
             {
-                throw mapnik::datasource_exception(s.str());
+                MAPNIK_LOG_ERROR(csv) << result.error << " at line: " << rows[i].line_number;
             }
             else
             {
-                MAPNIK_LOG_ERROR(csv) << s.str();
+                MAPNIK_LOG_ERROR(csv) << result.error;
             }
+            // return early if *.index is present
+            if (has_disk_index_) return;
         }
-        // return early if *.index is present
-        if (has_disk_index_) return;
     }
 }
 
@@ -140,6 +140,9 @@ struct csv_file_parser
     geometry_column_locator locator_;
     mapnik::box2d<double> extent_;
     mapnik::value_integer row_limit_ = 0;
+    // number of threads parsing rows, rows are still read and
+    // merged in file order on the calling thread
+    unsigned concurrency_ = 1;
     char separator_ = '\0';
     char quote_ = '\0';
     bool strict_ = false;
@@ -0,0 +1,179 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GDAL_BLOCK_CACHE_HPP
+#define GDAL_BLOCK_CACHE_HPP
+
+// mapnik
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/singleton.hpp>
+
+// boost
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/functional/hash.hpp>
+#pragma GCC diagnostic pop
+
+// stl
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+// gdal
+#include <gdal_priv.h>
+
+// Decoded pixels of GDAL bands, kept in cells that follow the block layout
+// of each band. Windows are assembled from whole cells, so the blocks under
+// neighbouring tiles are read and decoded only once. Shared by all GDAL
+// datasources asking for it, the least recently used cells are dropped once
+// the cache holds more bytes than reserved.
+class gdal_block_cache : public mapnik::singleton<gdal_block_cache, mapnik::CreateStatic>
+{
+    struct cell
+    {
+        int width;
+        int height;
+        std::vector<char> data;
+    };
+
+    struct cell_size_of
+    {
+        std::size_t operator()(cell const& c) const
+        {
+            return c.data.size();
+        }
+    };
+
+    using cell_ptr = std::shared_ptr<cell const>;
+    // dataset, band, column, row, pixel type
+    using key_type = std::tuple<GDALDataset const*, GDALRasterBand const*, int, int, int>;
+
+public:
+    // the cache grows to the largest size in bytes asked for by any datasource
+    void reserve(std::size_t max_size)
+    {
+        cells_.reserve(max_size);
+    }
+
+    // Drops the cells of `dataset`, before it is closed
+    void erase(GDALDataset const* dataset)
+    {
+        cells_.erase_if([dataset](key_type const& key) { return std::get<0>(key) == dataset; });
+    }
+
+    // Same as GDALRasterBand::RasterIO reading `width` x `height` pixels at
+    // `x`, `y` of `band` of `dataset` without resampling: pixels are written
+    // as `type`, and a spacing of 0 means packed pixels and rows.
+    CPLErr read(GDALDataset const& dataset, GDALRasterBand & band, int x, int y, int width, int height,
+                void * data, GDALDataType type, int pixel_space = 0, int line_space = 0)
+    {
+        int type_size = GDALGetDataTypeSize(type) / 8;
+        if (pixel_space == 0) pixel_space = type_size;
+        if (line_space == 0) line_space = pixel_space * width;
+
+        int cell_width = 0;
+        int cell_height = 0;
+        cell_size(band, cell_width, cell_height);
+
+        char * out = static_cast<char *>(data);
+        for (int row = y / cell_height; row * cell_height < y + height; ++row)
+        {
+            for (int col = x / cell_width; col * cell_width < x + width; ++col)
+            {
+                cell_ptr c = get(dataset, band, col, row, cell_width, cell_height, type);
+                if (!c) return CE_Failure;
+                int x0 = std::max(x, col * cell_width);
+                int x1 = std::min(x + width, col * cell_width + c->width);
+                int y0 = std::max(y, row * cell_height);
+                int y1 = std::min(y + height, row * cell_height + c->height);
+                for (int j = y0; j < y1; ++j)
+                {
+                    char const* src = c->data.data() +
+                        (static_cast<std::ptrdiff_t>(j - row * cell_height) * c->width +
+                         (x0 - col * cell_width)) * type_size;
+                    char * dst = out + static_cast<std::ptrdiff_t>(j - y) * line_space +
+                        static_cast<std::ptrdiff_t>(x0 - x) * pixel_space;
+                    if (pixel_space == type_size)
+                    {
+                        std::memcpy(dst, src, (x1 - x0) * type_size);
+                    }
+                    else
+                    {
+                        for (int i = x0; i < x1; ++i, src += type_size, dst += pixel_space)
+                        {
+                            std::memcpy(dst, src, type_size);
+                        }
+                    }
+                }
+            }
+        }
+        return CE_None;
+    }
+
+private:
+    friend class mapnik::CreateStatic<gdal_block_cache>;
+
+    gdal_block_cache()
+        : cells_() {}
+
+    // Cells are whole blocks, except that wide strips are split and thin
+    // ones grouped so a window never pulls in whole scanlines of the band.
+    static void cell_size(GDALRasterBand & band, int & width, int & height)
+    {
+        band.GetBlockSize(&width, &height);
+        width = clamp_size(width);
+        height = clamp_size(height);
+    }
+
+    static int clamp_size(int block_size)
+    {
+        if (block_size <= 0 || block_size > 1024) return 256;
+        if (block_size < 64) return ((64 + block_size - 1) / block_size) * block_size;
+        return block_size;
+    }
+
+    cell_ptr get(GDALDataset const& dataset, GDALRasterBand & band, int col, int row,
+                 int cell_width, int cell_height, GDALDataType type)
+    {
+        key_type key(&dataset, &band, col, row, static_cast<int>(type));
+        cell_ptr cached = cells_.find(key);
+        if (cached) return cached;
+        // read without holding the lock, as reads of the dataset without the
+        // cache do; a cell read by two threads at once is only kept once
+        auto c = std::make_shared<cell>();
+        c->width = std::min(cell_width, band.GetXSize() - col * cell_width);
+        c->height = std::min(cell_height, band.GetYSize() - row * cell_height);
+        int type_size = GDALGetDataTypeSize(type) / 8;
+        c->data.resize(static_cast<std::size_t>(c->width) * c->height * type_size);
+        CPLErr err = band.RasterIO(GF_Read, col * cell_width, row * cell_height, c->width, c->height,
+                                   c->data.data(), c->width, c->height, type, 0, 0);
+        if (err == CE_Failure) return cell_ptr();
+        return cells_.insert(key, c);
+    }
+
+    mapnik::util::lru_cache<key_type, cell, boost::hash<key_type>, cell_size_of> cells_;
+};
+
+#endif // GDAL_BLOCK_CACHE_HPP
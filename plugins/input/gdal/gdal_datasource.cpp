@@ -22,6 +22,7 @@
 
 #include "gdal_datasource.hpp"
 #include "gdal_featureset.hpp"
+#include "gdal_block_cache.hpp"
 
 // mapnik
 #include <mapnik/debug.hpp>
@@ -82,7 +83,9 @@ gdal_datasource::gdal_datasource(parameters const& params)
       dataset_(nullptr, &GDALClose),
       desc_(gdal_datasource::name(), "utf-8"),
       nodata_value_(params.get<double>("nodata")),
-      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12))
+      nodata_tolerance_(*params.get<double>("nodata_tolerance",1e-12)),
+      use_overviews_(*params.get<mapnik::boolean_type>("use_overviews", false)),
+      use_block_cache_(false)
 {
     MAPNIK_LOG_DEBUG(gdal) << "gdal_datasource: Initializing...";
 
@@ -111,6 +114,15 @@ gdal_datasource::gdal_datasource(parameters const& params)
     shared_dataset_ = *params.get<mapnik::boolean_type>("shared", false);
     band_ = *params.get<mapnik::value_integer>("band", -1);
 
+    // decoded blocks are kept in a cache shared by all datasources asking
+    // for one, bounded by the largest size asked for
+    mapnik::value_integer block_cache_size = *params.get<mapnik::value_integer>("block_cache_size", 0);
+    if (block_cache_size > 0)
+    {
+        gdal_block_cache::instance().reserve(block_cache_size);
+        use_block_cache_ = true;
+    }
+
 #if GDAL_VERSION_NUM >= 1600
     if (shared_dataset_)
     {
@@ -220,6 +232,10 @@ gdal_datasource::gdal_datasource(parameters const& params)
 gdal_datasource::~gdal_datasource()
 {
     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Closing Dataset=" << dataset_.get();
+    if (use_block_cache_ && dataset_)
+    {
+        gdal_block_cache::instance().erase(dataset_.get());
+    }
 }
 
 datasource::datasource_t gdal_datasource::type() const
@@ -263,7 +279,9 @@ featureset_ptr gdal_datasource::features(query const& q) const
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_);
+                                              nodata_tolerance_,
+                                              use_overviews_,
+                                              use_block_cache_);
 }
 
 featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol) const
@@ -282,5 +300,7 @@ featureset_ptr gdal_datasource::features_at_point(coord2d const& pt, double tol)
                                               dx_,
                                               dy_,
                                               nodata_value_,
-                                              nodata_tolerance_);
+                                              nodata_tolerance_,
+                                              use_overviews_,
+                                              use_block_cache_);
 }
@@ -68,6 +68,8 @@ private:
     bool shared_dataset_;
     boost::optional<double> nodata_value_;
     double nodata_tolerance_;
+    bool use_overviews_;
+    bool use_block_cache_;
 };
 
 #endif // GDAL_DATASOURCE_HPP
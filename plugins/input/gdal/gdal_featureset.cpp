@@ -31,11 +31,13 @@
 #include <mapnik/feature_factory.hpp>
 
 // stl
+#include <algorithm>
 #include <cmath>
 #include <memory>
 #include <sstream>
 
 #include "gdal_featureset.hpp"
+#include "gdal_block_cache.hpp"
 #include <gdal_priv.h>
 
 using mapnik::box2d;
@@ -79,6 +81,54 @@ void get_overview_meta(GDALRasterBand* band)
 }
 } // anonymous ns
 #endif
+
+namespace {
+
+// Index of the coarsest overview that still has a pixel for each output
+// pixel, where `factor_x`, `factor_y` are full resolution pixels per output
+// pixel, or -1 if only the full resolution will do. All bands read into one
+// image must have the overview at the same size.
+int select_overview(GDALDataset & dataset, int band, int nbands,
+                    double factor_x, double factor_y,
+                    int & overview_width, int & overview_height)
+{
+    GDALRasterBand * first = dataset.GetRasterBand(band > 0 ? band : 1);
+    if (first == nullptr) return -1;
+    int selected = -1;
+    double selected_scale = 1.0;
+    for (int i = 0; i < first->GetOverviewCount(); ++i)
+    {
+        GDALRasterBand * overview = first->GetOverview(i);
+        if (overview == nullptr || overview->GetXSize() <= 0 || overview->GetYSize() <= 0) continue;
+        double scale_x = static_cast<double>(first->GetXSize()) / overview->GetXSize();
+        double scale_y = static_cast<double>(first->GetYSize()) / overview->GetYSize();
+        if (scale_x <= factor_x && scale_y <= factor_y && scale_x > selected_scale)
+        {
+            selected = i;
+            selected_scale = scale_x;
+            overview_width = overview->GetXSize();
+            overview_height = overview->GetYSize();
+        }
+    }
+    if (selected >= 0 && band <= 0)
+    {
+        for (int i = 2; i <= nbands; ++i)
+        {
+            GDALRasterBand * other = dataset.GetRasterBand(i);
+            GDALRasterBand * overview = other ? other->GetOverview(selected) : nullptr;
+            if (overview == nullptr ||
+                overview->GetXSize() != overview_width ||
+                overview->GetYSize() != overview_height)
+            {
+                return -1;
+            }
+        }
+    }
+    return selected;
+}
+
+} // anonymous ns
+
 gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  int band,
                                  gdal_query q,
@@ -89,7 +139,9 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
                                  double dx,
                                  double dy,
                                  boost::optional<double> const& nodata,
-                                 double nodata_tolerance)
+                                 double nodata_tolerance,
+                                 bool use_overviews,
+                                 bool use_block_cache)
     : dataset_(dataset),
       ctx_(std::make_shared<mapnik::context_type>()),
       band_(band),
@@ -102,6 +154,13 @@ gdal_featureset::gdal_featureset(GDALDataset& dataset,
       nbands_(nbands),
       nodata_value_(nodata),
       nodata_tolerance_(nodata_tolerance),
+      use_overviews_(use_overviews),
+      use_block_cache_(use_block_cache),
+      overview_(-1),
+      overview_width_(0),
+      overview_height_(0),
+      window_{0, 0, 0, 0},
+      source_window_{0, 0, 0, 0},
       first_(true)
 {
     ctx_->push("nodata");
@@ -155,6 +214,8 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
     //size of resized output pixel in source image domain
     double margin_x = 1.0 / (std::fabs(dx_) * std::get<0>(q.resolution()));
     double margin_y = 1.0 / (std::fabs(dy_) * std::get<1>(q.resolution()));
+    double const factor_x = margin_x;
+    double const factor_y = margin_y;
     if (margin_x < 1)
     {
         margin_x = 1.0;
@@ -190,14 +251,49 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
     int width = end_x - x_off;
     int height = end_y - y_off;
 
+    //read from the coarsest overview that still resolves the output,
+    //widening the window to whole overview pixels
+    overview_ = -1;
+    window_ = window{x_off, y_off, width, height};
+    source_window_ = window_;
+    double scale_x = 1.0;
+    double scale_y = 1.0;
+    if (use_overviews_ && width > 0 && height > 0)
+    {
+        overview_ = select_overview(dataset_, band_, nbands_, factor_x, factor_y,
+                                    overview_width_, overview_height_);
+    }
+    if (overview_ >= 0)
+    {
+        scale_x = static_cast<double>(raster_width_) / overview_width_;
+        scale_y = static_cast<double>(raster_height_) / overview_height_;
+        int ov_x = static_cast<int>(std::floor(x_off / scale_x));
+        int ov_y = static_cast<int>(std::floor(y_off / scale_y));
+        int ov_end_x = std::min(static_cast<int>(std::ceil(end_x / scale_x)), overview_width_);
+        int ov_end_y = std::min(static_cast<int>(std::ceil(end_y / scale_y)), overview_height_);
+        window_ = window{ov_x, ov_y, ov_end_x - ov_x, ov_end_y - ov_y};
+        int src_x = static_cast<int>(rint(ov_x * scale_x));
+        int src_y = static_cast<int>(rint(ov_y * scale_y));
+        int src_end_x = std::min(static_cast<int>(rint(ov_end_x * scale_x)), static_cast<int>(raster_width_));
+        int src_end_y = std::min(static_cast<int>(rint(ov_end_y * scale_y)), static_cast<int>(raster_height_));
+        source_window_ = window{src_x, src_y, src_end_x - src_x, src_end_y - src_y};
+        width = window_.width;
+        height = window_.height;
+        MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Overview=" << overview_
+                               << " Size=" << overview_width_ << "x" << overview_height_;
+    }
+
     //calculate actual box2d of returned raster
-    box2d<double> feature_raster_extent(x_off, y_off, x_off + width, y_off + height);
+    box2d<double> feature_raster_extent(window_.x * scale_x,
+                                        window_.y * scale_y,
+                                        std::min((window_.x + window_.width) * scale_x, static_cast<double>(raster_width_)),
+                                        std::min((window_.y + window_.height) * scale_y, static_cast<double>(raster_height_)));
     feature_raster_extent = t.backward(feature_raster_extent);
 
     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Raster extent=" << raster_extent_;
     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: View extent=" << intersect;
     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: Query resolution=" << std::get<0>(q.resolution()) << "," << std::get<1>(q.resolution());
-    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: StartX=" << x_off << " StartY=" << y_off << " Width=" << width << " Height=" << height;
+    MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: StartX=" << window_.x << " StartY=" << window_.y << " Width=" << width << " Height=" << height;
 
     if (width > 0 && height > 0)
     {
@@ -220,9 +316,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 mapnik::image_gray8 image(width, height);
                 image.set(std::numeric_limits<std::uint8_t>::max());
                 raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                 image.data(), image.width(), image.height(),
-                                                 GDT_Byte, 0, 0);
+                raster_io_error = read_window(band, image.data(), GDT_Byte);
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
@@ -240,9 +334,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 mapnik::image_gray32f image(width, height);
                 image.set(std::numeric_limits<float>::max());
                 raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                 image.data(), image.width(), image.height(),
-                                                 GDT_Float32, 0, 0);
+                raster_io_error = read_window(band, image.data(), GDT_Float32);
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
@@ -259,9 +351,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 mapnik::image_gray16 image(width, height);
                 image.set(std::numeric_limits<std::uint16_t>::max());
                 raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                 image.data(), image.width(), image.height(),
-                                                 GDT_UInt16, 0, 0);
+                raster_io_error = read_window(band, image.data(), GDT_UInt16);
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
@@ -279,9 +369,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 mapnik::image_gray16s image(width, height);
                 image.set(std::numeric_limits<std::int16_t>::max());
                 raster_nodata = band->GetNoDataValue(&raster_has_nodata);
-                raster_io_error = band->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                 image.data(), image.width(), image.height(),
-                                                 GDT_Int16, 0, 0);
+                raster_io_error = read_window(band, image.data(), GDT_Int16);
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
@@ -388,9 +476,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     // TODO - we assume here the nodata value for the red band applies to all bands
                     // more details about this at http://trac.osgeo.org/gdal/ticket/2734
                     float* imageData = (float*)image.bytes();
-                    raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                    imageData, image.width(), image.height(),
-                                                    GDT_Float32, 0, 0);
+                    raster_io_error = read_window(red, imageData, GDT_Float32);
                     if (raster_io_error == CE_Failure) {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
@@ -408,8 +494,8 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
                 }
 
-                /* Use dataset RasterIO in priority in 99.9% of the cases */
-                if( red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
+                /* Without a block cache use dataset RasterIO in priority in 99.9% of the cases */
+                if( !use_block_cache_ && red->GetBand() == 1 && green->GetBand() == 2 && blue->GetBand() == 3 )
                 {
                     int nBandsToRead = 3;
                     if( alpha != nullptr && alpha->GetBand() == 4 && !raster_has_nodata )
@@ -417,7 +503,8 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                         nBandsToRead = 4;
                         alpha = nullptr; // to avoid reading it again afterwards
                     }
-                    raster_io_error = dataset_.RasterIO(GF_Read, x_off, y_off, width, height,
+                    raster_io_error = dataset_.RasterIO(GF_Read, source_window_.x, source_window_.y,
+                                                        source_window_.width, source_window_.height,
                                                         image.bytes(),
                                                         image.width(), image.height(), GDT_Byte,
                                                         nBandsToRead, nullptr,
@@ -428,18 +515,15 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 }
                 else
                 {
-                    raster_io_error = red->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
-                                                    image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = read_window(red, image.bytes() + 0, GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure) {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
-                    raster_io_error = green->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 1,
-                                                    image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = read_window(green, image.bytes() + 1, GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure) {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
-                    raster_io_error = blue->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 2,
-                                                    image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = read_window(blue, image.bytes() + 2, GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure) {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
@@ -477,9 +561,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: applying nodata value for layer=" << apply_nodata;
                     // first read the data in and create an alpha channel from the nodata values
                     float* imageData = (float*)image.bytes();
-                    raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height,
-                                                     imageData, image.width(), image.height(),
-                                                     GDT_Float32, 0, 0);
+                    raster_io_error = read_window(grey, imageData, GDT_Float32);
                     if (raster_io_error == CE_Failure)
                     {
                         throw datasource_exception(CPLGetLastErrorMsg());
@@ -498,22 +580,19 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     }
                 }
 
-                raster_io_error = grey->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 0,
-                                                 image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                raster_io_error = read_window(grey, image.bytes() + 0, GDT_Byte, 4, 4 * image.width());
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
                 }
 
-                raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 1,
-                                                 image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                raster_io_error = read_window(grey, image.bytes() + 1, GDT_Byte, 4, 4 * image.width());
                 if (raster_io_error == CE_Failure)
                 {
                     throw datasource_exception(CPLGetLastErrorMsg());
                 }
 
-                raster_io_error = grey->RasterIO(GF_Read,x_off, y_off, width, height, image.bytes() + 2,
-                                                 image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                raster_io_error = read_window(grey, image.bytes() + 2, GDT_Byte, 4, 4 * image.width());
 
                 if (raster_io_error == CE_Failure)
                 {
@@ -549,8 +628,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                 MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: processing alpha band...";
                 if (!raster_has_nodata || (red && green && blue))
                 {
-                    raster_io_error = alpha->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 3,
-                                                      image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                    raster_io_error = read_window(alpha, image.bytes() + 3, GDT_Byte, 4, 4 * image.width());
                     if (raster_io_error == CE_Failure) {
                         throw datasource_exception(CPLGetLastErrorMsg());
                     }
@@ -574,8 +652,7 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
                     MAPNIK_LOG_DEBUG(gdal) << "gdal_featureset: found and processing mask band...";
                     if (!raster_has_nodata)
                     {
-                        raster_io_error = mask->RasterIO(GF_Read, x_off, y_off, width, height, image.bytes() + 3,
-                                                          image.width(), image.height(), GDT_Byte, 4, 4 * image.width());
+                        raster_io_error = read_window(mask, image.bytes() + 3, GDT_Byte, 4, 4 * image.width());
                         if (raster_io_error == CE_Failure) {
                             throw datasource_exception(CPLGetLastErrorMsg());
                         }
@@ -602,6 +679,31 @@ feature_ptr gdal_featureset::get_feature(mapnik::query const& q)
     return feature_ptr();
 }
 
+CPLErr gdal_featureset::read_window(GDALRasterBand * band, void * data, GDALDataType type,
+                                    int pixel_space, int line_space)
+{
+    GDALRasterBand * source = band;
+    if (overview_ >= 0)
+    {
+        // mask bands in particular may lack the overview of their band
+        source = band->GetOverview(overview_);
+        if (source != nullptr &&
+            (source->GetXSize() != overview_width_ || source->GetYSize() != overview_height_))
+        {
+            source = nullptr;
+        }
+    }
+    if (source != nullptr && use_block_cache_)
+    {
+        return gdal_block_cache::instance().read(dataset_, *source, window_.x, window_.y, window_.width, window_.height,
+                                  data, type, pixel_space, line_space);
+    }
+    // let GDAL resample the full resolution window, it picks the
+    // overview itself when there is one
+    return band->RasterIO(GF_Read, source_window_.x, source_window_.y,
+                          source_window_.width, source_window_.height,
+                          data, window_.width, window_.height, type, pixel_space, line_space);
+}
 
 feature_ptr gdal_featureset::get_feature_at_point(mapnik::coord2d const& pt)
 {
@@ -29,9 +29,8 @@
 #include <mapnik/util/variant.hpp>
 // boost
 #include <boost/optional.hpp>
-
-class GDALDataset;
-class GDALRasterBand;
+// gdal
+#include <gdal_priv.h>
 
 using gdal_query = mapnik::util::variant<mapnik::query, mapnik::coord2d>;
 
@@ -66,13 +65,27 @@ public:
                     double dx,
                     double dy,
                     boost::optional<double> const& nodata,
-                    double nodata_tolerance);
+                    double nodata_tolerance,
+                    bool use_overviews,
+                    bool use_block_cache);
     virtual ~gdal_featureset();
     mapnik::feature_ptr next();
 
 private:
     mapnik::feature_ptr get_feature(mapnik::query const& q);
     mapnik::feature_ptr get_feature_at_point(mapnik::coord2d const& p);
+    // reads window_ of `band`, from the selected overview if there is one
+    CPLErr read_window(GDALRasterBand * band, void * data, GDALDataType type,
+                       int pixel_space = 0, int line_space = 0);
+
+    struct window
+    {
+        int x;
+        int y;
+        int width;
+        int height;
+    };
+
     GDALDataset & dataset_;
     mapnik::context_ptr ctx_;
     int band_;
@@ -85,6 +98,13 @@ private:
     int nbands_;
     boost::optional<double> nodata_value_;
     double nodata_tolerance_;
+    bool use_overviews_;
+    bool use_block_cache_;
+    int overview_;
+    int overview_width_;
+    int overview_height_;
+    window window_;        // pixels read, in the overview when one is selected
+    window source_window_; // the same pixels at full resolution
     bool first_;
 };
 
@@ -52,6 +52,7 @@
 #include <mapnik/geometry_adapters.hpp>
 #include <mapnik/json/feature_collection_grammar.hpp>
 #include <mapnik/json/extract_bounding_box_grammar_impl.hpp>
+#include <mapnik/json/structural_parser.hpp>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/util/spatial_index.hpp>
 #include <mapnik/geom_util.hpp>
@@ -120,6 +121,7 @@ geojson_datasource::geojson_datasource(parameters const& params)
       num_features_to_query_(std::max(mapnik::value_integer(1), *params.get<mapnik::value_integer>("num_features_to_query", 5)))
 {
     boost::optional<std::string> inline_string = params.get<std::string>("inline");
+    std::string feature_cache_file;
     if (!inline_string)
     {
         boost::optional<std::string> file = params.get<std::string>("file");
@@ -131,6 +133,12 @@ geojson_datasource::geojson_datasource(parameters const& params)
         else
             filename_ = *file;
         has_disk_index_ = mapnik::util::exists(filename_ + ".index");
+        boost::optional<std::string> feature_cache_dir = params.get<std::string>("feature_cache_dir");
+        if (!has_disk_index_ && feature_cache_dir && *params.get<mapnik::boolean_type>("cache_features", true))
+        {
+            feature_cache_file = mapnik::feature_cache::filename(*feature_cache_dir, filename_);
+            feature_cache_ = mapnik::feature_cache::open(feature_cache_file, filename_);
+        }
     }
 
     if (inline_string)
@@ -144,6 +152,10 @@ geojson_datasource::geojson_datasource(parameters const& params)
     {
         initialise_disk_index(filename_);
     }
+    else if (feature_cache_)
+    {
+        initialise_feature_cache();
+    }
     else
     {
         cache_features_ = *params.get<mapnik::boolean_type>("cache_features", true);
@@ -173,6 +185,12 @@ geojson_datasource::geojson_datasource(parameters const& params)
         if (cache_features_)
         {
             parse_geojson(start, end);
+            if (!feature_cache_file.empty())
+            {
+                mapnik::feature_cache_writer writer;
+                for (auto const& feature : features_) writer.add(*feature);
+                writer.write(feature_cache_file, filename_);
+            }
         }
         else
         {
@@ -235,9 +253,10 @@ void geojson_datasource::initialise_disk_index(std::string const& filename)
         mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, -1));
         using namespace boost::spirit;
         standard::space_type space;
-        if (!boost::spirit::qi::phrase_parse(start, end,
-                                             (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
-            || start != end)
+        if (!mapnik::json::parse_feature(start, end, *feature, geojson_datasource_static_tr)
+            && (!boost::spirit::qi::phrase_parse(start, end,
+                                                 (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
+                || start != end))
         {
             throw std::runtime_error("Failed to parse geojson feature");
         }
@@ -246,13 +265,44 @@ void geojson_datasource::initialise_disk_index(std::string const& filename)
     desc_.order_by_name();
 }
 
+void geojson_datasource::initialise_feature_cache()
+{
+    using values_container = std::vector< std::pair<box_type, std::pair<std::size_t, std::size_t>>>;
+    values_container values;
+    values.reserve(feature_cache_->size());
+    mapnik::context_ptr ctx = feature_cache_->make_context();
+    for (std::size_t index = 0; index < feature_cache_->size(); ++index)
+    {
+        mapnik::box2d<double> box = feature_cache_->envelope(index);
+        if (box.valid())
+        {
+            if (index == 0)
+            {
+                extent_ = box;
+            }
+            else
+            {
+                extent_.expand_to_include(box);
+            }
+            values.emplace_back(box, std::make_pair(index, 0));
+        }
+        if (index < num_features_to_query_)
+        {
+            initialise_descriptor(feature_cache_->feature(index, ctx, feature_cache_->id(index)));
+        }
+    }
+    // packing algorithm
+    tree_ = std::make_unique<spatial_index_type>(values);
+}
+
 template <typename Iterator>
 void geojson_datasource::initialise_index(Iterator start, Iterator end)
 {
     boxes_type boxes;
     boost::spirit::standard::space_type space;
     Iterator itr = start;
-    if (!boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_bbox_grammar)(boost::phoenix::ref(boxes)) , space))
+    if (!mapnik::json::extract_bounding_boxes(start, end, boxes)
+        && !boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_bbox_grammar)(boost::phoenix::ref(boxes)) , space))
     {
         cache_features_ = true; // force caching single feature
         itr = start; // reset iteraror
@@ -318,9 +368,10 @@ void geojson_datasource::initialise_index(Iterator start, Iterator end)
                 Iterator itr2 = start + geometry_index.first;
                 Iterator end2 = itr2 + geometry_index.second;
                 mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx,-1)); // temp feature
-                if (!boost::spirit::qi::phrase_parse(itr2, end2,
-                                                     (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
-                    || itr2 != end2)
+                if (!mapnik::json::parse_feature(itr2, end2, *feature, geojson_datasource_static_tr)
+                    && (!boost::spirit::qi::phrase_parse(itr2, end2,
+                                                         (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
+                        || itr2 != end2))
                 {
                     throw std::runtime_error("Failed to parse geojson feature");
                 }
@@ -340,21 +391,39 @@ void geojson_datasource::parse_geojson(Iterator start, Iterator end)
     mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
     std::size_t start_id = 1;
 
-    mapnik::json::default_feature_callback callback(features_);
-    Iterator itr = start;
-
-    try
+    if (!mapnik::json::parse_feature_collection(start, end, ctx, start_id, features_, geojson_datasource_static_tr))
     {
-        bool result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_fc_grammar)
-                                                      (boost::phoenix::ref(ctx), boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
-                                                      space);
-        if (!result || itr != end)
+        // single Feature or Geometry, or input the structural parser leaves to the grammar
+        ctx = std::make_shared<mapnik::context_type>();
+        mapnik::json::default_feature_callback callback(features_);
+        Iterator itr = start;
+
+        try
+        {
+            bool result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_fc_grammar)
+                                                          (boost::phoenix::ref(ctx), boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
+                                                          space);
+            if (!result || itr != end)
+            {
+                itr = start;
+                // try parsing as single Feature or single Geometry JSON
+                result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_feature_callback_grammar)
+                                                         (boost::phoenix::ref(ctx),boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
+                                                         space);
+                if (!result || itr != end)
+                {
+                    if (from_inline_string_) throw mapnik::datasource_exception("geojson_datasource: Failed parse GeoJSON file from in-memory string");
+                    else throw mapnik::datasource_exception("geojson_datasource: Failed parse GeoJSON file '" + filename_ + "'");
+                }
+            }
+        }
+        catch (expectation_failure<char const*> const& ex)
         {
             itr = start;
             // try parsing as single Feature or single Geometry JSON
-            result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_feature_callback_grammar)
-                                                     (boost::phoenix::ref(ctx),boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
-                                                     space);
+            bool result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_feature_callback_grammar)
+                                                          (boost::phoenix::ref(ctx),boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
+                                                          space);
             if (!result || itr != end)
             {
                 if (from_inline_string_) throw mapnik::datasource_exception("geojson_datasource: Failed parse GeoJSON file from in-memory string");
@@ -362,19 +431,6 @@ void geojson_datasource::parse_geojson(Iterator start, Iterator end)
             }
         }
     }
-    catch (expectation_failure<char const*> const& ex)
-    {
-        itr = start;
-        // try parsing as single Feature or single Geometry JSON
-        bool result = boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_feature_callback_grammar)
-                                                      (boost::phoenix::ref(ctx),boost::phoenix::ref(start_id), boost::phoenix::ref(callback)),
-                                                      space);
-        if (!result || itr != end)
-        {
-            if (from_inline_string_) throw mapnik::datasource_exception("geojson_datasource: Failed parse GeoJSON file from in-memory string");
-            else throw mapnik::datasource_exception("geojson_datasource: Failed parse GeoJSON file '" + filename_ + "'");
-        }
-    }
 
     using values_container = std::vector< std::pair<box_type, std::pair<std::size_t, std::size_t>>>;
     values_container values;
@@ -460,9 +516,10 @@ boost::optional<mapnik::datasource_geometry_t> geojson_datasource::get_geometry_
             mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, -1)); // temp feature
             using namespace boost::spirit;
             standard::space_type space;
-            if (!boost::spirit::qi::phrase_parse(start, end,
-                                                 (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
-                || start != end)
+            if (!mapnik::json::parse_feature(start, end, *feature, geojson_datasource_static_tr)
+                && (!boost::spirit::qi::phrase_parse(start, end,
+                                                     (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space)
+                    || start != end))
             {
                 throw std::runtime_error("Failed to parse geojson feature");
             }
@@ -479,6 +536,24 @@ boost::optional<mapnik::datasource_geometry_t> geojson_datasource::get_geometry_
             }
         }
     }
+    else if (feature_cache_)
+    {
+        std::size_t num_features = feature_cache_->size();
+        for (std::size_t i = 0; i < num_features && i < num_features_to_query_; ++i)
+        {
+            result = mapnik::util::to_ds_type(feature_cache_->geometry(i));
+            if (result)
+            {
+                int type = static_cast<int>(*result);
+                if (multi_type > 0 && multi_type != type)
+                {
+                    result.reset(mapnik::datasource_geometry_t::Collection);
+                    return result;
+                }
+                multi_type = type;
+            }
+        }
+    }
     else if (cache_features_)
     {
         std::size_t num_features = features_.size();
@@ -525,7 +600,8 @@ boost::optional<mapnik::datasource_geometry_t> geojson_datasource::get_geometry_
             using namespace boost::spirit;
             standard::space_type space;
             mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, -1)); // temp feature
-            if (!qi::phrase_parse(start2, end2, (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space))
+            if (!mapnik::json::parse_feature(start2, end2, *feature, geojson_datasource_static_tr)
+                && !qi::phrase_parse(start2, end2, (geojson_datasource_static_feature_grammar)(boost::phoenix::ref(*feature)), space))
             {
                 throw std::runtime_error("Failed to parse geojson feature");
             }
@@ -561,7 +637,14 @@ mapnik::featureset_ptr geojson_datasource::features(mapnik::query const& q) cons
                       {
                           return item0.second.first < item1.second.first;
                       });
-            if (cache_features_)
+            if (feature_cache_)
+            {
+                std::vector<std::size_t> indices;
+                indices.reserve(index_array.size());
+                for (auto const& item : index_array) indices.push_back(item.second.first);
+                return std::make_shared<mapnik::feature_cache_featureset>(feature_cache_, std::move(indices));
+            }
+            else if (cache_features_)
             {
                 return std::make_shared<geojson_featureset>(features_, std::move(index_array));
             }
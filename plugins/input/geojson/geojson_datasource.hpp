@@ -32,6 +32,7 @@
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/feature_cache.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -93,6 +94,7 @@ public:
     template <typename Iterator>
     void initialise_index(Iterator start, Iterator end);
     void initialise_disk_index(std::string const& filename);
+    void initialise_feature_cache();
 private:
     void initialise_descriptor(mapnik::feature_ptr const&);
     mapnik::datasource::datasource_t type_;
@@ -102,6 +104,7 @@ private:
     mapnik::box2d<double> extent_;
     std::vector<mapnik::feature_ptr> features_;
     std::unique_ptr<spatial_index_type> tree_;
+    mapnik::feature_cache::ptr feature_cache_;
     bool cache_features_ = true;
     bool has_disk_index_ = false;
     const std::size_t num_features_to_query_;
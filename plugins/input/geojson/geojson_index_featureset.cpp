@@ -25,6 +25,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_factory.hpp>
 #include <mapnik/json/feature_grammar.hpp>
+#include <mapnik/json/structural_parser.hpp>
 #include <mapnik/util/utf_conv_win.hpp>
 #include <mapnik/util/spatial_index.hpp>
 #include <mapnik/geometry_is_empty.hpp>
@@ -60,11 +61,22 @@ geojson_index_featureset::geojson_index_featureset(std::string const& filename,
     if (!file_) throw std::runtime_error("Can't open " + filename);
 #endif
     std::string indexname = filename + ".index";
+#if defined (MAPNIK_MEMORY_MAPPED_FILE)
+    boost::optional<mapnik::mapped_region_ptr> index_memory =
+        mapnik::mapped_memory_cache::instance().find(indexname, true);
+    if (!index_memory) throw mapnik::datasource_exception("GeoJSON Plugin: can't open index file " + indexname);
+    boost::interprocess::ibufferstream index(static_cast<char const*>((*index_memory)->get_address()),
+                                             (*index_memory)->get_size());
+    mapnik::util::spatial_index<value_type,
+                                mapnik::filter_in_box,
+                                boost::interprocess::ibufferstream>::query(filter, index, positions_);
+#else
     std::ifstream index(indexname.c_str(), std::ios::binary);
     if (!index) throw mapnik::datasource_exception("GeoJSON Plugin: can't open index file " + indexname);
     mapnik::util::spatial_index<value_type,
                                 mapnik::filter_in_box,
                                 std::ifstream>::query(filter, index, positions_);
+#endif
 
     std::sort(positions_.begin(), positions_.end(),
               [](value_type const& lhs, value_type const& rhs) { return lhs.first < rhs.first;});
@@ -94,7 +106,8 @@ mapnik::feature_ptr geojson_index_featureset::next()
         using namespace boost::spirit;
         standard::space_type space;
         mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
-        if (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end)
+        if (!mapnik::json::parse_feature(start, end, *feature, tr)
+            && (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end))
         {
             throw std::runtime_error("Failed to parse GeoJSON feature");
         }
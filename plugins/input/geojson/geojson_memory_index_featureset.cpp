@@ -24,6 +24,7 @@
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_factory.hpp>
 #include <mapnik/json/feature_grammar.hpp>
+#include <mapnik/json/structural_parser.hpp>
 #include <mapnik/util/utf_conv_win.hpp>
 #include <mapnik/geometry_is_empty.hpp>
 // stl
@@ -69,7 +70,8 @@ mapnik::feature_ptr geojson_memory_index_featureset::next()
         using namespace boost::spirit;
         standard::space_type space;
         mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, feature_id_++));
-        if (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end)
+        if (!mapnik::json::parse_feature(start, end, *feature, tr)
+            && (!qi::phrase_parse(start, end, (grammar)(boost::phoenix::ref(*feature)), space) || start != end))
         {
             throw std::runtime_error("Failed to parse geojson feature");
         }
@@ -30,6 +30,8 @@
 #include "resultset.hpp"
 #include <queue>
 #include <memory>
+#include <map>
+#include <vector>
 
 class postgis_processor_context;
 using postgis_processor_context_ptr = std::shared_ptr<postgis_processor_context>;
@@ -186,12 +188,158 @@ private:
 };
 
 
+#ifdef LIBPQ_HAS_PIPELINING
+class PipelinedResultSet : public IResultSet, private mapnik::util::noncopyable
+{
+public:
+    PipelinedResultSet(postgis_processor_context_ptr const& ctx,
+                       std::shared_ptr<Connection> const& conn, std::string const& sql)
+        : ctx_(ctx),
+          conn_(conn),
+          ticket_(conn->sendPipelinedQuery(sql))
+    {
+    }
+
+    virtual ~PipelinedResultSet()
+    {
+        close();
+    }
+
+    virtual void close()
+    {
+        rs_.reset();
+        if (conn_)
+        {
+            conn_->discardPipelinedQuery(ticket_);
+            conn_.reset();
+        }
+    }
+
+    virtual int getNumFields() const
+    {
+        return rs_->getNumFields();
+    }
+
+    virtual bool next()
+    {
+        while (!rs_ || !rs_->next())
+        {
+            if (!conn_)
+            {
+                return false;
+            }
+            rs_ = conn_->getPipelinedResult(ticket_);
+            if (!rs_)
+            {
+                conn_.reset();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    virtual const char* getFieldName(int index) const
+    {
+        return rs_->getFieldName(index);
+    }
+
+    virtual int getFieldLength(int index) const
+    {
+        return rs_->getFieldLength(index);
+    }
+
+    virtual int getFieldLength(const char* name) const
+    {
+        return rs_->getFieldLength(name);
+    }
+
+    virtual int getTypeOID(int index) const
+    {
+        return rs_->getTypeOID(index);
+    }
+
+    virtual int getTypeOID(const char* name) const
+    {
+        return rs_->getTypeOID(name);
+    }
+
+    virtual bool isNull(int index) const
+    {
+        return rs_->isNull(index);
+    }
+
+    virtual const char* getValue(int index) const
+    {
+        return rs_->getValue(index);
+    }
+
+    virtual const char* getValue(const char* name) const
+    {
+        return rs_->getValue(name);
+    }
+
+private:
+    // keeps the connections of the render alive
+    postgis_processor_context_ptr ctx_;
+    std::shared_ptr<Connection> conn_;
+    std::size_t ticket_;
+    std::shared_ptr<ResultSet> rs_;
+};
+#endif
+
+// Shared by all PostGIS layers of a render, see get_context()
 class postgis_processor_context : public mapnik::IProcessorContext
 {
 public:
     postgis_processor_context()
         : num_async_requests_(0) {}
+
+#ifdef LIBPQ_HAS_PIPELINING
+    ~postgis_processor_context()
+    {
+        for (auto & item : pipelines_)
+        {
+            for (std::shared_ptr<Connection> const& conn : item.second)
+            {
+                if (!conn->finishPipeline())
+                {
+                    // the pool drops closed connections
+                    conn->close();
+                }
+            }
+        }
+    }
+
+    // Connection to send the next query against `pool` on. Each of the first
+    // `max_connections` queries borrows its own connection; later queries
+    // are pipelined on the least busy of them, so that the queries of all
+    // layers are in flight at once instead of waiting for a free connection.
+    std::shared_ptr<Connection> pipeline_connection(std::shared_ptr< Pool<Connection,ConnectionCreator> > const& pool,
+                                                    int max_connections)
+    {
+        std::vector<std::shared_ptr<Connection> > & connections = pipelines_[pool.get()];
+        if (connections.size() < static_cast<std::size_t>(max_connections))
+        {
+            std::shared_ptr<Connection> conn = pool->borrowObject();
+            if (conn)
+            {
+                connections.push_back(conn);
+                return conn;
+            }
+        }
+        std::shared_ptr<Connection> least_busy;
+        for (std::shared_ptr<Connection> const& conn : connections)
+        {
+            if (conn->isOK() && (!least_busy || conn->pipelineSize() < least_busy->pipelineSize()))
+            {
+                least_busy = conn;
+            }
+        }
+        return least_busy;
+    }
+#else
     ~postgis_processor_context() {}
+#endif
 
     void add_request(std::shared_ptr<AsyncResultSet> const& req)
     {
@@ -214,6 +362,9 @@ public:
 private:
     using async_queue = std::queue<std::shared_ptr<AsyncResultSet> >;
     async_queue q_;
+#ifdef LIBPQ_HAS_PIPELINING
+    std::map<Pool<Connection,ConnectionCreator> const*, std::vector<std::shared_ptr<Connection> > > pipelines_;
+#endif
 
 };
 
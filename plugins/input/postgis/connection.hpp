@@ -32,6 +32,7 @@
 #include <memory>
 #include <sstream>
 #include <iostream>
+#include <deque>
 
 extern "C" {
 #include "libpq-fe.h"
@@ -46,6 +47,10 @@ public:
         : cursorId(0),
           closed_(false),
           pending_(false)
+#ifdef LIBPQ_HAS_PIPELINING
+        , pipeline_front_(0),
+          pipeline_read_(0)
+#endif
     {
         std::string connect_with_pass = connection_str;
         if (password && !password->empty())
@@ -257,12 +262,196 @@ public:
         return s.str();
     }
 
+#ifdef LIBPQ_HAS_PIPELINING
+    // Pipelined queries are sent without waiting for the results of the
+    // queries before them, and their rows are read back in order: in batches
+    // as they arrive where libpq has chunked rows, else a result at a time.
+    // Each query is followed by a sync point so that a failing query does
+    // not abort the ones queued behind it.
+    std::size_t sendPipelinedQuery(std::string const& sql)
+    {
+#ifdef MAPNIK_STATS
+        mapnik::progress_timer __stats__(std::clog, std::string("postgis_connection::send_pipelined_query ") + sql);
+#endif
+        bool ok = PQpipelineStatus(conn_) != PQ_PIPELINE_OFF || PQenterPipelineMode(conn_) == 1;
+        ok = ok && PQsendQueryParams(conn_, sql.c_str(), 0, 0, 0, 0, 0, 1) == 1;
+        ok = ok && PQpipelineSync(conn_) == 1;
+        if (!ok)
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += status();
+            err_msg += "in sendPipelinedQuery Full sql was: '";
+            err_msg += sql;
+            err_msg += "'\n";
+            close();
+            throw mapnik::datasource_exception(err_msg);
+        }
+        pipeline_.emplace_back(sql);
+        return pipeline_front_ + pipeline_.size() - 1;
+    }
+
+    // Next rows of the pipelined query `ticket`, nullptr once all of them
+    // have been returned. Rows of queries sent before it that have not been
+    // read yet are kept until their own result set asks for them.
+    std::shared_ptr<ResultSet> getPipelinedResult(std::size_t ticket)
+    {
+        pipelined_query & query = pipeline_[ticket - pipeline_front_];
+        while (query.rows.empty() && pipeline_read_ <= ticket)
+        {
+            readPipeline();
+        }
+        if (!query.error.empty())
+        {
+            std::string err_msg = "Postgis Plugin: ";
+            err_msg += query.error;
+            err_msg += "in getPipelinedResult Full sql was: '";
+            err_msg += query.sql;
+            err_msg += "'\n";
+            query.done = true;
+            trimPipeline();
+            throw mapnik::datasource_exception(err_msg);
+        }
+        std::shared_ptr<ResultSet> rs;
+        if (query.rows.empty())
+        {
+            query.done = true;
+            trimPipeline();
+        }
+        else
+        {
+            rs = query.rows.front();
+            query.rows.pop_front();
+        }
+        return rs;
+    }
+
+    // Rows of `ticket` are no longer wanted
+    void discardPipelinedQuery(std::size_t ticket)
+    {
+        if (ticket < pipeline_front_)
+        {
+            return;
+        }
+        pipelined_query & query = pipeline_[ticket - pipeline_front_];
+        query.rows.clear();
+        query.done = true;
+        trimPipeline();
+    }
+
+    std::size_t pipelineSize() const
+    {
+        return pipeline_.size();
+    }
+
+    // Reads the remaining pipelined results and leaves pipeline mode so the
+    // connection can go back to the pool. False if the connection is unusable.
+    bool finishPipeline()
+    {
+        try
+        {
+            while (pipeline_read_ < pipeline_front_ + pipeline_.size())
+            {
+                readPipeline();
+            }
+        }
+        catch (mapnik::datasource_exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(postgis) << ex.what();
+            return false;
+        }
+        pipeline_.clear();
+        pipeline_front_ = pipeline_read_;
+        return isOK() && (PQpipelineStatus(conn_) == PQ_PIPELINE_OFF || PQexitPipelineMode(conn_) == 1);
+    }
+#endif
+
 private:
     PGconn *conn_;
     int cursorId;
     bool closed_;
     bool pending_;
 
+#ifdef LIBPQ_HAS_PIPELINING
+    struct pipelined_query
+    {
+        explicit pipelined_query(std::string const& sql_)
+            : sql(sql_), done(false) {}
+        std::string sql;
+        std::string error;
+        std::deque<std::shared_ptr<ResultSet> > rows;
+        bool done;
+    };
+
+    // rows per result while streaming, a result set is made for each batch
+    static const int pipeline_chunk_rows = 1024;
+
+    // queries from pipeline_front_ on, read up to pipeline_read_
+    std::deque<pipelined_query> pipeline_;
+    std::size_t pipeline_front_;
+    std::size_t pipeline_read_;
+
+    // Reads one result of the first query whose results are not complete
+    void readPipeline()
+    {
+        if (!isOK())
+        {
+            throw mapnik::datasource_exception("Postgis Plugin: connection lost while reading pipelined results");
+        }
+        pipelined_query & query = pipeline_[pipeline_read_ - pipeline_front_];
+#ifdef LIBPQ_HAS_CHUNK_MODE
+        // Stream rows in batches. This is refused once results have started
+        // to arrive, in which case they come as a single result instead.
+        PQsetChunkedRowsMode(conn_, pipeline_chunk_rows);
+#endif
+        PGresult *result = getResult();
+        if (result == nullptr)
+        {
+            ++pipeline_read_;
+            PGresult *sync = getResult();
+            bool ok = sync && PQresultStatus(sync) == PGRES_PIPELINE_SYNC;
+            if (sync) PQclear(sync);
+            if (!ok)
+            {
+                std::string err_msg = "Postgis Plugin: ";
+                err_msg += status();
+                err_msg += "in readPipeline";
+                close();
+                throw mapnik::datasource_exception(err_msg);
+            }
+            trimPipeline();
+            return;
+        }
+        ExecStatusType result_status = PQresultStatus(result);
+        if (result_status != PGRES_TUPLES_OK
+#ifdef LIBPQ_HAS_CHUNK_MODE
+            && result_status != PGRES_TUPLES_CHUNK
+#endif
+            )
+        {
+            query.error = PQresultErrorMessage(result);
+            PQclear(result);
+        }
+        else if (query.done || PQntuples(result) == 0)
+        {
+            PQclear(result);
+        }
+        else
+        {
+            query.rows.push_back(std::make_shared<ResultSet>(result));
+        }
+    }
+
+    // Forgets queries at the front that are both read and done with
+    void trimPipeline()
+    {
+        while (!pipeline_.empty() && pipeline_front_ < pipeline_read_ && pipeline_.front().done)
+        {
+            pipeline_.pop_front();
+            ++pipeline_front_;
+        }
+    }
+#endif
+
     void clearAsyncResult(PGresult *result)
     {
         // Clear all pending results
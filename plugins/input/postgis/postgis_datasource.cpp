@@ -46,6 +46,7 @@
 #include <memory>
 #include <string>
 #include <algorithm>
+#include <cmath>
 #include <set>
 #include <sstream>
 #include <iomanip>
@@ -88,7 +89,10 @@ postgis_datasource::postgis_datasource(parameters const& params)
       extent_from_subquery_(*params.get<mapnik::boolean_type>("extent_from_subquery", false)),
       max_async_connections_(*params_.get<mapnik::value_integer>("max_async_connection", 1)),
       asynchronous_request_(false),
+      pipelining_(*params_.get<mapnik::boolean_type>("pipelining", false)),
       twkb_encoding_(false),
+      twkb_geometry_format_(false),
+      geometry_pushdown_(false),
       twkb_rounding_adjustment_(*params_.get<mapnik::value_double>("twkb_rounding_adjustment", 0.0)),
       simplify_snap_ratio_(*params_.get<mapnik::value_double>("simplify_snap_ratio", 1.0/40.0)),
       // 1/20 of pixel seems to be a good compromise to avoid
@@ -134,6 +138,14 @@ postgis_datasource::postgis_datasource(parameters const& params)
         asynchronous_request_ = true;
     }
 
+#ifndef LIBPQ_HAS_PIPELINING
+    if (pipelining_)
+    {
+        MAPNIK_LOG_WARN(postgis) << "postgis_datasource: pipelining is not supported by this libpq, ignoring it";
+        pipelining_ = false;
+    }
+#endif
+
     boost::optional<mapnik::value_integer> initial_size = params.get<mapnik::value_integer>("initial_size", 1);
     boost::optional<mapnik::boolean_type> autodetect_key_field = params.get<mapnik::boolean_type>("autodetect_key_field", false);
     boost::optional<mapnik::boolean_type> estimate_extent = params.get<mapnik::boolean_type>("estimate_extent", false);
@@ -144,6 +156,26 @@ postgis_datasource::postgis_datasource(parameters const& params)
     boost::optional<mapnik::boolean_type> twkb_opt = params.get<mapnik::boolean_type>("twkb_encoding", false);
     twkb_encoding_ = twkb_opt && *twkb_opt;
 
+    // Let the styles of the layer decide how geometries can be reduced on
+    // the server. Needs PostGIS 2.2 for ST_ClipByBox2D and ST_Simplify
+    // keeping collapsed geometries.
+    boost::optional<mapnik::boolean_type> pushdown_opt = params.get<mapnik::boolean_type>("geometry_pushdown", false);
+    geometry_pushdown_ = pushdown_opt && *pushdown_opt;
+
+    boost::optional<std::string> geometry_format = params.get<std::string>("geometry_format");
+    if (geometry_format)
+    {
+        if (*geometry_format == "twkb")
+        {
+            twkb_geometry_format_ = true;
+        }
+        else if (*geometry_format != "wkb")
+        {
+            throw mapnik::datasource_exception("Postgis Plugin: unknown geometry_format '" + *geometry_format
+                                               + "', expected 'wkb' or 'twkb'");
+        }
+    }
+
     boost::optional<mapnik::boolean_type> simplify_preserve_opt = params.get<mapnik::boolean_type>("simplify_dp_preserve", false);
     simplify_dp_preserve_ = simplify_preserve_opt && *simplify_preserve_opt;
 
@@ -527,6 +559,14 @@ layer_descriptor postgis_datasource::get_descriptor() const
     return desc_;
 }
 
+// Number of decimals the pixel size implies for ST_AsTWKB, which only
+// accepts -7 to 7
+int postgis_datasource::twkb_rounding(double px_sz) const
+{
+    const double decimals = 1.0 - std::round(std::log10(px_sz) + twkb_rounding_adjustment_);
+    return static_cast<int>(std::max(-7.0, std::min(7.0, decimals)));
+}
+
 std::string postgis_datasource::sql_bbox(box2d<double> const& env) const
 {
     std::ostringstream b;
@@ -699,6 +739,13 @@ std::shared_ptr<IResultSet> postgis_datasource::get_resultset(std::shared_ptr<Co
     {   // asynchronous requests
 
         std::shared_ptr<postgis_processor_context> pgis_ctxt = std::static_pointer_cast<postgis_processor_context>(ctx);
+#ifdef LIBPQ_HAS_PIPELINING
+        if (pipelining_)
+        {
+            // rows are read from the pipeline as they arrive
+            return std::make_shared<PipelinedResultSet>(pgis_ctxt, conn, sql);
+        }
+#endif
         if (conn)
         {
             // lauch async req & create asyncresult with conn
@@ -722,6 +769,8 @@ processor_context_ptr postgis_datasource::get_context(feature_style_context_map
         return processor_context_ptr();
     }
 
+    // one context for all PostGIS layers of the render, so that their
+    // queries share connections and pipelines
     std::string ds_name(name());
     feature_style_context_map::const_iterator itr = ctx.find(ds_name);
     if (itr != ctx.end())
@@ -766,9 +815,23 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
 
         if ( asynchronous_request_ )
         {
-            // limit use to num_async_request_ => if reached don't borrow the last connexion object
             std::shared_ptr<postgis_processor_context> pgis_ctxt = std::static_pointer_cast<postgis_processor_context>(proc_ctx);
-            if ( pgis_ctxt->num_async_requests_ < max_async_connections_ )
+            if (pipelining_)
+            {
+#ifdef LIBPQ_HAS_PIPELINING
+                // queries of all layers sharing the context are pipelined over
+                // at most max_async_connections_ connections of the pool
+                conn = pgis_ctxt->pipeline_connection(pool, max_async_connections_);
+#endif
+                if (!conn)
+                {
+                    throw mapnik::datasource_exception("Postgis Plugin: "
+                        "All connections from the pool have been taken. "
+                        "You can enlarge pool size by setting max_size parameter.");
+                }
+            }
+            // limit use to num_async_request_ => if reached don't borrow the last connexion object
+            else if ( pgis_ctxt->num_async_requests_ < max_async_connections_ )
             {
                 conn = pool->borrowObject();
                 pgis_ctxt->num_async_requests_++;
@@ -823,9 +886,9 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             // (c) a ST_AsTWKB implementation
 
             // What number of decimals of rounding does the pixel size imply?
-            const int twkb_rounding = -1 * std::lround(log10(px_sz) + twkb_rounding_adjustment_) + 1;
+            const int rounding = twkb_rounding(px_sz);
             // And what's that in map units?
-            const double twkb_tolerance = pow(10.0, -1.0 * twkb_rounding);
+            const double twkb_tolerance = pow(10.0, -1.0 * rounding);
 
             s << "SELECT ST_AsTWKB(";
             s << "ST_Simplify(";
@@ -848,20 +911,46 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             // ! ST_Simplify(), with parameter to keep collapsed geometries
             s << "," << twkb_tolerance << ",true)";
             // ! ST_TWKB()
-            s << "," << twkb_rounding << ") AS geom";
+            s << "," << rounding << ") AS geom";
         }
         else
         {
-            s << "SELECT ST_AsBinary(";
-            if (simplify_geometries_)
+            // Reductions the styles of the layer allow for, see geometry_pushdown
+            mapnik::geometry_requirements requirements;
+            if (geometry_pushdown_)
+            {
+                requirements = q.get_geometry_requirements();
+            }
+            const bool simplify = !requirements.points && (simplify_geometries_ || requirements.tolerance > 0.0);
+            const bool clip = !requirements.points &&
+                ((simplify_clip_resolution_ > 0.0 && simplify_clip_resolution_ > px_sz) || requirements.clip);
+            const bool snap = !requirements.points && simplify_geometries_ && simplify_snap_ratio_ > 0.0;
+
+            if (twkb_geometry_format_)
+            {
+                // Same geometry expression, quantised to the pixel size
+                s << "SELECT ST_AsTWKB(";
+            }
+            else
+            {
+                s << "SELECT ST_AsBinary(";
+            }
+            if (requirements.points)
+            {
+                // The point each part of the geometry is symbolized at
+                s << "ST_Collect(ARRAY(SELECT CASE WHEN GeometryType(part.geom) = 'LINESTRING'"
+                  << " THEN ST_LineInterpolatePoint(part.geom, 0.5) ELSE ST_Centroid(part.geom) END"
+                  << " FROM ST_Dump(";
+            }
+            if (simplify)
             {
                 s << "ST_Simplify(";
             }
-            if (simplify_clip_resolution_ > 0.0 && simplify_clip_resolution_ > px_sz)
+            if (clip)
             {
                 s << "ST_ClipByBox2D(";
             }
-            if (simplify_geometries_ && simplify_snap_ratio_ > 0.0)
+            if (snap)
             {
                 s<< "ST_SnapToGrid(";
             }
@@ -870,31 +959,43 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
             s << "\"" << geometryColumn_ << "\"";
 
             // ! ST_SnapToGrid()
-            if (simplify_geometries_ && simplify_snap_ratio_ > 0.0)
+            if (snap)
             {
                 const double tolerance = px_sz * simplify_snap_ratio_;
                 s << "," << tolerance << ")";
             }
 
             // ! ST_ClipByBox2D()
-            if (simplify_clip_resolution_ > 0.0 && simplify_clip_resolution_ > px_sz)
+            if (clip)
             {
                 s << "," << sql_bbox(box) << ")";
             }
 
             // ! ST_Simplify()
-            if (simplify_geometries_)
+            if (simplify)
             {
-                const double tolerance = px_sz * simplify_dp_ratio_;
+                double tolerance = simplify_geometries_ ? px_sz * simplify_dp_ratio_ : 0.0;
+                tolerance = std::max(tolerance, px_sz * requirements.tolerance);
                 s << ", " << tolerance;
                 // Add parameter to ST_Simplify to keep collapsed geometries
-                if (simplify_dp_preserve_)
+                if (simplify_dp_preserve_ || requirements.tolerance > 0.0)
                 {
                     s << ", true";
                 }
                 s << ")";
             }
 
+            // ! ST_Dump()
+            if (requirements.points)
+            {
+                s << ") AS part))";
+            }
+
+            // ! ST_AsTWKB()
+            if (twkb_geometry_format_)
+            {
+                s << "," << twkb_rounding(px_sz);
+            }
             // ! ST_AsBinary()
             s << ") AS geom";
         }
@@ -940,7 +1041,8 @@ featureset_ptr postgis_datasource::features_with_context(query const& q,processo
 
         std::shared_ptr<IResultSet> rs = get_resultset(conn, s.str(), pool, proc_ctx);
         return std::make_shared<postgis_featureset>(rs, ctx, desc_.get_encoding(), !key_field_.empty(),
-                                                    key_field_as_attribute_, twkb_encoding_);
+                                                    key_field_as_attribute_,
+                                                    twkb_encoding_ || twkb_geometry_format_);
 
     }
 
@@ -1027,8 +1129,10 @@ featureset_ptr postgis_datasource::features_at_point(coord2d const& pt, double t
             }
 
             std::shared_ptr<IResultSet> rs = get_resultset(conn, s.str(), pool);
+            // There is no resolution to quantise to here, so geometries
+            // are always requested as WKB
             return std::make_shared<postgis_featureset>(rs, ctx, desc_.get_encoding(), !key_field_.empty(),
-                                                        key_field_as_attribute_, twkb_encoding_);
+                                                        key_field_as_attribute_, false);
         }
     }
 
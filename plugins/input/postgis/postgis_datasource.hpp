@@ -79,6 +79,7 @@ public:
 
 private:
     std::string sql_bbox(box2d<double> const& env) const;
+    int twkb_rounding(double px_sz) const;
     std::string populate_tokens(std::string const& sql,
                                 double scale_denom,
                                 box2d<double> const& env,
@@ -119,7 +120,11 @@ private:
     bool estimate_extent_;
     int max_async_connections_;
     bool asynchronous_request_;
+    // asynchronous queries of all layers pipelined over shared connections
+    bool pipelining_;
     bool twkb_encoding_;
+    bool twkb_geometry_format_;
+    bool geometry_pushdown_;
     mapnik::value_double twkb_rounding_adjustment_;
     mapnik::value_double simplify_snap_ratio_;
     mapnik::value_double simplify_dp_ratio_;
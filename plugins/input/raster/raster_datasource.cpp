@@ -21,6 +21,10 @@
  *****************************************************************************/
 
 // boost
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#pragma GCC diagnostic pop
 
 // mapnik
 #include <mapnik/util/fs.hpp>
@@ -33,6 +37,7 @@
 #include "raster_featureset.hpp"
 #include "raster_info.hpp"
 #include "raster_datasource.hpp"
+#include "raster_tile_cache.hpp"
 
 using mapnik::layer_descriptor;
 using mapnik::featureset_ptr;
@@ -48,7 +53,9 @@ DATASOURCE_PLUGIN(raster_datasource)
 raster_datasource::raster_datasource(parameters const& params)
   : datasource(params),
     desc_(raster_datasource::name(), "utf-8"),
-    extent_initialized_(false)
+    extent_initialized_(false),
+    cache_tiles_(false),
+    pyramid_levels_(0)
 {
     MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Initializing...";
 
@@ -118,6 +125,35 @@ raster_datasource::raster_datasource(parameters const& params)
 
         width_ = x_width.get() * tile_size_;
         height_ = y_width.get() * tile_size_;
+
+        // tile_cache_size: decoded source tiles are kept in a cache of this
+        // many bytes shared by all datasources asking for one, bounded by
+        // the largest size asked for. 0, the default, decodes the tiles
+        // under every query.
+        mapnik::value_integer tile_cache_size = *params.get<mapnik::value_integer>("tile_cache_size", 0);
+        if (tile_cache_size > 0)
+        {
+            cache_tiles_ = true;
+            raster_tile_cache::instance().reserve(tile_cache_size);
+        }
+
+        // Precomputed pyramid: level z of `file` (${z} in the pattern) is a
+        // mosaic of tiles of the same size, each covering 2^z x 2^z tiles of
+        // level 0, and is used for queries at 2^z times the level 0 pixel
+        // size or coarser. Levels must cover whole tiles of level 0.
+        mapnik::value_integer pyramid_levels = *params.get<mapnik::value_integer>("pyramid_levels", 0);
+        pyramid_levels_ = static_cast<unsigned>(std::max<mapnik::value_integer>(0, std::min<mapnik::value_integer>(pyramid_levels, 16)));
+        if (pyramid_levels_ > 0 && filename_.find("${z}") == std::string::npos)
+        {
+            throw datasource_exception("Raster Plugin: pyramid_levels requires ${z} in the file pattern");
+        }
+        while (pyramid_levels_ > 0 &&
+               (x_width.get() % (1 << pyramid_levels_) != 0 || y_width.get() % (1 << pyramid_levels_) != 0))
+        {
+            MAPNIK_LOG_WARN(raster) << "raster_datasource: Pyramid level " << pyramid_levels_
+                                    << " does not cover whole tiles, skipped";
+            --pyramid_levels_;
+        }
     }
     else
     {
@@ -197,7 +233,22 @@ featureset_ptr raster_datasource::features(query const& q) const
     {
         MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Multi-Tiled policy";
 
-        tiled_multi_file_policy policy(filename_, format_, tile_size_, extent_, q.get_bbox(), width_, height_, tile_stride_);
+        // read from the coarsest pyramid level that still has a pixel for
+        // each output pixel
+        double factor = std::min(width_ / (extent_.width() * std::get<0>(q.resolution())),
+                                 height_ / (extent_.height() * std::get<1>(q.resolution())));
+        unsigned level = 0;
+        while (level < pyramid_levels_ && (2u << level) <= factor)
+        {
+            ++level;
+        }
+        std::string pattern(filename_);
+        boost::algorithm::replace_all(pattern, "${z}", std::to_string(level));
+
+        MAPNIK_LOG_DEBUG(raster) << "raster_datasource: Pyramid level=" << level;
+
+        tiled_multi_file_policy policy(pattern, format_, tile_size_, extent_, q.get_bbox(),
+                                       width_ >> level, height_ >> level, tile_stride_, cache_tiles_);
 
         return std::make_shared<raster_featureset<tiled_multi_file_policy> >(policy, extent_, q);
     }
@@ -64,6 +64,8 @@ private:
     bool multi_tiles_;
     unsigned tile_size_;
     unsigned tile_stride_;
+    bool cache_tiles_;
+    unsigned pyramid_levels_;
     unsigned width_;
     unsigned height_;
 };
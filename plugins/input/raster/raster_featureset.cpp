@@ -37,6 +37,7 @@
 #pragma GCC diagnostic pop
 
 #include "raster_featureset.hpp"
+#include "raster_tile_cache.hpp"
 
 using mapnik::query;
 using mapnik::image_reader;
@@ -65,6 +66,52 @@ raster_featureset<LookupPolicy>::~raster_featureset()
 {
 }
 
+template <typename LookupPolicy>
+template <typename Read>
+void raster_featureset<LookupPolicy>::set_raster(mapnik::feature_impl & feature,
+                                                 int reader_width, int reader_height,
+                                                 Read const& read) const
+{
+    int image_width = policy_.img_width(reader_width);
+    int image_height = policy_.img_height(reader_height);
+
+    if (image_width > 0 && image_height > 0)
+    {
+        mapnik::view_transform t(image_width, image_height, extent_, 0, 0);
+        box2d<double> intersect = bbox_.intersect(curIter_->envelope());
+        box2d<double> ext = t.forward(intersect);
+        box2d<double> rem = policy_.transform(ext);
+        // select minimum raster containing whole ext
+        int x_off = static_cast<int>(std::floor(ext.minx()));
+        int y_off = static_cast<int>(std::floor(ext.miny()));
+        int end_x = static_cast<int>(std::ceil(ext.maxx()));
+        int end_y = static_cast<int>(std::ceil(ext.maxy()));
+
+        // clip to available data
+        if (x_off >= image_width) x_off = image_width - 1;
+        if (y_off >= image_height) y_off = image_height - 1;
+        if (x_off < 0) x_off = 0;
+        if (y_off < 0) y_off = 0;
+        if (end_x > image_width)  end_x = image_width;
+        if (end_y > image_height) end_y = image_height;
+
+        int width = end_x - x_off;
+        int height = end_y - y_off;
+        if (width < 1) width = 1;
+        if (height < 1) height = 1;
+
+        // calculate actual box2d of returned raster
+        box2d<double> feature_raster_extent(rem.minx() + x_off,
+                                            rem.miny() + y_off,
+                                            rem.maxx() + x_off + width,
+                                            rem.maxy() + y_off + height);
+        feature_raster_extent = t.backward(feature_raster_extent);
+        mapnik::image_any data = read(x_off, y_off, width, height);
+        mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(feature_raster_extent, intersect, std::move(data), filter_factor_);
+        feature.set_raster(raster);
+    }
+}
+
 template <typename LookupPolicy>
 feature_ptr raster_featureset<LookupPolicy>::next()
 {
@@ -74,50 +121,35 @@ feature_ptr raster_featureset<LookupPolicy>::next()
 
         try
         {
-            std::unique_ptr<image_reader> reader(mapnik::get_image_reader(curIter_->file(),curIter_->format()));
+            if (policy_.cache_tiles())
+            {
+                raster_tile_cache::image_ptr tile = raster_tile_cache::instance().get(curIter_->file(), curIter_->format());
 
-            MAPNIK_LOG_DEBUG(raster) << "raster_featureset: Reader=" << curIter_->format() << "," << curIter_->file()
-                                     << ",size(" << curIter_->width() << "," << curIter_->height() << ")";
+                MAPNIK_LOG_DEBUG(raster) << "raster_featureset: Cached tile=" << curIter_->format() << "," << curIter_->file();
 
-            if (reader.get())
+                if (tile)
+                {
+                    set_raster(*feature, tile->width(), tile->height(),
+                               [&tile](int x_off, int y_off, int width, int height)
+                               {
+                                   return raster_tile_cache::crop(*tile, x_off, y_off, width, height);
+                               });
+                }
+            }
+            else
             {
-                int image_width = policy_.img_width(reader->width());
-                int image_height = policy_.img_height(reader->height());
+                std::unique_ptr<image_reader> reader(mapnik::get_image_reader(curIter_->file(),curIter_->format()));
+
+                MAPNIK_LOG_DEBUG(raster) << "raster_featureset: Reader=" << curIter_->format() << "," << curIter_->file()
+                                         << ",size(" << curIter_->width() << "," << curIter_->height() << ")";
 
-                if (image_width > 0 && image_height > 0)
+                if (reader.get())
                 {
-                    mapnik::view_transform t(image_width, image_height, extent_, 0, 0);
-                    box2d<double> intersect = bbox_.intersect(curIter_->envelope());
-                    box2d<double> ext = t.forward(intersect);
-                    box2d<double> rem = policy_.transform(ext);
-                    // select minimum raster containing whole ext
-                    int x_off = static_cast<int>(std::floor(ext.minx()));
-                    int y_off = static_cast<int>(std::floor(ext.miny()));
-                    int end_x = static_cast<int>(std::ceil(ext.maxx()));
-                    int end_y = static_cast<int>(std::ceil(ext.maxy()));
-
-                    // clip to available data
-                    if (x_off >= image_width) x_off = image_width - 1;
-                    if (y_off >= image_height) y_off = image_height - 1;
-                    if (x_off < 0) x_off = 0;
-                    if (y_off < 0) y_off = 0;
-                    if (end_x > image_width)  end_x = image_width;
-                    if (end_y > image_height) end_y = image_height;
-
-                    int width = end_x - x_off;
-                    int height = end_y - y_off;
-                    if (width < 1) width = 1;
-                    if (height < 1) height = 1;
-
-                    // calculate actual box2d of returned raster
-                    box2d<double> feature_raster_extent(rem.minx() + x_off,
-                                                        rem.miny() + y_off,
-                                                        rem.maxx() + x_off + width,
-                                                        rem.maxy() + y_off + height);
-                    feature_raster_extent = t.backward(feature_raster_extent);
-                    mapnik::image_any data = reader->read(x_off, y_off, width, height);
-                    mapnik::raster_ptr raster = std::make_shared<mapnik::raster>(feature_raster_extent, intersect, std::move(data), filter_factor_);
-                    feature->set_raster(raster);
+                    set_raster(*feature, reader->width(), reader->height(),
+                               [&reader](int x_off, int y_off, int width, int height)
+                               {
+                                   return reader->read(x_off, y_off, width, height);
+                               });
                 }
             }
         }
@@ -115,6 +115,11 @@ public:
     {
         return box2d<double>(0, 0, 0, 0);
     }
+
+    inline bool cache_tiles() const
+    {
+        return false;
+    }
 };
 
 class tiled_file_policy
@@ -190,6 +195,11 @@ public:
         return box2d<double>(0, 0, 0, 0);
     }
 
+    inline bool cache_tiles() const
+    {
+        return false;
+    }
+
 private:
 
     std::vector<raster_info> infos_;
@@ -208,11 +218,13 @@ public:
                             box2d<double> bbox,
                             unsigned width,
                             unsigned height,
-                            unsigned tile_stride)
+                            unsigned tile_stride,
+                            bool cache_tiles = false)
         : image_width_(width),
           image_height_(height),
           tile_size_(tile_size),
-          tile_stride_(tile_stride)
+          tile_stride_(tile_stride),
+          cache_tiles_(cache_tiles)
     {
         double lox = extent.minx();
         double loy = extent.miny();
@@ -293,11 +305,18 @@ public:
         return rem;
     }
 
+    // source tiles are decoded through the process wide raster_tile_cache
+    inline bool cache_tiles() const
+    {
+        return cache_tiles_;
+    }
+
 private:
 
     std::string interpolate(std::string const& pattern, int x, int y) const;
 
     unsigned int image_width_, image_height_, tile_size_, tile_stride_;
+    bool cache_tiles_;
     std::vector<raster_info> infos_;
 };
 
@@ -314,6 +333,12 @@ public:
     mapnik::feature_ptr next();
 
 private:
+    // sets the raster of `feature` to the part of the current source image
+    // inside the query, `read` returns a window of the source image
+    template <typename Read>
+    void set_raster(mapnik::feature_impl & feature, int reader_width, int reader_height,
+                    Read const& read) const;
+
     LookupPolicy policy_;
     mapnik::value_integer feature_id_;
     mapnik::context_ptr ctx_;
@@ -0,0 +1,153 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef RASTER_TILE_CACHE_HPP
+#define RASTER_TILE_CACHE_HPP
+
+// mapnik
+#include <mapnik/image_any.hpp>
+#include <mapnik/image_reader.hpp>
+#include <mapnik/util/fs.hpp>
+#include <mapnik/util/lru_cache.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/util/variant.hpp>
+
+// boost
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/functional/hash.hpp>
+#pragma GCC diagnostic pop
+
+// stl
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <tuple>
+
+// Decoded source tiles of tiled raster datasources, shared by all of them
+// and by all threads. Tiles are decoded whole, so map tiles reading different
+// windows of a source tile decode it once. The least recently used tiles are
+// dropped once the cache holds more bytes than reserved. Tiles are keyed by
+// the size and modification time of their file too, so a file replaced on
+// disk is decoded again.
+class raster_tile_cache : public mapnik::singleton<raster_tile_cache, mapnik::CreateStatic>
+{
+public:
+    using image_ptr = std::shared_ptr<mapnik::image_any const>;
+
+    // the cache grows to the largest size in bytes asked for by any datasource
+    void reserve(std::size_t max_size)
+    {
+        tiles_.reserve(max_size);
+    }
+
+    // Decoded image of `file`, nullptr if there is no reader for it.
+    // Throws what the image reader throws.
+    image_ptr get(std::string const& file, std::string const& format)
+    {
+        std::uint64_t file_size = 0;
+        std::int64_t mtime = 0;
+        if (!mapnik::util::file_stat(file, file_size, mtime))
+        {
+            // not cached, the reader reports what is wrong with the file
+            return read(file, format);
+        }
+        key_type key(file, format, file_size, mtime);
+        image_ptr image = tiles_.find(key);
+        if (image) return image;
+        // decode without holding the lock, a tile decoded by two threads at
+        // once is only kept once
+        image = read(file, format);
+        if (!image) return image;
+        return tiles_.insert(key, image);
+    }
+
+    // copy of a window of a cached image, callers may modify it
+    static mapnik::image_any crop(mapnik::image_any const& image, int x, int y, int width, int height)
+    {
+        return mapnik::util::apply_visitor(crop_image(x, y, width, height), image);
+    }
+
+private:
+    friend class mapnik::CreateStatic<raster_tile_cache>;
+
+    static image_ptr read(std::string const& file, std::string const& format)
+    {
+        std::unique_ptr<mapnik::image_reader> reader(mapnik::get_image_reader(file, format));
+        if (!reader) return image_ptr();
+        return std::make_shared<mapnik::image_any const>(
+            reader->read(0, 0, reader->width(), reader->height()));
+    }
+
+    struct crop_image
+    {
+        crop_image(int x, int y, int width, int height)
+            : x_(x), y_(y), width_(width), height_(height) {}
+
+        mapnik::image_any operator() (mapnik::image_null const&) const
+        {
+            return mapnik::image_any();
+        }
+
+        template <typename T>
+        mapnik::image_any operator() (T const& src) const
+        {
+            // pixels outside of a short tile are left transparent
+            int width = std::max(0, std::min(width_, static_cast<int>(src.width()) - x_));
+            int height = std::max(0, std::min(height_, static_cast<int>(src.height()) - y_));
+            T dst(width_, height_, width < width_ || height < height_,
+                  src.get_premultiplied(), src.painted());
+            dst.set_offset(src.get_offset());
+            dst.set_scaling(src.get_scaling());
+            for (int row = 0; row < height; ++row)
+            {
+                auto const* begin = src.get_row(y_ + row, x_);
+                std::copy(begin, begin + width, dst.get_row(row));
+            }
+            return mapnik::image_any(std::move(dst));
+        }
+
+        int x_;
+        int y_;
+        int width_;
+        int height_;
+    };
+
+    struct image_size
+    {
+        std::size_t operator()(mapnik::image_any const& image) const
+        {
+            return image.size();
+        }
+    };
+
+    raster_tile_cache()
+        : tiles_() {}
+
+    // file, format, file size and modification time
+    using key_type = std::tuple<std::string, std::string, std::uint64_t, std::int64_t>;
+
+    mapnik::util::lru_cache<key_type, mapnik::image_any, boost::hash<key_type>, image_size> tiles_;
+};
+
+#endif // RASTER_TILE_CACHE_HPP
@@ -20,6 +20,7 @@
  *
  *****************************************************************************/
 // mapnik
+#include <mapnik/debug.hpp>
 #include <mapnik/value_types.hpp>
 #include <mapnik/global.hpp>
 #include <mapnik/util/utf_conv_win.hpp>
@@ -38,6 +39,7 @@
 #pragma GCC diagnostic pop
 
 // stl
+#include <algorithm>
 #include <cstdint>
 #include <string>
 #include <cstring>
@@ -82,10 +84,7 @@ dbf_file::dbf_file(std::string const& file_name)
 }
 
 
-dbf_file::~dbf_file()
-{
-    ::operator delete(record_);
-}
+dbf_file::~dbf_file() {}
 
 
 bool dbf_file::is_open()
@@ -114,15 +113,22 @@ void dbf_file::move_to(int index)
     if (index>0 && index<=num_records_)
     {
         std::streampos pos=(num_fields_<<5)+34+(index-1)*(record_length_+1);
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+        if (static_cast<std::size_t>(pos) + record_length_ <= file_.buffer().second)
+        {
+            record_ = file_.buffer().first + pos;
+        }
+#else
         file_.seekg(pos,std::ios::beg);
-        file_.read(record_,record_length_);
+        file_.read(record_buffer_.data(),record_length_);
+#endif
     }
 }
 
 
 std::string dbf_file::string_value(int col) const
 {
-    if (col>=0 && col<num_fields_)
+    if (record_ && col>=0 && col<num_fields_)
     {
         return std::string(record_+fields_[col].offset_,fields_[col].length_);
     }
@@ -137,81 +143,156 @@ const field_descriptor& dbf_file::descriptor(int col) const
 }
 
 
-void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const
+namespace {
+
+// NOTE: ensure types handled here are matched in shape_datasource.cpp
+bool decode_field(field_descriptor const& field, const char* record,
+                  mapnik::transcoder const& tr, mapnik::value & val)
 {
     using namespace boost::spirit;
 
-    if (col>=0 && col<num_fields_)
+    switch (field.type_)
     {
-        std::string const& name=fields_[col].name_;
-
-        // NOTE: ensure types handled here are matched in shape_datasource.cpp
-        switch (fields_[col].type_)
-        {
-        case 'C':
-        case 'D':
+    case 'C':
+    case 'D':
+    {
+        // trim in place, the value ends at the first NUL if any
+        const char *itr = record + field.offset_;
+        const char *end = itr + field.length_;
+        itr = std::find_if(itr, end, mapnik::util::not_whitespace);
+        while (end != itr && !mapnik::util::not_whitespace(*(end - 1))) --end;
+        end = std::find(itr, end, '\0');
+        val = tr.transcode(itr, static_cast<std::int32_t>(end - itr));
+        return true;
+    }
+    case 'L':
+    {
+        char ch = record[field.offset_];
+        // NOTE: null logical fields use '?'
+        val = (ch == '1' || ch == 't' || ch == 'T' || ch == 'y' || ch == 'Y');
+        return true;
+    }
+    case 'N': // numeric
+    case 'O': // double
+    case 'F': // float
+    {
+        if (record[field.offset_] == '*')
         {
-            // FIXME - avoid constructing std::string on stack
-            std::string str(record_+fields_[col].offset_,fields_[col].length_);
-            mapnik::util::trim(str);
-            f.put(name,tr.transcode(str.c_str()));
-            break;
+            // NOTE: we intentionally do not store null here
+            // since it is equivalent to the attribute not existing
+            return false;
         }
-        case 'L':
+        const char *itr = record + field.offset_;
+        const char *end = itr + field.length_;
+        ascii::space_type space;
+        if (field.dec_ > 0)
         {
-            char ch = record_[fields_[col].offset_];
-            if ( ch == '1' || ch == 't' || ch == 'T' || ch == 'y' || ch == 'Y')
+            double d = 0.0;
+            static qi::double_type double_;
+            if (qi::phrase_parse(itr, end, double_, space, d))
             {
-                f.put(name,true);
+                val = d;
+                return true;
             }
-            else
-            {
-                // NOTE: null logical fields use '?'
-                f.put(name,false);
-            }
-            break;
         }
-        case 'N': // numeric
-        case 'O': // double
-        case 'F': // float
+        else
         {
-
-            if (record_[fields_[col].offset_] == '*')
-            {
-                // NOTE: we intentionally do not store null here
-                // since it is equivalent to the attribute not existing
-                break;
-            }
-            if ( fields_[col].dec_>0 )
-            {
-                double val = 0.0;
-                const char *itr = record_+fields_[col].offset_;
-                const char *end = itr + fields_[col].length_;
-                ascii::space_type space;
-                static qi::double_type double_;
-                if (qi::phrase_parse(itr,end,double_,space,val))
-                {
-                    f.put(name,val);
-                }
-            }
-            else
+            mapnik::value_integer i = 0;
+            static qi::int_parser<mapnik::value_integer,10,1,-1> numeric_parser;
+            if (qi::phrase_parse(itr, end, numeric_parser, space, i))
             {
-                mapnik::value_integer val = 0;
-                const char *itr = record_+fields_[col].offset_;
-                const char *end = itr + fields_[col].length_;
-                ascii::space_type space;
-                static qi::int_parser<mapnik::value_integer,10,1,-1> numeric_parser;
-                if (qi::phrase_parse(itr, end, numeric_parser, space, val))
-                {
-                    f.put(name,val);
-                }
+                val = i;
+                return true;
             }
-            break;
         }
+        return false;
+    }
+    }
+    return false;
+}
+
+class dbf_row : public mapnik::feature_attribute_source
+{
+public:
+    dbf_row(dbf_projection_ptr const& projection, const char* record)
+        : projection_(projection),
+          row_()
+    {
+        projection_->project(record, row_);
+    }
+
+    void decode(std::size_t index, mapnik::value & val) const
+    {
+        try
+        {
+            projection_->decode(index, row_.data(), val);
+        }
+        catch (...)
+        {
+            MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
+        }
+    }
+
+private:
+    dbf_projection_ptr projection_;
+    std::vector<char> row_;
+};
+
+}
+
+dbf_projection::dbf_projection(dbf_file const& dbf, std::vector<int> const& columns, std::string const& encoding)
+    : fields_(),
+      record_offsets_(),
+      row_length_(0),
+      tr_(encoding)
+{
+    fields_.reserve(columns.size());
+    record_offsets_.reserve(columns.size());
+    for (int col : columns)
+    {
+        field_descriptor field = dbf.descriptor(col);
+        record_offsets_.push_back(field.offset_);
+        field.offset_ = row_length_;
+        row_length_ += field.length_;
+        fields_.push_back(field);
+    }
+}
+
+void dbf_projection::project(const char* record, std::vector<char> & row) const
+{
+    row.resize(row_length_);
+    for (std::size_t i = 0; i < fields_.size(); ++i)
+    {
+        std::memcpy(row.data() + fields_[i].offset_, record + record_offsets_[i], fields_[i].length_);
+    }
+}
+
+bool dbf_projection::decode(std::size_t index, const char* row, mapnik::value & val) const
+{
+    if (index >= fields_.size()) return false;
+    return decode_field(fields_[index], row, tr_, val);
+}
+
+void dbf_file::add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const
+{
+    if (record_ && col>=0 && col<num_fields_)
+    {
+        mapnik::value val;
+        if (decode_field(fields_[col], record_, tr, val))
+        {
+            f.put(fields_[col].name_, std::move(val));
         }
     }
 }
 
+void dbf_file::add_attributes(dbf_projection_ptr const& projection, mapnik::feature_impl & f) const
+{
+    if (record_ && projection->size() > 0)
+    {
+        f.set_attribute_source(std::make_shared<dbf_row>(projection, record_));
+    }
+}
+
 void dbf_file::read_header()
 {
     char c=file_.get();
@@ -247,10 +328,13 @@ void dbf_file::read_header()
             fields_.push_back(desc);
         }
         record_length_=offset;
+#if !defined(MAPNIK_MEMORY_MAPPED_FILE)
         if (record_length_>0)
         {
-            record_=static_cast<char*>(::operator new (sizeof(char)*record_length_));
+            record_buffer_.resize(record_length_);
+            record_=record_buffer_.data();
         }
+#endif
     }
 }
 
@@ -39,6 +39,7 @@
 // stl
 #include <vector>
 #include <string>
+#include <memory>
 #include <cassert>
 #include <fstream>
 
@@ -52,6 +53,28 @@ struct field_descriptor
     std::streampos offset_;
 };
 
+class dbf_file;
+
+// Columns of a dbf file requested by a query, in feature context order.
+// Features keep only these columns of their record and decode them when
+// an attribute is first read.
+class dbf_projection : private mapnik::util::noncopyable
+{
+public:
+    dbf_projection(dbf_file const& dbf, std::vector<int> const& columns, std::string const& encoding);
+    std::size_t size() const { return fields_.size(); }
+    // copies the projected columns of a full record into `row`
+    void project(const char* record, std::vector<char> & row) const;
+    bool decode(std::size_t index, const char* row, mapnik::value & val) const;
+private:
+    // offsets are relative to a projected row
+    std::vector<field_descriptor> fields_;
+    std::vector<std::size_t> record_offsets_;
+    std::size_t row_length_;
+    mapnik::transcoder tr_;
+};
+
+using dbf_projection_ptr = std::shared_ptr<dbf_projection const>;
 
 class dbf_file : private mapnik::util::noncopyable
 {
@@ -65,8 +88,10 @@ private:
     mapnik::mapped_region_ptr mapped_region_;
 #else
     std::ifstream file_;
+    std::vector<char> record_buffer_;
 #endif
-    char* record_;
+    // current record, points straight into the mapped file if possible
+    const char* record_;
 public:
     dbf_file();
     dbf_file(std::string const& file_name);
@@ -78,6 +103,8 @@ public:
     void move_to(int index);
     std::string string_value(int col) const;
     void add_attribute(int col, mapnik::transcoder const& tr, mapnik::feature_impl & f) const;
+    // attributes of the current record, decoded on first access
+    void add_attributes(dbf_projection_ptr const& projection, mapnik::feature_impl & f) const;
 private:
     void read_header();
     int read_short();
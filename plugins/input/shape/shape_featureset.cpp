@@ -46,7 +46,7 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
       shape_(shape_name, false),
       query_ext_(),
       feature_bbox_(),
-      tr_(new transcoder(encoding)),
+      projection_(),
       shx_file_length_(0),
       row_limit_(row_limit),
       count_(0),
@@ -61,6 +61,7 @@ shape_featureset<filterT>::shape_featureset(filterT const& filter,
     shx_header.skip(6 * 4);
     shx_file_length_ = shx_header.read_xdr_integer();
     setup_attributes(ctx_, attribute_names, shape_name, shape_, attr_ids_);
+    projection_ = std::make_shared<dbf_projection>(shape_.dbf(), attr_ids_, encoding);
 }
 
 template <typename filterT>
@@ -144,17 +145,7 @@ feature_ptr shape_featureset<filterT>::next()
         if (attr_ids_.size())
         {
             shape_.dbf().move_to(shape_.id_);
-            try
-            {
-                for (auto id : attr_ids_)
-                {
-                    shape_.dbf().add_attribute(id, *tr_, *feature); //TODO optimize!!!
-                }
-            }
-            catch (...)
-            {
-                MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
-            }
+            shape_.dbf().add_attributes(projection_, *feature);
         }
         ++count_;
         return feature;
@@ -51,16 +51,18 @@ shape_index_featureset<filterT>::shape_index_featureset(filterT const& filter,
     : filter_(filter),
       ctx_(std::make_shared<mapnik::context_type>()),
       shape_ptr_(std::move(shape_ptr)),
-      tr_(new mapnik::transcoder(encoding)),
+      projection_(),
       offsets_(),
       itr_(),
       attr_ids_(),
       row_limit_(row_limit),
       count_(0),
-      feature_bbox_()
+      feature_bbox_(),
+      parts_()
 {
     shape_ptr_->shp().skip(100);
     setup_attributes(ctx_, attribute_names, shape_name, *shape_ptr_,attr_ids_);
+    projection_ = std::make_shared<dbf_projection>(shape_ptr_->dbf(), attr_ids_, encoding);
 
     auto index = shape_ptr_->index();
     if (index)
@@ -89,10 +91,10 @@ feature_ptr shape_index_featureset<filterT>::next()
     {
         int offset = itr_->offset;
         shape_ptr_->move_to(offset);
-        std::vector<std::pair<int,int>> parts;
+        parts_.clear();
         while (itr_ != offsets_.end() && itr_->offset == offset)
         {
-            if (itr_->start!= -1) parts.emplace_back(itr_->start, itr_->end);
+            if (itr_->start!= -1) parts_.emplace_back(itr_->start, itr_->end);
             ++itr_;
         }
         mapnik::value_integer feature_id = shape_ptr_->id();
@@ -135,8 +137,8 @@ feature_ptr shape_index_featureset<filterT>::next()
         {
             shape_io::read_bbox(record, feature_bbox_);
             if (!filter_.pass(feature_bbox_)) continue;
-            if (parts.size() < 2) feature->set_geometry(shape_io::read_polyline(record));
-            else feature->set_geometry(shape_io::read_polyline_parts(record, parts));
+            if (parts_.size() < 2) feature->set_geometry(shape_io::read_polyline(record));
+            else feature->set_geometry(shape_io::read_polyline_parts(record, parts_));
             break;
         }
         case shape_io::shape_polygon:
@@ -145,8 +147,8 @@ feature_ptr shape_index_featureset<filterT>::next()
         {
             shape_io::read_bbox(record, feature_bbox_);
             if (!filter_.pass(feature_bbox_)) continue;
-            if (parts.size() < 2) feature->set_geometry(shape_io::read_polygon(record));
-            else feature->set_geometry(shape_io::read_polygon_parts(record, parts));
+            if (parts_.size() < 2) feature->set_geometry(shape_io::read_polygon(record));
+            else feature->set_geometry(shape_io::read_polygon_parts(record, parts_));
             break;
         }
         default :
@@ -157,17 +159,7 @@ feature_ptr shape_index_featureset<filterT>::next()
         if (attr_ids_.size())
         {
             shape_ptr_->dbf().move_to(shape_ptr_->id_);
-            try
-            {
-                for (auto id : attr_ids_)
-                {
-                    shape_ptr_->dbf().add_attribute(id, *tr_, *feature);
-                }
-            }
-            catch (...)
-            {
-                MAPNIK_LOG_ERROR(shape) << "Shape Plugin: error processing attributes";
-            }
+            shape_ptr_->dbf().add_attributes(projection_, *feature);
         }
         ++count_;
         return feature;
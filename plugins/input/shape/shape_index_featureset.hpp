@@ -77,13 +77,15 @@ private:
     filterT filter_;
     context_ptr ctx_;
     std::unique_ptr<shape_io> shape_ptr_;
-    const std::unique_ptr<mapnik::transcoder> tr_;
+    dbf_projection_ptr projection_;
     std::vector<mapnik::detail::node> offsets_;
     std::vector<mapnik::detail::node>::iterator itr_;
     std::vector<int> attr_ids_;
     mapnik::value_integer row_limit_;
     mutable int count_;
     mutable box2d<double> feature_bbox_;
+    // reused across features
+    std::vector<std::pair<int,int>> parts_;
 };
 
 #endif // SHAPE_INDEX_FEATURESET_HPP
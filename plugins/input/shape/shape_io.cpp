@@ -120,22 +120,22 @@ mapnik::geometry::geometry<double> shape_io::read_polyline(shape_file::record_ty
     }
     else
     {
-        std::vector<int> parts;
-        parts.resize(num_parts);
-        std::for_each(parts.begin(), parts.end(), [&](int & part) { part = record.read_ndr_integer();});
+        // part indices are read in place
+        std::size_t parts_pos = record.pos;
+        record.skip(4 * num_parts);
         int start, end;
         mapnik::geometry::multi_line_string<double> multi_line;
         multi_line.reserve(num_parts);
         for (int k = 0; k < num_parts; ++k)
         {
-            start = parts[k];
+            start = record.ndr_integer_at(parts_pos + 4 * k);
             if (k == num_parts - 1)
             {
                 end = num_points;
             }
             else
             {
-                end = parts[k + 1];
+                end = record.ndr_integer_at(parts_pos + 4 * (k + 1));
             }
 
             mapnik::geometry::line_string<double> line;
@@ -188,17 +188,17 @@ mapnik::geometry::geometry<double> shape_io::read_polygon(shape_file::record_typ
     int num_parts = record.read_ndr_integer();
     int num_points = record.read_ndr_integer();
 
-    std::vector<int> parts;
-    parts.resize(num_parts);
-    std::for_each(parts.begin(), parts.end(), [&](int & part) { part = record.read_ndr_integer();});
+    // part indices are read in place
+    std::size_t parts_pos = record.pos;
+    record.skip(4 * num_parts);
     mapnik::geometry::polygon<double> poly;
     mapnik::geometry::multi_polygon<double> multi_poly;
     for (int k = 0; k < num_parts; ++k)
     {
-        int start = parts[k];
+        int start = record.ndr_integer_at(parts_pos + 4 * k);
         int end;
         if (k == num_parts - 1) end = num_points;
-        else end = parts[k + 1];
+        else end = record.ndr_integer_at(parts_pos + 4 * (k + 1));
 
         mapnik::geometry::linear_ring<double> ring;
         ring.reserve(end - start);
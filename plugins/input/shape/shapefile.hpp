@@ -28,6 +28,7 @@
 #include <fstream>
 #include <stdexcept>
 #include <cstdint>
+#include <vector>
 
 // mapnik
 #include <mapnik/global.hpp>
@@ -51,20 +52,8 @@ using mapnik::read_double_ndr;
 using mapnik::read_double_xdr;
 
 
-struct RecordTag
-{
-    using data_type = char*;
-    static data_type alloc(unsigned size)
-    {
-        return static_cast<data_type>(::operator new(sizeof(char)*size));
-    }
-
-    static void dealloc(data_type data)
-    {
-        ::operator delete(data);
-    }
-};
-
+// Records are views, either into the mapped file or into
+// the read buffer of shape_file, valid until the next read.
 struct MappedRecordTag
 {
     using data_type = const char*;
@@ -126,6 +115,14 @@ struct shape_record
         return val;
     }
 
+    // read without moving the current position
+    int ndr_integer_at(std::size_t offset) const
+    {
+        std::int32_t val;
+        read_int32_ndr(&data[offset], val);
+        return val;
+    }
+
     double read_double()
     {
         double val;
@@ -146,13 +143,13 @@ class shape_file : mapnik::util::noncopyable
 {
 public:
 
+    using record_type = shape_record<MappedRecordTag>;
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
     using file_source_type = boost::interprocess::ibufferstream;
-    using record_type = shape_record<MappedRecordTag>;
     mapnik::mapped_region_ptr mapped_region_;
 #else
     using file_source_type = std::ifstream;
-    using record_type = shape_record<RecordTag>;
+    std::vector<char> record_buffer_;
 #endif
 
     file_source_type file_;
@@ -206,7 +203,10 @@ public:
         rec.set_data(file_.buffer().first + file_.tellg());
         file_.seekg(rec.size, std::ios::cur);
 #else
-        file_.read(rec.get_data(), rec.size);
+        // buffer only ever grows, records don't allocate
+        if (record_buffer_.size() < rec.size) record_buffer_.resize(rec.size);
+        file_.read(record_buffer_.data(), rec.size);
+        rec.set_data(record_buffer_.data());
 #endif
     }
 
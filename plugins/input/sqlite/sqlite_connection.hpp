@@ -25,6 +25,7 @@
 
 // stl
 #include <string.h>
+#include <map>
 #include <memory>
 
 // mapnik
@@ -101,12 +102,18 @@ public:
 
     virtual ~sqlite_connection ()
     {
+        clear_statements();
         if (db_)
         {
             sqlite3_close (db_);
         }
     }
 
+    bool isOK() const
+    {
+        return db_ != 0;
+    }
+
     void throw_sqlite_error(std::string const& sql)
     {
         std::ostringstream s;
@@ -138,6 +145,36 @@ public:
         return std::make_shared<sqlite_resultset>(stmt);
     }
 
+    // Statement for `sql`, prepared once per connection. Only one
+    // resultset may use it at a time, see sqlite_resultset.
+    sqlite3_stmt* prepare_cached(std::string const& sql)
+    {
+        auto itr = statements_.find(sql);
+        if (itr != statements_.end())
+        {
+            return itr->second;
+        }
+        if (statements_.size() >= max_cached_statements)
+        {
+            clear_statements();
+        }
+#ifdef MAPNIK_STATS
+        mapnik::progress_timer __stats__(std::clog, std::string("sqlite_resultset::prepare_cached ") + sql);
+#endif
+        sqlite3_stmt* stmt = 0;
+#if SQLITE_VERSION_NUMBER >= 3020000
+        const int rc = sqlite3_prepare_v3 (db_, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT, &stmt, 0);
+#else
+        const int rc = sqlite3_prepare_v2 (db_, sql.c_str(), -1, &stmt, 0);
+#endif
+        if (rc != SQLITE_OK)
+        {
+            throw_sqlite_error(sql);
+        }
+        statements_.emplace(sql, stmt);
+        return stmt;
+    }
+
     void execute(std::string const& sql)
     {
 #ifdef MAPNIK_STATS
@@ -175,8 +212,20 @@ public:
 
 private:
 
+    void clear_statements()
+    {
+        for (auto const& item : statements_)
+        {
+            sqlite3_finalize (item.second);
+        }
+        statements_.clear();
+    }
+
+    static const std::size_t max_cached_statements = 64;
+
     sqlite3* db_;
     std::string file_;
+    std::map<std::string, sqlite3_stmt*> statements_;
 };
 
 #endif // MAPNIK_SQLITE_CONNECTION_HPP
@@ -0,0 +1,126 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_SQLITE_CONNECTION_POOL_HPP
+#define MAPNIK_SQLITE_CONNECTION_POOL_HPP
+
+// mapnik
+#include <mapnik/pool.hpp>
+#include <mapnik/util/singleton.hpp>
+#include <mapnik/value_types.hpp>
+
+// stl
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
+#include "sqlite_connection.hpp"
+
+// Opens read-only connections to a database file and runs the statements
+// the datasource ran on its own connection (attached databases, initdb)
+template <typename T>
+class sqlite_connection_creator
+{
+public:
+    sqlite_connection_creator(std::string const& file,
+                              std::vector<std::string> const& init_statements,
+                              mapnik::value_integer mmap_size)
+        : file_(file),
+          init_statements_(init_statements),
+          mmap_size_(mmap_size) {}
+
+    T* operator()() const
+    {
+#if SQLITE_VERSION_NUMBER >= 3005000
+        std::unique_ptr<T> conn(new T(file_, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX));
+#else
+        std::unique_ptr<T> conn(new T(file_));
+#endif
+        sqlite3_busy_timeout(*(*conn), 5000);
+        if (mmap_size_ > 0)
+        {
+            std::ostringstream s;
+            s << "PRAGMA mmap_size=" << mmap_size_;
+            conn->execute(s.str());
+        }
+        for (std::string const& sql : init_statements_)
+        {
+            conn->execute(sql);
+        }
+        return conn.release();
+    }
+
+    std::string id() const
+    {
+        std::ostringstream s;
+        s << file_ << "\n" << mmap_size_;
+        for (std::string const& sql : init_statements_)
+        {
+            s << "\n" << sql;
+        }
+        return s.str();
+    }
+
+private:
+    std::string file_;
+    std::vector<std::string> init_statements_;
+    mapnik::value_integer mmap_size_;
+};
+
+// Connections to the same database file, set up the same way, are shared by
+// all datasources using it. A connection is used by one featureset at a time,
+// which lets it keep its prepared statements between queries.
+class sqlite_connection_manager : public mapnik::singleton<sqlite_connection_manager, mapnik::CreateStatic>
+{
+public:
+    using pool_type = mapnik::Pool<sqlite_connection, sqlite_connection_creator>;
+
+    std::shared_ptr<pool_type> get_pool(sqlite_connection_creator<sqlite_connection> const& creator,
+                                        unsigned max_size)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        std::string key = creator.id();
+        auto itr = pools_.find(key);
+        if (itr != pools_.end())
+        {
+            itr->second->set_max_size(max_size);
+            return itr->second;
+        }
+        return pools_.emplace(key, std::make_shared<pool_type>(creator, 0, max_size)).first->second;
+    }
+
+private:
+    friend class mapnik::CreateStatic<sqlite_connection_manager>;
+    std::map<std::string, std::shared_ptr<pool_type> > pools_;
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+};
+
+#endif // MAPNIK_SQLITE_CONNECTION_POOL_HPP
@@ -57,6 +57,7 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
       extent_(),
       extent_initialized_(false),
       type_(datasource::Vector),
+      pool_failed_(false),
       table_(*params.get<std::string>("table", "")),
       fields_(*params.get<std::string>("fields", "*")),
       metadata_(*params.get<std::string>("metadata", "")),
@@ -282,7 +283,8 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
         bool index_db_attached = false;
         if (mapnik::util::exists(index_db))
         {
-            dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+            init_statements_.push_back("attach database '" + index_db + "' as " + index_table_);
+            dataset_->execute(init_statements_.back());
             index_db_attached = true;
         }
         has_spatial_index_ = sqlite_utils::has_rtree(index_table_,dataset_);
@@ -309,7 +311,8 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
                     has_spatial_index_ = true;
                     if (!index_db_attached && mapnik::util::exists(index_db))
                     {
-                        dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+                        init_statements_.push_back("attach database '" + index_db + "' as " + index_table_);
+                        dataset_->execute(init_statements_.back());
                     }
                 }
             }
@@ -354,6 +357,52 @@ sqlite_datasource::sqlite_datasource(parameters const& params)
         }
     }
 
+    // Feature queries run on read-only connections shared by all datasources
+    // using the same file. Connections are opened on demand, up to max_size
+    // (as for postgis), and SQLite reads through mmap only if asked to.
+    if (dataset_name_.compare(":memory:") != 0)
+    {
+        sqlite_connection_creator<sqlite_connection> creator(
+            dataset_name_,
+            init_statements_,
+            *params.get<mapnik::value_integer>("mmap_size", 0));
+        pool_ = sqlite_connection_manager::instance().get_pool(
+            creator,
+            *params.get<mapnik::value_integer>("max_size", 10));
+    }
+}
+
+std::shared_ptr<sqlite_resultset> sqlite_datasource::execute_query(std::string const& sql,
+                                                                   mapnik::box2d<double> const& e) const
+{
+    std::shared_ptr<sqlite_connection> conn;
+    if (pool_ && !pool_failed_)
+    {
+        try
+        {
+            conn = pool_->borrowObject();
+        }
+        catch (datasource_exception const& ex)
+        {
+            // e.g. init statements that need to write
+            if (!pool_failed_.exchange(true))
+            {
+                MAPNIK_LOG_WARN(sqlite) << "sqlite_datasource: not using shared read-only connections: " << ex.what();
+            }
+        }
+    }
+    std::shared_ptr<sqlite_resultset> rs;
+    if (conn)
+    {
+        rs = std::make_shared<sqlite_resultset>(conn, conn->prepare_cached(sql));
+    }
+    else
+    {
+        // no free pooled connection
+        rs = dataset_->execute_query(sql);
+    }
+    rs->bind_extent(e);
+    return rs;
 }
 
 std::string sqlite_datasource::populate_tokens(std::string const& sql) const
@@ -514,7 +563,6 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         {
             // TODO - debug warn if fails
             sqlite_utils::apply_spatial_filter(query,
-                                               e,
                                                table_,
                                                key_field_,
                                                index_table_,
@@ -540,7 +588,7 @@ featureset_ptr sqlite_datasource::features(query const& q) const
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs(execute_query(s.str(), e));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                      ctx,
@@ -594,7 +642,6 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
         {
             // TODO - debug warn if fails
             sqlite_utils::apply_spatial_filter(query,
-                                               e,
                                                table_,
                                                key_field_,
                                                index_table_,
@@ -620,7 +667,7 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
 
         MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
 
-        std::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
+        std::shared_ptr<sqlite_resultset> rs(execute_query(s.str(), e));
 
         return std::make_shared<sqlite_featureset>(rs,
                                                      ctx,
@@ -39,11 +39,13 @@
 #include <memory>
 
 // stl
+#include <atomic>
 #include <vector>
 #include <string>
 
 // sqlite
 #include "sqlite_connection.hpp"
+#include "sqlite_connection_pool.hpp"
 
 class sqlite_datasource : public mapnik::datasource
 {
@@ -63,12 +65,18 @@ private:
     // needed to attach auxillary databases
     void parse_attachdb(std::string const& attachdb) const;
     std::string populate_tokens(std::string const& sql) const;
+    // Runs a feature query, on a pooled connection when one is free
+    std::shared_ptr<sqlite_resultset> execute_query(std::string const& sql,
+                                                    mapnik::box2d<double> const& e) const;
 
     mapnik::box2d<double> extent_;
     bool extent_initialized_;
     mapnik::datasource::datasource_t type_;
     std::string dataset_name_;
     std::shared_ptr<sqlite_connection> dataset_;
+    std::shared_ptr<sqlite_connection_manager::pool_type> pool_;
+    // set once opening a pooled connection failed
+    mutable std::atomic<bool> pool_failed_;
     std::string table_;
     std::string fields_;
     std::string metadata_;
@@ -28,8 +28,11 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/params.hpp>
 
+#include <mapnik/box2d.hpp>
+
 // stl
 #include <string.h>
+#include <memory>
 
 // sqlite
 extern "C" {
@@ -38,6 +41,8 @@ extern "C" {
 
 
 
+class sqlite_connection;
+
 //==============================================================================
 
 class sqlite_resultset
@@ -49,11 +54,44 @@ public:
     {
     }
 
+    // Statement cached by `conn`, which stays borrowed by the resultset. The
+    // statement is reset for the next query instead of being finalized.
+    sqlite_resultset (std::shared_ptr<sqlite_connection> const& conn, sqlite3_stmt* stmt)
+        : conn_(conn),
+          stmt_(stmt)
+    {
+    }
+
     ~sqlite_resultset ()
     {
         if (stmt_)
         {
-            sqlite3_finalize (stmt_);
+            if (conn_)
+            {
+                sqlite3_reset (stmt_);
+                sqlite3_clear_bindings (stmt_);
+            }
+            else
+            {
+                sqlite3_finalize (stmt_);
+            }
+        }
+    }
+
+    // Binds the extent to the ?1 to ?4 parameters of a spatial filter,
+    // if the statement has them
+    void bind_extent (mapnik::box2d<double> const& e)
+    {
+        if (sqlite3_bind_parameter_count (stmt_) < 4)
+        {
+            return;
+        }
+        if ((sqlite3_bind_double (stmt_, 1, e.minx()) != SQLITE_OK) ||
+            (sqlite3_bind_double (stmt_, 2, e.maxx()) != SQLITE_OK) ||
+            (sqlite3_bind_double (stmt_, 3, e.miny()) != SQLITE_OK) ||
+            (sqlite3_bind_double (stmt_, 4, e.maxy()) != SQLITE_OK))
+        {
+            throw mapnik::datasource_exception("SQLite Plugin: invalid value for extent of spatial filter");
         }
     }
 
@@ -139,6 +177,7 @@ public:
 
 private:
 
+    std::shared_ptr<sqlite_connection> conn_;
     sqlite3_stmt* stmt_;
 };
 
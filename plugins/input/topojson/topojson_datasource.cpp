@@ -39,6 +39,7 @@
 #include <mapnik/util/variant.hpp>
 #include <mapnik/util/file_io.hpp>
 #include <mapnik/make_unique.hpp>
+#include <mapnik/feature_factory.hpp>
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -100,6 +101,30 @@ struct geometry_type_visitor
     {
         return static_cast<int>(mapnik::datasource_geometry_t::Polygon);
     }
+    int operator() (mapnik::geometry::point<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::Point);
+    }
+    int operator() (mapnik::geometry::multi_point<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::Point);
+    }
+    int operator() (mapnik::geometry::line_string<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::LineString);
+    }
+    int operator() (mapnik::geometry::multi_line_string<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::LineString);
+    }
+    int operator() (mapnik::geometry::polygon<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::Polygon);
+    }
+    int operator() (mapnik::geometry::multi_polygon<double> const&) const
+    {
+        return static_cast<int>(mapnik::datasource_geometry_t::Polygon);
+    }
     template <typename T>
     int operator() (T const& ) const
     {
@@ -158,10 +183,21 @@ topojson_datasource::topojson_datasource(parameters const& params)
         else
             filename_ = *file;
     }
+    boost::optional<std::string> feature_cache_dir = params.get<std::string>("feature_cache_dir");
+    std::string feature_cache_file;
+    if (inline_string_.empty() && feature_cache_dir)
+    {
+        feature_cache_file = mapnik::feature_cache::filename(*feature_cache_dir, filename_);
+        feature_cache_ = mapnik::feature_cache::open(feature_cache_file, filename_);
+    }
     if (!inline_string_.empty())
     {
         parse_topojson(inline_string_.c_str());
     }
+    else if (feature_cache_)
+    {
+        initialise_feature_cache();
+    }
     else
     {
         mapnik::util::file file(filename_);
@@ -173,6 +209,10 @@ topojson_datasource::topojson_datasource(parameters const& params)
         file_buffer.resize(file.size());
         std::fread(&file_buffer[0], file.size(), 1, file.get());
         parse_topojson(file_buffer.c_str());
+        if (!feature_cache_file.empty())
+        {
+            write_feature_cache(feature_cache_file);
+        }
     }
 }
 
@@ -224,6 +264,61 @@ void topojson_datasource::parse_topojson(T const& buffer)
     tree_ = std::make_unique<spatial_index_type>(values);
 }
 
+void topojson_datasource::write_feature_cache(std::string const& filename) const
+{
+    mapnik::feature_cache_writer writer;
+    std::size_t geometry_index = 0;
+    for (auto const& geom : topo_.geometries)
+    {
+        // a context per feature, so the cache records the properties each one has
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature = mapnik::util::apply_visitor(
+            mapnik::topojson::feature_generator<mapnik::context_ptr>(ctx, *tr_, topo_, ++geometry_index),
+            geom);
+        if (!feature) feature = mapnik::feature_factory::create(ctx, geometry_index);
+        writer.add(*feature);
+    }
+    writer.write(filename, filename_);
+}
+
+void topojson_datasource::initialise_feature_cache()
+{
+    using values_container = std::vector< std::pair<box_type, std::size_t> >;
+    values_container values;
+    values.reserve(feature_cache_->size());
+
+    bool first = true;
+    for (std::size_t index = 0; index < feature_cache_->size(); ++index)
+    {
+        mapnik::box2d<double> box = feature_cache_->envelope(index);
+        if (box.valid())
+        {
+            if (first)
+            {
+                first = false;
+                extent_ = box;
+                auto const& names = feature_cache_->attribute_names();
+                for (std::size_t column = 0; column < names.size(); ++column)
+                {
+                    if (!feature_cache_->has_attribute(index, column)) continue;
+                    mapnik::value val;
+                    feature_cache_->decode(index, column, val);
+                    desc_.add_descriptor(mapnik::attribute_descriptor(names[column],
+                                                                      mapnik::util::apply_visitor(attr_value_converter(), val)));
+                }
+            }
+            else
+            {
+                extent_.expand_to_include(box);
+            }
+            values.emplace_back(box, index);
+        }
+    }
+
+    // packing algorithm
+    tree_ = std::make_unique<spatial_index_type>(values);
+}
+
 topojson_datasource::~topojson_datasource() { }
 
 const char * topojson_datasource::name()
@@ -235,11 +330,12 @@ boost::optional<mapnik::datasource_geometry_t> topojson_datasource::get_geometry
 {
     boost::optional<mapnik::datasource_geometry_t> result;
     int multi_type = 0;
-    std::size_t num_features = topo_.geometries.size();
+    std::size_t num_features = feature_cache_ ? feature_cache_->size() : topo_.geometries.size();
     for (std::size_t i = 0; i < num_features && i < 5; ++i)
     {
-        mapnik::topojson::geometry const& geom = topo_.geometries[i];
-        int type = mapnik::util::apply_visitor(geometry_type_visitor(),geom);
+        int type = feature_cache_
+            ? mapnik::util::apply_visitor(geometry_type_visitor(), feature_cache_->geometry(i))
+            : mapnik::util::apply_visitor(geometry_type_visitor(), topo_.geometries[i]);
         if (type > 0)
         {
             if (multi_type > 0 && multi_type != type)
@@ -282,6 +378,13 @@ mapnik::featureset_ptr topojson_datasource::features(mapnik::query const& q) con
         if (tree_)
         {
             tree_->query(boost::geometry::index::intersects(box),std::back_inserter(index_array));
+            if (feature_cache_)
+            {
+                std::vector<std::size_t> indices;
+                indices.reserve(index_array.size());
+                for (auto const& item : index_array) indices.push_back(item.second);
+                return std::make_shared<mapnik::feature_cache_featureset>(feature_cache_, std::move(indices), 1);
+            }
             return std::make_shared<topojson_featureset>(topo_, *tr_, std::move(index_array));
         }
     }
@@ -32,6 +32,7 @@
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/unicode.hpp>
+#include <mapnik/feature_cache.hpp>
 #include <mapnik/json/topology.hpp>
 
 #pragma GCC diagnostic push
@@ -70,6 +71,8 @@ public:
     boost::optional<mapnik::datasource_geometry_t> get_geometry_type() const;
     template <typename T>
     void parse_topojson(T const& buffer);
+    void write_feature_cache(std::string const& filename) const;
+    void initialise_feature_cache();
 private:
     mapnik::datasource::datasource_t type_;
     std::map<std::string, mapnik::parameters> statistics_;
@@ -80,6 +83,7 @@ private:
     std::unique_ptr<mapnik::transcoder> tr_;
     mapnik::topojson::topology topo_;
     std::unique_ptr<spatial_index_type> tree_;
+    mapnik::feature_cache::ptr feature_cache_;
 };
 
 
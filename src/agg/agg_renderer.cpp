@@ -42,7 +42,6 @@
 #include <mapnik/image_compositing.hpp>
 #include <mapnik/image_filter.hpp>
 #include <mapnik/image_any.hpp>
-#include <mapnik/make_unique.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore_agg.hpp>
@@ -72,12 +71,16 @@ template <typename T0, typename T1>
 agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      painted_extents_(),
       internal_buffers_(m.width(), m.height()),
       inflated_buffer_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
-      common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor)
+      common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor),
+      layer_concurrency_(1),
+      filter_concurrency_(1),
+      raster_concurrency_(1)
 {
     setup(m, pixmap);
 }
@@ -86,12 +89,16 @@ template <typename T0, typename T1>
 agg_renderer<T0,T1>::agg_renderer(Map const& m, request const& req, attributes const& vars, T0 & pixmap, double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      painted_extents_(),
       internal_buffers_(req.width(), req.height()),
       inflated_buffer_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
-      common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor)
+      common_(m, req, vars, offset_x, offset_y, req.width(), req.height(), scale_factor),
+      layer_concurrency_(1),
+      filter_concurrency_(1),
+      raster_concurrency_(1)
 {
     setup(m, pixmap);
 }
@@ -101,16 +108,80 @@ agg_renderer<T0,T1>::agg_renderer(Map const& m, T0 & pixmap, std::shared_ptr<T1>
                               double scale_factor, unsigned offset_x, unsigned offset_y)
     : feature_style_processor<agg_renderer>(m, scale_factor),
       buffers_(),
+      painted_extents_(),
       internal_buffers_(m.width(), m.height()),
       inflated_buffer_(),
       ras_ptr(new rasterizer),
       gamma_method_(GAMMA_POWER),
       gamma_(1.0),
-      common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector)
+      common_(m, attributes(), offset_x, offset_y, m.width(), m.height(), scale_factor, detector),
+      layer_concurrency_(1),
+      filter_concurrency_(1),
+      raster_concurrency_(1)
 {
     setup(m, pixmap);
 }
 
+template <typename T0, typename T1>
+agg_renderer<T0,T1>::agg_renderer(Map const& m, agg_renderer const& parent)
+    : feature_style_processor<agg_renderer>(m, parent.common_.scale_factor_),
+      buffers_(),
+      painted_extents_(),
+      internal_buffers_(parent.common_.width_, parent.common_.height_),
+      inflated_buffer_(),
+      ras_ptr(new rasterizer),
+      gamma_method_(GAMMA_POWER),
+      gamma_(1.0),
+      common_(m, parent.common_,
+              std::make_shared<renderer_common::detector_type>(parent.common_.detector_->extent(),
+                                                                parent.common_.detector_->index())),
+      layer_concurrency_(1),
+      filter_concurrency_(1),
+      raster_concurrency_(1)
+{
+    // No target buffer here, the layer is rendered
+    // into one of internal buffers, see start_layer_processing()
+    ras_ptr->clip_box(0,0,common_.width_,common_.height_);
+}
+
+namespace {
+
+// Whether compositing a fully transparent source pixel leaves the
+// destination pixel as is, which allows skipping untouched regions.
+bool transparent_src_is_noop(composite_mode_e mode)
+{
+    switch (mode)
+    {
+    case dst:
+    case src_over:
+    case dst_over:
+    case src_atop:
+    case _xor:
+    case plus:
+    case minus:
+    case multiply:
+    case screen:
+    case overlay:
+    case darken:
+    case lighten:
+    case color_dodge:
+    case color_burn:
+    case hard_light:
+    case soft_light:
+    case difference:
+    case exclusion:
+    case invert:
+    case invert_rgb:
+    case grain_merge:
+    case linear_dodge:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
 template <typename buffer_type>
 struct setup_agg_bg_visitor
 {
@@ -156,7 +227,7 @@ struct setup_agg_bg_visitor
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::setup(Map const &m, buffer_type & pixmap)
 {
-    buffers_.emplace(pixmap);
+    push_buffer(pixmap);
 
     mapnik::set_premultiplied_alpha(pixmap, true);
     boost::optional<color> const& bg = m.background();
@@ -193,6 +264,54 @@ void agg_renderer<T0,T1>::setup(Map const &m, buffer_type & pixmap)
 template <typename T0, typename T1>
 agg_renderer<T0,T1>::~agg_renderer() {}
 
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::push_buffer(buffer_type & buffer)
+{
+    if (!painted_extents_.empty())
+    {
+        painted_extents_.top().expand_to_include(ras_ptr->painted_extent());
+    }
+    ras_ptr->reset_painted_extent();
+    buffers_.emplace(buffer);
+    painted_extents_.emplace();
+}
+
+template <typename T0, typename T1>
+box2d<int> agg_renderer<T0,T1>::pop_buffer()
+{
+    box2d<int> extent = painted_extents_.top();
+    extent.expand_to_include(ras_ptr->painted_extent());
+    ras_ptr->reset_painted_extent();
+    buffer_type & buffer = buffers_.top().get();
+    extent.clip(box2d<int>(0, 0, static_cast<int>(buffer.width()), static_cast<int>(buffer.height())));
+    buffers_.pop();
+    painted_extents_.pop();
+    if (!buffers_.empty() && &buffers_.top().get() == &buffer)
+    {
+        // drawn straight into the parent
+        painted_extents_.top().expand_to_include(extent);
+    }
+    return extent;
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_painted(box2d<int> extent)
+{
+    buffer_type const& buffer = buffers_.top().get();
+    extent.clip(box2d<int>(0, 0, static_cast<int>(buffer.width()), static_cast<int>(buffer.height())));
+    if (extent.valid() && extent.width() > 0 && extent.height() > 0)
+    {
+        painted_extents_.top().expand_to_include(extent);
+    }
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::mark_painted()
+{
+    buffer_type const& buffer = buffers_.top().get();
+    mark_painted(box2d<int>(0, 0, static_cast<int>(buffer.width()), static_cast<int>(buffer.height())));
+}
+
 template <typename T0, typename T1>
 void agg_renderer<T0,T1>::start_map_processing(Map const& map)
 {
@@ -228,12 +347,12 @@ void agg_renderer<T0,T1>::start_layer_processing(layer const& lay, box2d<double>
 
     if (lay.comp_op() || lay.get_opacity() < 1.0)
     {
-        buffers_.emplace(internal_buffers_.push());
+        push_buffer(internal_buffers_.push());
         set_premultiplied_alpha(buffers_.top().get(), true);
     }
     else
     {
-        buffers_.emplace(buffers_.top().get());
+        push_buffer(buffers_.top().get());
     }
 }
 
@@ -243,16 +362,58 @@ void agg_renderer<T0,T1>::end_layer_processing(layer const& lyr)
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End layer processing";
 
     buffer_type & current_buffer = buffers_.top().get();
-    buffers_.pop();
+    box2d<int> extent = pop_buffer();
     buffer_type & previous_buffer = buffers_.top().get();
 
     if (&current_buffer != &previous_buffer)
     {
         composite_mode_e comp_op = lyr.comp_op() ? *lyr.comp_op() : src_over;
-        composite(previous_buffer, current_buffer,
+        if (!transparent_src_is_noop(comp_op))
+        {
+            composite(previous_buffer, current_buffer,
+                      comp_op, lyr.get_opacity(), 0, 0);
+            mark_painted();
+        }
+        else if (extent.valid() && extent.width() > 0 && extent.height() > 0)
+        {
+            // nothing to do outside of what the layer has drawn
+            composite(previous_buffer, current_buffer, extent,
+                      comp_op, lyr.get_opacity(), 0, 0);
+            mark_painted(extent);
+        }
+        internal_buffers_.pop(extent);
+    }
+}
+
+template <typename T0, typename T1>
+void agg_renderer<T0,T1>::composite_layer(layer const& lyr, agg_renderer & detached)
+{
+    MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: Composite detached layer=" << lyr.name();
+
+    if (lyr.clear_label_cache())
+    {
+        common_.detector_->clear();
+    }
+
+    // the detached renderer is left inside of the layer, see start_layer_processing()
+    buffer_type & layer_buffer = detached.buffers_.top().get();
+    box2d<int> extent = detached.pop_buffer();
+    composite_mode_e comp_op = lyr.comp_op() ? *lyr.comp_op() : src_over;
+    // the target may be the buffer of a parent layer, which only
+    // composites what has been marked as painted
+    if (!transparent_src_is_noop(comp_op))
+    {
+        composite(buffers_.top().get(), layer_buffer,
                   comp_op, lyr.get_opacity(), 0, 0);
-        internal_buffers_.pop();
+        mark_painted();
     }
+    else if (extent.valid() && extent.width() > 0 && extent.height() > 0)
+    {
+        composite(buffers_.top().get(), layer_buffer, extent,
+                  comp_op, lyr.get_opacity(), 0, 0);
+        mark_painted(extent);
+    }
+    detached.internal_buffers_.pop(extent);
 }
 
 template <typename T0, typename T1>
@@ -283,17 +444,21 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
                 (inflated_buffer_->width() < target_width ||
                  inflated_buffer_->height() < target_height))
             {
-                inflated_buffer_ = std::make_unique<buffer_type>(target_width, target_height);
+                inflated_buffer_ = image_pool<buffer_type>::instance().acquire(target_width, target_height);
             }
             else
             {
-                mapnik::fill(*inflated_buffer_, 0); // fill with transparent colour
+                // only clear what the previous style has drawn
+                clear_extent(*inflated_buffer_, inflated_buffer_.get_deleter().dirty());
+                inflated_buffer_.get_deleter().set_dirty(
+                    box2d<int>(0, 0, static_cast<int>(inflated_buffer_->width()),
+                               static_cast<int>(inflated_buffer_->height())));
             }
-            buffers_.emplace(*inflated_buffer_);
+            push_buffer(*inflated_buffer_);
         }
         else
         {
-            buffers_.emplace(internal_buffers_.push());
+            push_buffer(internal_buffers_.push());
             common_.t_.set_offset(0);
             ras_ptr->clip_box(0,0,common_.width_,common_.height_);
         }
@@ -303,7 +468,7 @@ void agg_renderer<T0,T1>::start_style_processing(feature_type_style const& st)
     {
         common_.t_.set_offset(0);
         ras_ptr->clip_box(0,0,common_.width_,common_.height_);
-        buffers_.emplace(buffers_.top().get());
+        push_buffer(buffers_.top().get());
     }
 }
 
@@ -311,7 +476,7 @@ template <typename T0, typename T1>
 void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
 {
     buffer_type & current_buffer = buffers_.top().get();
-    buffers_.pop();
+    box2d<int> extent = pop_buffer();
     buffer_type & previous_buffer = buffers_.top().get();
     if (&current_buffer != &previous_buffer)
     {
@@ -319,42 +484,54 @@ void agg_renderer<T0,T1>::end_style_processing(feature_type_style const& st)
         if (st.image_filters().size() > 0)
         {
             blend_from = true;
-            mapnik::filter::filter_visitor<buffer_type> visitor(current_buffer, common_.scale_factor_);
-            for (mapnik::filter::filter_type const& filter_tag : st.image_filters())
-            {
-                util::apply_visitor(visitor, filter_tag);
-            }
+            mapnik::filter::apply_filters(current_buffer, st.image_filters(),
+                                          common_.scale_factor_, filter_concurrency_);
             mapnik::premultiply_alpha(current_buffer);
+            // filters may spread or fill beyond the drawn pixels
+            extent = box2d<int>(0, 0, static_cast<int>(current_buffer.width()),
+                                static_cast<int>(current_buffer.height()));
         }
-        if (st.comp_op())
+        composite_mode_e comp_op = st.comp_op() ? *st.comp_op() : src_over;
+        if (st.comp_op() || blend_from || st.get_opacity() < 1.0)
         {
-            composite(previous_buffer, current_buffer,
-                      *st.comp_op(), st.get_opacity(),
-                      -common_.t_.offset(),
-                      -common_.t_.offset());
+            int offset = common_.t_.offset();
+            if (!transparent_src_is_noop(comp_op))
+            {
+                composite(previous_buffer, current_buffer,
+                          comp_op, st.get_opacity(),
+                          -offset, -offset);
+                mark_painted();
+            }
+            else if (extent.valid() && extent.width() > 0 && extent.height() > 0)
+            {
+                // nothing to do outside of what the style has drawn
+                composite(previous_buffer, current_buffer, extent,
+                          comp_op, st.get_opacity(),
+                          -offset, -offset);
+                box2d<int> target(extent);
+                target.move(-offset, -offset);
+                target.clip(box2d<int>(0, 0, static_cast<int>(previous_buffer.width()),
+                                       static_cast<int>(previous_buffer.height())));
+                mark_painted(target);
+            }
         }
-        else if (blend_from || st.get_opacity() < 1.0)
+        if (&current_buffer == &internal_buffers_.top())
         {
-            composite(previous_buffer, current_buffer,
-                      src_over, st.get_opacity(),
-                      -common_.t_.offset(),
-                      -common_.t_.offset());
+            internal_buffers_.pop(extent);
         }
-        if (&current_buffer == &internal_buffers_.top())
+        else if (inflated_buffer_ && &current_buffer == inflated_buffer_.get())
         {
-            internal_buffers_.pop();
+            inflated_buffer_.get_deleter().set_dirty(extent);
         }
     }
 
     if (st.direct_image_filters().size() > 0)
     {
         // apply any 'direct' image filters
-        mapnik::filter::filter_visitor<buffer_type> visitor(previous_buffer, common_.scale_factor_);
-        for (mapnik::filter::filter_type const& filter_tag : st.direct_image_filters())
-        {
-            util::apply_visitor(visitor, filter_tag);
-        }
+        mapnik::filter::apply_filters(previous_buffer, st.direct_image_filters(),
+                                      common_.scale_factor_, filter_concurrency_);
         mapnik::premultiply_alpha(previous_buffer);
+        mark_painted();
     }
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
 }
@@ -370,7 +547,8 @@ struct agg_render_marker_visitor
                               pixel_position const& pos,
                               agg::trans_affine const& tr,
                               double opacity,
-                              composite_mode_e comp_op)
+                              composite_mode_e comp_op,
+                              box2d<int> & composited_extent)
         : common_(common),
           current_buffer_(current_buffer),
           ras_ptr_(ras_ptr),
@@ -379,7 +557,8 @@ struct agg_render_marker_visitor
           pos_(pos),
           tr_(tr),
           opacity_(opacity),
-          comp_op_(comp_op) {}
+          comp_op_(comp_op),
+          composited_extent_(composited_extent) {}
 
     void operator() (marker_null const&) const {}
 
@@ -468,10 +647,13 @@ struct agg_render_marker_visitor
         {
             double cx = 0.5 * width;
             double cy = 0.5 * height;
+            int x0 = static_cast<int>(std::floor(pos_.x - cx + .5));
+            int y0 = static_cast<int>(std::floor(pos_.y - cy + .5));
             composite(current_buffer_, marker.get_data(),
-                      comp_op_, opacity_,
-                      std::floor(pos_.x - cx + .5),
-                      std::floor(pos_.y - cy + .5));
+                      comp_op_, opacity_, x0, y0);
+            composited_extent_ = box2d<int>(x0, y0,
+                                            x0 + static_cast<int>(marker.width()),
+                                            y0 + static_cast<int>(marker.height()));
         }
         else
         {
@@ -540,7 +722,7 @@ struct agg_render_marker_visitor
     agg::trans_affine const& tr_;
     double opacity_;
     composite_mode_e comp_op_;
-
+    box2d<int> & composited_extent_;
 };
 
 template <typename T0, typename T1>
@@ -550,6 +732,7 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
                                     double opacity,
                                     composite_mode_e comp_op)
 {
+    box2d<int> composited_extent;
     agg_render_marker_visitor<buffer_type> visitor(common_,
                                                    buffers_.top().get(),
                                                    ras_ptr,
@@ -558,8 +741,10 @@ void agg_renderer<T0,T1>::render_marker(pixel_position const& pos,
                                                    pos,
                                                    tr,
                                                    opacity,
-                                                   comp_op);
+                                                   comp_op,
+                                                   composited_extent);
     util::apply_visitor(visitor, marker);
+    mark_painted(composited_extent);
 }
 
 template <typename T0, typename T1>
@@ -633,6 +818,7 @@ void agg_renderer<T0,T1>::draw_geo_extent(box2d<double> const& extent, mapnik::c
     double y0 = box.miny();
     double y1 = box.maxy();
     unsigned rgba = color.rgba();
+    mark_painted();
     for (double x=x0; x<x1; x++)
     {
         mapnik::set_pixel(buffers_.top().get(), x, y0, rgba);
@@ -223,6 +223,7 @@ void agg_renderer<T0,T1>::process(debug_symbolizer const& sym,
         gamma_method_ = GAMMA_POWER;
         gamma_ = 1.0;
     }
+    mark_painted();
 
     if (mode == DEBUG_SYM_MODE_RINGS)
     {
@@ -232,15 +233,12 @@ void agg_renderer<T0,T1>::process(debug_symbolizer const& sym,
     }
     else if (mode == DEBUG_SYM_MODE_COLLISION)
     {
-        std::vector<std::string> keys = parse_collision_detector_keys(
+        collision_cache_ids keys = parse_collision_detector_keys(
             get_optional<std::string>(sym, mapnik::keys::collision_cache, feature, common_.vars_));
 
         if (keys.empty())
         {
-            for (auto const & key : common_.detector_->keys())
-            {
-                keys.emplace_back(key);
-            }
+            keys = common_.detector_->keys();
         }
 
         for (auto const & key : keys)
@@ -136,6 +136,11 @@ struct thunk_renderer<image_rgba8> : render_thunk_list_dispatch
         }
     }
 
+    box2d<int> const& text_extent() const
+    {
+        return tex_.painted_extent();
+    }
+
 private:
     renderer_type &ren_;
     std::unique_ptr<rasterizer> const& ras_ptr_;
@@ -155,6 +160,7 @@ void agg_renderer<T0,T1>::process(group_symbolizer const& sym,
     render_group_symbolizer(
         sym, feature, common_.vars_, prj_trans, clipping_extent(common_), common_,
         ren);
+    mark_painted(ren.text_extent());
 }
 
 template void agg_renderer<image_rgba8>::process(group_symbolizer const&,
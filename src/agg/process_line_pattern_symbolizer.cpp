@@ -144,6 +144,8 @@ void  agg_renderer<T0,T1>::process(line_pattern_symbolizer const& sym,
     using vertex_processor_type = geometry::vertex_processor<apply_vertex_converter_type>;
     apply_vertex_converter_type apply(converter, ras);
     mapnik::util::apply_visitor(vertex_processor_type(apply), feature.get_geometry());
+    // outline rasterizer doesn't report its extent
+    mark_painted();
 }
 
 template void agg_renderer<image_rgba8>::process(line_pattern_symbolizer const&,
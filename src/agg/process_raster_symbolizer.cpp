@@ -57,7 +57,11 @@ void agg_renderer<T0,T1>::process(raster_symbolizer const& sym,
             int start_x, int start_y) {
             composite(buffers_.top().get(), target,
                       comp_op, opacity, start_x, start_y);
-        }
+            mark_painted(box2d<int>(start_x, start_y,
+                                    start_x + static_cast<int>(target.width()),
+                                    start_y + static_cast<int>(target.height())));
+        },
+        raster_concurrency_
     );
 }
 
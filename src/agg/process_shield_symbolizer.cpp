@@ -75,6 +75,7 @@ void  agg_renderer<T0,T1>::process(shield_symbolizer const& sym,
             ren.render(*glyphs);
         }
     }
+    mark_painted(ren.painted_extent());
 }
 
 
@@ -73,6 +73,7 @@ void agg_renderer<T0,T1>::process(text_symbolizer const& sym,
             ren.render(*glyphs);
         }
     }
+    mark_painted(ren.painted_extent());
 }
 
 template void agg_renderer<image_rgba8>::process(text_symbolizer const&,
@@ -173,6 +173,7 @@ source = Split(
     expression.cpp
     transform_expression.cpp
     feature_kv_iterator.cpp
+    feature_cache.cpp
     feature_style_processor.cpp
     feature_type_style.cpp
     dasharray_parser.cpp
@@ -188,6 +189,7 @@ source = Split(
     image_view_any.cpp
     image_any.cpp
     image_options.cpp
+    image_pool.cpp
     image_util.cpp
     image_util_jpeg.cpp
     image_util_png.cpp
@@ -235,6 +237,8 @@ source = Split(
     text/glyph_positions.cpp
     text/properties_util.cpp
     text/renderer.cpp
+    text/glyph_cache.cpp
+    text/shaping_cache.cpp
     text/text_properties.cpp
     text/font_feature_settings.cpp
     text/formatting/base.cpp
@@ -105,15 +105,12 @@ void cairo_renderer<T>::process(debug_symbolizer const& sym,
 
     if (mode == DEBUG_SYM_MODE_COLLISION)
     {
-        std::vector<std::string> keys = parse_collision_detector_keys(
+        collision_cache_ids keys = parse_collision_detector_keys(
             get_optional<std::string>(sym, mapnik::keys::collision_cache, feature, common_.vars_));
 
         if (keys.empty())
         {
-            for (auto const & key : common_.detector_->keys())
-            {
-                keys.emplace_back(key);
-            }
+            keys = common_.detector_->keys();
         }
 
         for (auto const & key : keys)
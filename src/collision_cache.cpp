@@ -26,43 +26,184 @@
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
 #include <boost/spirit/include/qi.hpp>
-#include <boost/spirit/include/phoenix.hpp>
 #pragma GCC diagnostic pop
 
+// stl
+#include <deque>
+#include <unordered_map>
+#ifdef MAPNIK_THREADSAFE
+#include <mutex>
+#endif
+
 namespace mapnik
 {
 
-std::vector<std::string> parse_collision_detector_keys(
-    boost::optional<std::string> const & keys)
+static const char * collision_index_strings[] = {
+    "quad-tree",
+    "grid",
+    ""
+};
+
+IMPLEMENT_ENUM( collision_index_e, collision_index_strings )
+
+namespace {
+
+// Process wide, names are never removed so that ids handed out stay
+// valid. Lists are split before locking, symbolizers keep the ids of
+// their lists, see collision_cache_list.
+class collision_cache_registry
 {
-    if (!keys)
+public:
+    collision_cache_registry()
+    {
+        intern("default");
+    }
+
+    collision_cache_id intern(std::string const& name)
     {
-        return std::vector<std::string>();
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return intern_impl(name);
     }
 
-    std::vector<std::string> parsed_keys;
-    boost::spirit::ascii::space_type space;
-    std::string::const_iterator iter = keys->begin();
-    std::string::const_iterator end = keys->end();
-
-    using namespace boost::spirit::qi;
-    using namespace boost::phoenix;
-    char_type char_;
-    as_string_type as_string;
-    _1_type _1;
-    _val_type _val;
-
-    if (!phrase_parse(iter, end,
-        as_string[+(char_ - ',')][push_back(_val, _1)] % ',',
-        space, parsed_keys))
+    boost::optional<collision_cache_id> find(std::string const& name)
     {
-        MAPNIK_LOG_ERROR(parse_collision_detector_keys) <<
-            "Something went wrong during parsing collision cache list: '" <<
-            *keys << "'. Using the whole string as the key.";
-        parsed_keys.emplace_back(*keys);
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto it = ids_.find(name);
+        if (it == ids_.end())
+        {
+            return boost::optional<collision_cache_id>();
+        }
+        return it->second;
+    }
+
+    std::string const& name(collision_cache_id id)
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        static const std::string unknown;
+        return id < names_.size() ? names_[id] : unknown;
+    }
+
+    std::size_t count()
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        return names_.size();
+    }
+
+    collision_cache_ids parse(std::string const& keys)
+    {
+        std::vector<std::string> names = split(keys);
+        collision_cache_ids ids;
+        ids.reserve(names.size());
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        for (auto const& name : names)
+        {
+            ids.push_back(intern_impl(name));
+        }
+        return ids;
+    }
+
+private:
+    collision_cache_id intern_impl(std::string const& name)
+    {
+        auto it = ids_.find(name);
+        if (it != ids_.end())
+        {
+            return it->second;
+        }
+        collision_cache_id id = static_cast<collision_cache_id>(names_.size());
+        names_.push_back(name);
+        ids_.emplace(name, id);
+        return id;
+    }
+
+public:
+    static std::vector<std::string> split(std::string const& keys)
+    {
+        std::vector<std::string> parsed_keys;
+        boost::spirit::ascii::space_type space;
+        std::string::const_iterator iter = keys.begin();
+        std::string::const_iterator end = keys.end();
+
+        using namespace boost::spirit::qi;
+        char_type char_;
+        as_string_type as_string;
+
+        if (!phrase_parse(iter, end,
+            as_string[+(char_ - ',')] % ',',
+            space, parsed_keys))
+        {
+            MAPNIK_LOG_ERROR(parse_collision_detector_keys) <<
+                "Something went wrong during parsing collision cache list: '" <<
+                keys << "'. Using the whole string as the key.";
+            parsed_keys.emplace_back(keys);
+        }
+
+        return parsed_keys;
     }
 
-    return parsed_keys;
+private:
+#ifdef MAPNIK_THREADSAFE
+    std::mutex mutex_;
+#endif
+    std::deque<std::string> names_;
+    std::unordered_map<std::string, collision_cache_id> ids_;
+};
+
+collision_cache_registry & registry()
+{
+    static collision_cache_registry instance;
+    return instance;
+}
+
+}
+
+collision_cache_id collision_cache_intern(std::string const& name)
+{
+    return registry().intern(name);
 }
 
+boost::optional<collision_cache_id> collision_cache_find(std::string const& name)
+{
+    return registry().find(name);
+}
+
+std::string const& collision_cache_name(collision_cache_id id)
+{
+    return registry().name(id);
+}
+
+std::size_t collision_cache_count()
+{
+    return registry().count();
+}
+
+std::vector<std::string> split_collision_detector_keys(std::string const& keys)
+{
+    return collision_cache_registry::split(keys);
+}
+
+collision_cache_ids parse_collision_detector_keys(
+    boost::optional<std::string> const & keys)
+{
+    if (!keys)
+    {
+        return collision_cache_ids();
+    }
+    return registry().parse(*keys);
+}
+
+collision_cache_list::collision_cache_list(std::string const& keys)
+    : keys_(keys),
+      ids_(registry().parse(keys)) {}
+
 }
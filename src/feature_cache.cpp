@@ -0,0 +1,778 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/debug.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/file_io.hpp>
+#include <mapnik/util/fs.hpp>
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+#include <mapnik/mapped_memory_cache.hpp>
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#pragma GCC diagnostic pop
+#endif
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/filesystem/path.hpp>
+#pragma GCC diagnostic pop
+
+// stl
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace mapnik
+{
+
+namespace {
+
+constexpr char format_version = 1;
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+constexpr std::size_t header_size = 112;
+constexpr std::size_t feature_record_size = 56;
+constexpr std::size_t cell_size = 16;
+
+enum geometry_tag : std::uint32_t
+{
+    empty_tag = 0,
+    point_tag,
+    line_string_tag,
+    polygon_tag,
+    multi_point_tag,
+    multi_line_string_tag,
+    multi_polygon_tag,
+    collection_tag
+};
+
+enum cell_type : std::uint32_t
+{
+    absent_cell = 0,
+    null_cell,
+    bool_cell,
+    integer_cell,
+    double_cell,
+    string_cell
+};
+
+struct source_key
+{
+    std::string path;
+    std::uint64_t size = 0;
+    // nanoseconds, see util::file_stat
+    std::int64_t mtime = 0;
+};
+
+bool make_source_key(std::string const& source, source_key & key)
+{
+    key.path = boost::filesystem::absolute(source).string();
+    return util::file_stat(key.path, key.size, key.mtime);
+}
+
+template <typename T>
+inline T read(char const* data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+inline std::size_t padding(std::size_t pos)
+{
+    return (8 - pos % 8) % 8;
+}
+
+class output
+{
+public:
+    explicit output(std::ofstream & out)
+        : out_(out), pos_(0) {}
+
+    void write(void const* data, std::size_t size)
+    {
+        out_.write(static_cast<char const*>(data), size);
+        pos_ += size;
+    }
+
+    template <typename T>
+    void write(T value)
+    {
+        write(&value, sizeof(T));
+    }
+
+    void align()
+    {
+        static char const zeros[8] = {};
+        write(zeros, padding(pos_));
+    }
+
+    std::size_t pos() const { return pos_; }
+
+private:
+    std::ofstream & out_;
+    std::size_t pos_;
+};
+
+struct structure_writer
+{
+    std::vector<std::uint32_t> & structure;
+    std::vector<double> & coordinates;
+
+    void add(geometry::point<double> const& pt)
+    {
+        coordinates.push_back(pt.x);
+        coordinates.push_back(pt.y);
+    }
+
+    template <typename Points>
+    void points(Points const& pts)
+    {
+        structure.push_back(static_cast<std::uint32_t>(pts.size()));
+        for (auto const& pt : pts) add(pt);
+    }
+
+    void rings(geometry::polygon<double> const& poly)
+    {
+        structure.push_back(static_cast<std::uint32_t>(poly.num_rings()));
+        points(poly.exterior_ring);
+        for (auto const& ring : poly.interior_rings) points(ring);
+    }
+
+    void operator() (geometry::geometry_empty const&)
+    {
+        structure.push_back(empty_tag);
+    }
+
+    void operator() (geometry::point<double> const& pt)
+    {
+        structure.push_back(point_tag);
+        add(pt);
+    }
+
+    void operator() (geometry::line_string<double> const& line)
+    {
+        structure.push_back(line_string_tag);
+        points(line);
+    }
+
+    void operator() (geometry::polygon<double> const& poly)
+    {
+        structure.push_back(polygon_tag);
+        rings(poly);
+    }
+
+    void operator() (geometry::multi_point<double> const& multi_pt)
+    {
+        structure.push_back(multi_point_tag);
+        points(multi_pt);
+    }
+
+    void operator() (geometry::multi_line_string<double> const& multi_line)
+    {
+        structure.push_back(multi_line_string_tag);
+        structure.push_back(static_cast<std::uint32_t>(multi_line.size()));
+        for (auto const& line : multi_line) points(line);
+    }
+
+    void operator() (geometry::multi_polygon<double> const& multi_poly)
+    {
+        structure.push_back(multi_polygon_tag);
+        structure.push_back(static_cast<std::uint32_t>(multi_poly.size()));
+        for (auto const& poly : multi_poly) rings(poly);
+    }
+
+    void operator() (geometry::geometry_collection<double> const& collection)
+    {
+        structure.push_back(collection_tag);
+        structure.push_back(static_cast<std::uint32_t>(collection.size()));
+        for (auto const& geom : collection) util::apply_visitor(*this, geom);
+    }
+};
+
+// reads back what structure_writer wrote, stopping at the first count
+// that runs past the end of the cache
+class structure_reader
+{
+public:
+    structure_reader(std::uint32_t const* structure, std::size_t pos, std::size_t size,
+                     char const* coordinates, std::size_t coord_pos, std::size_t coord_size)
+        : structure_(structure),
+          pos_(pos),
+          size_(size),
+          coordinates_(coordinates),
+          coord_pos_(coord_pos),
+          coord_size_(coord_size),
+          valid_(true) {}
+
+    geometry::geometry<double> read_geometry()
+    {
+        switch (next())
+        {
+        case point_tag:
+        {
+            geometry::point<double> pt;
+            if (points(1)) pt = point();
+            return geometry::geometry<double>(std::move(pt));
+        }
+        case line_string_tag:
+        {
+            geometry::line_string<double> line;
+            read_points(line);
+            return geometry::geometry<double>(std::move(line));
+        }
+        case polygon_tag:
+        {
+            geometry::polygon<double> poly;
+            read_rings(poly);
+            return geometry::geometry<double>(std::move(poly));
+        }
+        case multi_point_tag:
+        {
+            geometry::multi_point<double> multi_pt;
+            read_points(multi_pt);
+            return geometry::geometry<double>(std::move(multi_pt));
+        }
+        case multi_line_string_tag:
+        {
+            geometry::multi_line_string<double> multi_line;
+            std::size_t count = next();
+            if (count <= size_ - pos_) multi_line.resize(count);
+            for (auto & line : multi_line) read_points(line);
+            return geometry::geometry<double>(std::move(multi_line));
+        }
+        case multi_polygon_tag:
+        {
+            geometry::multi_polygon<double> multi_poly;
+            std::size_t count = next();
+            if (count <= size_ - pos_) multi_poly.resize(count);
+            for (auto & poly : multi_poly) read_rings(poly);
+            return geometry::geometry<double>(std::move(multi_poly));
+        }
+        case collection_tag:
+        {
+            geometry::geometry_collection<double> collection;
+            std::size_t count = next();
+            if (count <= size_ - pos_)
+            {
+                collection.reserve(count);
+                for (std::size_t i = 0; i < count && valid_; ++i)
+                {
+                    collection.push_back(read_geometry());
+                }
+            }
+            return geometry::geometry<double>(std::move(collection));
+        }
+        default:
+            return geometry::geometry<double>(geometry::geometry_empty());
+        }
+    }
+
+private:
+    std::uint32_t next()
+    {
+        if (pos_ < size_) return structure_[pos_++];
+        valid_ = false;
+        return empty_tag;
+    }
+
+    bool points(std::size_t count)
+    {
+        if (!valid_ || count > (coord_size_ - coord_pos_) / 2)
+        {
+            valid_ = false;
+            return false;
+        }
+        return true;
+    }
+
+    geometry::point<double> point()
+    {
+        char const* data = coordinates_ + coord_pos_ * sizeof(double);
+        coord_pos_ += 2;
+        return geometry::point<double>(read<double>(data), read<double>(data + sizeof(double)));
+    }
+
+    template <typename Points>
+    void read_points(Points & pts)
+    {
+        std::size_t count = next();
+        if (!points(count)) return;
+        pts.reserve(count);
+        for (std::size_t i = 0; i < count; ++i) pts.push_back(point());
+    }
+
+    void read_rings(geometry::polygon<double> & poly)
+    {
+        std::size_t count = next();
+        if (count == 0 || count > size_ - pos_) return;
+        read_points(poly.exterior_ring);
+        poly.interior_rings.resize(count - 1);
+        for (auto & ring : poly.interior_rings) read_points(ring);
+    }
+
+    std::uint32_t const* structure_;
+    std::size_t pos_;
+    std::size_t size_;
+    char const* coordinates_;
+    std::size_t coord_pos_;
+    std::size_t coord_size_;
+    bool valid_;
+};
+
+template <typename Cell>
+struct cell_visitor
+{
+    Cell & cell;
+    std::string & strings;
+
+    void operator() (value_null) const
+    {
+        cell.type = null_cell;
+    }
+
+    void operator() (value_bool val) const
+    {
+        cell.type = bool_cell;
+        cell.payload = val ? 1 : 0;
+    }
+
+    void operator() (value_integer val) const
+    {
+        cell.type = integer_cell;
+        std::memcpy(&cell.payload, &val, sizeof(cell.payload));
+    }
+
+    void operator() (value_double val) const
+    {
+        cell.type = double_cell;
+        std::memcpy(&cell.payload, &val, sizeof(cell.payload));
+    }
+
+    void operator() (value_unicode_string const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        cell.type = string_cell;
+        cell.size = static_cast<std::uint32_t>(utf8.size());
+        cell.payload = strings.size();
+        strings += utf8;
+    }
+};
+
+class cached_attributes : public feature_attribute_source
+{
+public:
+    cached_attributes(feature_cache::ptr const& cache, std::size_t index)
+        : cache_(cache),
+          index_(index) {}
+
+    void decode(std::size_t column, value & val) const
+    {
+        cache_->decode(index_, column, val);
+    }
+
+private:
+    feature_cache::ptr cache_;
+    std::size_t index_;
+};
+
+}
+
+feature_cache_writer::feature_cache_writer()
+    : names_(),
+      columns_(),
+      features_(),
+      structure_(),
+      coordinates_(),
+      strings_(),
+      count_(0) {}
+
+std::size_t feature_cache_writer::column(std::string const& name)
+{
+    auto itr = std::find(names_.begin(), names_.end(), name);
+    if (itr != names_.end()) return static_cast<std::size_t>(itr - names_.begin());
+    names_.push_back(name);
+    // absent in the features added so far and in the one being added
+    cell absent = { absent_cell, 0, 0 };
+    columns_.emplace_back(count_ + 1, absent);
+    return names_.size() - 1;
+}
+
+void feature_cache_writer::add(feature_impl const& feature)
+{
+    std::uint64_t structure_offset = structure_.size();
+    std::uint64_t coordinate_offset = coordinates_.size() / 2;
+    structure_writer writer{structure_, coordinates_};
+    util::apply_visitor(writer, feature.get_geometry());
+
+    box2d<double> box = feature.envelope();
+    std::int64_t id = feature.id();
+    double extent[4] = { box.minx(), box.miny(), box.maxx(), box.maxy() };
+    std::size_t pos = features_.size();
+    features_.resize(pos + feature_record_size);
+    char * record = features_.data() + pos;
+    std::memcpy(record, &id, 8);
+    std::memcpy(record + 8, extent, 32);
+    std::memcpy(record + 40, &structure_offset, 8);
+    std::memcpy(record + 48, &coordinate_offset, 8);
+
+    cell absent = { absent_cell, 0, 0 };
+    for (auto & col : columns_) col.push_back(absent);
+    context_ptr ctx = feature.context();
+    for (auto const& kv : *ctx)
+    {
+        if (kv.second >= feature.size()) continue;
+        cell & target = columns_[column(kv.first)][count_];
+        util::apply_visitor(cell_visitor<cell>{target, strings_}, feature.get(kv.second));
+    }
+    ++count_;
+}
+
+bool feature_cache_writer::write(std::string const& filename, std::string const& source) const
+{
+    source_key key;
+    if (!make_source_key(source, key))
+    {
+        MAPNIK_LOG_ERROR(feature_cache) << "feature_cache: could not stat '" << source << "'";
+        return false;
+    }
+    boost::system::error_code ec;
+    std::string temp = filename + "." + boost::filesystem::unique_path("%%%%-%%%%-%%%%").string() + ".tmp";
+    {
+        std::ofstream file(temp.c_str(), std::ios::binary);
+        if (!file)
+        {
+            MAPNIK_LOG_ERROR(feature_cache) << "feature_cache: could not create '" << temp << "'";
+            return false;
+        }
+        // section sizes decide the offsets written in the header
+        std::size_t pos = header_size + key.path.size();
+        pos += padding(pos);
+        std::uint64_t names_offset = pos;
+        for (auto const& name : names_) pos += 4 + name.size();
+        pos += padding(pos);
+        std::uint64_t features_offset = pos;
+        pos += features_.size();
+        std::uint64_t structure_offset = pos;
+        pos += structure_.size() * sizeof(std::uint32_t);
+        pos += padding(pos);
+        std::uint64_t coordinates_offset = pos;
+        pos += coordinates_.size() * sizeof(double);
+        std::uint64_t cells_offset = pos;
+        pos += names_.size() * count_ * cell_size;
+        std::uint64_t strings_offset = pos;
+        pos += strings_.size();
+        std::uint64_t file_size = pos;
+
+        output out(file);
+        char header[16];
+        std::memset(header, 0, 16);
+        std::strcpy(header, "mapnik-features");
+        header[15] = format_version;
+        out.write(header, 16);
+        out.write(byte_order_mark);
+        out.write(static_cast<std::uint32_t>(names_.size()));
+        out.write(static_cast<std::uint64_t>(count_));
+        out.write(key.size);
+        out.write(key.mtime);
+        out.write(names_offset);
+        out.write(features_offset);
+        out.write(structure_offset);
+        out.write(coordinates_offset);
+        out.write(cells_offset);
+        out.write(strings_offset);
+        out.write(file_size);
+        out.write(static_cast<std::uint64_t>(key.path.size()));
+        out.write(key.path.data(), key.path.size());
+        out.align();
+        for (auto const& name : names_)
+        {
+            out.write(static_cast<std::uint32_t>(name.size()));
+            out.write(name.data(), name.size());
+        }
+        out.align();
+        out.write(features_.data(), features_.size());
+        out.write(structure_.data(), structure_.size() * sizeof(std::uint32_t));
+        out.align();
+        out.write(coordinates_.data(), coordinates_.size() * sizeof(double));
+        for (auto const& col : columns_)
+        {
+            out.write(col.data(), col.size() * cell_size);
+        }
+        out.write(strings_.data(), strings_.size());
+        file.close();
+        if (!file || out.pos() != file_size)
+        {
+            MAPNIK_LOG_ERROR(feature_cache) << "feature_cache: could not write '" << temp << "'";
+            boost::filesystem::remove(temp, ec);
+            return false;
+        }
+    }
+    boost::filesystem::rename(temp, filename, ec);
+    if (ec)
+    {
+        MAPNIK_LOG_ERROR(feature_cache) << "feature_cache: could not rename '" << temp << "' to '"
+                                        << filename << "' (" << ec.message() << ")";
+        boost::filesystem::remove(temp, ec);
+        return false;
+    }
+    return true;
+}
+
+struct feature_cache::mapping
+{
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    mapped_region_ptr region;
+#else
+    std::vector<char> buffer;
+#endif
+};
+
+feature_cache::feature_cache()
+    : mapping_(new mapping),
+      data_(nullptr),
+      size_(0),
+      names_(),
+      features_(nullptr),
+      structure_(nullptr),
+      structure_size_(0),
+      coordinates_(nullptr),
+      coordinates_size_(0),
+      cells_(nullptr),
+      strings_(nullptr),
+      strings_size_(0) {}
+
+feature_cache::~feature_cache() {}
+
+std::string feature_cache::filename(std::string const& directory, std::string const& source)
+{
+    // FNV-1a of the absolute path, so different sources with the same
+    // name get their own cache file
+    std::string path = boost::filesystem::absolute(source).string();
+    std::uint64_t hash = 14695981039346656037ULL;
+    for (char c : path)
+    {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    std::snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(hash));
+    std::string name = boost::filesystem::path(source).filename().string() + "." + hex + ".features";
+    return (boost::filesystem::path(directory) / name).string();
+}
+
+feature_cache::ptr feature_cache::open(std::string const& filename, std::string const& source)
+{
+    std::shared_ptr<feature_cache> cache(new feature_cache);
+    if (!cache->load(filename, source)) return ptr();
+    return cache;
+}
+
+bool feature_cache::load(std::string const& filename, std::string const& source)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(filename, ec)) return false;
+    source_key key;
+    if (!make_source_key(source, key)) return false;
+    std::size_t file_size = 0;
+#if defined(MAPNIK_MEMORY_MAPPED_FILE)
+    boost::optional<mapped_region_ptr> region = mapped_memory_cache::instance().find(filename, false);
+    if (!region) return false;
+    mapping_->region = *region;
+    data_ = static_cast<char const*>((*region)->get_address());
+    file_size = (*region)->get_size();
+#else
+    util::file file(filename);
+    if (!file) return false;
+    mapping_->buffer.resize(file.size());
+    if (file.size() > 0 && std::fread(mapping_->buffer.data(), file.size(), 1, file.get()) != 1) return false;
+    data_ = mapping_->buffer.data();
+    file_size = mapping_->buffer.size();
+#endif
+    if (file_size < header_size) return false;
+    if (std::strncmp(data_, "mapnik-features", 15) != 0 || data_[15] != format_version
+        || read<std::uint32_t>(data_ + 16) != byte_order_mark)
+    {
+        return false;
+    }
+    std::size_t num_names = read<std::uint32_t>(data_ + 20);
+    std::uint64_t count = read<std::uint64_t>(data_ + 24);
+    std::uint64_t offsets[7];
+    std::memcpy(offsets, data_ + 48, sizeof(offsets));
+    std::uint64_t path_size = read<std::uint64_t>(data_ + 104);
+    if (offsets[6] != file_size
+        || read<std::uint64_t>(data_ + 32) != key.size
+        || read<std::int64_t>(data_ + 40) != key.mtime
+        || path_size != key.path.size()
+        || header_size + path_size > offsets[0]
+        || key.path.compare(0, std::string::npos, data_ + header_size, path_size) != 0)
+    {
+        return false;
+    }
+    for (std::size_t i = 0; i < 6; ++i)
+    {
+        if (offsets[i] > offsets[i + 1]) return false;
+    }
+    if (count > (offsets[2] - offsets[1]) / feature_record_size
+        || offsets[2] - offsets[1] != count * feature_record_size
+        || num_names * count * cell_size != offsets[5] - offsets[4])
+    {
+        return false;
+    }
+    char const* names = data_ + offsets[0];
+    char const* names_end = data_ + offsets[1];
+    names_.reserve(num_names);
+    for (std::size_t i = 0; i < num_names; ++i)
+    {
+        if (names_end - names < 4) return false;
+        std::uint32_t length = read<std::uint32_t>(names);
+        names += 4;
+        if (static_cast<std::size_t>(names_end - names) < length) return false;
+        names_.emplace_back(names, length);
+        names += length;
+    }
+    size_ = count;
+    features_ = data_ + offsets[1];
+    structure_ = reinterpret_cast<std::uint32_t const*>(data_ + offsets[2]);
+    structure_size_ = (offsets[3] - offsets[2]) / sizeof(std::uint32_t);
+    coordinates_ = data_ + offsets[3];
+    coordinates_size_ = (offsets[4] - offsets[3]) / sizeof(double);
+    cells_ = data_ + offsets[4];
+    strings_ = data_ + offsets[5];
+    strings_size_ = offsets[6] - offsets[5];
+    return true;
+}
+
+context_ptr feature_cache::make_context() const
+{
+    context_ptr ctx = std::make_shared<context_type>();
+    for (auto const& name : names_) ctx->push(name);
+    return ctx;
+}
+
+value_integer feature_cache::id(std::size_t index) const
+{
+    return read<std::int64_t>(features_ + index * feature_record_size);
+}
+
+box2d<double> feature_cache::envelope(std::size_t index) const
+{
+    char const* record = features_ + index * feature_record_size + 8;
+    double minx = read<double>(record);
+    double miny = read<double>(record + 8);
+    double maxx = read<double>(record + 16);
+    double maxy = read<double>(record + 24);
+    // box2d's constructor would turn the stored empty box into a valid one
+    if (!(minx <= maxx && miny <= maxy)) return box2d<double>();
+    return box2d<double>(minx, miny, maxx, maxy);
+}
+
+bool feature_cache::has_attribute(std::size_t index, std::size_t column) const
+{
+    return read<std::uint32_t>(cells_ + (column * size_ + index) * cell_size) != absent_cell;
+}
+
+geometry::geometry<double> feature_cache::geometry(std::size_t index) const
+{
+    char const* record = features_ + index * feature_record_size;
+    std::uint64_t structure_offset = read<std::uint64_t>(record + 40);
+    std::uint64_t coordinate_offset = read<std::uint64_t>(record + 48);
+    if (structure_offset >= structure_size_ || coordinate_offset > coordinates_size_ / 2)
+    {
+        return geometry::geometry<double>(geometry::geometry_empty());
+    }
+    structure_reader reader(structure_, structure_offset, structure_size_,
+                            coordinates_, coordinate_offset * 2, coordinates_size_);
+    return reader.read_geometry();
+}
+
+feature_ptr feature_cache::feature(std::size_t index, context_ptr const& ctx, value_integer id) const
+{
+    feature_ptr feature(feature_factory::create(ctx, id));
+    feature->set_geometry(geometry(index));
+    feature->set_attribute_source(std::make_shared<cached_attributes>(shared_from_this(), index));
+    return feature;
+}
+
+void feature_cache::decode(std::size_t index, std::size_t column, value & val) const
+{
+    if (column >= names_.size()) return;
+    char const* cell = cells_ + (column * size_ + index) * cell_size;
+    std::uint32_t size = read<std::uint32_t>(cell + 4);
+    std::uint64_t payload = read<std::uint64_t>(cell + 8);
+    switch (read<std::uint32_t>(cell))
+    {
+    case null_cell:
+        val = value_null();
+        break;
+    case bool_cell:
+        val = value_bool(payload != 0);
+        break;
+    case integer_cell:
+        val = read<value_integer>(cell + 8);
+        break;
+    case double_cell:
+        val = read<value_double>(cell + 8);
+        break;
+    case string_cell:
+        if (payload <= strings_size_ && size <= strings_size_ - payload)
+        {
+            val = value_unicode_string::fromUTF8(
+                U_NAMESPACE_QUALIFIER StringPiece(strings_ + payload, static_cast<std::int32_t>(size)));
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+feature_cache_featureset::feature_cache_featureset(feature_cache::ptr const& cache,
+                                                   std::vector<std::size_t> && indices,
+                                                   value_integer first_id)
+    : cache_(cache),
+      ctx_(cache->make_context()),
+      indices_(std::move(indices)),
+      itr_(indices_.begin()),
+      next_id_(first_id) {}
+
+feature_ptr feature_cache_featureset::next()
+{
+    while (itr_ != indices_.end())
+    {
+        std::size_t index = *itr_++;
+        if (index < cache_->size())
+        {
+            value_integer id = next_id_ > 0 ? next_id_++ : cache_->id(index);
+            return cache_->feature(index, ctx_, id);
+        }
+    }
+    return feature_ptr();
+}
+
+}
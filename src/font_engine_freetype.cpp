@@ -331,7 +331,7 @@ face_ptr freetype_engine::create_face_impl(std::string const& family_name,
                                                 static_cast<FT_Long>(mem_font_itr->second.second), // size
                                                 itr->second.first, // face index
                                                 &face);
-            if (!error) return std::make_shared<font_face>(face);
+            if (!error) return std::make_shared<font_face>(face, itr->second.second, itr->second.first);
         }
         // we don't add to cache here because the map and its font_cache
         // must be immutable during rendering for predictable thread safety
@@ -353,7 +353,7 @@ face_ptr freetype_engine::create_face_impl(std::string const& family_name,
                                                     static_cast<FT_Long>(mem_font_itr->second.second), // size
                                                     itr->second.first, // face index
                                                     &face);
-                if (!error) return std::make_shared<font_face>(face);
+                if (!error) return std::make_shared<font_face>(face, itr->second.second, itr->second.first);
             }
             found_font_file = true;
         }
@@ -380,7 +380,7 @@ face_ptr freetype_engine::create_face_impl(std::string const& family_name,
                 global_memory_fonts.erase(result.first);
                 return face_ptr();
             }
-            return std::make_shared<font_face>(face);
+            return std::make_shared<font_face>(face, itr->second.second, itr->second.first);
         }
     }
     return face_ptr();
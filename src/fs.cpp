@@ -34,6 +34,10 @@
 // stl
 #include <stdexcept>
 
+#ifndef _WINDOWS
+#include <sys/stat.h>
+#endif
+
 namespace mapnik {
 
 namespace util {
@@ -137,6 +141,32 @@ namespace util {
         return listing;
     }
 
+    bool file_stat(std::string const& filepath, std::uint64_t & size, std::int64_t & mtime)
+    {
+#ifdef _WINDOWS
+        boost::filesystem::path path(mapnik::utf8_to_utf16(filepath));
+        boost::system::error_code ec;
+        std::uintmax_t file_size = boost::filesystem::file_size(path, ec);
+        if (ec) return false;
+        std::time_t last_write_time = boost::filesystem::last_write_time(path, ec);
+        if (ec) return false;
+        size = file_size;
+        mtime = static_cast<std::int64_t>(last_write_time) * 1000000000;
+#else
+        // boost::filesystem only reports whole seconds, which misses files
+        // rewritten within the same second
+        struct stat st;
+        if (::stat(filepath.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) return false;
+#ifdef __APPLE__
+        struct timespec const& last_write_time = st.st_mtimespec;
+#else
+        struct timespec const& last_write_time = st.st_mtim;
+#endif
+        size = static_cast<std::uint64_t>(st.st_size);
+        mtime = static_cast<std::int64_t>(last_write_time.tv_sec) * 1000000000 + last_write_time.tv_nsec;
+#endif
+        return true;
+    }
 
 } // end namespace util
 
@@ -53,10 +53,8 @@ using detector_type = renderer_common::detector_type;
 
 group_point_layout::group_point_layout(params_type const & params)
     : params_(params),
-      collision_cache_insert_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_insert>())),
-      collision_cache_detect_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_detect>()))
+      collision_cache_insert_(params.collision_cache_insert),
+      collision_cache_detect_(params.collision_cache_detect)
 {
 }
 
@@ -26,6 +26,9 @@
 #include <mapnik/image_any.hpp>
 #include <mapnik/safe_cast.hpp>
 #include <mapnik/util/const_rendering_buffer.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -44,6 +47,9 @@
 #include "agg_color_rgba.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+
 namespace mapnik
 {
 
@@ -124,11 +130,216 @@ For example, if you generate some pattern with AGG (premultiplied) and would lik
 
 */
 
-template <>
-MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_mode_e mode,
-               float opacity,
-               int dx,
-               int dy)
+#ifdef SSE_MATH
+
+namespace detail {
+
+// SSE2 versions of the agg::comp_op_rgba_* blenders for the most used
+// modes. Each kernel blends two premultiplied RGBA pixels unpacked to
+// 16-bit uints and matches agg's integer arithmetic exactly, including
+// the wrap around of out of range results.
+
+inline __m128i scale_by_cover(__m128i s, __m128i cover)
+{
+    return _mm_mul255_epu16(s, cover);
+}
+
+inline __m128i low_byte(__m128i x)
+{
+    return _mm_and_si128(x, _mm_set1_epi16(0xff));
+}
+
+// keeps the destination where the source alpha is zero
+inline __m128i unless_transparent(__m128i result, __m128i s, __m128i d)
+{
+    __m128i transparent = _mm_cmpeq_epi16(_mm_splat_alpha_epi16(s), _mm_setzero_si128());
+    return _mm_or_si128(_mm_and_si128(transparent, d), _mm_andnot_si128(transparent, result));
+}
+
+struct sse_src_over
+{
+    // Dca' = Sca + Dca.(1 - Sa)
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i s1a = _mm_sub_epi16(_mm_set1_epi16(255), _mm_splat_alpha_epi16(s));
+        return low_byte(_mm_add_epi16(s, _mm_mul255_epu16(d, s1a)));
+    }
+};
+
+struct sse_dst_over
+{
+    // Dca' = Dca + Sca.(1 - Da)
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i d1a = _mm_sub_epi16(_mm_set1_epi16(255), _mm_splat_alpha_epi16(d));
+        return low_byte(_mm_add_epi16(d, _mm_mul255_epu16(s, d1a)));
+    }
+};
+
+struct sse_dst_in
+{
+    // Dca' = Dca.Sa
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        __m128i full = _mm_set1_epi16(255);
+        __m128i sa = _mm_splat_alpha_epi16(s);
+        sa = _mm_sub_epi16(full, _mm_mul255_epu16(cover, _mm_sub_epi16(full, sa)));
+        return _mm_mul255_epu16(d, sa);
+    }
+};
+
+struct sse_dst_out
+{
+    // Dca' = Dca.(1 - Sa), with agg's rounding term of base_shift
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i s1a = _mm_sub_epi16(_mm_set1_epi16(255), _mm_splat_alpha_epi16(s));
+        return _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(d, s1a), _mm_set1_epi16(8)), 8);
+    }
+};
+
+struct sse_plus
+{
+    // Dca' = min(Sca + Dca, 1)
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i result = _mm_min_epi16(_mm_add_epi16(s, d), _mm_set1_epi16(255));
+        return unless_transparent(result, s, d);
+    }
+};
+
+struct sse_multiply
+{
+    // Dca' = Sca.Dca + Sca.(1 - Da) + Dca.(1 - Sa)
+    // Da'  = Sa + Da - Sa.Da
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i full = _mm_set1_epi16(255);
+        __m128i sa = _mm_splat_alpha_epi16(s);
+        __m128i da = _mm_splat_alpha_epi16(d);
+        // Sca.(Dca + 1 - Da) + Dca.(1 - Sa) needs 17 bits, sum in 32-bit lanes
+        __m128i x0 = _mm_unpacklo_epi16(s, d);
+        __m128i x1 = _mm_unpackhi_epi16(s, d);
+        __m128i y = _mm_add_epi16(d, _mm_sub_epi16(full, da));
+        __m128i s1a = _mm_sub_epi16(full, sa);
+        __m128i y0 = _mm_unpacklo_epi16(y, s1a);
+        __m128i y1 = _mm_unpackhi_epi16(y, s1a);
+        __m128i round = _mm_set1_epi32(255);
+        __m128i lo = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(x0, y0), round), 8);
+        __m128i hi = _mm_srli_epi32(_mm_add_epi32(_mm_madd_epi16(x1, y1), round), 8);
+        __m128i color = _mm_packs_epi32(lo, hi);
+        __m128i alpha = _mm_sub_epi16(_mm_add_epi16(sa, da), _mm_mul255_epu16(sa, da));
+        __m128i alpha_lanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+        __m128i result = _mm_or_si128(_mm_andnot_si128(alpha_lanes, color),
+                                      _mm_and_si128(alpha_lanes, alpha));
+        return unless_transparent(low_byte(result), s, d);
+    }
+};
+
+struct sse_screen
+{
+    // Dca' = Sca + Dca - Sca.Dca
+    static __m128i blend(__m128i s, __m128i d, __m128i cover)
+    {
+        s = scale_by_cover(s, cover);
+        __m128i result = low_byte(_mm_sub_epi16(_mm_add_epi16(s, d), _mm_mul255_epu16(s, d)));
+        return unless_transparent(result, s, d);
+    }
+};
+
+template <typename Kernel>
+inline __m128i blend_rgba(__m128i src, __m128i dst, __m128i cover)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = Kernel::blend(_mm_unpacklo_epi8(src, zero), _mm_unpacklo_epi8(dst, zero), cover);
+    __m128i hi = Kernel::blend(_mm_unpackhi_epi8(src, zero), _mm_unpackhi_epi8(dst, zero), cover);
+    return _mm_packus_epi16(lo, hi);
+}
+
+template <typename Kernel>
+void composite_sse(image_rgba8 & dst, image_rgba8 const& src, box2d<int> const& extent,
+                   unsigned cover, int dx, int dy)
+{
+    using pixel_type = image_rgba8::pixel_type;
+    int x0 = std::max(extent.minx() + dx, 0);
+    int y0 = std::max(extent.miny() + dy, 0);
+    int x1 = std::min(static_cast<int>(dst.width()), extent.maxx() + dx);
+    int y1 = std::min(static_cast<int>(dst.height()), extent.maxy() + dy);
+    if (x0 >= x1 || y0 >= y1) return;
+    std::size_t width = static_cast<std::size_t>(x1 - x0);
+    __m128i cover_v = _mm_set1_epi16(static_cast<short>(cover));
+    for (int y = y0; y < y1; ++y)
+    {
+        pixel_type * d = dst.get_row(static_cast<std::size_t>(y)) + x0;
+        pixel_type const* s = src.get_row(static_cast<std::size_t>(y - dy)) + (x0 - dx);
+        std::size_t x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i s4 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(s + x));
+            __m128i d4 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(d + x));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d + x), blend_rgba<Kernel>(s4, d4, cover_v));
+        }
+        if (x < width)
+        {
+            pixel_type s4[4] = { 0, 0, 0, 0 };
+            pixel_type d4[4] = { 0, 0, 0, 0 };
+            std::copy(s + x, s + width, s4);
+            std::copy(d + x, d + width, d4);
+            __m128i result = blend_rgba<Kernel>(_mm_loadu_si128(reinterpret_cast<__m128i const*>(s4)),
+                                                _mm_loadu_si128(reinterpret_cast<__m128i const*>(d4)),
+                                                cover_v);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(d4), result);
+            std::copy(d4, d4 + (width - x), d + x);
+        }
+    }
+}
+
+// Returns false for modes without a SSE kernel
+inline bool composite_sse(image_rgba8 & dst, image_rgba8 const& src, box2d<int> const& extent,
+                          composite_mode_e mode, unsigned cover, int dx, int dy)
+{
+    switch (mode)
+    {
+    case src_over:
+        composite_sse<sse_src_over>(dst, src, extent, cover, dx, dy);
+        return true;
+    case dst_over:
+        composite_sse<sse_dst_over>(dst, src, extent, cover, dx, dy);
+        return true;
+    case dst_in:
+        composite_sse<sse_dst_in>(dst, src, extent, cover, dx, dy);
+        return true;
+    case dst_out:
+        composite_sse<sse_dst_out>(dst, src, extent, cover, dx, dy);
+        return true;
+    case plus:
+        composite_sse<sse_plus>(dst, src, extent, cover, dx, dy);
+        return true;
+    case multiply:
+        composite_sse<sse_multiply>(dst, src, extent, cover, dx, dy);
+        return true;
+    case screen:
+        composite_sse<sse_screen>(dst, src, extent, cover, dx, dy);
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // end ns
+
+#endif
+
+namespace detail {
+
+// extent is within the bounds of src
+void composite_rgba8(image_rgba8 & dst, image_rgba8 const& src, box2d<int> const& extent,
+                     composite_mode_e mode, float opacity, int dx, int dy)
 {
     using color = agg::rgba8;
     using order = agg::order_rgba;
@@ -151,9 +362,45 @@ MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_
     {
         throw std::runtime_error("DESTINATION MUST BE PREMULTIPLIED FOR COMPOSITING!");
     }
+#endif
+    agg::cover_type cover = safe_cast<agg::cover_type>(255*opacity);
+#ifdef SSE_MATH
+    if (&dst != &src && composite_sse(dst, src, extent, mode, cover, dx, dy))
+    {
+        return;
+    }
 #endif
     renderer_type ren(pixf);
-    ren.blend_from(pixf_mask,0,dx,dy,safe_cast<agg::cover_type>(255*opacity));
+    // inclusive coordinates
+    agg::rect_i src_rect(extent.minx(), extent.miny(), extent.maxx() - 1, extent.maxy() - 1);
+    ren.blend_from(pixf_mask,&src_rect,dx,dy,cover);
+}
+
+} // end ns
+
+template <>
+MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, composite_mode_e mode,
+               float opacity,
+               int dx,
+               int dy)
+{
+    box2d<int> extent(0, 0, safe_cast<int>(src.width()), safe_cast<int>(src.height()));
+    detail::composite_rgba8(dst, src, extent, mode, opacity, dx, dy);
+}
+
+MAPNIK_DECL void composite(image_rgba8 & dst, image_rgba8 const& src, box2d<int> const& extent,
+                           composite_mode_e mode,
+                           float opacity,
+                           int dx,
+                           int dy)
+{
+    box2d<int> src_extent(extent);
+    src_extent.clip(box2d<int>(0, 0, safe_cast<int>(src.width()), safe_cast<int>(src.height())));
+    if (!src_extent.valid() || src_extent.width() <= 0 || src_extent.height() <= 0)
+    {
+        return;
+    }
+    detail::composite_rgba8(dst, src, src_extent, mode, opacity, dx, dy);
 }
 
 template <>
@@ -0,0 +1,158 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/image_pool.hpp>
+
+namespace mapnik
+{
+
+template <typename T>
+image_pool<T>::image_pool()
+    : capacity_(256 * 1024 * 1024),
+      size_(0),
+      images_() {}
+
+template <typename T>
+image_pool<T>::~image_pool()
+{
+    clear();
+}
+
+template <typename T>
+typename image_pool<T>::image_ptr image_pool<T>::acquire(std::size_t width, std::size_t height)
+{
+    box2d<int> extent(0, 0, static_cast<int>(width), static_cast<int>(height));
+    entry_type entry(nullptr, box2d<int>());
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        auto itr = images_.find(key_type(width, height));
+        if (itr != images_.end() && !itr->second.empty())
+        {
+            entry = itr->second.back();
+            itr->second.pop_back();
+            size_ -= entry.first->size();
+        }
+    }
+    if (entry.first == nullptr)
+    {
+        return image_ptr(new T(width, height), deleter(extent));
+    }
+    // clear what the previous user has drawn, outside of the lock
+    T & image = *entry.first;
+    clear_extent(image, entry.second);
+    image.set_premultiplied(false);
+    image.painted(false);
+    return image_ptr(entry.first, deleter(extent));
+}
+
+template <typename T>
+void image_pool<T>::release(T * image, box2d<int> const& dirty)
+{
+    if (image == nullptr) return;
+    {
+#ifdef MAPNIK_THREADSAFE
+        std::lock_guard<std::mutex> lock(mutex_);
+#endif
+        if (size_ + image->size() <= capacity_)
+        {
+            size_ += image->size();
+            images_[key_type(image->width(), image->height())].emplace_back(image, dirty);
+            return;
+        }
+    }
+    delete image;
+}
+
+template <typename T>
+void image_pool<T>::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    for (auto & item : images_)
+    {
+        for (entry_type & entry : item.second)
+        {
+            delete entry.first;
+        }
+    }
+    images_.clear();
+    size_ = 0;
+}
+
+template <typename T>
+void image_pool<T>::set_capacity(std::size_t bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    capacity_ = bytes;
+    // drop the largest images first, images_ is ordered by width
+    using iterator = typename decltype(images_)::iterator;
+    std::vector<iterator> by_area;
+    by_area.reserve(images_.size());
+    for (auto itr = images_.begin(); itr != images_.end(); ++itr)
+    {
+        by_area.push_back(itr);
+    }
+    std::sort(by_area.begin(), by_area.end(), [](iterator const& lhs, iterator const& rhs) {
+            return lhs->first.first * lhs->first.second > rhs->first.first * rhs->first.second;
+        });
+    for (auto itr = by_area.begin(); itr != by_area.end() && size_ > capacity_; ++itr)
+    {
+        std::vector<entry_type> & images = (*itr)->second;
+        while (!images.empty() && size_ > capacity_)
+        {
+            T * image = images.back().first;
+            size_ -= image->size();
+            images.pop_back();
+            delete image;
+        }
+    }
+}
+
+template <typename T>
+std::size_t image_pool<T>::capacity() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return capacity_;
+}
+
+template <typename T>
+std::size_t image_pool<T>::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    return size_;
+}
+
+template class singleton<image_pool<image_rgba8>, CreateStatic>;
+template class MAPNIK_DECL image_pool<image_rgba8>;
+
+}
@@ -491,15 +491,105 @@ template MAPNIK_DECL bool is_solid(image_view_gray64f const&);
 
 namespace detail {
 
+#ifdef SSE_MATH
+
+// Same results as agg::multiplier_rgba::premultiply:
+// c := (c * a + 255) >> 8
+inline __m128i premultiply_rgba(__m128i rgba)
+{
+    __m128i zero = _mm_setzero_si128();
+    // a * 255 rounds back to a, which keeps alpha as it is
+    __m128i keep_alpha = _mm_set_epi16(255, 0, 0, 0, 255, 0, 0, 0);
+    __m128i lo = _mm_unpacklo_epi8(rgba, zero);
+    __m128i hi = _mm_unpackhi_epi8(rgba, zero);
+    lo = _mm_mul255_epu16(lo, _mm_or_si128(_mm_splat_alpha_epi16(lo), keep_alpha));
+    hi = _mm_mul255_epu16(hi, _mm_or_si128(_mm_splat_alpha_epi16(hi), keep_alpha));
+    return _mm_packus_epi16(lo, hi);
+}
+
+// Same results as agg::multiplier_rgba::demultiply:
+// c := min(c * 255 / a, 255), c := 0 if a == 0
+// The quotient is computed in single precision, which is exact after
+// truncation for 8-bit operands.
+inline __m128i demultiply_pixel(__m128i pixel)
+{
+    __m128 value = _mm_cvtepi32_ps(pixel);
+    __m128 alpha_lane = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+    __m128 divisor = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3,3,3,3));
+    // alpha is divided by 255 to keep it as it is
+    divisor = _mm_or_ps(_mm_andnot_ps(alpha_lane, divisor),
+                        _mm_and_ps(alpha_lane, _mm_set1_ps(255.0f)));
+    __m128 quotient = _mm_div_ps(_mm_mul_ps(value, _mm_set1_ps(255.0f)), divisor);
+    quotient = _mm_andnot_ps(_mm_cmpeq_ps(divisor, _mm_setzero_ps()), quotient);
+    return _mm_cvttps_epi32(quotient);
+}
+
+inline __m128i demultiply_rgba(__m128i rgba)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_unpacklo_epi8(rgba, zero);
+    __m128i hi = _mm_unpackhi_epi8(rgba, zero);
+    __m128i p0 = demultiply_pixel(_mm_unpacklo_epi16(lo, zero));
+    __m128i p1 = demultiply_pixel(_mm_unpackhi_epi16(lo, zero));
+    __m128i p2 = demultiply_pixel(_mm_unpacklo_epi16(hi, zero));
+    __m128i p3 = demultiply_pixel(_mm_unpackhi_epi16(hi, zero));
+    // saturating packs clamp the colors to 255
+    return _mm_packus_epi16(_mm_packs_epi32(p0, p1), _mm_packs_epi32(p2, p3));
+}
+
+template <typename Kernel>
+void transform_rgba_sse(image_rgba8 & data, Kernel kernel)
+{
+    std::size_t width = data.width();
+    for (std::size_t y = 0; y < data.height(); ++y)
+    {
+        image_rgba8::pixel_type * row = data.get_row(y);
+        std::size_t x = 0;
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i rgba = _mm_loadu_si128(reinterpret_cast<__m128i*>(row + x));
+            if (!_mm_opaque_rgba(rgba))
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(row + x), kernel(rgba));
+            }
+        }
+        if (x < width)
+        {
+            // opaque padding for the last pixels of the row
+            image_rgba8::pixel_type tail[4] = { 0xff000000, 0xff000000, 0xff000000, 0xff000000 };
+            std::copy(row + x, row + width, tail);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(tail),
+                             kernel(_mm_loadu_si128(reinterpret_cast<__m128i*>(tail))));
+            std::copy(tail, tail + (width - x), row + x);
+        }
+    }
+}
+
+inline void premultiply_sse(image_rgba8 & data)
+{
+    transform_rgba_sse(data, premultiply_rgba);
+}
+
+inline void demultiply_sse(image_rgba8 & data)
+{
+    transform_rgba_sse(data, demultiply_rgba);
+}
+
+#endif
+
 struct premultiply_visitor
 {
     bool operator() (image_rgba8 & data) const
     {
         if (!data.get_premultiplied())
         {
+#ifdef SSE_MATH
+            premultiply_sse(data);
+#else
             agg::rendering_buffer buffer(data.bytes(),safe_cast<unsigned>(data.width()),safe_cast<unsigned>(data.height()),safe_cast<int>(data.row_size()));
             agg::pixfmt_rgba32 pixf(buffer);
             pixf.premultiply();
+#endif
             data.set_premultiplied(true);
             return true;
         }
@@ -519,9 +609,13 @@ struct demultiply_visitor
     {
         if (data.get_premultiplied())
         {
+#ifdef SSE_MATH
+            demultiply_sse(data);
+#else
             agg::rendering_buffer buffer(data.bytes(),safe_cast<unsigned>(data.width()),safe_cast<unsigned>(data.height()),safe_cast<int>(data.row_size()));
             agg::pixfmt_rgba32_pre pixf(buffer);
             pixf.demultiply();
+#endif
             data.set_premultiplied(false);
             return true;
         }
@@ -0,0 +1,197 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/json/structural_index.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
+// stl
+#include <algorithm>
+#include <cstring>
+
+namespace mapnik { namespace json {
+
+namespace {
+
+constexpr std::size_t block_size = 64;
+constexpr std::size_t window_size = 1024 * block_size;
+
+struct block_masks
+{
+    std::uint64_t quote = 0;
+    std::uint64_t backslash = 0;
+    std::uint64_t op = 0;
+    std::uint64_t space = 0;
+};
+
+#ifdef SSE_MATH
+
+inline std::uint64_t to_mask(__m128i v, unsigned shift)
+{
+    return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(v))) << shift;
+}
+
+void classify(char const* in, block_masks & m)
+{
+    __m128i const quote = _mm_set1_epi8('"');
+    __m128i const backslash = _mm_set1_epi8('\\');
+    __m128i const case_bit = _mm_set1_epi8(0x20);
+    __m128i const open = _mm_set1_epi8('{');   // '[' | 0x20
+    __m128i const close = _mm_set1_epi8('}');  // ']' | 0x20
+    __m128i const colon = _mm_set1_epi8(':');
+    __m128i const comma = _mm_set1_epi8(',');
+    __m128i const space = _mm_set1_epi8(' ');
+    __m128i const tab = _mm_set1_epi8('\t');
+    __m128i const lf = _mm_set1_epi8('\n');
+    __m128i const cr = _mm_set1_epi8('\r');
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + 16 * i));
+        __m128i folded = _mm_or_si128(v, case_bit);
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, open), _mm_cmpeq_epi8(folded, close)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+        m.quote |= to_mask(_mm_cmpeq_epi8(v, quote), 16 * i);
+        m.backslash |= to_mask(_mm_cmpeq_epi8(v, backslash), 16 * i);
+        m.op |= to_mask(op, 16 * i);
+        m.space |= to_mask(ws, 16 * i);
+    }
+}
+
+#else
+
+void classify(char const* in, block_masks & m)
+{
+    for (unsigned i = 0; i < block_size; ++i)
+    {
+        std::uint64_t bit = std::uint64_t(1) << i;
+        switch (in[i])
+        {
+        case '"': m.quote |= bit; break;
+        case '\\': m.backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',': m.op |= bit; break;
+        case ' ': case '\t': case '\n': case '\r': m.space |= bit; break;
+        default: break;
+        }
+    }
+}
+
+#endif
+
+inline unsigned trailing_zeros(std::uint64_t mask)
+{
+#if defined(__GNUC__)
+    return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+    unsigned count = 0;
+    while ((mask & 1) == 0)
+    {
+        mask >>= 1;
+        ++count;
+    }
+    return count;
+#endif
+}
+
+// bit i of the result is the xor of bits 0..i of the input
+inline std::uint64_t prefix_xor(std::uint64_t mask)
+{
+    mask ^= mask << 1;
+    mask ^= mask << 2;
+    mask ^= mask << 4;
+    mask ^= mask << 8;
+    mask ^= mask << 16;
+    mask ^= mask << 32;
+    return mask;
+}
+
+// characters preceded by an odd number of backslashes; `carry` is 1 when
+// the previous block ended on an unfinished escape
+inline std::uint64_t find_escaped(std::uint64_t backslash, std::uint64_t & carry)
+{
+    std::uint64_t const even_bits = 0x5555555555555555ULL;
+    backslash &= ~carry;
+    std::uint64_t follows_escape = (backslash << 1) | carry;
+    std::uint64_t odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    std::uint64_t sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    carry = sequences_starting_on_even_bits < odd_sequence_starts ? 1 : 0;
+    std::uint64_t invert_mask = sequences_starting_on_even_bits << 1;
+    return (even_bits ^ invert_mask) & follows_escape;
+}
+
+}
+
+structural_index::structural_index(char const* start, char const* end)
+    : block_(start),
+      end_(end),
+      positions_(),
+      pos_(0),
+      in_string_(0),
+      prev_escaped_(0),
+      prev_scalar_(0) {}
+
+bool structural_index::fill()
+{
+    positions_.clear();
+    pos_ = 0;
+    while (positions_.empty() && block_ != end_)
+    {
+        char const* window_end = block_ + std::min(window_size, static_cast<std::size_t>(end_ - block_));
+        for (; block_ != window_end; )
+        {
+            std::size_t size = std::min(block_size, static_cast<std::size_t>(window_end - block_));
+            char const* in = block_;
+            char buffer[block_size];
+            if (size < block_size)
+            {
+                // pad the tail with whitespace, which never starts a token
+                std::memset(buffer, ' ', block_size);
+                std::memcpy(buffer, block_, size);
+                in = buffer;
+            }
+            block_masks m;
+            classify(in, m);
+            std::uint64_t escaped = find_escaped(m.backslash, prev_escaped_);
+            std::uint64_t quote = m.quote & ~escaped;
+            // opening quote and string contents, excluding the closing quote
+            std::uint64_t in_string = prefix_xor(quote) ^ in_string_;
+            in_string_ = 0 - (in_string >> 63);
+            std::uint64_t string_tail = in_string ^ quote;
+            std::uint64_t scalar = ~(m.op | m.space);
+            std::uint64_t nonquote_scalar = scalar & ~quote;
+            std::uint64_t follows_scalar = (nonquote_scalar << 1) | prev_scalar_;
+            prev_scalar_ = nonquote_scalar >> 63;
+            std::uint64_t structurals = (m.op | (scalar & ~follows_scalar)) & ~string_tail;
+            while (structurals != 0)
+            {
+                positions_.push_back(block_ + trailing_zeros(structurals));
+                structurals &= structurals - 1;
+            }
+            block_ += size;
+        }
+    }
+    return !positions_.empty();
+}
+
+}}
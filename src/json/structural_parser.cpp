@@ -0,0 +1,742 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/json/structural_parser.hpp>
+#include <mapnik/json/structural_index.hpp>
+#include <mapnik/json/generic_json.hpp>
+#include <mapnik/json/attribute_value_visitor.hpp>
+#include <mapnik/json/geometry_util.hpp>
+#include <mapnik/json/positions.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/box2d.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/spirit/include/qi.hpp>
+#pragma GCC diagnostic pop
+
+// stl
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace mapnik { namespace json {
+
+namespace {
+
+namespace qi = boost::spirit::qi;
+
+// numbers are read with the parsers of generic_json and positions_grammar
+qi::real_parser<double, qi::strict_real_policies<double>> const strict_double;
+qi::int_parser<mapnik::value_integer, 10, 1, -1> const integer;
+qi::double_type const double_;
+
+template <std::size_t N>
+inline bool equals(char const* first, char const* last, char const (&str)[N])
+{
+    return static_cast<std::size_t>(last - first) == N - 1 && std::memcmp(first, str, N - 1) == 0;
+}
+
+inline bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+inline int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Reads a plain decimal number when the result only needs one rounding:
+// at most 15 digits and a power of ten up to 10^22, both exact doubles.
+// Spirit's real parsers return the same value for these; anything else is
+// left to them.
+bool exact_double(char const* first, char const* last, double & val)
+{
+    static double const powers_of_ten[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative = first != last && *first == '-';
+    if (negative) ++first;
+    std::uint64_t digits = 0;
+    int count = 0;
+    int scale = 0;
+    char const* start = first;
+    for (; first != last && *first >= '0' && *first <= '9'; ++first, ++count)
+    {
+        digits = digits * 10 + static_cast<std::uint64_t>(*first - '0');
+    }
+    if (first == start) return false;
+    if (first != last && *first == '.')
+    {
+        start = ++first;
+        for (; first != last && *first >= '0' && *first <= '9'; ++first, ++count)
+        {
+            digits = digits * 10 + static_cast<std::uint64_t>(*first - '0');
+        }
+        if (first == start) return false;
+        scale = static_cast<int>(start - first);
+    }
+    if (first != last && (*first == 'e' || *first == 'E'))
+    {
+        if (++first == last) return false;
+        bool negative_exponent = *first == '-';
+        if (*first == '-' || *first == '+') ++first;
+        start = first;
+        int exponent = 0;
+        for (; first != last && *first >= '0' && *first <= '9' && first - start < 4; ++first)
+        {
+            exponent = exponent * 10 + (*first - '0');
+        }
+        if (first == start) return false;
+        scale += negative_exponent ? -exponent : exponent;
+    }
+    if (first != last || count > 15 || scale < -22 || scale > 22)
+    {
+        return false;
+    }
+    val = static_cast<double>(digits);
+    if (scale < 0) val /= powers_of_ten[-scale];
+    else val *= powers_of_ten[scale];
+    if (negative) val = -val;
+    return true;
+}
+
+// reads the four hex digits of a \u escape, surrogates are refused
+inline bool code_unit(char const* first, char const* last, std::uint32_t & code_point)
+{
+    if (last - first < 4) return false;
+    code_point = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        int digit = hex_digit(first[i]);
+        if (digit < 0) return false;
+        code_point = (code_point << 4) | static_cast<std::uint32_t>(digit);
+    }
+    return code_point < 0xd800 || code_point > 0xdfff;
+}
+
+// true if every escape in a string body is one unescape() decodes
+bool valid_escapes(char const* first, char const* last)
+{
+    while ((first = static_cast<char const*>(std::memchr(first, '\\', last - first))) != nullptr)
+    {
+        if (++first == last) return false;
+        std::uint32_t code_point;
+        switch (*first++)
+        {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            break;
+        case 'u':
+            if (!code_unit(first, last, code_point)) return false;
+            first += 4;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+// Decodes a string body. Surrogate pairs and the non-JSON escapes accepted
+// by unicode_string are left to the grammar.
+bool unescape(char const* first, char const* last, std::string & str)
+{
+    str.clear();
+    str.reserve(last - first);
+    while (first != last)
+    {
+        char const* backslash = static_cast<char const*>(std::memchr(first, '\\', last - first));
+        if (backslash == nullptr)
+        {
+            str.append(first, last);
+            break;
+        }
+        str.append(first, backslash);
+        first = backslash + 1;
+        if (first == last) return false;
+        char c = *first++;
+        switch (c)
+        {
+        case '"': case '\\': case '/': str += c; break;
+        case 'b': str += '\b'; break;
+        case 'f': str += '\f'; break;
+        case 'n': str += '\n'; break;
+        case 'r': str += '\r'; break;
+        case 't': str += '\t'; break;
+        case 'u':
+        {
+            std::uint32_t code_point;
+            if (!code_unit(first, last, code_point)) return false;
+            first += 4;
+            if (code_point < 0x80)
+            {
+                str += static_cast<char>(code_point);
+            }
+            else if (code_point < 0x800)
+            {
+                str += static_cast<char>(0xc0 | (code_point >> 6));
+                str += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+            else
+            {
+                str += static_cast<char>(0xe0 | (code_point >> 12));
+                str += static_cast<char>(0x80 | ((code_point >> 6) & 0x3f));
+                str += static_cast<char>(0x80 | (code_point & 0x3f));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+struct feature_parts
+{
+    bool has_geometry = false;
+    mapnik::geometry::geometry<double> geometry;
+    json_object properties;
+};
+
+void set_feature(feature_parts & parts, mapnik::feature_impl & feature, mapnik::transcoder const& tr)
+{
+    if (parts.has_geometry) feature.set_geometry(std::move(parts.geometry));
+    attribute_value_visitor visitor(tr);
+    for (auto const& kv : parts.properties)
+    {
+        feature.put_new(kv.first, mapnik::util::apply_visitor(visitor, kv.second));
+    }
+}
+
+class parser : util::noncopyable
+{
+public:
+    parser(char const* start, char const* end)
+        : index_(start, end),
+          end_(end),
+          current_(nullptr) {}
+
+    char const* next()
+    {
+        return current_ = index_.next();
+    }
+
+    // last token returned by next()
+    char const* current() const
+    {
+        return current_;
+    }
+
+    bool expect(char c)
+    {
+        char const* tok = next();
+        return tok != nullptr && *tok == c;
+    }
+
+    // one past the last character of the token starting at tok
+    char const* token_end(char const* tok)
+    {
+        char const* last = index_.peek();
+        if (last == nullptr) last = end_;
+        while (last > tok && is_space(last[-1])) --last;
+        return last;
+    }
+
+    // string token including quotes is [tok, last)
+    bool string(char const* tok, char const*& last)
+    {
+        if (*tok != '"') return false;
+        last = token_end(tok);
+        return last - tok >= 2 && last[-1] == '"' && index_.valid()
+            && valid_escapes(tok + 1, last - 1);
+    }
+
+    bool null(char const* tok)
+    {
+        return *tok == 'n' && equals(tok, token_end(tok), "null");
+    }
+
+    // calls f(tok) for each element of the array or object just opened,
+    // up to the matching `close`
+    template <typename F>
+    bool elements(char close, F f)
+    {
+        char const* tok = next();
+        if (tok == nullptr) return false;
+        if (*tok == close) return true;
+        for (;;)
+        {
+            if (!f(tok)) return false;
+            tok = next();
+            if (tok == nullptr) return false;
+            if (*tok == close) return true;
+            if (*tok != ',' || (tok = next()) == nullptr) return false;
+        }
+    }
+
+    // calls f(key, key_end, value) for each member of the object just
+    // opened; the raw key including quotes is [key, key_end)
+    template <typename F>
+    bool members(F f)
+    {
+        return elements('}', [this, &f](char const* key) {
+                char const* key_end;
+                char const* tok;
+                return string(key, key_end) && expect(':') && (tok = next()) != nullptr
+                    && f(key, key_end, tok);
+            });
+    }
+
+    bool scalar(char const* tok, json_value & val)
+    {
+        char const* last = token_end(tok);
+        char const* itr = tok;
+        double d;
+        if (std::find_if(tok, last, [](char c) { return c == '.' || c == 'e' || c == 'E'; }) != last
+            && exact_double(tok, last, d))
+        {
+            val = d;
+            return true;
+        }
+        if (qi::parse(itr, last, strict_double, d))
+        {
+            val = d;
+            return itr == last;
+        }
+        itr = tok;
+        mapnik::value_integer i;
+        if (qi::parse(itr, last, integer, i))
+        {
+            val = i;
+            return itr == last;
+        }
+        if (equals(tok, last, "true")) val = true;
+        else if (equals(tok, last, "false")) val = false;
+        else if (equals(tok, last, "null")) val = value_null();
+        else return false;
+        return true;
+    }
+
+    bool value(char const* tok, json_value & val)
+    {
+        switch (*tok)
+        {
+        case '{':
+        {
+            json_object object;
+            if (!members([this, &object](char const* key, char const* key_end, char const* tok) {
+                        object.emplace_back();
+                        return unescape(key + 1, key_end - 1, object.back().first)
+                            && value(tok, object.back().second);
+                    })) return false;
+            val = std::move(object);
+            return true;
+        }
+        case '[':
+        {
+            json_array array;
+            if (!elements(']', [this, &array](char const* tok) {
+                        array.emplace_back();
+                        return value(tok, array.back());
+                    })) return false;
+            val = std::move(array);
+            return true;
+        }
+        case '"':
+        {
+            char const* last;
+            std::string str;
+            if (!string(tok, last) || !unescape(tok + 1, last - 1, str)) return false;
+            val = std::move(str);
+            return true;
+        }
+        default:
+            return scalar(tok, val);
+        }
+    }
+
+    bool skip(char const* tok)
+    {
+        switch (*tok)
+        {
+        case '{':
+            return members([this](char const*, char const*, char const* tok) { return skip(tok); });
+        case '[':
+            return elements(']', [this](char const* tok) { return skip(tok); });
+        case '"':
+        {
+            char const* last;
+            return string(tok, last);
+        }
+        default:
+        {
+            json_value val;
+            return scalar(tok, val);
+        }
+        }
+    }
+
+    bool coordinate(char const* tok, double & val)
+    {
+        char const* last = token_end(tok);
+        return exact_double(tok, last, val) || (qi::parse(tok, last, double_, val) && tok == last);
+    }
+
+    // [x, y, ...]
+    bool position(char const* tok, double & x, double & y)
+    {
+        char const* t;
+        if (*tok != '[' || (t = next()) == nullptr || !coordinate(t, x)
+            || !expect(',') || (t = next()) == nullptr || !coordinate(t, y))
+        {
+            return false;
+        }
+        for (;;)
+        {
+            t = next();
+            if (t == nullptr) return false;
+            if (*t == ']') return true;
+            double z;
+            if (*t != ',' || (t = next()) == nullptr || !coordinate(t, z)) return false;
+        }
+    }
+
+    // Nesting of the coordinates at tok, as chosen by positions_grammar:
+    // 1 for a position, 2 for positions, 3 for rings, 4 for an array of
+    // rings. An empty innermost array is a ring.
+    int coordinates_depth(char const* tok) const
+    {
+        int depth = 0;
+        for (; tok != end_; ++tok)
+        {
+            if (*tok == '[') ++depth;
+            else if (!is_space(*tok)) break;
+        }
+        if (tok != end_ && *tok == ']') ++depth;
+        return depth;
+    }
+
+    template <typename Box>
+    bool extent(char const* tok, int depth, Box & box)
+    {
+        if (depth == 1)
+        {
+            double x, y;
+            if (!position(tok, x, y)) return false;
+            typename Box::value_type bx = x;
+            typename Box::value_type by = y;
+            if (!box.valid()) box.init(bx, by);
+            else box.expand_to_include(bx, by);
+            return true;
+        }
+        bool empty = true;
+        return *tok == '['
+            && elements(']', [this, depth, &box, &empty](char const* tok) {
+                    empty = false;
+                    return extent(tok, depth - 1, box);
+                })
+            && (!empty || depth == 2);
+    }
+
+    bool points(char const* tok, positions & ring)
+    {
+        return *tok == '[' && elements(']', [this, &ring](char const* tok) {
+                double x, y;
+                if (!position(tok, x, y)) return false;
+                ring.emplace_back(x, y);
+                return true;
+            });
+    }
+
+    bool rings(char const* tok, std::vector<positions> & rings)
+    {
+        return *tok == '[' && elements(']', [this, &rings](char const* tok) {
+                rings.emplace_back();
+                return points(tok, rings.back());
+            }) && !rings.empty();
+    }
+
+    bool coordinates(char const* tok, json::coordinates & coords)
+    {
+        switch (coordinates_depth(tok))
+        {
+        case 1:
+        {
+            double x, y;
+            if (!position(tok, x, y)) return false;
+            coords = position_type(x, y);
+            return true;
+        }
+        case 2:
+        {
+            positions ring;
+            if (!points(tok, ring)) return false;
+            coords = std::move(ring);
+            return true;
+        }
+        case 3:
+        {
+            std::vector<positions> polygon;
+            if (!rings(tok, polygon)) return false;
+            coords = std::move(polygon);
+            return true;
+        }
+        case 4:
+        {
+            std::vector<std::vector<positions>> polygons;
+            if (*tok != '[' || !elements(']', [this, &polygons](char const* tok) {
+                        polygons.emplace_back();
+                        return rings(tok, polygons.back());
+                    }) || polygons.empty()) return false;
+            coords = std::move(polygons);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    bool geometry_type(char const* tok, int & type)
+    {
+        char const* last;
+        if (!string(tok, last)) return false;
+        if (equals(tok, last, "\"Point\"")) type = 1;
+        else if (equals(tok, last, "\"LineString\"")) type = 2;
+        else if (equals(tok, last, "\"Polygon\"")) type = 3;
+        else if (equals(tok, last, "\"MultiPoint\"")) type = 4;
+        else if (equals(tok, last, "\"MultiLineString\"")) type = 5;
+        else if (equals(tok, last, "\"MultiPolygon\"")) type = 6;
+        else if (equals(tok, last, "\"GeometryCollection\"")) type = 7;
+        else return false;
+        return true;
+    }
+
+    bool geometry(char const* tok, mapnik::geometry::geometry<double> & geom)
+    {
+        int type = 0;
+        json::coordinates coords;
+        bool empty = true;
+        if (*tok != '{' || !members([&](char const* key, char const* key_end, char const* tok) {
+                    empty = false;
+                    if (equals(key, key_end, "\"type\"")) return geometry_type(tok, type);
+                    if (equals(key, key_end, "\"coordinates\"")) return coordinates(tok, coords);
+                    if (equals(key, key_end, "\"geometries\""))
+                    {
+                        mapnik::geometry::geometry_collection<double> collection;
+                        if (*tok != '[' || !elements(']', [this, &collection](char const* tok) {
+                                    collection.emplace_back();
+                                    return geometry(tok, collection.back());
+                                }) || collection.empty()) return false;
+                        geom = std::move(collection);
+                        return true;
+                    }
+                    return skip(tok);
+                }) || empty)
+        {
+            return false;
+        }
+        try
+        {
+            create_geometry_impl()(geom, type, coords);
+        }
+        catch (std::runtime_error const&)
+        {
+            return false;
+        }
+        return true;
+    }
+
+    bool feature(char const* tok, feature_parts & parts)
+    {
+        bool is_feature = false;
+        return *tok == '{' && members([&](char const* key, char const* key_end, char const* tok) {
+                if (equals(key, key_end, "\"type\""))
+                {
+                    char const* last;
+                    return is_feature = string(tok, last) && equals(tok, last, "\"Feature\"");
+                }
+                if (equals(key, key_end, "\"geometry\""))
+                {
+                    mapnik::geometry::geometry<double> geom;
+                    if (!null(tok) && !geometry(tok, geom)) return false;
+                    parts.geometry = std::move(geom);
+                    parts.has_geometry = true;
+                    return true;
+                }
+                if (equals(key, key_end, "\"properties\""))
+                {
+                    return null(tok) || (*tok == '{' && members([this, &parts](char const* key, char const* key_end, char const* tok) {
+                                parts.properties.emplace_back();
+                                return unescape(key + 1, key_end - 1, parts.properties.back().first)
+                                    && value(tok, parts.properties.back().second);
+                            }));
+                }
+                return skip(tok);
+            }) && is_feature;
+    }
+
+    // Walks a feature the way extract_bounding_box_grammar does: box of the
+    // last "coordinates" member, at any depth; scalars are not validated.
+    template <typename Box>
+    bool feature_extent(char const* tok, Box & box)
+    {
+        switch (*tok)
+        {
+        case '{':
+            return members([this, &box](char const* key, char const* key_end, char const* tok) {
+                    if (equals(key, key_end, "\"FeatureCollection\"")) return false;
+                    if (*tok == '[' && equals(key, key_end, "\"coordinates\""))
+                    {
+                        Box coords_box;
+                        if (!extent(tok, coordinates_depth(tok), coords_box)) return false;
+                        box = coords_box;
+                        return true;
+                    }
+                    return feature_extent(tok, box);
+                });
+        case '[':
+            return elements(']', [this, &box](char const* tok) { return feature_extent(tok, box); });
+        case '"':
+        {
+            char const* last;
+            return string(tok, last) && !equals(tok, last, "\"FeatureCollection\"");
+        }
+        case '}': case ']': case ':': case ',':
+            return false;
+        default:
+            return true;
+        }
+    }
+
+private:
+    using position_type = mapnik::geometry::point<double>;
+
+    structural_index index_;
+    char const* end_;
+    char const* current_;
+};
+
+}
+
+template <typename Boxes>
+bool extract_bounding_boxes(char const* start, char const* end, Boxes & boxes)
+{
+    using box_type = typename Boxes::value_type::first_type;
+    parser p(start, end);
+    char const* tok = p.next();
+    if (tok == nullptr) return false;
+    if (*tok == '{')
+    {
+        // members before "features"
+        for (;;)
+        {
+            char const* key = p.next();
+            char const* key_end;
+            if (key == nullptr || !p.string(key, key_end) || !p.expect(':')
+                || (tok = p.next()) == nullptr)
+            {
+                return false;
+            }
+            if (equals(key, key_end, "\"features\"")) break;
+            if (!p.skip(tok) || !p.expect(',')) return false;
+        }
+    }
+    Boxes result;
+    if (*tok != '[' || !p.elements(']', [&](char const* tok) {
+                box_type box;
+                if (*tok != '{' || !p.feature_extent(tok, box)) return false;
+                if (box.valid())
+                {
+                    result.emplace_back(box, std::make_pair(static_cast<std::size_t>(tok - start),
+                                                            static_cast<std::size_t>(p.current() + 1 - tok)));
+                }
+                return true;
+            }))
+    {
+        return false;
+    }
+    boxes.insert(boxes.end(), result.begin(), result.end());
+    return true;
+}
+
+bool parse_feature(char const* start, char const* end,
+                   mapnik::feature_impl & feature, mapnik::transcoder const& tr)
+{
+    parser p(start, end);
+    feature_parts parts;
+    char const* tok = p.next();
+    if (tok == nullptr || !p.feature(tok, parts) || p.next() != nullptr) return false;
+    set_feature(parts, feature, tr);
+    return true;
+}
+
+bool parse_feature_collection(char const* start, char const* end,
+                              mapnik::context_ptr const& ctx, std::size_t & start_id,
+                              std::vector<mapnik::feature_ptr> & features,
+                              mapnik::transcoder const& tr)
+{
+    parser p(start, end);
+    std::vector<mapnik::feature_ptr> result;
+    std::size_t id = start_id;
+    bool empty = true;
+    char const* tok = p.next();
+    if (tok == nullptr || *tok != '{' || !p.members([&](char const* key, char const* key_end, char const* tok) {
+                empty = false;
+                if (equals(key, key_end, "\"type\""))
+                {
+                    char const* last;
+                    return p.string(tok, last) && equals(tok, last, "\"FeatureCollection\"");
+                }
+                if (equals(key, key_end, "\"features\""))
+                {
+                    return *tok == '[' && p.elements(']', [&](char const* tok) {
+                            feature_parts parts;
+                            if (!p.feature(tok, parts)) return false;
+                            mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, id++));
+                            set_feature(parts, *feature, tr);
+                            result.push_back(feature);
+                            return true;
+                        });
+                }
+                return p.skip(tok);
+            }) || empty || p.next() != nullptr)
+    {
+        return false;
+    }
+    features.insert(features.end(), result.begin(), result.end());
+    start_id = id;
+    return true;
+}
+
+using boxes_type = std::vector<std::pair<box2d<double>, std::pair<std::size_t, std::size_t>>>;
+using boxes_float_type = std::vector<std::pair<box2d<float>, std::pair<std::size_t, std::size_t>>>;
+template bool extract_bounding_boxes<boxes_type>(char const*, char const*, boxes_type&);
+template bool extract_bounding_boxes<boxes_float_type>(char const*, char const*, boxes_float_type&);
+
+}}
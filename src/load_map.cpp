@@ -45,6 +45,7 @@
 #include <mapnik/text/placements/registry.hpp>
 #include <mapnik/text/placements/dummy.hpp>
 #include <mapnik/rule.hpp>
+#include <mapnik/collision_cache.hpp>
 #include <mapnik/config_error.hpp>
 #include <mapnik/util/dasharray_parser.hpp>
 #include <mapnik/util/conversions.hpp>
@@ -131,6 +132,7 @@ private:
     bool parse_raster_colorizer(raster_colorizer_ptr const& rc, xml_node const& node);
     void parse_stroke(symbolizer_base & symbol, xml_node const& node);
     void parse_svg_attributes(symbolizer_base & symbol, xml_node const& node);
+    void parse_collision_cache_keys(symbolizer_base & symbol, xml_node const& node);
     void ensure_font_face(std::string const& face_name);
     void find_unused_nodes(xml_node const& root);
     void find_unused_nodes_recursive(xml_node const& node, std::string & error_text);
@@ -248,6 +250,12 @@ void map_parser::parse_map(Map & map, xml_node const& node, std::string const& b
                 map.set_buffer_size(*buffer_size);
             }
 
+            optional<collision_index_e> collision_index = map_node.get_opt_attr<collision_index_e>("collision-index");
+            if (collision_index)
+            {
+                map.set_collision_index(*collision_index);
+            }
+
             optional<std::string> maximum_extent = map_node.get_opt_attr<std::string>("maximum-extent");
             if (maximum_extent)
             {
@@ -943,6 +951,13 @@ void map_parser::parse_symbolizer_base(symbolizer_base &sym, xml_node const& nod
     }
 }
 
+void map_parser::parse_collision_cache_keys(symbolizer_base & symbol, xml_node const& node)
+{
+    // cache names are interned now, renderers use their ids
+    set_symbolizer_property<symbolizer_base, collision_cache_list>(symbol, keys::collision_cache_detect, node);
+    set_symbolizer_property<symbolizer_base, collision_cache_list>(symbol, keys::collision_cache_insert, node);
+}
+
 void map_parser::parse_point_symbolizer(rule & rule, xml_node const & node)
 {
     try
@@ -957,8 +972,7 @@ void map_parser::parse_point_symbolizer(rule & rule, xml_node const & node)
         set_symbolizer_property<symbolizer_base,value_bool>(sym, keys::ignore_placement, node);
         set_symbolizer_property<symbolizer_base,label_placement_enum>(sym, keys::label_placement, node);
         set_symbolizer_property<symbolizer_base,transform_type>(sym, keys::image_transform, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_detect, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_insert, node);
+        parse_collision_cache_keys(sym, node);
         put(sym, keys::multipolicy, WHOLE_MULTI);
         if (file && !file->empty())
         {
@@ -1019,8 +1033,7 @@ void map_parser::parse_collision_symbolizer(rule & rule, xml_node const & node)
         set_symbolizer_property<symbolizer_base, value_bool>(sym, keys::clip, node);
         set_symbolizer_property<symbolizer_base, value_double>(sym, keys::offset, node);
         set_symbolizer_property<symbolizer_base, value_bool>(sym, keys::allow_overlap, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_detect, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_insert, node);
+        parse_collision_cache_keys(sym, node);
         rule.append(std::move(sym));
     }
     catch (config_error const& ex)
@@ -1097,8 +1110,7 @@ void map_parser::parse_markers_symbolizer(rule & rule, xml_node const& node)
         set_symbolizer_property<symbolizer_base,double>(sym, keys::margin, node);
         set_symbolizer_property<symbolizer_base,double>(sym, keys::grid_cell_width, node);
         set_symbolizer_property<symbolizer_base,double>(sym, keys::grid_cell_height, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_detect, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_insert, node);
+        parse_collision_cache_keys(sym, node);
         parse_stroke(sym,node);
         rule.append(std::move(sym));
     }
@@ -1222,8 +1234,7 @@ void map_parser::parse_text_symbolizer(rule & rule, xml_node const& node)
             set_symbolizer_property<symbolizer_base,composite_mode_e>(sym, keys::halo_comp_op, node);
             set_symbolizer_property<symbolizer_base,halo_rasterizer_enum>(sym, keys::halo_rasterizer, node);
             set_symbolizer_property<symbolizer_base,transform_type>(sym, keys::halo_transform, node);
-            set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_detect, node);
-            set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_insert, node);
+            parse_collision_cache_keys(sym, node);
             rule.append(std::move(sym));
         }
     }
@@ -1265,8 +1276,7 @@ void map_parser::parse_shield_symbolizer(rule & rule, xml_node const& node)
         set_symbolizer_property<symbolizer_base,double>(sym, keys::shield_dy, node);
         set_symbolizer_property<symbolizer_base,double>(sym, keys::opacity, node);
         set_symbolizer_property<symbolizer_base,value_bool>(sym, keys::unlock_image, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_detect, node);
-        set_symbolizer_property<symbolizer_base, std::string>(sym, keys::collision_cache_insert, node);
+        parse_collision_cache_keys(sym, node);
 
         std::string file = node.get_attr<std::string>("file");
         if (file.empty())
@@ -1489,8 +1499,7 @@ void map_parser::parse_group_symbolizer(rule & rule, xml_node const & node)
         text_placements_ptr placements = std::make_shared<text_placements_dummy>();
         placements->defaults.text_properties_from_xml(node);
         put<text_placements_ptr>(symbol, keys::text_placements_, placements);
-        set_symbolizer_property<symbolizer_base, std::string>(symbol, keys::collision_cache_detect, node);
-        set_symbolizer_property<symbolizer_base, std::string>(symbol, keys::collision_cache_insert, node);
+        parse_collision_cache_keys(symbol, node);
 
         size_t layout_count = 0;
         for (auto const& child_node : node)
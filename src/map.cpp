@@ -71,6 +71,7 @@ Map::Map()
     background_image_comp_op_(src_over),
     background_image_opacity_(1.0),
     aspectFixMode_(GROW_BBOX),
+    collision_index_(COLLISION_INDEX_QUAD_TREE),
     base_path_(""),
     extra_params_(),
     font_directory_(),
@@ -85,6 +86,7 @@ Map::Map(int width,int height, std::string const& srs)
       background_image_comp_op_(src_over),
       background_image_opacity_(1.0),
       aspectFixMode_(GROW_BBOX),
+      collision_index_(COLLISION_INDEX_QUAD_TREE),
       base_path_(""),
       extra_params_(),
       font_directory_(),
@@ -104,6 +106,7 @@ Map::Map(Map const& rhs)
       fontsets_(rhs.fontsets_),
       layers_(rhs.layers_),
       aspectFixMode_(rhs.aspectFixMode_),
+      collision_index_(rhs.collision_index_),
       current_extent_(rhs.current_extent_),
       maximum_extent_(rhs.maximum_extent_),
       base_path_(rhs.base_path_),
@@ -127,6 +130,7 @@ Map::Map(Map && rhs)
       fontsets_(std::move(rhs.fontsets_)),
       layers_(std::move(rhs.layers_)),
       aspectFixMode_(std::move(rhs.aspectFixMode_)),
+      collision_index_(std::move(rhs.collision_index_)),
       current_extent_(std::move(rhs.current_extent_)),
       maximum_extent_(std::move(rhs.maximum_extent_)),
       base_path_(std::move(rhs.base_path_)),
@@ -158,6 +162,7 @@ void swap (Map & lhs, Map & rhs)
     std::swap(lhs.fontsets_, rhs.fontsets_);
     std::swap(lhs.layers_, rhs.layers_);
     std::swap(lhs.aspectFixMode_, rhs.aspectFixMode_);
+    std::swap(lhs.collision_index_, rhs.collision_index_);
     std::swap(lhs.current_extent_, rhs.current_extent_);
     std::swap(lhs.maximum_extent_, rhs.maximum_extent_);
     std::swap(lhs.base_path_, rhs.base_path_);
@@ -182,6 +187,7 @@ bool Map::operator==(Map const& rhs) const
         (fontsets_ == rhs.fontsets_) &&
         (layers_ == rhs.layers_) &&
         (aspectFixMode_ == rhs.aspectFixMode_) &&
+        (collision_index_ == rhs.collision_index_) &&
         (current_extent_ == rhs.current_extent_) &&
         (maximum_extent_ == rhs.maximum_extent_) &&
         (base_path_ == rhs.base_path_) &&
@@ -39,10 +39,8 @@ marker_layout::marker_layout(params_type const & params)
       avoid_edges_(params.get<value_bool, keys::avoid_edges>()),
       direction_(params.get<direction_enum, keys::direction>()),
       margin_(params.get<value_double, keys::margin>() * params.scale_factor),
-      collision_cache_insert_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_insert>())),
-      collision_cache_detect_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_detect>()))
+      collision_cache_insert_(params.collision_cache_insert),
+      collision_cache_detect_(params.collision_cache_detect)
 {
 }
 
@@ -28,14 +28,194 @@
 #include <mapnik/raster.hpp>
 #include <mapnik/raster_colorizer.hpp>
 #include <mapnik/enumeration.hpp>
+#include <mapnik/util/noncopyable.hpp>
+#ifdef SSE_MATH
+#include <mapnik/sse.hpp>
+#endif
 
 // stl
+#include <algorithm>
+#include <cstdint>
 #include <limits>
 #include <cmath>
+#include <mutex>
+#include <type_traits>
 
 namespace mapnik
 {
 
+inline unsigned interpolate(unsigned start, unsigned end, float fraction)
+{
+    return static_cast<unsigned>(fraction * (static_cast<float>(end) - static_cast<float>(start)) + static_cast<float>(start));
+}
+
+namespace detail {
+
+//! \brief The stops of a raster_colorizer resolved for colorizing many values
+//!
+//! The stop a value falls in is found by binary search and everything
+//! get_color works out from the stop alone is done once per stop. 8 and 16
+//! bit values are looked up in tables of all their colors, built on first
+//! use. Colors are the same as get_color gives.
+class compiled_colorizer : private util::noncopyable
+{
+public:
+    explicit compiled_colorizer(raster_colorizer const& colorizer)
+        : default_color_(colorizer.get_default_color().rgba()),
+          epsilon_(colorizer.get_epsilon())
+    {
+        colorizer_stops const& stops = colorizer.get_stops();
+        int count = stops.size();
+        values_.reserve(count);
+        for (auto const& stop : stops)
+        {
+            values_.push_back(stop.get_value());
+        }
+        // segment i covers the values from stop i - 1 up to stop i, the
+        // first one the values before the first stop
+        segments_.resize(count + 1);
+        if (count == 0)
+        {
+            segments_[0].mode = COLORIZER_DISCRETE;
+            segments_[0].color = default_color_;
+            return;
+        }
+        for (int i = 0; i <= count; ++i)
+        {
+            segment & s = segments_[i];
+            colorizer_stop const& next = stops[std::min(i, count - 1)];
+            mapnik::color const& start = (i == 0) ? colorizer.get_default_color() : stops[i - 1].get_color();
+            colorizer_mode_enum mode = (i == 0) ? COLORIZER_INHERIT : stops[i - 1].get_mode_enum();
+            s.mode = (mode == COLORIZER_INHERIT) ? colorizer.get_default_mode_enum() : mode;
+            s.value = (i == 0) ? 0 : stops[i - 1].get_value();
+            s.next_value = next.get_value();
+            // past the last stop; values before the first stop never reach it
+            s.flat = (i > 0 && s.next_value == s.value);
+            s.color = start.rgba();
+            unsigned const starts[4] = { start.red(), start.green(), start.blue(), start.alpha() };
+            unsigned const ends[4] = { next.get_color().red(), next.get_color().green(),
+                                       next.get_color().blue(), next.get_color().alpha() };
+            for (int c = 0; c < 4; ++c)
+            {
+                s.start[c] = static_cast<float>(starts[c]);
+                s.diff[c] = static_cast<float>(ends[c]) - static_cast<float>(starts[c]);
+            }
+        }
+    }
+
+    std::uint32_t color(float value) const
+    {
+        // index of the first stop above value, NaN falls in the last segment
+        // like it does in get_color
+        std::size_t index = std::upper_bound(values_.begin(), values_.end(), value) - values_.begin();
+        segment const& s = segments_[index];
+        float stop_value = (index == 0) ? value : s.value;
+        switch (s.mode)
+        {
+        case COLORIZER_LINEAR:
+        {
+            if (s.flat) return s.color;
+            float fraction = (value - stop_value) / (s.next_value - stop_value);
+#ifdef SSE_MATH
+            // all four channels at once, truncating like interpolate()
+            __m128 channels = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(fraction), _mm_loadu_ps(s.diff)),
+                                         _mm_loadu_ps(s.start));
+            __m128i packed = _mm_cvttps_epi32(channels);
+            packed = _mm_packs_epi32(packed, packed);
+            packed = _mm_packus_epi16(packed, packed);
+            return static_cast<std::uint32_t>(_mm_cvtsi128_si32(packed));
+#else
+            std::uint32_t rgba = 0;
+            for (int c = 0; c < 4; ++c)
+            {
+                unsigned channel = static_cast<unsigned>(fraction * s.diff[c] + s.start[c]);
+                rgba |= (channel & 0xff) << (8 * c);
+            }
+            return rgba;
+#endif
+        }
+        case COLORIZER_DISCRETE:
+            return s.color;
+        case COLORIZER_EXACT:
+        default:
+            return (std::fabs(value - stop_value) < epsilon_) ? s.color : default_color_;
+        }
+    }
+
+    //! \brief Colors of all values of T, indexed by value - min
+    template <typename T>
+    std::uint32_t const* table() const
+    {
+        static_assert(std::is_integral<T>::value && sizeof(T) <= 2, "tables are for 8 and 16 bit values");
+        std::size_t index = (sizeof(T) == 1 ? 0 : 2) + (std::is_signed<T>::value ? 1 : 0);
+        std::call_once(table_flags_[index], [this, index]()
+        {
+            std::vector<std::uint32_t> & table = tables_[index];
+            table.reserve(std::size_t(1) << (8 * sizeof(T)));
+            for (int v = std::numeric_limits<T>::min(); v <= std::numeric_limits<T>::max(); ++v)
+            {
+                table.push_back(color(static_cast<float>(v)));
+            }
+        });
+        return tables_[index].data();
+    }
+
+private:
+    struct segment
+    {
+        colorizer_mode_enum mode = COLORIZER_DISCRETE;
+        bool flat = false;
+        float value = 0;
+        float next_value = 0;
+        std::uint32_t color = 0;
+        float start[4] = { 0, 0, 0, 0 }; // stop color channels, r g b a
+        float diff[4] = { 0, 0, 0, 0 };  // next stop color channels minus start
+    };
+
+    std::vector<float> values_;
+    std::vector<segment> segments_;
+    std::uint32_t default_color_;
+    float epsilon_;
+    // gray8, gray8s, gray16, gray16s
+    mutable std::once_flag table_flags_[4];
+    mutable std::vector<std::uint32_t> tables_[4];
+};
+
+} // namespace detail
+
+namespace {
+
+template <typename T>
+using has_color_table = std::integral_constant<bool, std::is_integral<T>::value && sizeof(T) <= 2>;
+
+template <typename T>
+void colorize_pixels(detail::compiled_colorizer const& colorizer, std::uint32_t * out,
+                     T const* in, int len, boost::optional<double> const& nodata,
+                     float epsilon, std::true_type)
+{
+    std::uint32_t const* table = colorizer.table<T>();
+    int const min = std::numeric_limits<T>::min();
+    for (int i = 0; i < len; ++i)
+    {
+        T value = in[i];
+        out[i] = (nodata && (std::fabs(value - *nodata) < epsilon)) ? 0 : table[value - min];
+    }
+}
+
+template <typename T>
+void colorize_pixels(detail::compiled_colorizer const& colorizer, std::uint32_t * out,
+                     T const* in, int len, boost::optional<double> const& nodata,
+                     float epsilon, std::false_type)
+{
+    for (int i = 0; i < len; ++i)
+    {
+        T value = in[i];
+        out[i] = (nodata && (std::fabs(value - *nodata) < epsilon)) ? 0 : colorizer.color(value);
+    }
+}
+
+} // anonymous namespace
+
 //! \brief Strings for the colorizer_mode enumeration
 static const char *colorizer_mode_strings[] = {
     "inherit",
@@ -99,7 +279,7 @@ raster_colorizer::raster_colorizer(colorizer_mode mode, color const& _color)
     , default_color_(_color)
     , epsilon_(std::numeric_limits<float>::epsilon())
 {
-
+    compile();
 }
 
 raster_colorizer::~raster_colorizer()
@@ -118,10 +298,33 @@ bool raster_colorizer::add_stop(colorizer_stop const& stop)
     }
 
     stops_.push_back(stop);
+    compile();
 
     return true;
 }
 
+void raster_colorizer::set_stops(colorizer_stops const& stops)
+{
+    stops_.clear();
+    for (auto const& stop : stops)
+    {
+        if (!stops_.empty() && stop.get_value() <= stops_.back().get_value())
+        {
+            MAPNIK_LOG_ERROR(raster_colorizer) << "raster_colorizer: Stop " << stop.get_value()
+                                               << " is not above the previous stop, skipped";
+            continue;
+        }
+        stops_.push_back(stop);
+    }
+    compile();
+}
+
+void raster_colorizer::compile()
+{
+    // shared with copies of this colorizer until either changes
+    compiled_ = std::make_shared<detail::compiled_colorizer const>(*this);
+}
+
 template <typename T>
 void raster_colorizer::colorize(image_rgba8 & out, T const& in,
                                 boost::optional<double> const& nodata,
@@ -133,23 +336,9 @@ void raster_colorizer::colorize(image_rgba8 & out, T const& in,
     std::uint32_t * out_data = out.data();
     pixel_type const* in_data = in.data();
     int len = out.width() * out.height();
-    for (int i=0; i<len; ++i)
-    {
-        pixel_type value = in_data[i];
-        if (nodata && (std::fabs(value - *nodata) < epsilon_))
-        {
-            out_data[i] = 0; // rgba(0,0,0,0)
-        }
-        else
-        {
-            out_data[i] = get_color(value);
-        }
-    }
-}
-
-inline unsigned interpolate(unsigned start, unsigned end, float fraction)
-{
-    return static_cast<unsigned>(fraction * (static_cast<float>(end) - static_cast<float>(start)) + static_cast<float>(start));
+    // nodata pixels are left rgba(0,0,0,0)
+    colorize_pixels(*compiled_, out_data, in_data, len, nodata, epsilon_,
+                    has_color_table<pixel_type>());
 }
 
 unsigned raster_colorizer::get_color(float value) const
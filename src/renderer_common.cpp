@@ -65,7 +65,8 @@ renderer_common::renderer_common(Map const &m, attributes const& vars, unsigned
                      view_transform(m.width(),m.height(),m.get_current_extent(),offset_x,offset_y),
                      std::make_shared<detector_type>(
                         box2d<double>(-m.buffer_size(), -m.buffer_size(),
-                                      m.width() + m.buffer_size() ,m.height() + m.buffer_size())))
+                                      m.width() + m.buffer_size() ,m.height() + m.buffer_size()),
+                        m.collision_index()))
 {}
 
 renderer_common::renderer_common(Map const &m, attributes const& vars, unsigned offset_x, unsigned offset_y,
@@ -84,7 +85,15 @@ renderer_common::renderer_common(Map const &m, request const &req, attributes co
                      view_transform(req.width(),req.height(),req.extent(),offset_x,offset_y),
                      std::make_shared<detector_type>(
                         box2d<double>(-req.buffer_size(), -req.buffer_size(),
-                                      req.width() + req.buffer_size() ,req.height() + req.buffer_size())))
+                                      req.width() + req.buffer_size() ,req.height() + req.buffer_size()),
+                        m.collision_index()))
+{}
+
+renderer_common::renderer_common(Map const &m, renderer_common const& other, detector_ptr detector)
+   : renderer_common(m, other.width_, other.height_, other.scale_factor_,
+                     other.vars_,
+                     view_transform(other.t_),
+                     detector)
 {}
 
 renderer_common::~renderer_common()
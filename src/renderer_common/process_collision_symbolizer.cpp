@@ -31,10 +31,8 @@ point_layout::point_layout(params_type const & params)
           params.get<value_double, keys::width>() * params.scale_factor,
           params.get<value_double, keys::height>() * params.scale_factor),
       allow_overlap_(params.get<value_bool, keys::allow_overlap>()),
-      collision_cache_insert_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_insert>())),
-      collision_cache_detect_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_detect>()))
+      collision_cache_insert_(params.collision_cache_insert),
+      collision_cache_detect_(params.collision_cache_detect)
 {
 }
 
@@ -67,7 +65,9 @@ void process_collision_symbolizer(
     label_placement::placement_params params {
         prj_trans, common.t_, tr, sym, feature, common.vars_,
         box2d<double>(0, 0, common.width_, common.height_), common.query_extent_,
-        common.scale_factor_, common.symbol_cache_ };
+        common.scale_factor_, common.symbol_cache_,
+        label_placement::collision_cache_keys(*common.detector_, sym, keys::collision_cache_insert, feature, common.vars_),
+        label_placement::collision_cache_keys(*common.detector_, sym, keys::collision_cache_detect, feature, common.vars_) };
 
     using traits = label_placement::collision_symbolizer_traits;
     traits::layout_generator_type layout_generator(params, *common.detector_);
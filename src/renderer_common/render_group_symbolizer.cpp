@@ -192,7 +192,9 @@ void render_group_symbolizer(group_symbolizer const& sym,
     label_placement::placement_params params {
         prj_trans, common.t_, tr, sym, feature, vars,
         box2d<double>(0, 0, common.width_, common.height_), common.query_extent_,
-        common.scale_factor_, common.symbol_cache_ };
+        common.scale_factor_, common.symbol_cache_,
+        label_placement::collision_cache_keys(*common.detector_, sym, keys::collision_cache_insert, feature, vars),
+        label_placement::collision_cache_keys(*common.detector_, sym, keys::collision_cache_detect, feature, vars) };
 
     using traits = label_placement::group_symbolizer_traits;
     text_placement_info_ptr placement_info = mapnik::get<text_placements_ptr>(
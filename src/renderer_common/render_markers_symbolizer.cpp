@@ -185,7 +185,9 @@ struct render_marker_symbolizer_visitor
         const label_placement::placement_params params {
             prj_trans_, common_.t_, tr, sym_, feature_, common_.vars_,
             box2d<double>(0, 0, common_.width_, common_.height_),
-            common_.query_extent_, common_.scale_factor_, common_.symbol_cache_ };
+            common_.query_extent_, common_.scale_factor_, common_.symbol_cache_,
+            label_placement::collision_cache_keys(*common_.detector_, sym_, keys::collision_cache_insert, feature_, common_.vars_),
+            label_placement::collision_cache_keys(*common_.detector_, sym_, keys::collision_cache_detect, feature_, common_.vars_) };
         const auto placement_method = params.get<label_placement_enum, keys::label_placement>();
 
         using traits = label_placement::marker_symbolizer_traits;
@@ -240,7 +242,9 @@ struct render_marker_symbolizer_visitor
         const label_placement::placement_params params {
             prj_trans_, common_.t_, tr, sym_, feature_, common_.vars_,
             box2d<double>(0, 0, common_.width_, common_.height_),
-            common_.query_extent_, common_.scale_factor_, common_.symbol_cache_ };
+            common_.query_extent_, common_.scale_factor_, common_.symbol_cache_,
+            label_placement::collision_cache_keys(*common_.detector_, sym_, keys::collision_cache_insert, feature_, common_.vars_),
+            label_placement::collision_cache_keys(*common_.detector_, sym_, keys::collision_cache_detect, feature_, common_.vars_) };
         const auto placement_method = params.get<label_placement_enum, keys::label_placement>();
 
         using traits = label_placement::marker_symbolizer_traits;
@@ -32,7 +32,8 @@ virtual_renderer_common::virtual_renderer_common(renderer_common const& other)
     : renderer_common(other)
 {
     // replace collision detector with my own so that I don't pollute the original
-    detector_ = std::make_shared<renderer_common::detector_type>(other.detector_->extent());
+    detector_ = std::make_shared<renderer_common::detector_type>(other.detector_->extent(),
+                                                                 other.detector_->index());
 }
 
 namespace detail {
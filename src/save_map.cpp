@@ -666,6 +666,12 @@ void serialize_map(ptree & pt, Map const& map, bool explicit_defaults)
         set_attr( map_node, "buffer-size", buffer_size );
     }
 
+    collision_index_e collision_index = map.collision_index();
+    if (collision_index != COLLISION_INDEX_QUAD_TREE || explicit_defaults)
+    {
+        set_attr(map_node, "collision-index", collision_index);
+    }
+
     std::string const& base_path = map.base_path();
     if ( !base_path.empty() || explicit_defaults)
     {
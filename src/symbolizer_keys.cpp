@@ -158,8 +158,8 @@ static const property_meta_type key_meta[const_max_key] =
     property_meta_type{ "grid-cell-height", nullptr, property_types::target_double},
     property_meta_type{ "margin", nullptr, property_types::target_double},
     property_meta_type{ "collision-cache", nullptr, property_types::target_string },
-    property_meta_type{ "collision-cache-insert", nullptr, property_types::target_string },
-    property_meta_type{ "collision-cache-detect", nullptr, property_types::target_string },
+    property_meta_type{ "collision-cache-insert", nullptr, property_types::target_collision_cache_list },
+    property_meta_type{ "collision-cache-detect", nullptr, property_types::target_collision_cache_list },
     property_meta_type{ "lacing",  [](enumeration_wrapper e)
                         {return enumeration<pattern_lacing_mode_enum,pattern_lacing_mode_enum_MAX>(pattern_lacing_mode_enum(e.value)).as_string();},
                         property_types::target_lacing},
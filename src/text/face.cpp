@@ -22,6 +22,7 @@
 // mapnik
 #include <mapnik/text/face.hpp>
 #include <mapnik/debug.hpp>
+#include <mapnik/text/glyph_cache.hpp>
 
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore.hpp>
@@ -46,6 +47,8 @@ const struct
 #include FT_ERRORS_H
 }
 
+#include <harfbuzz/hb-ft.h>
+
 #pragma GCC diagnostic pop
 
 namespace mapnik
@@ -63,10 +66,12 @@ const char * ft_translate_error_code(int err_code)
     return "Unknown error";
 }
 
-font_face::font_face(FT_Face face)
+font_face::font_face(FT_Face face, std::string const& file_name, long face_index)
     : face_(face),
       color_font_(init_color_font()),
-      unscaled_ascender_(get_ascender())
+      unscaled_ascender_(get_ascender()),
+      glyph_cache_id_(glyph_cache::instance().face_id(file_name, face_index)),
+      hb_font_(nullptr)
 {
 }
 
@@ -134,12 +139,32 @@ bool font_face::glyph_dimensions(glyph_info & glyph) const
     return true;
 }
 
+hb_font_t * font_face::hb_font() const
+{
+    if (!hb_font_)
+    {
+        hb_font_ = hb_ft_font_create(face_, nullptr);
+        // https://github.com/mapnik/test-data-visual/pull/25
+        #if HB_VERSION_MAJOR > 0
+         #if HB_VERSION_ATLEAST(1, 0 , 5)
+        hb_ft_font_set_load_flags(hb_font_, FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING);
+         #endif
+        #endif
+    }
+    return hb_font_;
+}
+
 font_face::~font_face()
 {
     MAPNIK_LOG_DEBUG(font_face) <<
         "font_face: Clean up face \"" << family_name() <<
         " " << style_name() << "\"";
 
+    if (hb_font_)
+    {
+        hb_font_destroy(hb_font_);
+    }
+
     FT_Done_Face(face_);
 }
 
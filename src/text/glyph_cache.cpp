@@ -0,0 +1,76 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/text/glyph_cache.hpp>
+
+namespace mapnik
+{
+
+glyph_cache::glyph_cache()
+    : cache_(0),
+      faces_() {}
+
+std::uint32_t glyph_cache::face_id(std::string const& file_name, long face_index)
+{
+    std::string name(file_name);
+    name += '\n';
+    name += std::to_string(face_index);
+#ifdef MAPNIK_THREADSAFE
+    std::lock_guard<std::mutex> lock(mutex_);
+#endif
+    auto result = faces_.emplace(std::move(name), static_cast<std::uint32_t>(faces_.size()));
+    return result.first->second;
+}
+
+glyph_bitmap_ptr glyph_cache::find(glyph_cache_key const& key)
+{
+    return cache_.find(key);
+}
+
+void glyph_cache::insert(glyph_cache_key const& key, glyph_bitmap_ptr bitmap)
+{
+    cache_.insert(key, std::move(bitmap));
+}
+
+void glyph_cache::clear()
+{
+    cache_.clear();
+}
+
+void glyph_cache::set_capacity(std::size_t bytes)
+{
+    cache_.set_capacity(bytes);
+}
+
+std::size_t glyph_cache::capacity() const
+{
+    return cache_.capacity();
+}
+
+std::size_t glyph_cache::size() const
+{
+    return cache_.size();
+}
+
+}
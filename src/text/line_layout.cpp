@@ -62,10 +62,8 @@ text_upright_e simplify_upright(text_upright_e upright, double angle)
 
 single_line_layout::single_line_layout(params_type const & params)
     : params_(params),
-      collision_cache_insert_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_insert>())),
-      collision_cache_detect_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_detect>()))
+      collision_cache_insert_(params.collision_cache_insert),
+      collision_cache_detect_(params.collision_cache_detect)
 {
 }
 
@@ -122,7 +120,7 @@ bool single_line_layout::try_placement(
         if (!is_reachable(detector, pp, layout))
         {
             // Placements beyond collision extent are assumed to be successful.
-            return true;
+            return !collision(detector, text_props, glyphs, layouts.text());
         }
 
         pixel_position align_offset = layout.alignment_offset();
@@ -221,7 +219,7 @@ bool single_line_layout::try_placement(
                 cluster_offset.y -= rot.sin * glyph.advance();
 
                 box2d<double> bbox = get_bbox(layout, glyph, pos, rot);
-                if (collision(detector, text_props, bbox, layouts.text())) return false;
+                if (outside_canvas(text_props, bbox)) return false;
                 glyphs.emplace_back(glyph, pos, rot, bbox);
             }
             // See comment above
@@ -229,6 +227,9 @@ bool single_line_layout::try_placement(
         }
     }
 
+    // All glyph boxes of the path are tested against the detector at once
+    if (collision(detector, text_props, glyphs, layouts.text())) return false;
+
     if (upside_down_glyph_count > static_cast<unsigned>(layouts.text().length() / 2))
     {
         if (orientation == UPRIGHT_AUTO)
@@ -283,23 +284,37 @@ void single_line_layout::process_bboxes(
     }
 }
 
+bool single_line_layout::outside_canvas(
+    evaluated_text_properties const & text_props,
+    const box2d<double> &box) const
+{
+    return (text_props.avoid_edges && !params_.dims.contains(box))
+        ||
+        (text_props.minimum_padding > 0 &&
+         !params_.dims.contains(box + (params_.scale_factor * text_props.minimum_padding)));
+}
+
 bool single_line_layout::collision(
     detector_type & detector,
     evaluated_text_properties const & text_props,
-    const box2d<double> &box,
+    glyph_positions const& glyphs,
     const value_unicode_string &repeat_key) const
 {
+    if (text_props.allow_overlap || glyphs.size() == 0)
+    {
+        return false;
+    }
+    std::vector<box_type> boxes;
+    boxes.reserve(glyphs.size());
+    for (auto const& glyph_pos : glyphs)
+    {
+        boxes.push_back(glyph_pos.bbox);
+    }
     double margin = text_props.margin * params_.scale_factor;
     double repeat_distance = (text_props.repeat_distance != 0 ? text_props.repeat_distance : text_props.minimum_distance) * params_.scale_factor;
-    return (text_props.avoid_edges && !params_.dims.contains(box))
-        ||
-        (text_props.minimum_padding > 0 &&
-         !params_.dims.contains(box + (params_.scale_factor * text_props.minimum_padding)))
+    return (repeat_key.length() == 0 && !detector.has_placement(boxes, margin, collision_cache_detect_))
         ||
-        (!text_props.allow_overlap &&
-         ((repeat_key.length() == 0 && !detector.has_placement(box, margin, collision_cache_detect_))
-          ||
-          (repeat_key.length() > 0 && !detector.has_placement(box, margin, repeat_key, repeat_distance, collision_cache_detect_))));
+        (repeat_key.length() > 0 && !detector.has_placement(boxes, margin, repeat_key, repeat_distance, collision_cache_detect_));
 }
 
 }// ns mapnik
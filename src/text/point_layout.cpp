@@ -42,10 +42,8 @@ namespace mapnik
 
 point_layout::point_layout(params_type const & params)
     : params_(params),
-      collision_cache_insert_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_insert>())),
-      collision_cache_detect_(parse_collision_detector_keys(
-          params.get_optional<std::string, keys::collision_cache_detect>()))
+      collision_cache_insert_(params.collision_cache_insert),
+      collision_cache_detect_(params.collision_cache_detect)
 {
 }
 
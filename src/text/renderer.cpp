@@ -47,6 +47,10 @@
 #include "agg_renderer_scanline.h"
 #pragma GCC diagnostic pop
 
+// stl
+#include <algorithm>
+#include <cmath>
+
 namespace mapnik
 {
 
@@ -62,6 +66,11 @@ text_renderer::text_renderer (halo_rasterizer_e rasterizer, composite_mode_e com
       halo_transform_()
 {}
 
+text_renderer::~text_renderer()
+{
+    release_glyphs();
+}
+
 void text_renderer::set_transform(agg::trans_affine const& transform)
 {
     transform_ = transform;
@@ -72,78 +81,134 @@ void text_renderer::set_halo_transform(agg::trans_affine const& halo_transform)
     halo_transform_ = halo_transform;
 }
 
-void text_renderer::prepare_glyphs(glyph_positions const& positions)
+namespace {
+
+// Cached glyph rotations and origins are snapped to these steps, so that
+// the same rasterized glyphs can be reused through the glyph_cache.
+constexpr std::int32_t angle_steps = 1440; // 0.25 degree
+constexpr FT_Pos subpixel_step = 16; // 1/4 pixel in 26.6
+
+inline FT_Pos snap_subpixel(FT_Pos value)
+{
+    return (value + subpixel_step / 2) & ~(subpixel_step - 1);
+}
+
+inline bool is_identity(agg::trans_affine const& tr)
+{
+    return tr.sx == 1.0 && tr.shy == 0.0 && tr.shx == 0.0 && tr.sy == 1.0;
+}
+
+}
+
+void text_renderer::prepare_glyphs(glyph_positions const& positions, bool snap)
 {
     FT_Matrix matrix;
     FT_Vector pen;
-    FT_Error  error;
 
-    glyphs_.clear();
+    release_glyphs();
     glyphs_.reserve(positions.size());
 
     for (auto const& glyph_pos : positions)
     {
         glyph_info const& glyph = glyph_pos.glyph;
-        FT_Int32 load_flags = FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING;
+        double size = glyph.format->text_size * scale_factor_;
 
-        FT_Face face = glyph.face->get_face();
-        if (glyph.face->is_color())
+        double cos_angle = glyph_pos.rot.cos;
+        double sin_angle = glyph_pos.rot.sin;
+        std::int32_t angle = 0;
+        if (snap && (sin_angle != 0.0 || cos_angle < 0.0))
         {
-            load_flags |= FT_LOAD_COLOR ;
-            if (face->num_fixed_sizes > 0)
-            {
-                int scaled_size = static_cast<int>(glyph.format->text_size * scale_factor_);
-                int best_match = 0;
-                int diff = std::abs(scaled_size - face->available_sizes[0].width);
-                for (int i = 1; i < face->num_fixed_sizes; ++i)
-                {
-                    int ndiff = std::abs(scaled_size - face->available_sizes[i].height);
-                    if (ndiff < diff)
-                    {
-                        best_match = i;
-                        diff = ndiff;
-                    }
-                }
-                error = FT_Select_Size(face, best_match);
-            }
+            angle = static_cast<std::int32_t>(std::round(
+                std::atan2(sin_angle, cos_angle) * angle_steps / (2 * M_PI)));
+            double snapped = angle * 2 * M_PI / angle_steps;
+            cos_angle = std::cos(snapped);
+            sin_angle = std::sin(snapped);
         }
-        else
-        {
-            glyph.face->set_character_sizes(glyph.format->text_size * scale_factor_);
-        }
-
-        double size = glyph.format->text_size * scale_factor_;
-        matrix.xx = static_cast<FT_Fixed>( glyph_pos.rot.cos * 0x10000L);
-        matrix.xy = static_cast<FT_Fixed>(-glyph_pos.rot.sin * 0x10000L);
-        matrix.yx = static_cast<FT_Fixed>( glyph_pos.rot.sin * 0x10000L);
-        matrix.yy = static_cast<FT_Fixed>( glyph_pos.rot.cos * 0x10000L);
+        matrix.xx = static_cast<FT_Fixed>( cos_angle * 0x10000L);
+        matrix.xy = static_cast<FT_Fixed>(-sin_angle * 0x10000L);
+        matrix.yx = static_cast<FT_Fixed>( sin_angle * 0x10000L);
+        matrix.yy = static_cast<FT_Fixed>( cos_angle * 0x10000L);
 
         pixel_position pos = glyph_pos.pos + glyph.offset.rotate(glyph_pos.rot);
         pen.x = static_cast<FT_Pos>(pos.x * 64);
         pen.y = static_cast<FT_Pos>(pos.y * 64);
+        if (snap)
+        {
+            pen.x = snap_subpixel(pen.x);
+            pen.y = snap_subpixel(pen.y);
+        }
 
-        FT_Set_Transform(face, &matrix, &pen);
-        error = FT_Load_Glyph(face, glyph.glyph_index, load_flags);
-        if (error) continue;
-        FT_Glyph image;
-        error = FT_Get_Glyph(face->glyph, &image);
-        if (error) continue;
         box2d<double> bbox(0, glyph_pos.glyph.ymin(), 1, glyph_pos.glyph.ymax());
-        glyphs_.emplace_back(glyph, image, pos, glyph_pos.rot, size, bbox);
+        glyphs_.emplace_back(glyph, pos, glyph_pos.rot, size, bbox, matrix, pen, angle);
+    }
+}
+
+bool text_renderer::load_glyph(glyph_t & glyph)
+{
+    if (glyph.image)
+    {
+        return true;
+    }
+
+    FT_Int32 load_flags = FT_LOAD_DEFAULT | FT_LOAD_NO_HINTING;
+    FT_Face face = glyph.info.face->get_face();
+    if (glyph.info.face->is_color())
+    {
+        load_flags |= FT_LOAD_COLOR ;
+        if (face->num_fixed_sizes > 0)
+        {
+            int scaled_size = static_cast<int>(glyph.size);
+            int best_match = 0;
+            int diff = std::abs(scaled_size - face->available_sizes[0].width);
+            for (int i = 1; i < face->num_fixed_sizes; ++i)
+            {
+                int ndiff = std::abs(scaled_size - face->available_sizes[i].height);
+                if (ndiff < diff)
+                {
+                    best_match = i;
+                    diff = ndiff;
+                }
+            }
+            FT_Select_Size(face, best_match);
+        }
+    }
+    else
+    {
+        glyph.info.face->set_character_sizes(glyph.size);
     }
+
+    FT_Set_Transform(face, &glyph.matrix, &glyph.pen);
+    if (FT_Load_Glyph(face, glyph.info.glyph_index, load_flags)) return false;
+    FT_Glyph image;
+    if (FT_Get_Glyph(face->glyph, &image)) return false;
+    glyph.image = image;
+    return true;
+}
+
+void text_renderer::release_glyphs()
+{
+    for (auto & glyph : glyphs_)
+    {
+        if (glyph.image)
+        {
+            FT_Done_Glyph(glyph.image);
+        }
+    }
+    glyphs_.clear();
 }
 
 template <typename T>
-void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
+void composite_bitmap(T & pixmap, unsigned char const* buffer, unsigned width, unsigned rows,
+                      unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
 {
-    int x_max = x + bitmap->width;
-    int y_max = y + bitmap->rows;
+    int x_max = x + width;
+    int y_max = y + rows;
 
     for (int i = x, p = 0; i < x_max; ++i, ++p)
     {
         for (int j = y, q = 0; j < y_max; ++j, ++q)
         {
-            unsigned gray = bitmap->buffer[q * bitmap->width + p];
+            unsigned gray = buffer[q * width + p];
             if (gray)
             {
                 mapnik::composite_pixel(pixmap, comp_op, i, j, rgba, gray, opacity);
@@ -152,6 +217,12 @@ void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y
     }
 }
 
+template <typename T>
+void composite_bitmap(T & pixmap, FT_Bitmap *bitmap, unsigned rgba, int x, int y, double opacity, composite_mode_e comp_op)
+{
+    composite_bitmap(pixmap, bitmap->buffer, bitmap->width, bitmap->rows, rgba, x, y, opacity, comp_op);
+}
+
 template<class PixFmt> class image_accessor_halo
 {
 public:
@@ -392,13 +463,85 @@ agg_text_renderer<T>::agg_text_renderer (pixmap_type & pixmap,
                                          composite_mode_e halo_comp_op,
                                          double scale_factor,
                                          stroker_ptr stroker)
-    : text_renderer(rasterizer, comp_op, halo_comp_op, scale_factor, stroker), pixmap_(pixmap)
+    : text_renderer(rasterizer, comp_op, halo_comp_op, scale_factor, stroker),
+      pixmap_(pixmap),
+      painted_extent_()
 {}
 
+template <typename T>
+glyph_bitmap_ptr agg_text_renderer<T>::rasterize(glyph_t & glyph, FT_Vector const& start,
+                                                 int & left, int & top)
+{
+    glyph_bitmap_ptr bitmap;
+    if (glyph.info.face->is_color())
+    {
+        return bitmap;
+    }
+
+    FT_Pos origin_x = glyph.pen.x + start.x;
+    FT_Pos origin_y = glyph.pen.y + start.y;
+
+    glyph_cache_key key;
+    key.face_id = glyph.info.face->glyph_cache_id();
+    key.glyph_index = glyph.info.glyph_index;
+    key.size = static_cast<long>(glyph.size * (1 << 6));
+    key.angle = glyph.angle;
+    key.offset_x = static_cast<std::uint8_t>(origin_x & 63);
+    key.offset_y = static_cast<std::uint8_t>(origin_y & 63);
+
+    glyph_cache & cache = glyph_cache::instance();
+    bitmap = cache.find(key);
+    if (!bitmap && load_glyph(glyph))
+    {
+        FT_Glyph g;
+        if (FT_Glyph_Copy(glyph.image, &g) == 0)
+        {
+            FT_Glyph_Transform(g, nullptr, const_cast<FT_Vector*>(&start));
+            if (FT_Glyph_To_Bitmap(&g, FT_RENDER_MODE_NORMAL, 0, 1) == 0)
+            {
+                FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(g);
+                if (bit->bitmap.pixel_mode == FT_PIXEL_MODE_GRAY)
+                {
+                    auto result = std::make_shared<glyph_bitmap>();
+                    // Rasterization is invariant under whole pixel
+                    // translation, store the position relative to the origin.
+                    result->left = bit->left - static_cast<int>(origin_x >> 6);
+                    result->top = bit->top - static_cast<int>(origin_y >> 6);
+                    result->width = bit->bitmap.width;
+                    result->rows = bit->bitmap.rows;
+                    result->buffer.resize(result->width * result->rows);
+                    for (unsigned row = 0; row < result->rows; ++row)
+                    {
+                        std::copy_n(bit->bitmap.buffer + row * bit->bitmap.pitch, result->width,
+                                    result->buffer.data() + row * result->width);
+                    }
+                    bitmap = result;
+                    cache.insert(key, bitmap);
+                }
+            }
+            FT_Done_Glyph(g);
+        }
+    }
+
+    if (bitmap)
+    {
+        left = bitmap->left + static_cast<int>(origin_x >> 6);
+        top = bitmap->top + static_cast<int>(origin_y >> 6);
+    }
+    return bitmap;
+}
+
 template <typename T>
 void agg_text_renderer<T>::render(glyph_positions const& pos)
 {
-    prepare_glyphs(pos);
+    // rasterized glyphs are shared through the glyph cache unless the
+    // glyph outlines are transformed or are colour bitmaps
+    bool const cached = glyph_cache::instance().capacity() > 0 &&
+        is_identity(transform_) && is_identity(halo_transform_) &&
+        std::none_of(pos.begin(), pos.end(), [](glyph_position const& glyph_pos)
+                     { return glyph_pos.glyph.face->is_color(); });
+
+    prepare_glyphs(pos, cached);
     FT_Error  error;
     FT_Vector start;
     FT_Vector start_halo;
@@ -407,6 +550,11 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
 
     start.x =  static_cast<FT_Pos>(base_point.x * (1 << 6));
     start.y =  static_cast<FT_Pos>((height - base_point.y) * (1 << 6));
+    if (cached)
+    {
+        start.x = snap_subpixel(start.x);
+        start.y = snap_subpixel(start.y);
+    }
     start_halo = start;
     start.x += transform_.tx * 64;
     start.y += transform_.ty * 64;
@@ -433,13 +581,33 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
     double text_opacity = 1.0;
     double halo_opacity = 1.0;
 
-    for (auto const& glyph : glyphs_)
+    for (auto & glyph : glyphs_)
     {
         halo_fill = glyph.info.format->halo_fill.rgba();
         halo_opacity = glyph.info.format->halo_opacity;
         halo_radius = glyph.info.format->halo_radius * scale_factor_;
         // make sure we've got reasonable values.
         if (halo_radius <= 0.0 || halo_radius > 1024.0) continue;
+        if (rasterizer_ != HALO_RASTERIZER_FULL && cached)
+        {
+            int left, top;
+            glyph_bitmap_ptr bitmap = rasterize(glyph, start_halo, left, top);
+            if (bitmap)
+            {
+                render_halo(bitmap->buffer.data(),
+                            bitmap->width,
+                            bitmap->rows,
+                            1,
+                            halo_fill,
+                            left,
+                            height - top,
+                            halo_radius,
+                            halo_opacity,
+                            halo_comp_op_);
+                continue;
+            }
+        }
+        if (!load_glyph(glyph)) continue;
         FT_Glyph g;
         error = FT_Glyph_Copy(glyph.image, &g);
         if (!error)
@@ -450,6 +618,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                 if (g->format != FT_GLYPH_FORMAT_OUTLINE)
                 {
                     MAPNIK_LOG_WARN(agg_text_renderer) << "HALO_RASTERIZER_FULL only works with vectorial glyphs.";
+                    FT_Done_Glyph(g);
                     continue;
                 }
 
@@ -461,6 +630,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                     FT_BitmapGlyph bit = reinterpret_cast<FT_BitmapGlyph>(g);
                     if (bit->bitmap.pixel_mode != FT_PIXEL_MODE_BGRA)
                     {
+                        mark_painted(bit->left, height - bit->top, bit->bitmap.width, bit->bitmap.rows);
                         composite_bitmap(pixmap_,
                                          &bit->bitmap,
                                          halo_fill,
@@ -478,6 +648,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                     error = FT_Glyph_To_Bitmap(&g, FT_RENDER_MODE_NORMAL, 0, 1);
                     if (error)
                     {
+                        FT_Done_Glyph(g);
                         continue;
                     }
                 }
@@ -486,6 +657,8 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                 {
                     int x = (start.x >> 6) + glyph.pos.x;
                     int y = height - (start.y >> 6) - glyph.pos.y;
+                    // scaled and rotated, assume the whole image is touched
+                    mark_painted(0, 0, pixmap_.width(), pixmap_.height());
                     composite_color_glyph_halo(pixmap_,
                                                bit->bitmap,
                                                transform_,
@@ -513,8 +686,8 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                                 halo_comp_op_);
                 }
             }
+            FT_Done_Glyph(g);
         }
-        FT_Done_Glyph(g);
     }
 
     // render actual text
@@ -523,6 +696,27 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
         fill = glyph.info.format->fill.rgba();
         text_opacity = glyph.info.format->text_opacity;
 
+        if (cached)
+        {
+            int left, top;
+            glyph_bitmap_ptr bitmap = rasterize(glyph, start, left, top);
+            if (bitmap)
+            {
+                mark_painted(left, height - top, bitmap->width, bitmap->rows);
+                composite_bitmap(pixmap_,
+                                 bitmap->buffer.data(),
+                                 bitmap->width,
+                                 bitmap->rows,
+                                 fill,
+                                 left,
+                                 height - top,
+                                 text_opacity,
+                                 comp_op_);
+                continue;
+            }
+        }
+        if (!load_glyph(glyph)) continue;
+
         FT_Glyph_Transform(glyph.image, &matrix, &start);
         error = 0;
         if ( glyph.image->format != FT_GLYPH_FORMAT_BITMAP )
@@ -538,6 +732,8 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
             {
                 int x = (start.x >> 6) + glyph.pos.x;
                 int y = height - (start.y >> 6) - glyph.pos.y;
+                // scaled and rotated, assume the whole image is touched
+                mark_painted(0, 0, pixmap_.width(), pixmap_.height());
                 composite_color_glyph(pixmap_,
                                       bit->bitmap,
                                       transform_,
@@ -549,6 +745,7 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
             }
             else
             {
+                mark_painted(bit->left, height - bit->top, bit->bitmap.width, bit->bitmap.rows);
                 composite_bitmap(pixmap_,
                                  &bit->bitmap,
                                  fill,
@@ -558,8 +755,8 @@ void agg_text_renderer<T>::render(glyph_positions const& pos)
                                  comp_op_);
             }
         }
-        FT_Done_Glyph(glyph.image);
     }
+    release_glyphs();
 }
 
 
@@ -586,6 +783,7 @@ void grid_text_renderer<T>::render(glyph_positions const& pos, value_integer fea
     for (auto & glyph : glyphs_)
     {
         halo_radius = glyph.info.format->halo_radius * scale_factor_;
+        if (!load_glyph(glyph)) continue;
         FT_Glyph_Transform(glyph.image, &halo_matrix, &start);
         error = FT_Glyph_To_Bitmap(&glyph.image, FT_RENDER_MODE_NORMAL, 0, 1);
         if (!error)
@@ -597,13 +795,13 @@ void grid_text_renderer<T>::render(glyph_positions const& pos, value_integer fea
                            height - bit->top,
                            static_cast<int>(halo_radius));
         }
-        FT_Done_Glyph(glyph.image);
     }
+    release_glyphs();
 }
 
 
 template <typename T>
-void agg_text_renderer<T>::render_halo(unsigned char *buffer,
+void agg_text_renderer<T>::render_halo(unsigned char const* buffer,
                                        unsigned width,
                                        unsigned height,
                                        unsigned pixel_width,
@@ -615,6 +813,7 @@ void agg_text_renderer<T>::render_halo(unsigned char *buffer,
                                        composite_mode_e comp_op)
 {
     int x, y;
+    mark_painted(x1, y1, width, height, std::max(1, static_cast<int>(halo_radius)));
     if (halo_radius < 1.0)
     {
         for (x=0; x < width; x++)
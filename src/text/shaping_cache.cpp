@@ -0,0 +1,64 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+
+// mapnik
+#include <mapnik/text/shaping_cache.hpp>
+
+namespace mapnik
+{
+
+shaping_cache::shaping_cache()
+    : cache_(16384) {}
+
+shaped_glyphs_ptr shaping_cache::find(shaping_cache_key const& key)
+{
+    return cache_.find(key);
+}
+
+void shaping_cache::insert(shaping_cache_key key, shaped_glyphs_ptr glyphs)
+{
+    cache_.insert(std::move(key), std::move(glyphs));
+}
+
+void shaping_cache::clear()
+{
+    cache_.clear();
+}
+
+void shaping_cache::set_capacity(std::size_t items)
+{
+    cache_.set_capacity(items);
+}
+
+std::size_t shaping_cache::capacity() const
+{
+    return cache_.capacity();
+}
+
+std::size_t shaping_cache::size() const
+{
+    return cache_.size();
+}
+
+}
@@ -31,6 +31,10 @@
 #include <mapnik/raster.hpp>
 #include <mapnik/proj_transform.hpp>
 
+// stl
+#include <thread>
+#include <vector>
+
 #pragma GCC diagnostic push
 #include <mapnik/warning_ignore_agg.hpp>
 #include "agg_image_filters.h"
@@ -50,11 +54,18 @@
 
 namespace mapnik {
 
+namespace {
+
+// Targets with fewer pixels are warped on the calling thread only
+constexpr std::size_t min_warp_pixels_per_thread = 128 * 1024;
+
+}
+
 template <typename T>
 MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const& prj_trans,
                  box2d<double> const& target_ext, box2d<double> const& source_ext,
                  double offset_x, double offset_y, unsigned mesh_size, scaling_method_e scaling_method, double filter_factor,
-                 boost::optional<double> const & nodata_value)
+                 boost::optional<double> const & nodata_value, unsigned concurrency)
 {
     using image_type = T;
     using pixel_type = typename image_type::pixel_type;
@@ -87,80 +98,122 @@ MAPNIK_DECL void warp_image (T & target, T const& source, proj_transform const&
         }
     }
     prj_trans.backward(xs.data(), ys.data(), nullptr, mesh_nx*mesh_ny);
+    for(std::size_t j = 0; j < mesh_ny; ++j)
+    {
+        for (std::size_t i=0; i<mesh_nx; ++i)
+        {
+            tt.forward(&xs(i,j), &ys(i,j));
+        }
+    }
+
+    agg::image_filter_lut filter;
+    if (scaling_method != SCALING_NEAR)
+    {
+        detail::set_scaling_method(filter, scaling_method, filter_factor);
+    }
+    boost::optional<typename detail::agg_scaling_traits<image_type>::span_image_resample_affine::value_type> nodata;
+    if (nodata_value)
+    {
+        nodata = nodata_value;
+    }
 
-    agg::rasterizer_scanline_aa<> rasterizer;
-    agg::scanline_bin scanline;
-    agg::rendering_buffer buf(target.bytes(),
-                              target.width(),
-                              target.height(),
-                              target.width() * pixel_size);
-    pixfmt_pre pixf(buf);
-    renderer_base rb(pixf);
-    rasterizer.clip_box(0, 0, target.width(), target.height());
-    agg::rendering_buffer buf_tile(
-        const_cast<unsigned char*>(source.bytes()),
-        source.width(),
-        source.height(),
-        source.width() * pixel_size);
-
-    pixfmt_pre pixf_tile(buf_tile);
-
-    using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
-    img_accessor_type ia(pixf_tile);
-
-    agg::span_allocator<color_type> sa;
-    // Project mesh cells into target interpolating raster inside each one
-    for (std::size_t j = 0; j < mesh_ny - 1; ++j)
+    // Renders the target rows [y_begin, y_end). Every band rasterizes the mesh
+    // cells reaching into it in the same order and only clips the spans, so
+    // pixels come out exactly as when the whole target is rendered at once.
+    auto render_rows = [&](int y_begin, int y_end)
     {
-        for (std::size_t i = 0; i < mesh_nx - 1; ++i)
+        agg::rasterizer_scanline_aa<> rasterizer;
+        agg::scanline_bin scanline;
+        agg::rendering_buffer buf(target.bytes(),
+                                  target.width(),
+                                  target.height(),
+                                  target.width() * pixel_size);
+        pixfmt_pre pixf(buf);
+        renderer_base rb(pixf);
+        rb.clip_box(0, y_begin, target.width() - 1, y_end - 1);
+        rasterizer.clip_box(0, 0, target.width(), target.height());
+        agg::rendering_buffer buf_tile(
+            const_cast<unsigned char*>(source.bytes()),
+            source.width(),
+            source.height(),
+            source.width() * pixel_size);
+
+        pixfmt_pre pixf_tile(buf_tile);
+
+        using img_accessor_type = agg::image_accessor_clone<pixfmt_pre>;
+        img_accessor_type ia(pixf_tile);
+
+        agg::span_allocator<color_type> sa;
+        // Project mesh cells into target interpolating raster inside each one
+        for (std::size_t j = 0; j < mesh_ny - 1; ++j)
         {
-            double polygon[8] = {xs(i,j), ys(i,j),
-                                 xs(i+1,j), ys(i+1,j),
-                                 xs(i+1,j+1), ys(i+1,j+1),
-                                 xs(i,j+1), ys(i,j+1)};
-            tt.forward(polygon+0, polygon+1);
-            tt.forward(polygon+2, polygon+3);
-            tt.forward(polygon+4, polygon+5);
-            tt.forward(polygon+6, polygon+7);
-
-            rasterizer.reset();
-            rasterizer.move_to_d(std::floor(polygon[0]), std::floor(polygon[1]));
-            rasterizer.line_to_d(std::floor(polygon[2]), std::floor(polygon[3]));
-            rasterizer.line_to_d(std::floor(polygon[4]), std::floor(polygon[5]));
-            rasterizer.line_to_d(std::floor(polygon[6]), std::floor(polygon[7]));
-
-            std::size_t x0 = i * mesh_size;
-            std::size_t y0 = j * mesh_size;
-            std::size_t x1 = (i+1) * mesh_size;
-            std::size_t y1 = (j+1) * mesh_size;
-            x1 = std::min(x1, source.width());
-            y1 = std::min(y1, source.height());
-            agg::trans_affine tr(polygon, x0, y0, x1, y1);
-            if (tr.is_valid())
+            for (std::size_t i = 0; i < mesh_nx - 1; ++i)
             {
-                interpolator_type interpolator(tr);
-                if (scaling_method == SCALING_NEAR)
-                {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
-                    span_gen_type sg(ia, interpolator);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
-                }
-                else
+                double polygon[8] = {std::floor(xs(i,j)), std::floor(ys(i,j)),
+                                     std::floor(xs(i+1,j)), std::floor(ys(i+1,j)),
+                                     std::floor(xs(i+1,j+1)), std::floor(ys(i+1,j+1)),
+                                     std::floor(xs(i,j+1)), std::floor(ys(i,j+1))};
+                double miny = std::min(std::min(polygon[1], polygon[3]), std::min(polygon[5], polygon[7]));
+                double maxy = std::max(std::max(polygon[1], polygon[3]), std::max(polygon[5], polygon[7]));
+                if (maxy < y_begin || miny >= y_end) continue;
+
+                rasterizer.reset();
+                rasterizer.move_to_d(polygon[0], polygon[1]);
+                rasterizer.line_to_d(polygon[2], polygon[3]);
+                rasterizer.line_to_d(polygon[4], polygon[5]);
+                rasterizer.line_to_d(polygon[6], polygon[7]);
+
+                std::size_t x0 = i * mesh_size;
+                std::size_t y0 = j * mesh_size;
+                std::size_t x1 = (i+1) * mesh_size;
+                std::size_t y1 = (j+1) * mesh_size;
+                x1 = std::min(x1, source.width());
+                y1 = std::min(y1, source.height());
+                double quad[8] = {xs(i,j), ys(i,j),
+                                  xs(i+1,j), ys(i+1,j),
+                                  xs(i+1,j+1), ys(i+1,j+1),
+                                  xs(i,j+1), ys(i,j+1)};
+                agg::trans_affine tr(quad, x0, y0, x1, y1);
+                if (tr.is_valid())
                 {
-                    using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
-                    agg::image_filter_lut filter;
-                    detail::set_scaling_method(filter, scaling_method, filter_factor);
-                    boost::optional<typename span_gen_type::value_type> nodata;
-                    if (nodata_value)
+                    interpolator_type interpolator(tr);
+                    if (scaling_method == SCALING_NEAR)
+                    {
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_filter;
+                        span_gen_type sg(ia, interpolator);
+                        agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
+                    }
+                    else
                     {
-                        nodata = nodata_value;
+                        using span_gen_type = typename detail::agg_scaling_traits<image_type>::span_image_resample_affine;
+                        span_gen_type sg(ia, interpolator, filter, nodata);
+                        agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
                     }
-                    span_gen_type sg(ia, interpolator, filter, nodata);
-                    agg::render_scanlines_bin(rasterizer, scanline, rb, sa, sg);
                 }
             }
-
         }
+    };
+
+    int height = static_cast<int>(target.height());
+    std::size_t bands = std::min(static_cast<std::size_t>(concurrency),
+                                 target.width() * target.height() / min_warp_pixels_per_thread);
+    bands = std::min(bands, target.height());
+    if (bands <= 1)
+    {
+        render_rows(0, height);
+        return;
+    }
+    int band = static_cast<int>((target.height() + bands - 1) / bands);
+    std::vector<std::thread> threads;
+    threads.reserve(bands - 1);
+    for (int start = band; start < height; start += band)
+    {
+        threads.emplace_back(render_rows, start, std::min(start + band, height));
+    }
+    render_rows(0, band);
+    for (std::thread & t : threads)
+    {
+        t.join();
     }
 }
 
@@ -238,16 +291,16 @@ void reproject_and_scale_raster(raster & target, raster const& source,
 
 
 template MAPNIK_DECL void warp_image (image_rgba8&, image_rgba8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray8&, image_gray8 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray16&, image_gray16 const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 template MAPNIK_DECL void warp_image (image_gray32f&, image_gray32f const&, proj_transform const&,
-                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &);
+                                      box2d<double> const&, box2d<double> const&, double, double, unsigned, scaling_method_e, double, boost::optional<double> const &, unsigned);
 
 
 }// namespace mapnik
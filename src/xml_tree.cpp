@@ -35,6 +35,7 @@
 #include <mapnik/raster_colorizer.hpp>
 #include <mapnik/expression.hpp>
 #include <mapnik/text/font_feature_settings.hpp>
+#include <mapnik/collision_index.hpp>
 
 // stl
 #include <type_traits>
@@ -436,6 +437,7 @@ compile_get_opt_attr(halo_rasterizer_e);
 compile_get_opt_attr(expression_ptr);
 compile_get_opt_attr(font_feature_settings);
 compile_get_opt_attr(pattern_lacing_mode_e);
+compile_get_opt_attr(collision_index_e);
 compile_get_attr(std::string);
 compile_get_attr(filter_mode_e);
 compile_get_attr(debug_symbolizer_mode_e);
@@ -0,0 +1,255 @@
+#include "catch.hpp"
+
+#include <mapnik/label_collision_detector.hpp>
+#include <mapnik/collision_cache.hpp>
+#include <mapnik/label_placements/base.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/symbolizer.hpp>
+
+#include <vector>
+
+namespace {
+
+void populate(mapnik::label_collision_detector4 & detector)
+{
+    for (int i = 0; i < 40; ++i)
+    {
+        double x = (i * 37) % 500;
+        double y = (i * 53) % 500;
+        detector.insert(mapnik::box2d<double>(x, y, x + 20 + i, y + 10));
+    }
+    // crosses cell boundaries and the extent
+    detector.insert(mapnik::box2d<double>(-20, 240, 540, 250), "river");
+}
+
+}
+
+TEST_CASE("collision detector") {
+
+SECTION("grid and quad-tree backends agree") {
+
+    mapnik::box2d<double> extent(-10, -10, 522, 522);
+    mapnik::label_collision_detector4 tree(extent, mapnik::COLLISION_INDEX_QUAD_TREE);
+    mapnik::label_collision_detector4 grid(extent, mapnik::COLLISION_INDEX_GRID);
+    populate(tree);
+    populate(grid);
+
+    for (double y = -30; y < 540; y += 7)
+    {
+        for (double x = -30; x < 540; x += 11)
+        {
+            mapnik::box2d<double> box(x, y, x + 5, y + 5);
+            CHECK(tree.has_placement(box) == grid.has_placement(box));
+            CHECK(tree.has_placement(box, 3.0) == grid.has_placement(box, 3.0));
+            CHECK(tree.has_placement(box, 1.0, "river", 30.0) == grid.has_placement(box, 1.0, "river", 30.0));
+        }
+    }
+
+    std::size_t tree_count = 0, grid_count = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) ++tree_count;
+    for (auto it = grid.begin(); it != grid.end(); ++it) ++grid_count;
+    CHECK(tree_count == 41);
+    CHECK(grid_count == 41);
+
+    grid.clear();
+    CHECK(grid.has_placement(mapnik::box2d<double>(0, 240, 10, 250)));
+}
+
+SECTION("batched placement") {
+
+    mapnik::label_collision_detector4 detector(mapnik::box2d<double>(0, 0, 256, 256),
+                                               mapnik::COLLISION_INDEX_GRID);
+    detector.insert(mapnik::box2d<double>(100, 100, 120, 120), "label");
+
+    std::vector<mapnik::box2d<double>> free_path = {
+        { 10, 10, 20, 20 }, { 20, 12, 30, 22 }, { 30, 14, 40, 24 } };
+    std::vector<mapnik::box2d<double>> blocked_path = {
+        { 80, 90, 90, 100 }, { 90, 95, 101, 105 }, { 110, 95, 120, 105 } };
+    std::vector<mapnik::box2d<double>> near_path = {
+        { 60, 100, 70, 110 }, { 70, 100, 80, 110 } };
+
+    CHECK(detector.has_placement(std::vector<mapnik::box2d<double>>(), 0.0));
+    CHECK(detector.has_placement(free_path, 0.0));
+    CHECK_FALSE(detector.has_placement(blocked_path, 0.0));
+    CHECK(detector.has_placement(near_path, 5.0));
+    CHECK_FALSE(detector.has_placement(near_path, 25.0));
+    CHECK_FALSE(detector.has_placement(near_path, 5.0, "label", 25.0));
+    CHECK(detector.has_placement(near_path, 5.0, "other", 25.0));
+
+    mapnik::keyed_collision_cache<mapnik::label_collision_detector4> cache(
+        detector.extent(), mapnik::COLLISION_INDEX_GRID);
+    mapnik::collision_cache_ids keys;
+    cache.insert(mapnik::box2d<double>(100, 100, 120, 120), keys);
+    CHECK(cache.has_placement(free_path, 0.0, keys));
+    CHECK_FALSE(cache.has_placement(blocked_path, 0.0, keys));
+}
+
+SECTION("interned collision cache keys") {
+
+    boost::optional<std::string> list(std::string("roads, pois"));
+    mapnik::collision_cache_ids const ids = mapnik::parse_collision_detector_keys(list);
+    REQUIRE(ids.size() == 2);
+    CHECK(mapnik::collision_cache_name(ids[0]) == "roads");
+    CHECK(mapnik::collision_cache_name(ids[1]) == "pois");
+    CHECK(mapnik::parse_collision_detector_keys(list) == ids);
+    CHECK(mapnik::collision_cache_intern("default") == mapnik::default_collision_cache_id);
+    CHECK(mapnik::parse_collision_detector_keys(boost::optional<std::string>()).empty());
+
+    mapnik::keyed_collision_cache<mapnik::label_collision_detector4> cache(
+        mapnik::box2d<double>(0, 0, 256, 256));
+    mapnik::box2d<double> box(10, 10, 20, 20);
+    mapnik::collision_cache_ids const roads = { ids[0] };
+    mapnik::collision_cache_ids const pois = { ids[1] };
+    cache.insert(box, roads);
+    CHECK_FALSE(cache.has_placement(box, ids));
+    CHECK(cache.has_placement(box, pois));
+    CHECK(cache.has_placement(box, mapnik::collision_cache_ids()));
+    CHECK(cache.keys().size() == 2);
+    CHECK_FALSE(cache.detector("roads").has_placement(box));
+
+    // constant lists of symbolizers are interned when the property is made
+    mapnik::collision_cache_list const constant("pois,roads");
+    CHECK(constant.str() == "pois,roads");
+    REQUIRE(constant.ids().size() == 2);
+    CHECK(constant.ids()[0] == ids[1]);
+    CHECK(constant.ids()[1] == ids[0]);
+    CHECK(constant == mapnik::collision_cache_list("pois,roads"));
+}
+
+SECTION("symbolizer collision cache keys") {
+
+    mapnik::keyed_collision_cache<mapnik::label_collision_detector4> cache(
+        mapnik::box2d<double>(0, 0, 256, 256));
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_impl feature(ctx, 1);
+    feature.put_new("layer", mapnik::value_unicode_string("water"));
+    mapnik::attributes vars;
+
+    mapnik::text_symbolizer sym;
+    CHECK(mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_insert, feature, vars).empty());
+    mapnik::put(sym, mapnik::keys::collision_cache_insert, mapnik::collision_cache_list("roads"));
+    mapnik::collision_cache_ids constant = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_insert, feature, vars);
+    REQUIRE(constant.size() == 1);
+    CHECK(mapnik::collision_cache_name(constant[0]) == "roads");
+    mapnik::put(sym, mapnik::keys::collision_cache_detect, mapnik::parse_expression("[layer]+',roads'"));
+    mapnik::collision_cache_ids dynamic = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_detect, feature, vars);
+    // "water" is not registered, nothing was inserted there
+    REQUIRE(dynamic.size() == 1);
+    CHECK(dynamic[0] == constant[0]);
+
+    // names of expressions are kept by the cache of the renderer
+    std::size_t registered = mapnik::collision_cache_count();
+    mapnik::put(sym, mapnik::keys::collision_cache_insert, mapnik::parse_expression("[layer]"));
+    mapnik::collision_cache_ids inserted = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_insert, feature, vars);
+    REQUIRE(inserted.size() == 1);
+    mapnik::box2d<double> box(10, 10, 20, 20);
+    cache.insert(box, inserted);
+    dynamic = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_detect, feature, vars);
+    REQUIRE(dynamic.size() == 2);
+    CHECK(dynamic[0] == inserted[0]);
+    CHECK_FALSE(cache.has_placement(box, dynamic));
+    CHECK_FALSE(cache.detector("water").has_placement(box));
+    CHECK(cache.has_placement(box, constant));
+    CHECK_FALSE(mapnik::collision_cache_find("water").is_initialized());
+    CHECK(mapnik::collision_cache_count() == registered);
+
+    // detecting against unknown names only does not use the default cache
+    cache.insert(box, mapnik::collision_cache_ids());
+    mapnik::put(sym, mapnik::keys::collision_cache_detect, mapnik::parse_expression("'nowhere'"));
+    CHECK(cache.has_placement(box, mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_detect, feature, vars)));
+}
+
+SECTION("collision cache names registered while rendering") {
+
+    mapnik::keyed_collision_cache<mapnik::label_collision_detector4> cache(
+        mapnik::box2d<double>(0, 0, 256, 256));
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_impl feature(ctx, 1);
+    feature.put_new("layer", mapnik::value_unicode_string("registered-late"));
+    mapnik::attributes vars;
+    mapnik::text_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::collision_cache_insert, mapnik::parse_expression("[layer]"));
+    mapnik::put(sym, mapnik::keys::collision_cache_detect, mapnik::parse_expression("[layer]"));
+
+    // nothing was inserted into the name yet
+    mapnik::box2d<double> first(10, 10, 20, 20);
+    CHECK(cache.has_placement(first, mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_detect, feature, vars)));
+    cache.insert(first, mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_insert, feature, vars));
+
+    // a symbolizer listing the name registers it
+    mapnik::text_symbolizer constant_sym;
+    mapnik::put(constant_sym, mapnik::keys::collision_cache_insert,
+                mapnik::collision_cache_list("registered-late"));
+    mapnik::collision_cache_ids constant = mapnik::label_placement::collision_cache_keys(
+        cache, constant_sym, mapnik::keys::collision_cache_insert, feature, vars);
+    REQUIRE(constant.size() == 1);
+    mapnik::box2d<double> second(100, 100, 120, 120);
+    cache.insert(second, constant);
+
+    // the expression now resolves to the registered cache as well
+    mapnik::collision_cache_ids inserted = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_insert, feature, vars);
+    CHECK(inserted == constant);
+    mapnik::collision_cache_ids detected = mapnik::label_placement::collision_cache_keys(
+        cache, sym, mapnik::keys::collision_cache_detect, feature, vars);
+    CHECK_FALSE(cache.has_placement(first, detected));
+    CHECK_FALSE(cache.has_placement(second, detected));
+    CHECK(cache.has_placement(mapnik::box2d<double>(200, 200, 210, 210), detected));
+}
+
+SECTION("expression collision cache keys are not registered") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("name");
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    for (int i = 0; i < 500; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+        feature->put("name", mapnik::value_unicode_string(("distinct-" + std::to_string(i)).c_str()));
+        feature->set_geometry(mapnik::geometry::point<double>((i * 7) % 256, (i * 13) % 256));
+        ds->push(feature);
+    }
+
+    mapnik::Map m(256, 256);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::collision_cache_insert, mapnik::parse_expression("[name]"));
+    mapnik::put(sym, mapnik::keys::collision_cache_detect, mapnik::parse_expression("[name]+',default'"));
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style("style", std::move(style));
+    mapnik::layer lyr("points");
+    lyr.set_datasource(ds);
+    lyr.add_style("style");
+    m.add_layer(lyr);
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+
+    std::size_t registered = mapnik::collision_cache_count();
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.apply();
+    CHECK(mapnik::collision_cache_count() == registered);
+    CHECK_FALSE(mapnik::collision_cache_find("distinct-1").is_initialized());
+}
+
+}
@@ -0,0 +1,180 @@
+#include "catch.hpp"
+
+#include <mapnik/feature_cache.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/util/fs.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/filesystem/operations.hpp>
+#pragma GCC diagnostic pop
+
+#include <fstream>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+namespace {
+
+void write_source(std::string const& filename, std::string const& content)
+{
+    std::ofstream out(filename.c_str(), std::ios::binary);
+    out << content;
+}
+
+mapnik::geometry::geometry<double> make_polygon()
+{
+    mapnik::geometry::polygon<double> poly;
+    poly.exterior_ring.add_coord(0, 0);
+    poly.exterior_ring.add_coord(10, 0);
+    poly.exterior_ring.add_coord(10, 10);
+    poly.exterior_ring.add_coord(0, 0);
+    mapnik::geometry::linear_ring<double> hole;
+    hole.add_coord(1, 1);
+    hole.add_coord(2, 1);
+    hole.add_coord(2, 2);
+    hole.add_coord(1, 1);
+    poly.add_hole(std::move(hole));
+    return mapnik::geometry::geometry<double>(std::move(poly));
+}
+
+}
+
+TEST_CASE("feature cache") {
+
+SECTION("features round trip through the cache file") {
+
+    std::string directory("/tmp/mapnik-tests/");
+    boost::filesystem::create_directories(directory);
+    std::string source = directory + "feature_cache_source.json";
+    write_source(source, "{}");
+    std::string filename = mapnik::feature_cache::filename(directory, source);
+    CHECK(filename == mapnik::feature_cache::filename(directory, source));
+
+    mapnik::feature_cache_writer writer;
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 7));
+        feature->set_geometry(make_polygon());
+        feature->put_new("name", mapnik::value_unicode_string("caf\xc3\xa9"));
+        feature->put_new("count", mapnik::value_integer(-42));
+        feature->put_new("ratio", 0.25);
+        feature->put_new("flag", true);
+        feature->put_new("none", mapnik::value_null());
+        writer.add(*feature);
+    }
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 8));
+        mapnik::geometry::geometry_collection<double> collection;
+        collection.emplace_back(mapnik::geometry::point<double>(3, 4));
+        mapnik::geometry::multi_line_string<double> lines;
+        lines.resize(2);
+        lines[0].add_coord(0, 0);
+        lines[0].add_coord(1, 1);
+        lines[1].add_coord(5, 5);
+        lines[1].add_coord(6, 7);
+        collection.emplace_back(std::move(lines));
+        feature->set_geometry(std::move(collection));
+        feature->put_new("other", mapnik::value_integer(1));
+        writer.add(*feature);
+    }
+    {
+        mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 9));
+        writer.add(*feature);
+    }
+    REQUIRE(writer.write(filename, source));
+
+    mapnik::feature_cache::ptr cache = mapnik::feature_cache::open(filename, source);
+    REQUIRE(cache);
+    REQUIRE(cache->size() == 3);
+    CHECK(cache->attribute_names().size() == 6);
+    CHECK(cache->id(0) == 7);
+    CHECK(cache->id(2) == 9);
+    CHECK(cache->envelope(0) == mapnik::box2d<double>(0, 0, 10, 10));
+    CHECK(cache->envelope(1) == mapnik::box2d<double>(0, 0, 6, 7));
+    CHECK(!cache->envelope(2).valid());
+
+    mapnik::context_ptr ctx = cache->make_context();
+    mapnik::feature_ptr first = cache->feature(0, ctx, cache->id(0));
+    REQUIRE(first->get_geometry().is<mapnik::geometry::polygon<double>>());
+    auto const& poly = mapnik::util::get<mapnik::geometry::polygon<double>>(first->get_geometry());
+    CHECK(poly.exterior_ring.size() == 4);
+    REQUIRE(poly.interior_rings.size() == 1);
+    CHECK(poly.interior_rings[0][2].x == 2);
+    CHECK(first->get("name") == mapnik::value_unicode_string("caf\xc3\xa9"));
+    CHECK(first->get("count") == mapnik::value_integer(-42));
+    CHECK(first->get("ratio") == 0.25);
+    CHECK(first->get("flag") == true);
+    CHECK(first->get("none").is_null());
+    CHECK(first->get("other").is_null());
+
+    mapnik::feature_ptr second = cache->feature(1, ctx, cache->id(1));
+    REQUIRE(second->get_geometry().is<mapnik::geometry::geometry_collection<double>>());
+    auto const& collection = mapnik::util::get<mapnik::geometry::geometry_collection<double>>(second->get_geometry());
+    REQUIRE(collection.size() == 2);
+    CHECK(collection[0].is<mapnik::geometry::point<double>>());
+    CHECK(collection[1].is<mapnik::geometry::multi_line_string<double>>());
+    CHECK(second->get("other") == mapnik::value_integer(1));
+    CHECK(second->get("name").is_null());
+    std::size_t other = 0;
+    while (cache->attribute_names()[other] != "other") ++other;
+    CHECK(cache->has_attribute(1, other));
+    CHECK(!cache->has_attribute(0, other));
+
+    mapnik::feature_ptr third = cache->feature(2, ctx, cache->id(2));
+    CHECK(third->get_geometry().is<mapnik::geometry::geometry_empty>());
+
+    mapnik::feature_cache_featureset fs(cache, std::vector<std::size_t>{2, 0}, 1);
+    mapnik::feature_ptr f = fs.next();
+    REQUIRE(f);
+    CHECK(f->id() == 1);
+    f = fs.next();
+    REQUIRE(f);
+    CHECK(f->id() == 2);
+    CHECK(f->get("count") == mapnik::value_integer(-42));
+    CHECK(!fs.next());
+
+    // a changed source invalidates the cache
+    write_source(source, "{ }");
+    CHECK(!mapnik::feature_cache::open(filename, source));
+    CHECK(!mapnik::feature_cache::open(directory + "missing.features", source));
+
+    mapnik::util::remove(filename);
+    mapnik::util::remove(source);
+}
+
+#ifndef _WINDOWS
+SECTION("a source rewritten within the same second invalidates the cache") {
+
+    std::string directory("/tmp/mapnik-tests/");
+    boost::filesystem::create_directories(directory);
+    std::string source = directory + "feature_cache_same_second.json";
+    std::string filename = mapnik::feature_cache::filename(directory, source);
+    struct timespec times[2] = { { 1500000000, 0 }, { 1500000000, 0 } };
+    write_source(source, "{}");
+    REQUIRE(::utimensat(AT_FDCWD, source.c_str(), times, 0) == 0);
+
+    mapnik::feature_cache_writer writer;
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    writer.add(*mapnik::feature_factory::create(ctx, 1));
+    REQUIRE(writer.write(filename, source));
+    REQUIRE(mapnik::feature_cache::open(filename, source));
+
+    // same size, half a second later
+    write_source(source, "[]");
+    times[0].tv_nsec = times[1].tv_nsec = 500000000;
+    REQUIRE(::utimensat(AT_FDCWD, source.c_str(), times, 0) == 0);
+    CHECK(!mapnik::feature_cache::open(filename, source));
+
+    mapnik::util::remove(filename);
+    mapnik::util::remove(source);
+}
+#endif
+
+}
@@ -0,0 +1,67 @@
+#include "catch.hpp"
+
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/value.hpp>
+
+namespace {
+
+struct counting_source : mapnik::feature_attribute_source
+{
+    mutable std::size_t decoded = 0;
+
+    void decode(std::size_t index, mapnik::value & val) const
+    {
+        ++decoded;
+        if (index == 0) val = mapnik::value_integer(42);
+        else if (index == 1) val = mapnik::value_unicode_string("lazy");
+        // index 2 has no value
+    }
+};
+
+}
+
+TEST_CASE("feature") {
+
+SECTION("attributes are decoded on first access") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("number");
+    ctx->push("name");
+    ctx->push("missing");
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    auto source = std::make_shared<counting_source>();
+    feature->set_attribute_source(source);
+    CHECK(source->decoded == 0);
+
+    CHECK(feature->get("number") == mapnik::value_integer(42));
+    CHECK(feature->get("number") == mapnik::value_integer(42));
+    CHECK(source->decoded == 1);
+
+    feature->put("name", mapnik::value_integer(7));
+    CHECK(feature->get("name") == mapnik::value_integer(7));
+    CHECK(source->decoded == 1);
+
+    CHECK(feature->get("missing").is_null());
+    CHECK(source->decoded == 2);
+
+    auto const& data = feature->get_data();
+    CHECK(data.size() == 3);
+    CHECK(source->decoded == 2);
+}
+
+SECTION("get_data decodes pending attributes") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    ctx->push("number");
+    ctx->push("name");
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    auto source = std::make_shared<counting_source>();
+    feature->set_attribute_source(source);
+    auto const& data = feature->get_data();
+    CHECK(source->decoded == 2);
+    CHECK(data[0] == mapnik::value_integer(42));
+    CHECK(data[1] == mapnik::value_unicode_string("lazy"));
+}
+
+}
@@ -0,0 +1,246 @@
+#include "catch.hpp"
+
+#include <mapnik/util/featureset_prefetch.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/expression.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+// features alive at once, to check that nothing reads a whole layer ahead
+struct feature_counter
+{
+    std::atomic<std::size_t> live{0};
+    std::atomic<std::size_t> max_live{0};
+    std::atomic<std::size_t> produced{0};
+};
+
+// Featureset making its features on demand, like a cursor of
+// a database or a file being read. Features have a fill colour,
+// which is not a colour for the feature at `bad_fill_at`.
+class streaming_featureset : public mapnik::Featureset
+{
+public:
+    streaming_featureset(std::size_t size, feature_counter & counter, std::size_t throw_at = 0,
+                         std::size_t bad_fill_at = 0)
+        : ctx_(std::make_shared<mapnik::context_type>()),
+          size_(size),
+          next_(0),
+          throw_at_(throw_at),
+          bad_fill_at_(bad_fill_at),
+          counter_(counter)
+    {
+        ctx_->push("fill");
+    }
+
+    mapnik::feature_ptr next()
+    {
+        if (next_ == size_) return mapnik::feature_ptr();
+        if (throw_at_ > 0 && next_ == throw_at_) throw std::runtime_error("read failed");
+        std::size_t id = ++next_;
+        std::size_t live = ++counter_.live;
+        ++counter_.produced;
+        std::size_t max_live = counter_.max_live;
+        while (live > max_live && !counter_.max_live.compare_exchange_weak(max_live, live)) {}
+        feature_counter & counter = counter_;
+        mapnik::feature_ptr feature(new mapnik::feature_impl(ctx_, id),
+                                    [&counter](mapnik::feature_impl * f) { --counter.live; delete f; });
+        double x = (id * 37) % 250;
+        double y = (id * 53) % 250;
+        mapnik::geometry::linear_ring<double> ring;
+        ring.emplace_back(x, y);
+        ring.emplace_back(x + 20, y);
+        ring.emplace_back(x + 20, y + 20);
+        ring.emplace_back(x, y + 20);
+        ring.emplace_back(x, y);
+        mapnik::geometry::polygon<double> poly;
+        poly.set_exterior_ring(std::move(ring));
+        feature->set_geometry(std::move(poly));
+        feature->put("fill", mapnik::value_unicode_string(id == bad_fill_at_ ? "bogus" : "rgba(200,0,0,0.4)"));
+        return feature;
+    }
+
+private:
+    mapnik::context_ptr ctx_;
+    std::size_t size_;
+    std::size_t next_;
+    std::size_t throw_at_;
+    std::size_t bad_fill_at_;
+    feature_counter & counter_;
+};
+
+class streaming_datasource : public mapnik::datasource
+{
+public:
+    streaming_datasource(std::size_t size, feature_counter & counter, std::size_t bad_fill_at = 0)
+        : mapnik::datasource(mapnik::parameters()),
+          size_(size),
+          bad_fill_at_(bad_fill_at),
+          counter_(counter) {}
+
+    datasource_t type() const { return datasource::Vector; }
+    boost::optional<mapnik::datasource_geometry_t> get_geometry_type() const
+    {
+        return mapnik::datasource_geometry_t::Polygon;
+    }
+    mapnik::featureset_ptr features(mapnik::query const&) const
+    {
+        return std::make_shared<streaming_featureset>(size_, counter_, 0, bad_fill_at_);
+    }
+    mapnik::featureset_ptr features_at_point(mapnik::coord2d const&, double) const
+    {
+        return mapnik::featureset_ptr();
+    }
+    mapnik::box2d<double> envelope() const { return mapnik::box2d<double>(0, 0, 270, 270); }
+    mapnik::layer_descriptor get_descriptor() const { return mapnik::layer_descriptor("streaming", "utf-8"); }
+
+private:
+    std::size_t size_;
+    std::size_t bad_fill_at_;
+    feature_counter & counter_;
+};
+
+mapnik::image_rgba8 render(mapnik::Map const& m, unsigned prefetch_concurrency)
+{
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.set_prefetch_concurrency(prefetch_concurrency);
+    ren.apply();
+    return im;
+}
+
+}
+
+TEST_CASE("featureset prefetch") {
+
+SECTION("featuresets are read in order with a bounded buffer") {
+
+    feature_counter counter;
+    std::vector<mapnik::featureset_ptr> featuresets;
+    {
+        mapnik::featureset_prefetcher prefetcher(1, 8);
+        for (int i = 0; i < 3; ++i)
+        {
+            featuresets.push_back(prefetcher.add(std::make_shared<streaming_featureset>(500, counter)));
+        }
+        prefetcher.start();
+        std::size_t count = 0;
+        for (auto const& fs : featuresets)
+        {
+            for (mapnik::feature_ptr f = fs->next(); f; f = fs->next())
+            {
+                ++count;
+            }
+        }
+        CHECK(count == 1500);
+    }
+#ifdef MAPNIK_THREADSAFE
+    // the buffers of the featureset being read and of the one being
+    // filled, one more held by the blocked reader and one by the consumer
+    CHECK(counter.max_live <= 2 * 8 + 2);
+#endif
+    CHECK(counter.live == 0);
+}
+
+SECTION("unread featuresets do not block the prefetcher") {
+
+    feature_counter counter;
+    {
+        mapnik::featureset_prefetcher prefetcher(2, 4);
+        auto fs = prefetcher.add(std::make_shared<streaming_featureset>(1000, counter));
+        prefetcher.add(std::make_shared<streaming_featureset>(1000, counter));
+        prefetcher.start();
+        CHECK(fs->next() != nullptr);
+    }
+    CHECK(counter.produced < 2000);
+}
+
+SECTION("errors are raised by the reading featureset") {
+
+    feature_counter counter;
+    mapnik::featureset_prefetcher prefetcher(1, 4);
+    auto fs = prefetcher.add(std::make_shared<streaming_featureset>(100, counter, 20));
+    prefetcher.start();
+    std::size_t count = 0;
+    auto read_all = [&]() { while (fs->next()) ++count; };
+    CHECK_THROWS(read_all());
+    CHECK(count == 20);
+}
+
+SECTION("streaming layers are rendered without reading them ahead") {
+
+    feature_counter counter;
+    mapnik::Map m(256, 256);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::polygon_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::fill, mapnik::color(200, 0, 0, 100));
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style("style", std::move(style));
+    for (int i = 0; i < 3; ++i)
+    {
+        mapnik::layer lyr("layer" + std::to_string(i));
+        lyr.set_datasource(std::make_shared<streaming_datasource>(5000, counter));
+        lyr.add_style("style");
+        m.add_layer(lyr);
+    }
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 270, 270));
+
+    mapnik::image_rgba8 serial = render(m, 0);
+    counter.max_live = 0;
+    mapnik::image_rgba8 prefetched = render(m, 2);
+    CHECK(mapnik::compare(serial, prefetched, 0, true) == 0);
+#ifdef MAPNIK_THREADSAFE
+    // the default buffers of the layer being rendered and of the two
+    // layers being read at once, each with one more held by its reader
+    CHECK(counter.max_live <= 3 * 257 + 1);
+#endif
+    CHECK(counter.live == 0);
+}
+
+SECTION("errors rendering a layer free detached layers waiting for features") {
+
+    // the only prefetching thread is blocked on the full buffer of the first
+    // layer, while the second layer is rendered on a worker thread
+    feature_counter counter;
+    mapnik::Map m(256, 256);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::polygon_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::fill, mapnik::parse_expression("[fill]"));
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style("style", std::move(style));
+    mapnik::layer first("first");
+    first.set_datasource(std::make_shared<streaming_datasource>(5000, counter, 20));
+    first.add_style("style");
+    m.add_layer(first);
+    mapnik::layer second("second");
+    second.set_datasource(std::make_shared<streaming_datasource>(5000, counter));
+    second.add_style("style");
+    second.set_comp_op(mapnik::multiply);
+    m.add_layer(second);
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 270, 270));
+
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.set_prefetch_concurrency(1);
+    ren.set_layer_concurrency(2);
+    CHECK_THROWS(ren.apply());
+    CHECK(counter.live == 0);
+}
+
+}
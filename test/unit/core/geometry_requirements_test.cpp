@@ -0,0 +1,118 @@
+#include "catch.hpp"
+
+#include <mapnik/attribute_collector.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/symbolizer.hpp>
+
+#include <set>
+#include <string>
+
+namespace {
+
+mapnik::geometry_requirements collect(std::initializer_list<mapnik::rule> rules)
+{
+    std::set<std::string> names;
+    mapnik::attribute_collector collector(names);
+    for (auto const& r : rules)
+    {
+        collector(r);
+    }
+    return collector.get_geometry_requirements();
+}
+
+mapnik::rule make_rule(mapnik::symbolizer const& sym)
+{
+    mapnik::rule r;
+    r.append(mapnik::symbolizer(sym));
+    return r;
+}
+
+}
+
+TEST_CASE("geometry requirements") {
+
+SECTION("no symbolizers") {
+    mapnik::geometry_requirements req = collect({});
+    CHECK(!req.points);
+    CHECK(!req.clip);
+    CHECK(req.tolerance == 0.0);
+}
+
+SECTION("point placements") {
+    mapnik::point_symbolizer point;
+    mapnik::markers_symbolizer markers;
+    mapnik::geometry_requirements req = collect({ make_rule(point), make_rule(markers) });
+    CHECK(req.points);
+    CHECK(!req.clip);
+
+    mapnik::markers_symbolizer line_markers;
+    mapnik::put(line_markers, mapnik::keys::label_placement, mapnik::LINE_PLACEMENT);
+    CHECK(!collect({ make_rule(point), make_rule(line_markers) }).points);
+
+    mapnik::markers_symbolizer largest;
+    mapnik::put(largest, mapnik::keys::multipolicy, mapnik::LARGEST_MULTI);
+    CHECK(!collect({ make_rule(largest) }).points);
+
+    mapnik::rule by_type = make_rule(point);
+    by_type.set_filter(mapnik::parse_expression("[mapnik::geometry_type] = polygon"));
+    CHECK(!collect({ by_type }).points);
+
+    mapnik::text_symbolizer text;
+    CHECK(!collect({ make_rule(point), make_rule(text) }).points);
+}
+
+SECTION("clipping and simplification") {
+    mapnik::polygon_symbolizer poly;
+    mapnik::put(poly, mapnik::keys::clip, true);
+    mapnik::put(poly, mapnik::keys::simplify_tolerance, 2.0);
+    mapnik::put(poly, mapnik::keys::simplify_algorithm, mapnik::douglas_peucker);
+    mapnik::line_symbolizer line;
+    mapnik::put(line, mapnik::keys::clip, true);
+    mapnik::put(line, mapnik::keys::simplify_tolerance, 1.0);
+    mapnik::put(line, mapnik::keys::simplify_algorithm, mapnik::douglas_peucker);
+    mapnik::geometry_requirements req = collect({ make_rule(poly), make_rule(line) });
+    CHECK(!req.points);
+    CHECK(req.clip);
+    CHECK(req.tolerance == 1.0);
+
+    // a point symbolizer does not care about simplification, but does about clipping
+    mapnik::point_symbolizer point;
+    req = collect({ make_rule(poly), make_rule(point) });
+    CHECK(!req.points);
+    CHECK(!req.clip);
+    CHECK(req.tolerance == 2.0);
+
+    mapnik::line_symbolizer dashed(line);
+    mapnik::dash_array dashes;
+    dashes.emplace_back(2.0, 2.0);
+    mapnik::put(dashed, mapnik::keys::stroke_dasharray, dashes);
+    CHECK(!collect({ make_rule(dashed) }).clip);
+
+    mapnik::line_symbolizer unclipped;
+    req = collect({ make_rule(poly), make_rule(unclipped) });
+    CHECK(!req.clip);
+    CHECK(req.tolerance == 0.0);
+
+    mapnik::line_symbolizer by_expression(line);
+    mapnik::put(by_expression, mapnik::keys::simplify_tolerance, mapnik::parse_expression("[tolerance]"));
+    CHECK(collect({ make_rule(by_expression) }).tolerance == 0.0);
+
+    // only Douglas-Peucker simplification is left to the datasource
+    mapnik::line_symbolizer radial(line);
+    mapnik::put(radial, mapnik::keys::simplify_algorithm, mapnik::radial_distance);
+    req = collect({ make_rule(poly), make_rule(radial) });
+    CHECK(req.clip);
+    CHECK(req.tolerance == 0.0);
+
+    mapnik::line_symbolizer by_default;
+    mapnik::put(by_default, mapnik::keys::simplify_tolerance, 1.0);
+    CHECK(collect({ make_rule(by_default) }).tolerance == 0.0);
+
+    mapnik::raster_symbolizer raster;
+    req = collect({ make_rule(poly), make_rule(raster) });
+    CHECK(!req.clip);
+    CHECK(req.tolerance == 0.0);
+}
+
+}
@@ -1065,6 +1065,38 @@ TEST_CASE("csv") {
             auto feat = fs->next();
             CHECK(feature_count(feat->get_geometry()) == 1);
         } // END SECTION
+
+        SECTION("rows parsed concurrently") {
+            std::ostringstream csv;
+            csv << "x,y,label\n";
+            for (int i = 0; i < 5000; ++i)
+            {
+                if (i % 97 == 0) csv << "\n"; // blank line
+                else if (i % 89 == 0) csv << "bad,0,\"bad\"\n"; // invalid geometry
+                else csv << i % 360 - 180 << "," << i % 170 - 85 << ",\"label\n" << i << "\"\n";
+            }
+            auto read = [&csv](unsigned concurrency)
+            {
+                mapnik::parameters params;
+                params["type"] = std::string("csv");
+                params["inline"] = csv.str();
+                params["concurrency"] = mapnik::value_integer(concurrency);
+                auto ds = mapnik::datasource_cache::instance().create(params);
+                REQUIRE(bool(ds));
+                std::vector<std::string> rows;
+                auto fs = all_features(ds);
+                for (auto feat = fs->next(); feat; feat = fs->next())
+                {
+                    rows.push_back(feat->to_string() + feat->envelope().to_string());
+                }
+                return std::make_pair(ds->envelope(), rows);
+            };
+            auto serial = read(1);
+            auto parallel = read(4);
+            CHECK(serial.second.size() == 5000 - 52 - 56);
+            CHECK(serial.first == parallel.first);
+            CHECK(serial.second == parallel.second);
+        } // END SECTION
         mapnik::logger::instance().set_severity(severity);
     }
 } // END TEST CASE
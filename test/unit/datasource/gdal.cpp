@@ -0,0 +1,257 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/util/fs.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/filesystem/operations.hpp>
+#pragma GCC diagnostic pop
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string const directory("/tmp/mapnik-tests/gdal/");
+
+// Little endian TIFF, written by hand so the test does not need GDAL
+// to make its fixture
+class tiff_writer
+{
+public:
+    struct image
+    {
+        std::uint32_t size;
+        std::uint8_t value;
+        bool overview;
+    };
+
+    // One 8 bit grey band of `size` x `size` pixels in map units from
+    // 0,0 to `size`,`size`, with each following image stored as its
+    // overview. All pixels of an image have the image's value.
+    void write(std::string const& path, std::vector<image> const& images)
+    {
+        data_.clear();
+        data_.append("II", 2);
+        u16(42);
+        std::size_t next_ifd = data_.size();
+        u32(0);
+        double const size = images.front().size;
+        for (image const& img : images)
+        {
+            std::uint32_t pixels_offset = static_cast<std::uint32_t>(data_.size());
+            data_.append(img.size * img.size, static_cast<char>(img.value));
+            std::uint32_t scale_offset = 0;
+            std::uint32_t tiepoint_offset = 0;
+            if (!img.overview)
+            {
+                scale_offset = f64({ 1.0, 1.0, 0.0 });
+                tiepoint_offset = f64({ 0.0, 0.0, 0.0, 0.0, size, 0.0 });
+            }
+            align();
+            patch(next_ifd, static_cast<std::uint32_t>(data_.size()));
+            std::vector<std::vector<std::uint32_t>> tags = {
+                { 254, 4, 1, img.overview ? 1u : 0u }, // NewSubfileType, reduced resolution
+                { 256, 4, 1, img.size },               // ImageWidth
+                { 257, 4, 1, img.size },               // ImageLength
+                { 258, 3, 1, 8 },                      // BitsPerSample
+                { 259, 3, 1, 1 },                      // Compression, none
+                { 262, 3, 1, 1 },                      // PhotometricInterpretation, black is zero
+                { 273, 4, 1, pixels_offset },          // StripOffsets
+                { 277, 3, 1, 1 },                      // SamplesPerPixel
+                { 278, 4, 1, img.size },               // RowsPerStrip
+                { 279, 4, 1, img.size * img.size },    // StripByteCounts
+                { 284, 3, 1, 1 } };                    // PlanarConfiguration
+            if (!img.overview)
+            {
+                tags.push_back({ 33550, 12, 3, scale_offset });    // ModelPixelScale
+                tags.push_back({ 33922, 12, 6, tiepoint_offset }); // ModelTiepoint
+            }
+            u16(static_cast<std::uint16_t>(tags.size()));
+            for (auto const& tag : tags)
+            {
+                u16(static_cast<std::uint16_t>(tag[0]));
+                u16(static_cast<std::uint16_t>(tag[1]));
+                u32(tag[2]);
+                if (tag[1] == 3)
+                {
+                    u16(static_cast<std::uint16_t>(tag[3]));
+                    u16(0);
+                }
+                else
+                {
+                    u32(tag[3]);
+                }
+            }
+            next_ifd = data_.size();
+            u32(0);
+        }
+        std::ofstream file(path, std::ios::binary);
+        file.write(data_.data(), data_.size());
+    }
+
+private:
+    void u16(std::uint16_t v)
+    {
+        char bytes[2] = { static_cast<char>(v & 0xff), static_cast<char>(v >> 8) };
+        data_.append(bytes, 2);
+    }
+
+    void u32(std::uint32_t v)
+    {
+        u16(static_cast<std::uint16_t>(v & 0xffff));
+        u16(static_cast<std::uint16_t>(v >> 16));
+    }
+
+    std::uint32_t f64(std::vector<double> const& values)
+    {
+        align();
+        std::uint32_t offset = static_cast<std::uint32_t>(data_.size());
+        for (double v : values)
+        {
+            std::uint64_t bits;
+            std::memcpy(&bits, &v, sizeof(bits));
+            u32(static_cast<std::uint32_t>(bits & 0xffffffff));
+            u32(static_cast<std::uint32_t>(bits >> 32));
+        }
+        return offset;
+    }
+
+    void align()
+    {
+        if (data_.size() % 2) data_.push_back('\0');
+    }
+
+    void patch(std::size_t pos, std::uint32_t v)
+    {
+        for (int i = 0; i < 4; ++i)
+        {
+            data_[pos + i] = static_cast<char>((v >> (8 * i)) & 0xff);
+        }
+    }
+
+    std::string data_;
+};
+
+mapnik::datasource_ptr make_datasource(std::string const& file, bool use_overviews, int block_cache_size)
+{
+    mapnik::parameters params;
+    params["type"] = "gdal";
+    params["file"] = file;
+    params["band"] = mapnik::value_integer(1);
+    params["use_overviews"] = use_overviews;
+    params["block_cache_size"] = mapnik::value_integer(block_cache_size);
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+    return ds;
+}
+
+// the raster of a query of the whole extent at `resolution` pixels per unit
+mapnik::image_gray8 read(mapnik::datasource_ptr const& ds, double resolution)
+{
+    mapnik::query q(ds->envelope(), mapnik::query::resolution_type(resolution, resolution));
+    auto features = ds->features(q);
+    mapnik::feature_ptr feature = features->next();
+    REQUIRE(feature);
+    mapnik::raster_ptr const& raster = feature->get_raster();
+    REQUIRE(raster);
+    CHECK(raster->ext_ == ds->envelope());
+    REQUIRE(raster->data_.is<mapnik::image_gray8>());
+    return mapnik::util::get<mapnik::image_gray8>(raster->data_);
+}
+
+bool filled_with(mapnik::image_gray8 const& image, std::uint8_t value)
+{
+    for (std::size_t y = 0; y < image.height(); ++y)
+    {
+        for (std::size_t x = 0; x < image.width(); ++x)
+        {
+            if (image(x, y) != value) return false;
+        }
+    }
+    return true;
+}
+
+}
+
+TEST_CASE("gdal") {
+
+    std::string gdal_plugin("./plugins/input/gdal.input");
+    if (mapnik::util::exists(gdal_plugin))
+    {
+        boost::filesystem::create_directories(directory);
+        std::string const file = directory + "overviews.tif";
+        // overviews with values of their own, to tell which one was read
+        tiff_writer().write(file, { { 512, 50, false }, { 256, 100, true }, { 128, 200, true } });
+
+        SECTION("overviews are read only if asked for")
+        {
+            auto ds = make_datasource(file, false, 0);
+            CHECK(ds->envelope() == mapnik::box2d<double>(0, 0, 512, 512));
+            mapnik::image_gray8 full = read(ds, 1.0);
+            CHECK(full.width() == 512);
+            CHECK(filled_with(full, 50));
+
+            auto ds_overviews = make_datasource(file, true, 0);
+            mapnik::image_gray8 same = read(ds_overviews, 1.0);
+            CHECK(same.width() == 512);
+            CHECK(filled_with(same, 50));
+            mapnik::image_gray8 half = read(ds_overviews, 0.5);
+            CHECK(half.width() == 256);
+            CHECK(filled_with(half, 100));
+            // the coarsest overview that still has a pixel per output pixel
+            mapnik::image_gray8 third = read(ds_overviews, 0.3);
+            CHECK(third.width() == 256);
+            CHECK(filled_with(third, 100));
+            mapnik::image_gray8 quarter = read(ds_overviews, 0.25);
+            CHECK(quarter.width() == 128);
+            CHECK(filled_with(quarter, 200));
+        }
+
+        SECTION("the block cache gives what direct reads give")
+        {
+            auto direct = make_datasource(file, true, 0);
+            auto cached = make_datasource(file, true, 1024 * 1024);
+            for (double resolution : { 1.0, 0.5, 0.25, 0.5, 1.0 })
+            {
+                INFO("resolution " << resolution);
+                mapnik::image_gray8 expected = read(direct, resolution);
+                mapnik::image_gray8 image = read(cached, resolution);
+                REQUIRE(image.width() == expected.width());
+                REQUIRE(image.height() == expected.height());
+                CHECK(std::memcmp(image.data(), expected.data(), image.size()) == 0);
+            }
+        }
+
+        boost::filesystem::remove_all(directory);
+    }
+}
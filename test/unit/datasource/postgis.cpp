@@ -228,6 +228,41 @@ TEST_CASE("postgis") {
             REQUIRE(false == feature->get("col+bool").to_bool());
         }
 
+        SECTION("Postgis layers pipeline asynchronous queries")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "test";
+            params["max_async_connection"] = "2";
+            params["pipelining"] = "true";
+            auto ds1 = mapnik::datasource_cache::instance().create(params);
+            params["table"] = "(SELECT * FROM test LIMIT 3) as data";
+            auto ds2 = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds1 != nullptr);
+            REQUIRE(ds2 != nullptr);
+
+            // more queries than connections, read back out of order
+            mapnik::feature_style_context_map ctx_map;
+            mapnik::processor_context_ptr ctx = ds1->get_context(ctx_map);
+            REQUIRE(ctx == ds2->get_context(ctx_map));
+            mapnik::query q1(ds1->envelope());
+            mapnik::query q2(ds2->envelope());
+            std::size_t const count1 = count_features(ds1->features(q1));
+            std::size_t const count2 = count_features(ds2->features(q2));
+            CHECK(count1 > count2);
+            std::vector<mapnik::featureset_ptr> featuresets;
+            for (std::size_t i = 0; i < 3; ++i)
+            {
+                featuresets.push_back(ds1->features_with_context(q1, ctx));
+                featuresets.push_back(ds2->features_with_context(q2, ctx));
+            }
+            featuresets[3].reset();
+            CHECK(count_features(featuresets[5]) == count2);
+            CHECK(count_features(featuresets[0]) == count1);
+            CHECK(count_features(featuresets[4]) == count1);
+            CHECK(count_features(featuresets[1]) == count2);
+            CHECK(count_features(featuresets[2]) == count1);
+        }
+
         SECTION("Postgis cursorresultest")
         {
             mapnik::parameters params(base_params);
@@ -255,6 +290,56 @@ TEST_CASE("postgis") {
             require_geometry(featureset->next(), 3, mapnik::geometry::geometry_types::GeometryCollection);
         }
 
+        SECTION("Postgis should throw with unknown geometry_format")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "test";
+            params["geometry_format"] = "geojson";
+            REQUIRE_THROWS(mapnik::datasource_cache::instance().create(params));
+        }
+
+        SECTION("Postgis twkb geometry_format")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "(SELECT * FROM test) as data";
+            params["geometry_format"] = "twkb";
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            auto featureset = all_features(ds);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::Point);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::Point);
+            require_geometry(featureset->next(), 2, mapnik::geometry::geometry_types::MultiPoint);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::LineString);
+            require_geometry(featureset->next(), 2, mapnik::geometry::geometry_types::MultiLineString);
+            require_geometry(featureset->next(), 1, mapnik::geometry::geometry_types::Polygon);
+            require_geometry(featureset->next(), 2, mapnik::geometry::geometry_types::MultiPolygon);
+            require_geometry(featureset->next(), 3, mapnik::geometry::geometry_types::GeometryCollection);
+
+            // features_at_point always requests WKB
+            featureset = ds->features_at_point(mapnik::coord2d(1, 1));
+            mapnik::feature_ptr feature;
+            while ((bool(feature = featureset->next()))) {
+                CHECK(!feature->get_geometry().is<mapnik::geometry::geometry_empty>());
+            }
+        }
+
+        SECTION("Postgis twkb geometry_format at extreme pixel sizes")
+        {
+            mapnik::parameters params(base_params);
+            params["table"] = "(SELECT * FROM test) as data";
+            params["geometry_format"] = "twkb";
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+            // ST_AsTWKB rejects more than 7 decimals either way
+            for (double resolution : { 1e12, 1e-12 })
+            {
+                mapnik::query q(ds->envelope(), mapnik::query::resolution_type(resolution, resolution));
+                auto featureset = ds->features(q);
+                REQUIRE(featureset != nullptr);
+                CHECK(count_features(featureset) == 8);
+            }
+        }
+
         SECTION("Postgis bbox query")
         {
             mapnik::parameters params(base_params);
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/raster.hpp>
+#include <mapnik/util/fs.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+#pragma GCC diagnostic pop
+
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string const directory("/tmp/mapnik-tests/raster-pyramid/");
+
+// path of tile `x`, `tms_y` of level `z`, as interpolated from the pattern
+// directory + "${z}/${x}_${y}.png"
+std::string tile_path(int z, int x, int tms_y)
+{
+    return (boost::format("%s%d/%03d/%03d/%03d_%03d/%03d/%03d.png") % directory % z
+            % (x / 1000000) % ((x / 1000) % 1000) % (x % 1000)
+            % (tms_y / 1000000) % ((tms_y / 1000) % 1000) % (tms_y % 1000)).str();
+}
+
+void write_tile(std::string const& path, std::uint32_t color)
+{
+    boost::filesystem::create_directories(boost::filesystem::path(path).parent_path());
+    mapnik::image_rgba8 tile(4, 4);
+    tile.set(color);
+    mapnik::save_to_file(tile, path, "png");
+}
+
+std::vector<std::uint32_t> colors(mapnik::datasource_ptr const& ds, double resolution)
+{
+    mapnik::query q(ds->envelope(), mapnik::query::resolution_type(resolution, resolution));
+    std::vector<std::uint32_t> result;
+    auto features = ds->features(q);
+    for (mapnik::feature_ptr feature = features->next(); feature; feature = features->next())
+    {
+        mapnik::raster_ptr const& raster = feature->get_raster();
+        REQUIRE(raster);
+        REQUIRE(raster->data_.is<mapnik::image_rgba8>());
+        result.push_back(mapnik::util::get<mapnik::image_rgba8>(raster->data_)(0, 0));
+    }
+    return result;
+}
+
+}
+
+TEST_CASE("raster") {
+
+    std::string raster_plugin("./plugins/input/raster.input");
+    if (mapnik::util::exists(raster_plugin))
+    {
+        SECTION("multi tiles are read from cached pyramid levels")
+        {
+            // 2x2 tiles of 4x4 pixels at level 0, one tile at level 1
+            std::vector<std::string> level0;
+            for (int x = 0; x < 2; ++x)
+            {
+                for (int y = 0; y < 2; ++y)
+                {
+                    level0.push_back(tile_path(0, x, y));
+                    write_tile(level0.back(), 0xff000000 | (x * 0x80) | (y * 0x8000));
+                }
+            }
+            write_tile(tile_path(1, 0, 0), 0xffffffff);
+
+            mapnik::parameters params;
+            params["type"] = "raster";
+            params["file"] = directory + "${z}/${x}_${y}.png";
+            params["format"] = "png";
+            params["multi"] = true;
+            params["x_width"] = mapnik::value_integer(2);
+            params["y_width"] = mapnik::value_integer(2);
+            params["tile_size"] = mapnik::value_integer(4);
+            params["extent"] = "0,0,8,8";
+            params["pyramid_levels"] = mapnik::value_integer(1);
+            params["tile_cache_size"] = mapnik::value_integer(1024 * 1024);
+            auto ds = mapnik::datasource_cache::instance().create(params);
+            REQUIRE(ds != nullptr);
+
+            // tiles are listed column by column from the bottom, tms rows
+            // count from the top
+            std::vector<std::uint32_t> expected = { 0xff008000, 0xff000000, 0xff008080, 0xff000080 };
+            CHECK(colors(ds, 1.0) == expected);
+            CHECK(colors(ds, 0.5) == std::vector<std::uint32_t>{ 0xffffffff });
+
+            // tiles replaced on disk are decoded again
+            for (auto const& path : level0)
+            {
+                std::time_t mtime = boost::filesystem::last_write_time(path);
+                write_tile(path, 0xff0000ff);
+                boost::filesystem::last_write_time(path, mtime + 10);
+            }
+            CHECK(colors(ds, 1.0) == std::vector<std::uint32_t>(4, 0xff0000ff));
+
+            params["file"] = directory + "${x}_${y}.png";
+            CHECK_THROWS(mapnik::datasource_cache::instance().create(params));
+            boost::filesystem::remove_all(directory);
+        }
+    }
+}
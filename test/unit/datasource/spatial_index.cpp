@@ -23,7 +23,12 @@
 #include "catch.hpp"
 
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/packed_rtree.hpp>
 #include <mapnik/util/spatial_index.hpp>
+#include <boost/interprocess/streams/bufferstream.hpp>
+
+#include <algorithm>
+#include <sstream>
 
 TEST_CASE("spatial_index")
 {
@@ -83,5 +88,121 @@ TEST_CASE("spatial_index")
         REQUIRE(results[2] == 3);
         REQUIRE(results[3] == 2);
         REQUIRE(results.size() == 4);
+
+        // query index held in memory
+        std::string buffer = out.str();
+        boost::interprocess::ibufferstream mem(buffer.data(), buffer.size());
+        results.clear();
+        mapnik::util::spatial_index<value_type, filter_in_box, boost::interprocess::ibufferstream>::query(filter, mem, results);
+        REQUIRE(results.size() == 4);
+        REQUIRE(results[0] == 1);
+        REQUIRE(results[1] == 4);
+        REQUIRE(results[2] == 3);
+        REQUIRE(results[3] == 2);
+        results.clear();
+        mem.seekg(0, std::ios::beg);
+        mapnik::util::spatial_index<value_type, filter_in_box, boost::interprocess::ibufferstream>::query_first_n(filter, mem, results, 3);
+        REQUIRE(results.size() == 3);
+        REQUIRE(results[2] == 3);
+
+        // truncated index stops at the last complete node
+        boost::interprocess::ibufferstream truncated(buffer.data(), buffer.size() - 8);
+        results.clear();
+        mapnik::util::spatial_index<value_type, filter_in_box, boost::interprocess::ibufferstream>::query(filter, truncated, results);
+        REQUIRE(results.size() < 4);
+
+        // several boxes in one pass
+        std::vector<filter_in_box> filters;
+        filters.emplace_back(mapnik::box2d<double>(0,0,25,25));
+        filters.emplace_back(mapnik::box2d<double>(25,0,50,50));
+        filters.emplace_back(mapnik::box2d<double>(60,60,100,100));
+        filters.emplace_back(box);
+        std::vector<std::vector<value_type>> batch;
+        in.seekg(0, std::ios::beg);
+        mapnik::util::spatial_index<value_type, filter_in_box, std::istringstream>::query(filters, in, batch);
+        REQUIRE(batch.size() == 4);
+        for (std::size_t i = 0; i < filters.size(); ++i)
+        {
+            std::vector<value_type> single;
+            mem.seekg(0, std::ios::beg);
+            mapnik::util::spatial_index<value_type, filter_in_box, boost::interprocess::ibufferstream>::query(filters[i], mem, single);
+            CHECK(batch[i] == single);
+        }
+        REQUIRE(batch[3].size() == 4);
+        REQUIRE(batch[2].empty());
+    }
+    SECTION("mapnik::packed_rtree<T>")
+    {
+        using value_type = std::pair<std::size_t, std::size_t>;
+        using mapnik::filter_in_box;
+        using box_type = mapnik::box2d<double>;
+        box_type extent(0,0,1000,1000);
+        mapnik::packed_rtree<value_type> tree(extent, 4);
+        std::vector<std::pair<box_type, value_type>> items;
+        unsigned seed = 12345;
+        auto random = [&seed](double max) { seed = seed * 1103515245 + 12345; return (seed >> 8) % 10000 * max / 10000.0; };
+        for (std::size_t i = 0; i < 300; ++i)
+        {
+            double x = random(990);
+            double y = random(990);
+            box_type box(x, y, x + random(10), y + random(10));
+            items.emplace_back(box, value_type(i * 100, 100));
+            tree.insert(items.back().second, box);
+        }
+        REQUIRE(tree.count_items() == 300);
+        REQUIRE(tree.count() == 75 + 19 + 5 + 2 + 1);
+
+        std::ostringstream out(std::ios::binary);
+        tree.write(out);
+        std::string buffer = out.str();
+        REQUIRE(buffer.substr(0, 12) == "mapnik-rtree");
+
+        using index_type = mapnik::util::spatial_index<value_type, filter_in_box, std::istringstream>;
+        using memory_index_type = mapnik::util::spatial_index<value_type, filter_in_box, boost::interprocess::ibufferstream>;
+        std::istringstream in(buffer, std::ios::binary);
+        REQUIRE(mapnik::util::check_spatial_index(in));
+        in.seekg(0, std::ios::beg);
+        REQUIRE(index_type::bounding_box(in) == extent);
+
+        std::vector<box_type> queries = { box_type(0,0,1000,1000), box_type(100,100,300,250),
+                                          box_type(500,0,510,1000), box_type(2000,2000,3000,3000) };
+        for (auto const& query : queries)
+        {
+            std::vector<value_type> expected;
+            for (auto const& item : items)
+            {
+                if (item.first.intersects(query)) expected.push_back(item.second);
+            }
+            std::vector<value_type> results;
+            in.seekg(0, std::ios::beg);
+            index_type::query(filter_in_box(query), in, results);
+            boost::interprocess::ibufferstream mem(buffer.data(), buffer.size());
+            std::vector<value_type> memory_results;
+            memory_index_type::query(filter_in_box(query), mem, memory_results);
+            CHECK(results == memory_results);
+            std::sort(results.begin(), results.end());
+            CHECK(results == expected);
+        }
+
+        std::vector<value_type> results;
+        in.seekg(0, std::ios::beg);
+        index_type::query_first_n(filter_in_box(extent), in, results, 10);
+        REQUIRE(results.size() == 10);
+
+        std::vector<filter_in_box> filters;
+        for (auto const& query : queries) filters.emplace_back(query);
+        std::vector<std::vector<value_type>> batch;
+        in.seekg(0, std::ios::beg);
+        index_type::query(filters, in, batch);
+        REQUIRE(batch.size() == queries.size());
+        REQUIRE(batch[0].size() == items.size());
+        REQUIRE(batch[3].empty());
+
+        // values of another size are rejected
+        using wrong_index_type = mapnik::util::spatial_index<std::int32_t, filter_in_box, std::istringstream>;
+        std::vector<std::int32_t> wrong;
+        in.seekg(0, std::ios::beg);
+        REQUIRE_THROWS(wrong_index_type::query(filter_in_box(extent), in, wrong));
     }
 }
+
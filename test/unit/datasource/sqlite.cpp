@@ -0,0 +1,152 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2015 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "catch.hpp"
+
+#include <mapnik/datasource.hpp>
+#include <mapnik/datasource_cache.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/util/fs.hpp>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string const world("./test/data/sqlite/world.sqlite");
+
+mapnik::datasource_ptr make_datasource(std::string const& table)
+{
+    mapnik::parameters params;
+    params["type"] = "sqlite";
+    params["file"] = world;
+    params["table"] = table;
+    params["geometry_table"] = "world_merc";
+    params["geometry_field"] = "GEOMETRY";
+    params["key_field"] = "OGC_FID";
+    params["max_size"] = mapnik::value_integer(2);
+    auto ds = mapnik::datasource_cache::instance().create(params);
+    REQUIRE(ds != nullptr);
+    return ds;
+}
+
+std::vector<mapnik::value_integer> ids(mapnik::featureset_ptr const& features)
+{
+    std::vector<mapnik::value_integer> result;
+    for (mapnik::feature_ptr feature = features->next(); feature; feature = features->next())
+    {
+        result.push_back(feature->id());
+    }
+    return result;
+}
+
+std::vector<mapnik::value_integer> ids(mapnik::datasource_ptr const& ds, mapnik::box2d<double> const& extent)
+{
+    return ids(ds->features(mapnik::query(extent)));
+}
+
+}
+
+TEST_CASE("sqlite") {
+
+    std::string sqlite_plugin("./plugins/input/sqlite.input");
+    if (mapnik::util::exists(sqlite_plugin) && mapnik::util::exists(world))
+    {
+        SECTION("featuresets read at once share the pooled connections")
+        {
+            auto ds = make_datasource("world_merc");
+            std::vector<mapnik::value_integer> all = ids(ds, ds->envelope());
+            REQUIRE(all.size() == 245);
+
+            // more than max_size open, the others use the own connection
+            std::vector<mapnik::featureset_ptr> featuresets;
+            for (int i = 0; i < 4; ++i)
+            {
+                featuresets.push_back(ds->features(mapnik::query(ds->envelope())));
+                REQUIRE(featuresets.back()->next());
+            }
+            for (auto const& features : featuresets)
+            {
+                CHECK(ids(features).size() == all.size() - 1);
+            }
+            featuresets.clear();
+            CHECK(ids(ds, ds->envelope()) == all);
+        }
+
+        SECTION("the query extent is bound to the prepared statement")
+        {
+            auto ds = make_datasource("world_merc");
+            auto all = ds->features(mapnik::query(ds->envelope()));
+            std::vector<mapnik::box2d<double>> extents = {
+                mapnik::box2d<double>(-2e6, 4e6, 3e6, 8e6),
+                mapnik::box2d<double>(-1.4e7, 2e6, -6e6, 7e6),
+                mapnik::box2d<double>(1e7, -5e6, 1.6e7, -1e6) };
+            std::vector<std::vector<mapnik::value_integer>> expected(extents.size());
+            for (mapnik::feature_ptr feature = all->next(); feature; feature = all->next())
+            {
+                for (std::size_t i = 0; i < extents.size(); ++i)
+                {
+                    if (feature->envelope().intersects(extents[i]))
+                    {
+                        expected[i].push_back(feature->id());
+                    }
+                }
+            }
+            all.reset();
+            // the same statement, run again with another extent each time
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (std::size_t i = 0; i < extents.size(); ++i)
+                {
+                    std::vector<mapnik::value_integer> result = ids(ds, extents[i]);
+                    REQUIRE(!result.empty());
+                    CHECK(result == expected[i]);
+                }
+            }
+        }
+
+        SECTION("statements are prepared again once the cache was cleared")
+        {
+            auto all = ids(make_datasource("world_merc"), mapnik::box2d<double>(-2e7, -2e7, 2e7, 2e7));
+            // each of them with its own statement, more than a connection keeps
+            std::vector<mapnik::datasource_ptr> datasources;
+            for (int i = 0; i < 70; ++i)
+            {
+                datasources.push_back(make_datasource(
+                    "(select * from world_merc where OGC_FID > " + std::to_string(i * 3) + ") as w"));
+            }
+            for (int pass = 0; pass < 2; ++pass)
+            {
+                for (std::size_t i = 0; i < datasources.size(); ++i)
+                {
+                    std::vector<mapnik::value_integer> expected;
+                    for (auto id : all)
+                    {
+                        if (id > static_cast<mapnik::value_integer>(i * 3)) expected.push_back(id);
+                    }
+                    INFO("datasource " << i);
+                    CHECK(ids(datasources[i], datasources[i]->envelope()) == expected);
+                }
+            }
+        }
+    }
+}
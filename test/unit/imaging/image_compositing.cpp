@@ -0,0 +1,141 @@
+#include "catch.hpp"
+
+// mapnik
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/image_compositing.hpp>
+
+#include "agg_color_rgba.h"
+#include "agg_pixfmt_rgba.h"
+
+namespace {
+
+using blender_type = agg::comp_op_adaptor_rgba_pre<agg::rgba8, agg::order_rgba>;
+using multiplier_type = agg::multiplier_rgba<agg::rgba8, agg::order_rgba>;
+
+mapnik::image_rgba8 make_image(std::size_t width, std::size_t height, unsigned seed)
+{
+    mapnik::image_rgba8 im(width, height);
+    unsigned state = seed;
+    auto next = [&state]() { state = state * 1103515245u + 12345u; return (state >> 16) & 0xff; };
+    for (std::size_t y = 0; y < height; ++y)
+    {
+        for (std::size_t x = 0; x < width; ++x)
+        {
+            unsigned a = next();
+            a = a < 64 ? 0 : (a > 192 ? 255 : a);
+            unsigned r = next() * a / 255;
+            unsigned g = next() * a / 255;
+            unsigned b = next() * a / 255;
+            im(x, y) = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+    im.set_premultiplied(true);
+    return im;
+}
+
+std::size_t count_mismatches(mapnik::composite_mode_e mode, float opacity, int dx, int dy,
+                             mapnik::box2d<int> const* extent = nullptr)
+{
+    mapnik::image_rgba8 src = make_image(13, 9, 1);
+    mapnik::image_rgba8 dst = make_image(11, 10, 2);
+    mapnik::image_rgba8 expected(dst);
+    unsigned cover = static_cast<unsigned>(255 * opacity);
+    for (int y = 0; y < static_cast<int>(dst.height()); ++y)
+    {
+        for (int x = 0; x < static_cast<int>(dst.width()); ++x)
+        {
+            int sx = x - dx;
+            int sy = y - dy;
+            if (sx < 0 || sy < 0 || sx >= static_cast<int>(src.width()) || sy >= static_cast<int>(src.height())) continue;
+            if (extent && (sx < extent->minx() || sy < extent->miny() ||
+                           sx >= extent->maxx() || sy >= extent->maxy())) continue;
+            std::uint8_t const* s = reinterpret_cast<std::uint8_t const*>(&src(sx, sy));
+            std::uint8_t * d = reinterpret_cast<std::uint8_t*>(&expected(x, y));
+            blender_type::blend_pix(static_cast<unsigned>(mode), d, s[0], s[1], s[2], s[3], cover);
+        }
+    }
+    if (extent) mapnik::composite(dst, src, *extent, mode, opacity, dx, dy);
+    else mapnik::composite(dst, src, mode, opacity, dx, dy);
+    std::size_t mismatches = 0;
+    for (std::size_t y = 0; y < dst.height(); ++y)
+    {
+        for (std::size_t x = 0; x < dst.width(); ++x)
+        {
+            if (dst(x, y) != expected(x, y)) ++mismatches;
+        }
+    }
+    return mismatches;
+}
+
+}
+
+TEST_CASE("image compositing") {
+
+SECTION("rgba8 matches the agg blenders") {
+
+    mapnik::composite_mode_e const modes[] = {
+        mapnik::src_over, mapnik::dst_over, mapnik::dst_in, mapnik::dst_out,
+        mapnik::plus, mapnik::multiply, mapnik::screen, mapnik::darken };
+    for (auto mode : modes)
+    {
+        for (float opacity : { 1.0f, 0.6f, 0.0f })
+        {
+            CHECK(count_mismatches(mode, opacity, 0, 0) == 0);
+            CHECK(count_mismatches(mode, opacity, 3, -2) == 0);
+            CHECK(count_mismatches(mode, opacity, -5, 4) == 0);
+        }
+    }
+}
+
+SECTION("rgba8 restricted to an extent") {
+
+    mapnik::box2d<int> const extents[] = {
+        mapnik::box2d<int>(2, 1, 9, 7),
+        mapnik::box2d<int>(-4, 3, 5, 20),
+        mapnik::box2d<int>(4, 4, 4, 8) };
+    mapnik::composite_mode_e const modes[] = {
+        mapnik::src_over, mapnik::multiply, mapnik::screen, mapnik::hard_light };
+    for (auto mode : modes)
+    {
+        for (auto const& extent : extents)
+        {
+            CHECK(count_mismatches(mode, 1.0f, 0, 0, &extent) == 0);
+            CHECK(count_mismatches(mode, 0.6f, 3, -2, &extent) == 0);
+        }
+    }
+}
+
+SECTION("premultiply and demultiply match agg") {
+
+    // every color value with every alpha value
+    mapnik::image_rgba8 im(257, 256);
+    for (std::size_t y = 0; y < im.height(); ++y)
+    {
+        for (std::size_t x = 0; x < im.width(); ++x)
+        {
+            unsigned c = x & 0xff;
+            im(x, y) = (static_cast<unsigned>(y) << 24) | (c << 16) | ((255 - c) << 8) | c;
+        }
+    }
+    mapnik::image_rgba8 expected(im);
+    for (auto & pixel : expected)
+    {
+        multiplier_type::premultiply(reinterpret_cast<std::uint8_t*>(&pixel));
+    }
+    mapnik::image_rgba8 premultiplied(im);
+    CHECK(mapnik::premultiply_alpha(premultiplied));
+    CHECK(std::equal(expected.begin(), expected.end(), premultiplied.begin()));
+
+    expected = im;
+    for (auto & pixel : expected)
+    {
+        multiplier_type::demultiply(reinterpret_cast<std::uint8_t*>(&pixel));
+    }
+    mapnik::image_rgba8 demultiplied(im);
+    demultiplied.set_premultiplied(true);
+    CHECK(mapnik::demultiply_alpha(demultiplied));
+    CHECK(std::equal(expected.begin(), expected.end(), demultiplied.begin()));
+}
+
+}
@@ -521,4 +521,32 @@ SECTION("test color-blind-tritanope") {
 
 } // END SECTION
 
+SECTION("test fused and threaded filters") {
+
+    mapnik::image_rgba8 im(512,512);
+    for (std::size_t i = 0; i < im.size(); ++i)
+    {
+        im.bytes()[i] = static_cast<std::uint8_t>((i * 7919) >> 3);
+    }
+    std::string filter("gray,invert,blur,agg-stack-blur(4,2),color-to-alpha(blue),scale-hsla(0,1,0,1,0,1,0.2,0.8),sobel,colorize-alpha(green,blue)");
+    std::vector<mapnik::filter::filter_type> filter_vector;
+    REQUIRE(mapnik::filter::parse_image_filters(filter, filter_vector));
+
+    mapnik::image_rgba8 expected(im);
+    mapnik::filter::filter_visitor<mapnik::image_rgba8> visitor(expected);
+    for (mapnik::filter::filter_type const& filter_tag : filter_vector)
+    {
+        mapnik::util::apply_visitor(visitor, filter_tag);
+    }
+
+    for (unsigned concurrency : { 1u, 2u, 3u, 8u })
+    {
+        mapnik::image_rgba8 out(im);
+        mapnik::filter::apply_filters(out, filter_vector, 1.0, concurrency);
+        CHECK(out.get_premultiplied() == expected.get_premultiplied());
+        CHECK(mapnik::compare(out, expected, 0, true) == 0);
+    }
+
+} // END SECTION
+
 } // END TEST CASE
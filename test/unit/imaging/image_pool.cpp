@@ -0,0 +1,91 @@
+#include "catch.hpp"
+
+#include <mapnik/image_pool.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/color.hpp>
+
+TEST_CASE("image pool") {
+
+SECTION("released images are reused and cleared") {
+
+    mapnik::image_pool<mapnik::image_rgba8> & pool = mapnik::image_pool<mapnik::image_rgba8>::instance();
+    pool.clear();
+    mapnik::image_rgba8 const* address = nullptr;
+    {
+        auto image = pool.acquire(64, 32);
+        REQUIRE(image->width() == 64);
+        REQUIRE(image->height() == 32);
+        address = image.get();
+        mapnik::fill(*image, mapnik::color("red"));
+        image->set_premultiplied(true);
+    }
+    CHECK(pool.size() == 64 * 32 * 4);
+    {
+        auto image = pool.acquire(64, 32);
+        CHECK(image.get() == address);
+        CHECK(pool.size() == 0);
+        CHECK(!image->get_premultiplied());
+        CHECK(mapnik::is_solid(*image));
+        CHECK((*image)(0, 0) == 0);
+        // only the dirty region is cleared on reuse
+        mapnik::fill(*image, mapnik::color("red"));
+        (*image)(0, 0) = 0;
+        image.get_deleter().set_dirty(mapnik::box2d<int>(10, 5, 20, 8));
+    }
+    {
+        auto image = pool.acquire(64, 32);
+        CHECK(image.get() == address);
+        CHECK((*image)(0, 0) == 0);
+        CHECK((*image)(10, 5) == 0);
+        CHECK((*image)(19, 7) == 0);
+        CHECK((*image)(20, 7) == mapnik::color("red").rgba());
+        CHECK((*image)(10, 8) == mapnik::color("red").rgba());
+    }
+    {
+        auto image = pool.acquire(32, 64);
+        CHECK(image.get() != address);
+    }
+    pool.clear();
+    CHECK(pool.size() == 0);
+}
+
+SECTION("capacity limits the retained images") {
+
+    mapnik::image_pool<mapnik::image_rgba8> & pool = mapnik::image_pool<mapnik::image_rgba8>::instance();
+    pool.clear();
+    std::size_t capacity = pool.capacity();
+    pool.set_capacity(0);
+    {
+        auto image = pool.acquire(16, 16);
+    }
+    CHECK(pool.size() == 0);
+    pool.set_capacity(16 * 16 * 4);
+    {
+        auto image1 = pool.acquire(16, 16);
+        auto image2 = pool.acquire(16, 16);
+    }
+    CHECK(pool.size() == 16 * 16 * 4);
+    pool.set_capacity(0);
+    CHECK(pool.size() == 0);
+    pool.set_capacity(capacity);
+}
+
+SECTION("lowering the capacity drops the largest images first") {
+
+    mapnik::image_pool<mapnik::image_rgba8> & pool = mapnik::image_pool<mapnik::image_rgba8>::instance();
+    pool.clear();
+    std::size_t capacity = pool.capacity();
+    pool.set_capacity(1024 * 1024);
+    {
+        // widest but smallest
+        auto wide = pool.acquire(64, 1);
+        auto large = pool.acquire(32, 32);
+    }
+    CHECK(pool.size() == (64 + 32 * 32) * 4);
+    pool.set_capacity(64 * 4);
+    CHECK(pool.size() == 64 * 4);
+    pool.clear();
+    pool.set_capacity(capacity);
+}
+
+}
@@ -0,0 +1,336 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/raster.hpp>
+
+namespace {
+
+mapnik::datasource_ptr make_squares(double offset)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    for (int i = 0; i < 8; ++i)
+    {
+        double x = offset + i * 24;
+        mapnik::geometry::linear_ring<double> ring;
+        ring.emplace_back(x, x);
+        ring.emplace_back(x + 60, x);
+        ring.emplace_back(x + 60, x + 60);
+        ring.emplace_back(x, x + 60);
+        ring.emplace_back(x, x);
+        mapnik::geometry::polygon<double> poly;
+        poly.set_exterior_ring(std::move(ring));
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+        feature->set_geometry(std::move(poly));
+        ds->push(feature);
+    }
+    return ds;
+}
+
+mapnik::Map make_map()
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(200, 220, 255));
+
+    mapnik::color const colors[] = {
+        mapnik::color(255, 0, 0, 180),
+        mapnik::color(0, 128, 0, 200),
+        mapnik::color(0, 0, 255, 128),
+        mapnik::color(255, 200, 0, 255),
+        mapnik::color(90, 0, 90, 100) };
+    mapnik::composite_mode_e const comp_ops[] = {
+        mapnik::multiply, mapnik::src_over, mapnik::screen, mapnik::overlay, mapnik::darken };
+
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+        std::string name("style" + std::to_string(i));
+        mapnik::feature_type_style style;
+        mapnik::rule r;
+        mapnik::polygon_symbolizer poly_sym;
+        mapnik::put(poly_sym, mapnik::keys::fill, colors[i]);
+        r.append(std::move(poly_sym));
+        mapnik::line_symbolizer line_sym;
+        mapnik::put(line_sym, mapnik::keys::stroke_width, 2.0);
+        r.append(std::move(line_sym));
+        style.add_rule(std::move(r));
+        m.insert_style(name, std::move(style));
+
+        mapnik::layer lyr("layer" + std::to_string(i));
+        lyr.set_datasource(make_squares(i * 10.0));
+        lyr.add_style(name);
+        if (i % 2 == 0)
+        {
+            lyr.set_comp_op(comp_ops[i]);
+        }
+        else
+        {
+            // rendered serially in between detached layers
+            lyr.set_opacity(i == 3 ? 1.0 : 0.6);
+        }
+        m.add_layer(lyr);
+    }
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 300, 300));
+    return m;
+}
+
+mapnik::datasource_ptr make_points()
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    for (int i = 0; i < 6; ++i)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, i + 1));
+        feature->set_geometry(mapnik::geometry::point<double>(30 + i * 45, 250 - i * 40));
+        ds->push(feature);
+    }
+    return ds;
+}
+
+void add_polygon_style(mapnik::Map & m, std::string const& name, mapnik::color const& fill)
+{
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::polygon_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::fill, fill);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+}
+
+void add_markers_style(mapnik::Map & m, std::string const& name)
+{
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::allow_overlap, true);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+}
+
+// independent sublayers inside of a layer with its own buffer, which itself
+// is rendered in place because of its markers
+mapnik::Map make_nested_map()
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(200, 220, 255));
+    add_markers_style(m, "markers");
+    add_polygon_style(m, "red", mapnik::color(255, 0, 0, 180));
+    add_polygon_style(m, "blue", mapnik::color(0, 0, 255, 128));
+
+    mapnik::layer parent("parent");
+    parent.set_datasource(make_points());
+    parent.add_style("markers");
+    parent.set_comp_op(mapnik::multiply);
+
+    mapnik::layer red("red");
+    red.set_datasource(make_squares(0.0));
+    red.add_style("red");
+    red.set_comp_op(mapnik::src_over);
+    parent.add_layer(red);
+
+    mapnik::layer blue("blue");
+    blue.set_datasource(make_squares(40.0));
+    blue.add_style("blue");
+    blue.set_opacity(0.6);
+    parent.add_layer(blue);
+
+    m.add_layer(parent);
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 300, 300));
+    return m;
+}
+
+// a gradient raster covering most of the map
+mapnik::datasource_ptr make_raster()
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::image_rgba8 image(64, 64);
+    for (std::size_t y = 0; y < image.height(); ++y)
+    {
+        for (std::size_t x = 0; x < image.width(); ++x)
+        {
+            image(x, y) = mapnik::color(x * 4, y * 4, 128, 200).rgba();
+        }
+    }
+    mapnik::box2d<double> extent(20, 20, 280, 280);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->set_raster(std::make_shared<mapnik::raster>(extent, std::move(image), 1.0));
+    ds->push(feature);
+    ds->set_envelope(extent);
+    return ds;
+}
+
+void add_raster_style(mapnik::Map & m, std::string const& name)
+{
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    r.append(mapnik::raster_symbolizer());
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+}
+
+void add_colliding_markers_style(mapnik::Map & m, std::string const& name,
+                                 mapnik::color const& fill, double size)
+{
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::fill, fill);
+    mapnik::put(sym, mapnik::keys::width, size);
+    mapnik::put(sym, mapnik::keys::height, size);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style(name, std::move(style));
+}
+
+// Marker layers are rendered in place, since their markers collide with
+// each other. The second one is only drawn if the detached layer between
+// them clears the label cache.
+mapnik::Map make_mixed_map(bool clear_label_cache)
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(200, 220, 255));
+    add_raster_style(m, "raster");
+    add_polygon_style(m, "red", mapnik::color(255, 0, 0, 180));
+    add_polygon_style(m, "blue", mapnik::color(0, 0, 255, 128));
+    add_colliding_markers_style(m, "green", mapnik::color(0, 160, 0), 20);
+    add_colliding_markers_style(m, "purple", mapnik::color(128, 0, 128), 10);
+
+    mapnik::layer raster("raster");
+    raster.set_datasource(make_raster());
+    raster.add_style("raster");
+    raster.set_comp_op(mapnik::multiply);
+    m.add_layer(raster);
+
+    mapnik::layer markers("markers");
+    markers.set_datasource(make_points());
+    markers.add_style("green");
+    m.add_layer(markers);
+
+    mapnik::layer red("red");
+    red.set_datasource(make_squares(0.0));
+    red.add_style("red");
+    red.set_comp_op(mapnik::screen);
+    red.set_clear_label_cache(clear_label_cache);
+    m.add_layer(red);
+
+    mapnik::layer more_markers("more markers");
+    more_markers.set_datasource(make_points());
+    more_markers.add_style("purple");
+    m.add_layer(more_markers);
+
+    // a raster layer with its own detached sublayer
+    mapnik::layer faded("faded raster");
+    faded.set_datasource(make_raster());
+    faded.add_style("raster");
+    faded.set_opacity(0.5);
+    mapnik::layer blue("blue");
+    blue.set_datasource(make_squares(40.0));
+    blue.add_style("blue");
+    blue.set_comp_op(mapnik::darken);
+    faded.add_layer(blue);
+    m.add_layer(faded);
+
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 300, 300));
+    return m;
+}
+
+mapnik::image_rgba8 render(mapnik::Map const& m, unsigned concurrency)
+{
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.set_layer_concurrency(concurrency);
+    ren.apply();
+    return im;
+}
+
+}
+
+TEST_CASE("layer concurrency") {
+
+SECTION("detached layers produce the same pixels") {
+
+    mapnik::Map m = make_map();
+
+    mapnik::image_rgba8 serial(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, serial);
+        ren.apply();
+    }
+
+    for (unsigned concurrency : { 2u, 3u, 8u })
+    {
+        mapnik::image_rgba8 parallel(m.width(), m.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, parallel);
+        ren.set_layer_concurrency(concurrency);
+        ren.apply();
+        CHECK(mapnik::compare(serial, parallel, 0, true) == 0);
+    }
+}
+
+SECTION("prefetched features produce the same pixels") {
+
+    mapnik::Map m = make_map();
+
+    mapnik::image_rgba8 serial(m.width(), m.height());
+    {
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, serial);
+        ren.apply();
+    }
+
+    for (unsigned concurrency : { 1u, 4u })
+    {
+        mapnik::image_rgba8 prefetched(m.width(), m.height());
+        mapnik::agg_renderer<mapnik::image_rgba8> ren(m, prefetched);
+        ren.set_prefetch_concurrency(concurrency);
+        ren.set_layer_concurrency(concurrency);
+        ren.apply();
+        CHECK(mapnik::compare(serial, prefetched, 0, true) == 0);
+    }
+}
+
+SECTION("detached sublayers are composited into their parent layer") {
+
+    mapnik::Map m = make_nested_map();
+    mapnik::image_rgba8 serial = render(m, 1);
+    // inside of a red square, away from the markers
+    CHECK(serial(20, 245) != mapnik::color(200, 220, 255).rgba());
+    for (unsigned concurrency : { 2u, 4u })
+    {
+        CHECK(mapnik::compare(serial, render(m, concurrency), 0, true) == 0);
+    }
+}
+
+SECTION("raster and marker layers and cleared label caches") {
+
+    mapnik::Map cleared = make_mixed_map(true);
+    mapnik::Map kept = make_mixed_map(false);
+    mapnik::image_rgba8 serial = render(cleared, 1);
+    mapnik::image_rgba8 serial_kept = render(kept, 1);
+    // the second marker layer is only there once the cache is cleared
+    CHECK(mapnik::compare(serial, serial_kept, 0, true) > 0);
+    for (unsigned concurrency : { 2u, 3u, 8u })
+    {
+        CHECK(mapnik::compare(serial, render(cleared, concurrency), 0, true) == 0);
+        CHECK(mapnik::compare(serial_kept, render(kept, concurrency), 0, true) == 0);
+    }
+}
+
+}
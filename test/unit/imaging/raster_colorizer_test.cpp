@@ -0,0 +1,100 @@
+#include "catch.hpp"
+
+#include <mapnik/raster_colorizer.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/image.hpp>
+
+#include <cstddef>
+#include <limits>
+
+namespace {
+
+template <typename T>
+T make_source(std::initializer_list<double> values)
+{
+    T source(values.size(), 1);
+    std::size_t i = 0;
+    for (double value : values)
+    {
+        source(i++, 0) = static_cast<typename T::pixel_type>(value);
+    }
+    return source;
+}
+
+// colorize must give what get_color gives for every pixel
+template <typename T>
+void check_colorize(mapnik::raster_colorizer const& colorizer, T const& source,
+                    boost::optional<double> const& nodata = boost::optional<double>())
+{
+    mapnik::feature_impl feature(std::make_shared<mapnik::context_type>(), 1);
+    mapnik::image_rgba8 out(source.width(), source.height());
+    colorizer.colorize(out, source, nodata, feature);
+    for (std::size_t x = 0; x < source.width(); ++x)
+    {
+        auto value = source(x, 0);
+        std::uint32_t expected = (nodata && value == *nodata) ? 0 : colorizer.get_color(value);
+        INFO("value " << +value);
+        CHECK(out(x, 0) == expected);
+    }
+}
+
+}
+
+TEST_CASE("raster colorizer") {
+
+SECTION("colorize matches get_color") {
+
+    mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(10, 20, 30, 40));
+    colorizer.add_stop(mapnik::colorizer_stop(-100, mapnik::COLORIZER_INHERIT, mapnik::color(255, 0, 0, 255)));
+    colorizer.add_stop(mapnik::colorizer_stop(0, mapnik::COLORIZER_DISCRETE, mapnik::color(0, 255, 0, 128)));
+    colorizer.add_stop(mapnik::colorizer_stop(10, mapnik::COLORIZER_EXACT, mapnik::color(0, 0, 255, 255)));
+    colorizer.add_stop(mapnik::colorizer_stop(20, mapnik::COLORIZER_LINEAR, mapnik::color(7, 200, 13, 255)));
+    colorizer.add_stop(mapnik::colorizer_stop(250.5, mapnik::COLORIZER_LINEAR, mapnik::color(250, 3, 99, 0)));
+    colorizer.add_stop(mapnik::colorizer_stop(1000, mapnik::COLORIZER_INHERIT, mapnik::color(1, 2, 3, 4)));
+
+    std::initializer_list<double> values = { -32768, -1000, -100, -99.5, -1, 0, 5, 10, 11, 20, 21.7,
+                                             100, 127, 250, 251, 255, 999, 1000, 30000, 65535 };
+    check_colorize(colorizer, make_source<mapnik::image_gray8>({ 0, 1, 9, 10, 20, 21, 100, 250, 251, 255 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray8s>({ -128, -100, -50, -1, 0, 10, 15, 20, 127 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray16>({ 0, 10, 20, 200, 251, 999, 1000, 65535 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray16s>({ -32768, -100, -7, 0, 20, 300, 32767 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray32s>(values));
+    check_colorize(colorizer, make_source<mapnik::image_gray32f>(values));
+    check_colorize(colorizer, make_source<mapnik::image_gray64f>(values));
+    check_colorize(colorizer, make_source<mapnik::image_gray32f>(values), boost::optional<double>(999));
+    check_colorize(colorizer, make_source<mapnik::image_gray16s>({ -7, 0, 20, -9999 }),
+                   boost::optional<double>(-9999));
+    check_colorize(colorizer, make_source<mapnik::image_gray32f>({ std::numeric_limits<float>::quiet_NaN() }));
+
+    // changing the stops is seen by colorize
+    colorizer.set_default_mode(mapnik::COLORIZER_DISCRETE);
+    colorizer.set_default_color(mapnik::color(1, 1, 1, 1));
+    check_colorize(colorizer, make_source<mapnik::image_gray8s>({ -128, -100, -50, -1, 0, 10, 15, 20, 127 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray32f>(values));
+    colorizer.set_stops(mapnik::colorizer_stops());
+    check_colorize(colorizer, make_source<mapnik::image_gray8>({ 0, 255 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray64f>(values));
+}
+
+SECTION("stops out of order are left out") {
+
+    mapnik::raster_colorizer colorizer(mapnik::COLORIZER_LINEAR, mapnik::color(10, 20, 30, 40));
+    mapnik::colorizer_stops stops;
+    stops.emplace_back(10, mapnik::COLORIZER_INHERIT, mapnik::color(255, 0, 0, 255));
+    stops.emplace_back(0, mapnik::COLORIZER_DISCRETE, mapnik::color(0, 255, 0, 128));
+    stops.emplace_back(100, mapnik::COLORIZER_INHERIT, mapnik::color(0, 0, 255, 255));
+    stops.emplace_back(100, mapnik::COLORIZER_EXACT, mapnik::color(7, 200, 13, 255));
+    stops.emplace_back(50, mapnik::COLORIZER_LINEAR, mapnik::color(250, 3, 99, 0));
+    stops.emplace_back(200, mapnik::COLORIZER_DISCRETE, mapnik::color(1, 2, 3, 4));
+    colorizer.set_stops(stops);
+
+    mapnik::colorizer_stops const& kept = colorizer.get_stops();
+    REQUIRE(kept.size() == 3);
+    CHECK(kept[0].get_value() == 10);
+    CHECK(kept[1].get_value() == 100);
+    CHECK(kept[2].get_value() == 200);
+    check_colorize(colorizer, make_source<mapnik::image_gray8>({ 0, 5, 10, 50, 99, 100, 150, 200, 255 }));
+    check_colorize(colorizer, make_source<mapnik::image_gray32f>({ -1, 0, 10, 50, 100, 150, 200, 1000 }));
+}
+
+}
@@ -0,0 +1,170 @@
+#include "catch.hpp"
+
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/params.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/image_pool.hpp>
+#include <mapnik/parse_path.hpp>
+
+#pragma GCC diagnostic push
+#include <mapnik/warning_ignore.hpp>
+#include <boost/filesystem/operations.hpp>
+#pragma GCC diagnostic pop
+
+namespace {
+
+mapnik::datasource_ptr make_square(double x, double y, double size)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::geometry::linear_ring<double> ring;
+    ring.emplace_back(x, y);
+    ring.emplace_back(x + size, y);
+    ring.emplace_back(x + size, y + size);
+    ring.emplace_back(x, y + size);
+    ring.emplace_back(x, y);
+    mapnik::geometry::polygon<double> poly;
+    poly.set_exterior_ring(std::move(ring));
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->set_geometry(std::move(poly));
+    ds->push(feature);
+    return ds;
+}
+
+// overlapping squares, each in its own comp-op style
+mapnik::Map make_map(double size, mapnik::composite_mode_e comp_op)
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(200, 220, 255));
+
+    mapnik::composite_mode_e const comp_ops[] = {
+        mapnik::multiply, mapnik::src_over, comp_op, mapnik::screen };
+    for (std::size_t i = 0; i < 4; ++i)
+    {
+        std::string name("style" + std::to_string(i));
+        mapnik::feature_type_style style;
+        style.set_comp_op(comp_ops[i]);
+        if (i == 1) style.set_opacity(0.5);
+        mapnik::rule r;
+        mapnik::polygon_symbolizer poly_sym;
+        mapnik::put(poly_sym, mapnik::keys::fill, mapnik::color(40 * i, 255 - 40 * i, 90, 200));
+        r.append(std::move(poly_sym));
+        style.add_rule(std::move(r));
+        m.insert_style(name, std::move(style));
+
+        mapnik::layer lyr("layer" + std::to_string(i));
+        lyr.set_datasource(make_square(20.0 * i, 30.0 + 10.0 * i, size));
+        lyr.add_style(name);
+        if (i == 3) lyr.set_comp_op(mapnik::darken);
+        m.add_layer(lyr);
+    }
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 300, 300));
+    return m;
+}
+
+// unscaled png markers are blended into the buffer without the rasterizer
+mapnik::Map make_marker_map(std::string const& marker_file, mapnik::composite_mode_e comp_op)
+{
+    mapnik::Map m(256, 256);
+    m.set_background(mapnik::color(200, 220, 255));
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->set_geometry(mapnik::geometry::point<double>(100, 100));
+    ds->push(feature);
+
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::markers_symbolizer sym;
+    mapnik::put(sym, mapnik::keys::file, mapnik::parse_path(marker_file));
+    mapnik::put(sym, mapnik::keys::allow_overlap, true);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style("markers", std::move(style));
+
+    mapnik::layer lyr("markers");
+    lyr.set_datasource(ds);
+    lyr.add_style("markers");
+    lyr.set_comp_op(comp_op);
+    m.add_layer(lyr);
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 256, 256));
+    return m;
+}
+
+mapnik::image_rgba8 render(mapnik::Map const& m)
+{
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.apply();
+    return im;
+}
+
+}
+
+TEST_CASE("style extent") {
+
+SECTION("untouched parts of style buffers are left alone") {
+
+    mapnik::Map m = make_map(60.0, mapnik::overlay);
+    mapnik::image_rgba8 im = render(m);
+    // outside of the squares
+    CHECK(im(250, 10) == mapnik::color(200, 220, 255).rgba());
+    CHECK(im(5, 250) == mapnik::color(200, 220, 255).rgba());
+    // inside of the first square
+    CHECK(im(10, 200) != mapnik::color(200, 220, 255).rgba());
+}
+
+SECTION("reused buffers are cleared where they were drawn into") {
+
+    // dst-out touches the whole parent buffer
+    mapnik::Map large = make_map(250.0, mapnik::dst_out);
+    mapnik::Map small = make_map(40.0, mapnik::dst_out);
+
+    mapnik::image_pool<mapnik::image_rgba8>::instance().clear();
+    mapnik::image_rgba8 expected = render(small);
+
+    // scratch buffers now come from the pool, dirty from the large squares
+    render(large);
+    mapnik::image_rgba8 reused = render(small);
+    CHECK(mapnik::compare(expected, reused, 0, true) == 0);
+}
+
+SECTION("blended markers are composited and cleared") {
+
+    std::string directory("/tmp/mapnik-tests/style-extent/");
+    boost::filesystem::create_directories(directory);
+    std::string marker_file(directory + "marker.png");
+    mapnik::image_rgba8 marker(16, 16);
+    marker.set(mapnik::color(255, 0, 0).rgba());
+    mapnik::save_to_file(marker, marker_file, "png");
+
+    mapnik::image_pool<mapnik::image_rgba8>::instance().clear();
+    mapnik::image_rgba8 im = render(make_marker_map(marker_file, mapnik::src_over));
+    CHECK(im(100, 156) == mapnik::color(255, 0, 0).rgba());
+    CHECK(im(10, 10) == mapnik::color(200, 220, 255).rgba());
+
+    // the layer buffer holding the marker goes back to the pool, the next
+    // user composites all of it
+    mapnik::Map cleared = make_map(40.0, mapnik::dst_out);
+    mapnik::image_pool<mapnik::image_rgba8>::instance().clear();
+    mapnik::image_rgba8 expected = render(cleared);
+    render(make_marker_map(marker_file, mapnik::src_over));
+    mapnik::image_rgba8 reused = render(cleared);
+    CHECK(mapnik::compare(expected, reused, 0, true) == 0);
+    boost::filesystem::remove_all(directory);
+}
+
+}
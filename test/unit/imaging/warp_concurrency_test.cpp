@@ -0,0 +1,62 @@
+#include "catch.hpp"
+
+#include <mapnik/warp.hpp>
+#include <mapnik/image.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+
+namespace {
+
+template <typename T>
+T make_source(unsigned width, unsigned height)
+{
+    T source(width, height);
+    for (unsigned y = 0; y < height; ++y)
+    {
+        for (unsigned x = 0; x < width; ++x)
+        {
+            source(x, y) = static_cast<typename T::pixel_type>(0xff000000 | ((x * 7) & 0xff) |
+                                                               (((y * 5) & 0xff) << 8) |
+                                                               (((x ^ y) & 0xff) << 16));
+        }
+    }
+    return source;
+}
+
+}
+
+TEST_CASE("warp concurrency") {
+
+SECTION("warping in bands gives the serial result") {
+
+    mapnik::projection source_prj("+init=epsg:4326");
+    mapnik::projection target_prj("+init=epsg:3857");
+    mapnik::proj_transform prj_trans(target_prj, source_prj);
+    mapnik::box2d<double> source_ext(-20, 30, 25, 70);
+    mapnik::box2d<double> target_ext(-2226389.8, 3503549.8, 2783000, 11068715);
+
+    auto rgba = make_source<mapnik::image_rgba8>(400, 300);
+    auto gray = make_source<mapnik::image_gray16>(400, 300);
+    for (auto method : { mapnik::SCALING_NEAR, mapnik::SCALING_BILINEAR, mapnik::SCALING_LANCZOS })
+    {
+        mapnik::image_rgba8 serial(800, 700, true, true);
+        mapnik::image_rgba8 parallel(800, 700, true, true);
+        mapnik::warp_image(serial, rgba, prj_trans, target_ext, source_ext, 0.3, 0.2, 16,
+                           method, 1.0, boost::optional<double>(), 1);
+        mapnik::warp_image(parallel, rgba, prj_trans, target_ext, source_ext, 0.3, 0.2, 16,
+                           method, 1.0, boost::optional<double>(), 4);
+        CHECK(!mapnik::is_solid(serial));
+        CHECK(mapnik::compare(serial, parallel, 0, true) == 0);
+
+        mapnik::image_gray16 gray_serial(800, 700);
+        mapnik::image_gray16 gray_parallel(800, 700);
+        mapnik::warp_image(gray_serial, gray, prj_trans, target_ext, source_ext, 0.3, 0.2, 16,
+                           method, 1.0, boost::optional<double>(0), 1);
+        mapnik::warp_image(gray_parallel, gray, prj_trans, target_ext, source_ext, 0.3, 0.2, 16,
+                           method, 1.0, boost::optional<double>(0), 3);
+        CHECK(mapnik::compare(gray_serial, gray_parallel, 0, true) == 0);
+    }
+}
+
+}
@@ -0,0 +1,137 @@
+#include "catch.hpp"
+// mapnik
+#include <mapnik/json/structural_parser.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/box2d.hpp>
+#include <mapnik/geometry_envelope.hpp>
+// stl
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using boxes_type = std::vector<std::pair<mapnik::box2d<double>, std::pair<std::size_t, std::size_t>>>;
+
+bool parse(std::string const& json, mapnik::feature_impl & feature)
+{
+    mapnik::transcoder tr("utf8");
+    return mapnik::json::parse_feature(json.c_str(), json.c_str() + json.size(), feature, tr);
+}
+
+mapnik::box2d<double> envelope(mapnik::feature_impl const& feature)
+{
+    return mapnik::geometry::envelope(feature.get_geometry());
+}
+
+}
+
+TEST_CASE("geojson structural parser") {
+
+SECTION("feature") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    std::string json = "{ \"type\" : \"Feature\", \"properties\" : { \"name\" : \"caf\\u00e9\\n\", "
+        "\"int\" : -12, \"double\" : 1.5e2, \"flag\" : true, \"none\" : null, \"list\" : [1,2] }, "
+        "\"geometry\" : { \"type\" : \"Polygon\", \"coordinates\" : [[[0,0],[10,0],[10,10],[0,0]]] } }";
+    REQUIRE(parse(json, *feature));
+    REQUIRE(feature->get_geometry().is<mapnik::geometry::polygon<double>>());
+    auto const& poly = mapnik::util::get<mapnik::geometry::polygon<double>>(feature->get_geometry());
+    CHECK(poly.exterior_ring.size() == 4);
+    CHECK(poly.interior_rings.empty());
+    CHECK(envelope(*feature) == mapnik::box2d<double>(0, 0, 10, 10));
+    CHECK(feature->get("name") == mapnik::value_unicode_string("caf\xc3\xa9\n"));
+    CHECK(feature->get("int") == mapnik::value_integer(-12));
+    CHECK(feature->get("double") == 150.0);
+    CHECK(feature->get("flag") == true);
+    CHECK(feature->get("none").is_null());
+    CHECK(feature->get("list").to_string() == "[1,2]");
+}
+
+SECTION("feature with null geometry") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    REQUIRE(parse("{\"type\":\"Feature\",\"geometry\":null,\"properties\":{\"a\":1}}", *feature));
+    CHECK(feature->get_geometry().is<mapnik::geometry::geometry_empty>());
+    CHECK(feature->get("a") == mapnik::value_integer(1));
+}
+
+SECTION("input left to the grammar") {
+
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    std::vector<std::string> inputs = {
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}",
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]},\"properties\":{\"a\":\"\\x\"}}",
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}} trailing",
+        "{\"type\":\"Feature\",\"geometry\":{}}",
+        "{\"type\":\"Point\",\"coordinates\":[1,2]}",
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]},\"properties\":{\"a\":\"open}}"
+    };
+    for (auto const& json : inputs)
+    {
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+        INFO(json);
+        CHECK(!parse(json, *feature));
+        CHECK(feature->get_geometry().is<mapnik::geometry::geometry_empty>());
+        CHECK(feature->size() == 0);
+    }
+}
+
+SECTION("feature collection") {
+
+    mapnik::transcoder tr("utf8");
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    std::vector<mapnik::feature_ptr> features;
+    std::size_t start_id = 1;
+    std::string json = "{\"type\":\"FeatureCollection\",\"features\":["
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]},\"properties\":{\"a\":1}},"
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"LineString\",\"coordinates\":[[1,2],[3,4]]},\"properties\":{\"b\":\"x\"}}"
+        "]}";
+    REQUIRE(mapnik::json::parse_feature_collection(json.c_str(), json.c_str() + json.size(),
+                                                   ctx, start_id, features, tr));
+    REQUIRE(features.size() == 2);
+    CHECK(start_id == 3);
+    CHECK(features[0]->id() == 1);
+    CHECK(features[1]->id() == 2);
+    CHECK(features[0]->get_geometry().is<mapnik::geometry::point<double>>());
+    CHECK(envelope(*features[0]) == mapnik::box2d<double>(1, 2, 1, 2));
+    CHECK(features[1]->get_geometry().is<mapnik::geometry::line_string<double>>());
+    CHECK(envelope(*features[1]) == mapnik::box2d<double>(1, 2, 3, 4));
+    CHECK(features[1]->get("b") == mapnik::value_unicode_string("x"));
+
+    std::string broken = json.substr(0, json.size() - 2);
+    CHECK(!mapnik::json::parse_feature_collection(broken.c_str(), broken.c_str() + broken.size(),
+                                                  ctx, start_id, features, tr));
+    CHECK(features.size() == 2);
+    CHECK(start_id == 3);
+}
+
+SECTION("bounding boxes") {
+
+    std::string json = "{\"type\":\"FeatureCollection\",\"crs\":{\"type\":\"name\"},\"features\":[ "
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}}, "
+        "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[[0,0],[5,-1],[3,4],[0,0]]]}}"
+        "]}";
+    boxes_type boxes;
+    REQUIRE(mapnik::json::extract_bounding_boxes(json.c_str(), json.c_str() + json.size(), boxes));
+    REQUIRE(boxes.size() == 2);
+    CHECK(boxes[0].first == mapnik::box2d<double>(1, 2, 1, 2));
+    CHECK(boxes[1].first == mapnik::box2d<double>(0, -1, 5, 4));
+    for (auto const& item : boxes)
+    {
+        std::string feature = json.substr(item.second.first, item.second.second);
+        CHECK(feature.front() == '{');
+        CHECK(feature.back() == '}');
+    }
+    CHECK(json.substr(boxes[0].second.first, boxes[0].second.second) ==
+          "{\"type\":\"Feature\",\"geometry\":{\"type\":\"Point\",\"coordinates\":[1,2]}}");
+
+    boxes_type none;
+    std::string broken = json.substr(0, json.size() - 2);
+    CHECK(!mapnik::json::extract_bounding_boxes(broken.c_str(), broken.c_str() + broken.size(), none));
+    CHECK(none.empty());
+}
+
+}
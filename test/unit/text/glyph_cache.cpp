@@ -0,0 +1,144 @@
+#include "catch.hpp"
+#include <mapnik/text/glyph_cache.hpp>
+#include <mapnik/memory_datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/expression.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/rule.hpp>
+#include <mapnik/feature_type_style.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/symbolizer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/font_engine_freetype.hpp>
+#include <mapnik/text/placements/dummy.hpp>
+#include <mapnik/text/formatting/text.hpp>
+
+namespace {
+
+mapnik::glyph_cache_key make_key(std::uint32_t glyph_index)
+{
+    mapnik::glyph_cache_key key;
+    key.face_id = mapnik::glyph_cache::instance().face_id("fonts/DejaVuSans.ttf", 0);
+    key.glyph_index = glyph_index;
+    key.size = 12 << 6;
+    key.angle = 0;
+    key.offset_x = 16;
+    key.offset_y = 0;
+    return key;
+}
+
+mapnik::glyph_bitmap_ptr make_bitmap(unsigned width, unsigned rows)
+{
+    auto bitmap = std::make_shared<mapnik::glyph_bitmap>();
+    bitmap->left = 0;
+    bitmap->top = rows;
+    bitmap->width = width;
+    bitmap->rows = rows;
+    bitmap->buffer.assign(width * rows, 255);
+    return bitmap;
+}
+
+// a label at x, y in a 64 x 32 map of 64 x 32 units
+mapnik::image_rgba8 render_label(double x, double y)
+{
+    mapnik::context_ptr ctx = std::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    feature->put_new("name", mapnik::transcoder("utf-8").transcode("Ag"));
+    feature->set_geometry(mapnik::geometry::point<double>(x, y));
+    mapnik::parameters params;
+    params["type"] = "memory";
+    auto ds = std::make_shared<mapnik::memory_datasource>(params);
+    ds->push(feature);
+
+    mapnik::Map m(64, 32);
+    mapnik::layer lyr("layer");
+    lyr.set_datasource(ds);
+    lyr.add_style("style");
+    m.add_layer(lyr);
+    mapnik::feature_type_style style;
+    mapnik::rule r;
+    mapnik::text_symbolizer sym;
+    auto placements = std::make_shared<mapnik::text_placements_dummy>();
+    placements->defaults.format_defaults.face_name = "DejaVu Sans Book";
+    placements->defaults.format_defaults.text_size = 14.0;
+    placements->defaults.format_defaults.fill = mapnik::color(0, 0, 0);
+    placements->defaults.set_format_tree(
+        std::make_shared<mapnik::formatting::text_node>(mapnik::parse_expression("[name]")));
+    mapnik::put<mapnik::text_placements_ptr>(sym, mapnik::keys::text_placements_, placements);
+    r.append(std::move(sym));
+    style.add_rule(std::move(r));
+    m.insert_style("style", std::move(style));
+    m.zoom_to_box(mapnik::box2d<double>(0, 0, 64, 32));
+
+    mapnik::image_rgba8 im(m.width(), m.height());
+    mapnik::agg_renderer<mapnik::image_rgba8> ren(m, im);
+    ren.apply();
+    return im;
+}
+
+}
+
+TEST_CASE("glyph cache") {
+
+    mapnik::glyph_cache & cache = mapnik::glyph_cache::instance();
+    std::size_t capacity = cache.capacity();
+    cache.clear();
+
+    SECTION("the cache is off by default") {
+        CHECK(capacity == 0);
+    }
+
+    SECTION("faces are identified by font file and face index") {
+        CHECK(cache.face_id("fonts/DejaVuSans.ttf", 0) == cache.face_id("fonts/DejaVuSans.ttf", 0));
+        CHECK(cache.face_id("fonts/DejaVuSans.ttf", 0) != cache.face_id("fonts/DejaVuSans-Bold.ttf", 0));
+        // faces of a collection share the file
+        CHECK(cache.face_id("fonts/NotoSansCJK.ttc", 0) != cache.face_id("fonts/NotoSansCJK.ttc", 1));
+    }
+
+    SECTION("least recently used glyphs are evicted") {
+        cache.set_capacity(300);
+        cache.insert(make_key(1), make_bitmap(10, 10));
+        cache.insert(make_key(2), make_bitmap(10, 10));
+        CHECK(cache.size() == 200);
+        // touch the first glyph so the second one goes
+        REQUIRE(cache.find(make_key(1)));
+        cache.insert(make_key(3), make_bitmap(10, 10));
+        cache.insert(make_key(4), make_bitmap(5, 10));
+        CHECK(cache.size() == 250);
+        CHECK(cache.find(make_key(1)));
+        CHECK_FALSE(cache.find(make_key(2)));
+        CHECK(cache.find(make_key(3)));
+        CHECK(cache.find(make_key(4)));
+
+        mapnik::glyph_cache_key other = make_key(4);
+        other.offset_x = 32;
+        CHECK_FALSE(cache.find(other));
+    }
+
+    SECTION("zero capacity disables the cache") {
+        cache.set_capacity(0);
+        cache.insert(make_key(1), make_bitmap(10, 10));
+        CHECK_FALSE(cache.find(make_key(1)));
+        CHECK(cache.size() == 0);
+    }
+
+    SECTION("only cached glyphs are snapped to quarter pixels") {
+        REQUIRE(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf"));
+        // a tenth of a pixel moves uncached glyphs
+        cache.set_capacity(0);
+        mapnik::image_rgba8 exact = render_label(32, 16);
+        CHECK(mapnik::compare(exact, render_label(32.1, 16.1), 0, true) > 0);
+        CHECK(mapnik::compare(exact, render_label(32, 16), 0, true) == 0);
+        // but gives the same cached glyphs
+        cache.set_capacity(16 * 1024 * 1024);
+        mapnik::image_rgba8 snapped = render_label(32, 16);
+        CHECK(mapnik::compare(snapped, render_label(32.1, 16.1), 0, true) == 0);
+        CHECK(cache.size() > 0);
+    }
+
+    cache.clear();
+    cache.set_capacity(capacity);
+}
@@ -22,4 +22,48 @@ TEST_CASE("shapers compile") {
                                 width_map,
                                 fm,
                                 scale_factor);
-}
\ No newline at end of file
+}
+TEST_CASE("shaping cache") {
+
+    REQUIRE(mapnik::freetype_engine::register_font("fonts/dejavu-fonts-ttf-2.37/ttf/DejaVuSans.ttf"));
+    mapnik::font_library fl;
+    mapnik::face_manager fm(fl, mapnik::freetype_engine::get_mapping(), mapnik::freetype_engine::get_cache());
+    mapnik::shaping_cache & cache = mapnik::shaping_cache::instance();
+    cache.clear();
+
+    mapnik::evaluated_format_properties_ptr format(new mapnik::evaluated_format_properties());
+    format->face_name = "DejaVu Sans Book";
+    format->text_size = 10.0;
+
+    auto shape = [&](double scale_factor) {
+        mapnik::text_itemizer itemizer;
+        itemizer.add_text(mapnik::value_unicode_string("Main Street"), format);
+        mapnik::text_line line(0, itemizer.text().length());
+        std::map<unsigned,double> width_map;
+        mapnik::harfbuzz_shaper::shape_text(line, itemizer, width_map, fm, scale_factor);
+        std::vector<std::pair<unsigned, double>> glyphs;
+        for (auto const& glyph : line)
+        {
+            glyphs.emplace_back(glyph.glyph_index, glyph.advance());
+        }
+        return glyphs;
+    };
+
+    auto first = shape(1.0);
+    CHECK(first.size() == 11);
+    CHECK(cache.size() == 1);
+    auto second = shape(1.0);
+    CHECK(cache.size() == 1);
+    CHECK(first == second);
+
+    // shaping results do not depend on the text size
+    auto scaled = shape(2.0);
+    CHECK(cache.size() == 1);
+    REQUIRE(scaled.size() == first.size());
+    for (std::size_t i = 0; i < first.size(); ++i)
+    {
+        CHECK(scaled[i].first == first[i].first);
+        CHECK(scaled[i].second == Approx(first[i].second * 2.0));
+    }
+    cache.clear();
+}
@@ -0,0 +1,81 @@
+#include "catch.hpp"
+
+#include <mapnik/util/lru_cache.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct buffer_size
+{
+    std::size_t operator()(std::vector<char> const& buffer) const
+    {
+        return buffer.size();
+    }
+};
+
+using buffer_cache = mapnik::util::lru_cache<std::string, std::vector<char>, std::hash<std::string>, buffer_size>;
+
+std::shared_ptr<std::vector<char> const> make_buffer(std::size_t size)
+{
+    return std::make_shared<std::vector<char> const>(size);
+}
+
+}
+
+TEST_CASE("lru_cache") {
+
+SECTION("least recently used values are dropped") {
+
+    buffer_cache cache(10);
+    cache.insert("a", make_buffer(6));
+    cache.insert("b", make_buffer(4));
+    CHECK(cache.size() == 10);
+    REQUIRE(cache.find("a"));
+    cache.insert("c", make_buffer(3));
+    CHECK_FALSE(cache.find("b"));
+    CHECK(cache.find("a"));
+    CHECK(cache.find("c"));
+    CHECK(cache.size() == 9);
+
+    // a value larger than the capacity is handed back only
+    auto large = make_buffer(11);
+    CHECK(cache.insert("d", large) == large);
+    CHECK_FALSE(cache.find("d"));
+    CHECK(cache.size() == 0);
+}
+
+SECTION("values are kept once") {
+
+    buffer_cache cache(10);
+    auto first = make_buffer(2);
+    CHECK(cache.insert("a", first) == first);
+    CHECK(cache.insert("a", make_buffer(2)) == first);
+    CHECK(cache.size() == 2);
+
+    cache.insert("b", make_buffer(3));
+    cache.erase_if([](std::string const& key) { return key == "a"; });
+    CHECK_FALSE(cache.find("a"));
+    CHECK(cache.size() == 3);
+    cache.clear();
+    CHECK(cache.size() == 0);
+}
+
+SECTION("capacity") {
+
+    mapnik::util::lru_cache<int, int> cache;
+    cache.insert(1, std::make_shared<int const>(1));
+    CHECK_FALSE(cache.find(1));
+    cache.reserve(2);
+    cache.reserve(1);
+    CHECK(cache.capacity() == 2);
+    cache.insert(1, std::make_shared<int const>(1));
+    cache.insert(2, std::make_shared<int const>(2));
+    CHECK(cache.size() == 2);
+    cache.set_capacity(1);
+    CHECK(cache.size() == 1);
+    CHECK(cache.find(2));
+}
+}
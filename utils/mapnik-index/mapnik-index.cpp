@@ -27,6 +27,7 @@
 
 #include <mapnik/util/fs.hpp>
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/packed_rtree.hpp>
 
 #include "process_csv_file.hpp"
 #include "process_geojson_file.hpp"
@@ -39,6 +40,7 @@
 
 const int DEFAULT_DEPTH = 8;
 const double DEFAULT_RATIO = 0.55;
+const unsigned int DEFAULT_NODE_SIZE = 16;
 
 namespace mapnik { namespace detail {
 
@@ -54,6 +56,16 @@ bool is_geojson(std::string const& filename)
         || boost::iends_with(filename,".json");
 }
 
+template <typename Tree, typename Boxes>
+void insert_boxes(Tree & tree, Boxes const& boxes)
+{
+    for (auto const& item : boxes)
+    {
+        auto ext_f = std::get<0>(item);
+        tree.insert(std::get<1>(item), mapnik::box2d<double>(ext_f.minx(), ext_f.miny(), ext_f.maxx(), ext_f.maxy()));
+    }
+}
+
 }}
 
 int main (int argc, char** argv)
@@ -64,6 +76,8 @@ int main (int argc, char** argv)
     bool validate_features = false;
     unsigned int depth = DEFAULT_DEPTH;
     double ratio = DEFAULT_RATIO;
+    bool packed = false;
+    unsigned int node_size = DEFAULT_NODE_SIZE;
     std::vector<std::string> files;
     char separator = 0;
     char quote = 0;
@@ -77,6 +91,8 @@ int main (int argc, char** argv)
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("format,f",po::value<std::string>(),"index format: quadtree or rtree\n(default quadtree)")
+            ("node-size,n",po::value<unsigned int>(),"rtree node size (default 16)")
             ("separator,s", po::value<char>(), "CSV columns separator")
             ("quote,q", po::value<char>(), "CSV columns quote")
             ("manual-headers,H", po::value<std::string>(), "CSV manual headers string")
@@ -116,6 +132,20 @@ int main (int argc, char** argv)
         {
             ratio = vm["ratio"].as<double>();
         }
+        if (vm.count("format"))
+        {
+            std::string format = vm["format"].as<std::string>();
+            if (format == "rtree") packed = true;
+            else if (format != "quadtree")
+            {
+                std::clog << "Error: unknown index format '" << format << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if (vm.count("node-size"))
+        {
+            node_size = vm["node-size"].as<unsigned int>();
+        }
         if (vm.count("separator"))
         {
             separator = vm["separator"].as<char>();
@@ -160,8 +190,15 @@ int main (int argc, char** argv)
         return EXIT_FAILURE;
     }
 
-    std::clog << "max tree depth:" << depth << std::endl;
-    std::clog << "split ratio:" << ratio << std::endl;
+    if (packed)
+    {
+        std::clog << "packed rtree node size:" << node_size << std::endl;
+    }
+    else
+    {
+        std::clog << "max tree depth:" << depth << std::endl;
+        std::clog << "split ratio:" << ratio << std::endl;
+    }
 
     using box_type = mapnik::box2d<float>;
     using item_type = std::pair<box_type, std::pair<std::size_t, std::size_t>>;
@@ -203,13 +240,6 @@ int main (int argc, char** argv)
         {
             std::clog << extent << std::endl;
             mapnik::box2d<double> extent_d(extent.minx(), extent.miny(), extent.maxx(), extent.maxy());
-            mapnik::quad_tree<std::pair<std::size_t, std::size_t>> tree(extent_d, depth, ratio);
-            for (auto const& item : boxes)
-            {
-                auto ext_f = std::get<0>(item);
-                tree.insert(std::get<1>(item), mapnik::box2d<double>(ext_f.minx(), ext_f.miny(), ext_f.maxx(), ext_f.maxy()));
-            }
-
             std::fstream file((filename + ".index").c_str(),
                               std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
             if (!file)
@@ -219,11 +249,24 @@ int main (int argc, char** argv)
             }
             else
             {
-                tree.trim();
-                std::clog <<  "number nodes=" << tree.count() << std::endl;
-                std::clog <<  "number element=" << tree.count_items() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
-                tree.write(file);
+                if (packed)
+                {
+                    mapnik::packed_rtree<std::pair<std::size_t, std::size_t>> tree(extent_d, node_size);
+                    mapnik::detail::insert_boxes(tree, boxes);
+                    std::clog <<  "number nodes=" << tree.count() << std::endl;
+                    std::clog <<  "number element=" << tree.count_items() << std::endl;
+                    tree.write(file);
+                }
+                else
+                {
+                    mapnik::quad_tree<std::pair<std::size_t, std::size_t>> tree(extent_d, depth, ratio);
+                    mapnik::detail::insert_boxes(tree, boxes);
+                    tree.trim();
+                    std::clog <<  "number nodes=" << tree.count() << std::endl;
+                    std::clog <<  "number element=" << tree.count_items() << std::endl;
+                    tree.write(file);
+                }
                 file.flush();
                 file.close();
             }
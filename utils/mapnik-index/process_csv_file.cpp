@@ -37,9 +37,11 @@
 #include <mapnik/mapped_memory_cache.hpp>
 #endif
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 
 namespace mapnik { namespace detail {
 
@@ -51,6 +53,7 @@ std::pair<bool,typename T::value_type::first_type> process_csv_file(T & boxes, s
     p.manual_headers_ = manual_headers;
     p.separator_ = separator;
     p.quote_ = quote;
+    p.concurrency_ = std::max(1u, std::thread::hardware_concurrency());
 
 #if defined(MAPNIK_MEMORY_MAPPED_FILE)
     using file_source_type = boost::interprocess::ibufferstream;
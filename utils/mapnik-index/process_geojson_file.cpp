@@ -36,6 +36,7 @@
 
 #include <mapnik/json/extract_bounding_box_grammar_impl.hpp>
 #include <mapnik/json/feature_collection_grammar_impl.hpp>
+#include <mapnik/json/structural_parser.hpp>
 
 namespace {
 
@@ -103,7 +104,8 @@ std::pair<bool,typename T::value_type::first_type> process_geojson_file(T & boxe
     auto const* itr = start;
     try
     {
-        if (!boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_bbox_grammar)(boost::phoenix::ref(boxes)) , space))
+        if (!mapnik::json::extract_bounding_boxes(start, end, boxes)
+            && !boost::spirit::qi::phrase_parse(itr, end, (geojson_datasource_static_bbox_grammar)(boost::phoenix::ref(boxes)) , space))
         {
             std::clog << "mapnik-index (GeoJSON) : could not extract bounding boxes from : '" <<  filename <<  "'" << std::endl;
             return std::make_pair(false, extent);
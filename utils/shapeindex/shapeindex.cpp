@@ -26,6 +26,7 @@
 #include <string>
 #include <mapnik/util/fs.hpp>
 #include <mapnik/quad_tree.hpp>
+#include <mapnik/packed_rtree.hpp>
 #include <mapnik/geometry_envelope.hpp>
 #include "shapefile.hpp"
 #include "shape_io.hpp"
@@ -38,6 +39,7 @@
 
 const int DEFAULT_DEPTH = 8;
 const double DEFAULT_RATIO = 0.55;
+const unsigned int DEFAULT_NODE_SIZE = 16;
 
 int main (int argc,char** argv)
 {
@@ -48,6 +50,8 @@ int main (int argc,char** argv)
     bool index_parts = false;
     unsigned int depth = DEFAULT_DEPTH;
     double ratio = DEFAULT_RATIO;
+    bool packed = false;
+    unsigned int node_size = DEFAULT_NODE_SIZE;
     std::vector<std::string> shape_files;
 
     try
@@ -60,6 +64,8 @@ int main (int argc,char** argv)
             ("verbose,v","verbose output")
             ("depth,d", po::value<unsigned int>(), "max tree depth\n(default 8)")
             ("ratio,r",po::value<double>(),"split ratio (default 0.55)")
+            ("format,f",po::value<std::string>(),"index format: quadtree or rtree\n(default quadtree)")
+            ("node-size,n",po::value<unsigned int>(),"rtree node size (default 16)")
             ("shape_files",po::value<std::vector<std::string> >(),"shape files to index: file1 file2 ...fileN")
             ;
 
@@ -96,6 +102,20 @@ int main (int argc,char** argv)
         {
             ratio = vm["ratio"].as<double>();
         }
+        if (vm.count("format"))
+        {
+            std::string format = vm["format"].as<std::string>();
+            if (format == "rtree") packed = true;
+            else if (format != "quadtree")
+            {
+                std::clog << "Error: unknown index format '" << format << "'" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if (vm.count("node-size"))
+        {
+            node_size = vm["node-size"].as<unsigned int>();
+        }
 
         if (vm.count("shape_files"))
         {
@@ -108,8 +128,15 @@ int main (int argc,char** argv)
         return EXIT_FAILURE;
     }
 
-    std::clog << "max tree depth:" << depth << std::endl;
-    std::clog << "split ratio:" << ratio << std::endl;
+    if (packed)
+    {
+        std::clog << "packed rtree node size:" << node_size << std::endl;
+    }
+    else
+    {
+        std::clog << "max tree depth:" << depth << std::endl;
+        std::clog << "split ratio:" << ratio << std::endl;
+    }
 
     if (shape_files.size() == 0)
     {
@@ -172,6 +199,12 @@ int main (int argc,char** argv)
         int pos = 50;
         shx.seek(pos * 2);
         mapnik::quad_tree<mapnik::detail::node> tree(extent, depth, ratio);
+        mapnik::packed_rtree<mapnik::detail::node> rtree(extent, node_size);
+        auto insert = [&](mapnik::detail::node const& item, box2d<double> const& box)
+        {
+            if (packed) rtree.insert(item, box);
+            else tree.insert(item, box);
+        };
         int count = 0;
 
         if (shape_type != shape_io::shape_null)
@@ -234,7 +267,7 @@ int main (int argc,char** argv)
                             {
                                 std::clog << "record number " << record_number << " box=" << item_ext << std::endl;
                             }
-                            tree.insert(mapnik::detail::node(offset * 2, start, end),item_ext);
+                            insert(mapnik::detail::node(offset * 2, start, end),item_ext);
                             ++count;
                         }
                     }
@@ -251,7 +284,7 @@ int main (int argc,char** argv)
                     {
                         std::clog << "record number " << record_number << " box=" << item_ext << std::endl;
                     }
-                    tree.insert(mapnik::detail::node(offset * 2,-1,0),item_ext);
+                    insert(mapnik::detail::node(offset * 2,-1,0),item_ext);
                     ++count;
                 }
             }
@@ -268,10 +301,18 @@ int main (int argc,char** argv)
             }
             else
             {
-                tree.trim();
-                std::clog << " number nodes=" << tree.count() << std::endl;
                 file.exceptions(std::ios::failbit | std::ios::badbit);
-                tree.write(file);
+                if (packed)
+                {
+                    std::clog << " number nodes=" << rtree.count() << std::endl;
+                    rtree.write(file);
+                }
+                else
+                {
+                    tree.trim();
+                    std::clog << " number nodes=" << tree.count() << std::endl;
+                    tree.write(file);
+                }
                 file.flush();
                 file.close();
             }